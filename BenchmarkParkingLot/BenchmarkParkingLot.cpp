@@ -0,0 +1,1084 @@
+#include "benchmark/benchmark.h"
+
+#include "ParkingLot.h"
+#include "Car.h"
+#include "NullEventSink.h"
+#include "ParkingSiteManager.h"
+#include "BinaryLog.h"
+#include "ColumnarExport.h"
+#include "LatencyHistogram.h"
+#include "OccupancyAnalytics.h"
+#include "OccupancyForecaster.h"
+#include "TariffTable.h"
+#include "ZonedBayAllocator.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    /// \brief Big enough for the highest occupancy level used below
+    const int kBenchmarkCapacity = 100000;
+
+    std::shared_ptr<ParkingLot> getBenchmarkLot()
+    {
+        std::shared_ptr<ParkingLot> parking_lot = ParkingLot::getInstance(kBenchmarkCapacity, kBenchmarkCapacity, kBenchmarkCapacity);
+
+        // Printing the events would dominate the measurement
+        parking_lot->setEventSink(std::make_shared<NullEventSink>());
+        return parking_lot;
+    }
+
+    /// \brief Parks the given number of cars and releases them when it goes out of scope
+    class Occupancy
+    {
+    public:
+        Occupancy(const std::shared_ptr<ParkingLot> & parking_lot, int count)
+            : m_parking_lot(parking_lot)
+        {
+            for (int i = 0; i < count; ++i)
+            {
+                m_license_plates.push_back("OCC" + std::to_string(i));
+                m_parking_lot->parkVehicle(std::make_shared<Car>(m_license_plates.back(), 1.0));
+            }
+        }
+
+        ~Occupancy()
+        {
+            for (const auto & license_plate : m_license_plates)
+            {
+                m_parking_lot->releaseVehicleByLicensePlate(license_plate);
+            }
+        }
+
+    private:
+        std::shared_ptr<ParkingLot> m_parking_lot;
+        std::vector<std::string> m_license_plates;
+    };
+}
+
+static void BM_ParkAndReleaseByTicketID(benchmark::State & state)
+{
+    std::shared_ptr<ParkingLot> parking_lot = getBenchmarkLot();
+    Occupancy occupancy(parking_lot, static_cast<int>(state.range(0)));
+    std::shared_ptr<Vehicle> car = std::make_shared<Car>("BENCH", 1.0);
+
+    for (auto _ : state)
+    {
+        parking_lot->parkVehicle(car);
+        parking_lot->releaseVehicleByTicketID(parking_lot->getTicketIDByLicensePlate("BENCH"));
+    }
+}
+BENCHMARK(BM_ParkAndReleaseByTicketID)->Arg(0)->Arg(1000)->Arg(10000)->Arg(50000);
+
+static void BM_ParkAndReleaseByLicensePlate(benchmark::State & state)
+{
+    std::shared_ptr<ParkingLot> parking_lot = getBenchmarkLot();
+    Occupancy occupancy(parking_lot, static_cast<int>(state.range(0)));
+    std::shared_ptr<Vehicle> car = std::make_shared<Car>("BENCH", 1.0);
+
+    for (auto _ : state)
+    {
+        parking_lot->parkVehicle(car);
+        parking_lot->getTicketIDByLicensePlate("BENCH");
+        parking_lot->releaseVehicleByLicensePlate("BENCH");
+    }
+}
+BENCHMARK(BM_ParkAndReleaseByLicensePlate)->Arg(0)->Arg(1000)->Arg(10000)->Arg(50000);
+
+static void BM_ParkAndReleaseConcurrent(benchmark::State & state)
+{
+    std::shared_ptr<ParkingLot> parking_lot = getBenchmarkLot();
+    std::shared_ptr<Vehicle> car = std::make_shared<Car>("BENCH" + std::to_string(state.thread_index()), 1.0);
+
+    for (auto _ : state)
+    {
+        parking_lot->parkVehicle(car);
+        parking_lot->releaseVehicleByLicensePlate(car->getLicensePlate());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ParkAndReleaseConcurrent)->ThreadRange(1, 8)->UseRealTime();
+
+static void BM_ParkAndReleaseOneByOne(benchmark::State & state)
+{
+    std::shared_ptr<ParkingLot> parking_lot = getBenchmarkLot();
+    std::vector<std::shared_ptr<Vehicle>> vehicles;
+    std::vector<std::string> license_plates;
+    for (int i = 0; i < state.range(0); ++i)
+    {
+        license_plates.push_back("BURST" + std::to_string(i));
+        vehicles.push_back(std::make_shared<Car>(license_plates.back(), 1.0));
+    }
+
+    for (auto _ : state)
+    {
+        for (const auto & vehicle : vehicles)
+        {
+            parking_lot->parkVehicle(vehicle);
+        }
+        for (const auto & license_plate : license_plates)
+        {
+            parking_lot->releaseVehicleByLicensePlate(license_plate);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ParkAndReleaseOneByOne)->Arg(50)->Arg(500);
+
+static void BM_ParkAndReleaseInBulk(benchmark::State & state)
+{
+    std::shared_ptr<ParkingLot> parking_lot = getBenchmarkLot();
+    std::vector<std::shared_ptr<Vehicle>> vehicles;
+    std::vector<std::string> license_plates;
+    for (int i = 0; i < state.range(0); ++i)
+    {
+        license_plates.push_back("BURST" + std::to_string(i));
+        vehicles.push_back(std::make_shared<Car>(license_plates.back(), 1.0));
+    }
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(parking_lot->parkVehicles(vehicles));
+        benchmark::DoNotOptimize(parking_lot->releaseVehicles(license_plates));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ParkAndReleaseInBulk)->Arg(50)->Arg(500);
+
+static void BM_ReleaseUnknownThrowing(benchmark::State & state)
+{
+    std::shared_ptr<ParkingLot> parking_lot = getBenchmarkLot();
+    for (auto _ : state)
+    {
+        try
+        {
+            parking_lot->releaseVehicleByLicensePlate("UNKNOWN");
+        }
+        catch (const std::exception & e)
+        {
+            benchmark::DoNotOptimize(e.what());
+        }
+    }
+}
+BENCHMARK(BM_ReleaseUnknownThrowing);
+
+static void BM_ReleaseUnknownNonThrowing(benchmark::State & state)
+{
+    std::shared_ptr<ParkingLot> parking_lot = getBenchmarkLot();
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(parking_lot->tryReleaseVehicleByLicensePlate("UNKNOWN"));
+    }
+}
+BENCHMARK(BM_ReleaseUnknownNonThrowing);
+
+
+static void BM_OccupancySnapshot(benchmark::State & state)
+{
+    std::shared_ptr<ParkingLot> parking_lot = getBenchmarkLot();
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(parking_lot->getOccupancySnapshot());
+    }
+}
+BENCHMARK(BM_OccupancySnapshot);
+
+static void BM_ParkAndReleaseWhilePolling(benchmark::State & state)
+{
+    std::shared_ptr<ParkingLot> parking_lot = getBenchmarkLot();
+    std::shared_ptr<Vehicle> car = std::make_shared<Car>("BENCH", 1.0);
+
+    // Signage boards polling the occupancy as fast as they can
+    std::atomic<bool> stop{ false };
+    std::atomic<long long> polls{ 0 };
+    std::vector<std::thread> readers;
+    for (int i = 0; i < state.range(0); ++i)
+    {
+        readers.emplace_back([&parking_lot, &stop, &polls]()
+        {
+            long long count = 0;
+            while (!stop.load(std::memory_order_relaxed))
+            {
+                benchmark::DoNotOptimize(parking_lot->getOccupancySnapshot());
+                ++count;
+            }
+            polls.fetch_add(count);
+        });
+    }
+
+    for (auto _ : state)
+    {
+        parking_lot->tryParkVehicle(car);
+        parking_lot->tryReleaseVehicleByLicensePlate("BENCH");
+    }
+
+    stop.store(true);
+    for (auto & reader : readers)
+    {
+        reader.join();
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["polls"] = benchmark::Counter(static_cast<double>(polls.load()), benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_ParkAndReleaseWhilePolling)->Arg(0)->Arg(1)->Arg(4)->UseRealTime();
+
+static void BM_ParkedVehicleSnapshot(benchmark::State & state)
+{
+    std::shared_ptr<ParkingLot> parking_lot = getBenchmarkLot();
+    Occupancy occupancy(parking_lot, static_cast<int>(state.range(0)));
+    for (auto _ : state)
+    {
+        // A report listing all buses
+        ParkedVehicleSnapshot snapshot = parking_lot->getParkedVehicleSnapshot();
+        benchmark::DoNotOptimize(std::count_if(snapshot.begin(), snapshot.end(), [](const ParkedRecord & record) { return record.type == VehicleType::Bus; }));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ParkedVehicleSnapshot)->Arg(1000)->Arg(50000)->Unit(benchmark::kMicrosecond);
+
+static void BM_ParkAndReleaseWhileExporting(benchmark::State & state)
+{
+    std::shared_ptr<ParkingLot> parking_lot = getBenchmarkLot();
+    Occupancy occupancy(parking_lot, 50000);
+    std::shared_ptr<Vehicle> car = std::make_shared<Car>("BENCH", 1.0);
+
+    // Reports going through all parked vehicles one after another
+    std::atomic<bool> stop{ false };
+    std::atomic<long long> exports{ 0 };
+    std::vector<std::thread> exporters;
+    for (int i = 0; i < state.range(0); ++i)
+    {
+        exporters.emplace_back([&parking_lot, &stop, &exports]()
+        {
+            long long count = 0;
+            while (!stop.load(std::memory_order_relaxed))
+            {
+                ParkedVehicleSnapshot snapshot = parking_lot->getParkedVehicleSnapshot();
+                benchmark::DoNotOptimize(std::count_if(snapshot.begin(), snapshot.end(), [&snapshot](const ParkedRecord & record)
+                {
+                    return snapshot.timeUs() - record.entry_time_us > 24ll * 3600 * 1000000;
+                }));
+                ++count;
+            }
+            exports.fetch_add(count);
+        });
+    }
+
+    for (auto _ : state)
+    {
+        parking_lot->tryParkVehicle(car);
+        parking_lot->tryReleaseVehicleByLicensePlate("BENCH");
+    }
+
+    stop.store(true);
+    for (auto & exporter : exporters)
+    {
+        exporter.join();
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["exports"] = benchmark::Counter(static_cast<double>(exports.load()), benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_ParkAndReleaseWhileExporting)->Arg(0)->Arg(1)->UseRealTime();
+
+static void BM_ParkAndReleaseSitePerThread(benchmark::State & state)
+{
+    // Shared by all threads of all runs, every thread works on its own site
+    static ParkingSiteManager manager;
+    static std::once_flag sites_added;
+    std::call_once(sites_added, []()
+    {
+        for (int site_id = 0; site_id < 8; ++site_id)
+        {
+            manager.addSite(site_id, kBenchmarkCapacity, kBenchmarkCapacity, kBenchmarkCapacity);
+            manager.site(site_id).setEventSink(std::make_shared<NullEventSink>());
+        }
+    });
+
+    ParkingLot & site = manager.site(state.thread_index());
+    std::shared_ptr<Vehicle> car = std::make_shared<Car>("BENCH", 1.0);
+    for (auto _ : state)
+    {
+        site.tryParkVehicle(car);
+        site.tryReleaseVehicleByLicensePlate("BENCH");
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ParkAndReleaseSitePerThread)->ThreadRange(1, 8)->UseRealTime();
+
+namespace
+{
+    /// \brief Journal with one million park and release records, written once for all runs
+    JournalConfig getRecoveryJournal()
+    {
+        JournalConfig config;
+        config.directory = "bench_journal_source";
+        config.sync = false;
+        config.snapshot_interval = 0;
+
+        static std::once_flag journal_written;
+        std::call_once(journal_written, [&config]()
+        {
+            std::filesystem::remove_all(config.directory);
+            std::filesystem::create_directory(config.directory);
+
+            ParkingSiteManager manager;
+            ParkingLot & site = *manager.addSite(0, kBenchmarkCapacity, kBenchmarkCapacity, kBenchmarkCapacity);
+            site.setEventSink(std::make_shared<NullEventSink>());
+            site.openJournal(config);
+
+            // 525k arrivals and 475k departures, the last 50k vehicles stay parked
+            const int kVehicles = 525000;
+            const int kStaying = 50000;
+            for (int i = 0; i < kVehicles; ++i)
+            {
+                site.tryParkVehicle(std::make_shared<Car>("REC" + std::to_string(i), 1.0));
+                if (i >= kStaying)
+                {
+                    site.tryReleaseVehicleByLicensePlate("REC" + std::to_string(i - kStaying));
+                }
+            }
+        });
+        return config;
+    }
+}
+
+static void BM_RecoverOneMillionJournalRecords(benchmark::State & state)
+{
+    JournalConfig source = getRecoveryJournal();
+    JournalConfig config = source;
+    config.directory = "bench_journal_recovery";
+
+    std::size_t journal_records = 0;
+    for (auto _ : state)
+    {
+        // Recovery rewrites the files, every run starts from a copy
+        state.PauseTiming();
+        std::filesystem::remove_all(config.directory);
+        std::filesystem::copy(source.directory, config.directory);
+        std::unique_ptr<ParkingSiteManager> manager(new ParkingSiteManager());
+        ParkingLot & site = *manager->addSite(0, kBenchmarkCapacity, kBenchmarkCapacity, kBenchmarkCapacity);
+        state.ResumeTiming();
+
+        journal_records = site.openJournal(config).journal_records;
+
+        state.PauseTiming();
+        manager.reset();
+        state.ResumeTiming();
+    }
+    state.counters["journal_records"] = static_cast<double>(journal_records);
+}
+BENCHMARK(BM_RecoverOneMillionJournalRecords)->Unit(benchmark::kMillisecond)->Iterations(3);
+
+static void BM_CalculateCharges(benchmark::State & state)
+{
+    TariffTable tariffs;
+    tariffs.setBand(VehicleType::Car, 22, 6, 0.5);
+
+    // End-of-day settlement of one million closed tickets
+    ClosedTickets tickets;
+    const std::int64_t kStart = 1700000000LL * 1000000;
+    for (int i = 0; i < 1000000; ++i)
+    {
+        std::int64_t entry_time_us = kStart + static_cast<std::int64_t>(i) * 86400;
+        tickets.add(static_cast<VehicleType>(i % kVehicleTypeCount), entry_time_us, entry_time_us + static_cast<std::int64_t>(i % 600) * 60 * 1000000);
+    }
+    std::vector<double> charges(tickets.size());
+
+    for (auto _ : state)
+    {
+        tariffs.calculateCharges(tickets, charges.data());
+        benchmark::DoNotOptimize(charges.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(tickets.size()));
+}
+BENCHMARK(BM_CalculateCharges)->Unit(benchmark::kMillisecond);
+
+namespace
+{
+    const std::int64_t kBookingHour = 3600LL * 1000000;
+
+    /// \brief Books the given number of cars for 1 to 4 hours at random times of the next 89 days
+    void bookRandomBays(ParkingLot & site, const int count, std::mt19937_64 & rng)
+    {
+        std::int64_t now_us = systemClockMicroseconds();
+        std::uniform_int_distribution<std::int64_t> start(kBookingHour, 89 * 24 * kBookingHour);
+        std::uniform_int_distribution<std::int64_t> hours(1, 4);
+        for (int i = 0; i < count; ++i)
+        {
+            std::int64_t from_us = now_us + start(rng);
+            site.tryBookBay(VehicleType::Car, "BOOK" + std::to_string(i), from_us, from_us + hours(rng) * kBookingHour);
+        }
+    }
+}
+
+// Whether a car bay is free during a 4 hour interval, with up to one million future bookings
+static void BM_BookableBays(benchmark::State & state)
+{
+    ParkingSiteManager manager;
+    ParkingLot & site = *manager.addSite(0, kBenchmarkCapacity, kBenchmarkCapacity, kBenchmarkCapacity);
+    std::mt19937_64 rng(1);
+    bookRandomBays(site, static_cast<int>(state.range(0)), rng);
+
+    std::int64_t now_us = systemClockMicroseconds();
+    std::uniform_int_distribution<std::int64_t> start(kBookingHour, 85 * 24 * kBookingHour);
+    for (auto _ : state)
+    {
+        std::int64_t from_us = now_us + start(rng);
+        benchmark::DoNotOptimize(site.getBookableBays(VehicleType::Car, from_us, from_us + 4 * kBookingHour));
+    }
+}
+BENCHMARK(BM_BookableBays)->Arg(0)->Arg(1000)->Arg(1000000);
+
+// Books and cancels a bay, with up to one million future bookings
+static void BM_BookAndCancel(benchmark::State & state)
+{
+    ParkingSiteManager manager;
+    ParkingLot & site = *manager.addSite(0, kBenchmarkCapacity, kBenchmarkCapacity, kBenchmarkCapacity);
+    std::mt19937_64 rng(1);
+    bookRandomBays(site, static_cast<int>(state.range(0)), rng);
+
+    std::int64_t now_us = systemClockMicroseconds();
+    std::uniform_int_distribution<std::int64_t> start(kBookingHour, 85 * 24 * kBookingHour);
+    for (auto _ : state)
+    {
+        std::int64_t from_us = now_us + start(rng);
+        site.cancelBooking(site.tryBookBay(VehicleType::Car, "BENCH", from_us, from_us + 4 * kBookingHour));
+    }
+}
+BENCHMARK(BM_BookAndCancel)->Arg(0)->Arg(1000)->Arg(1000000);
+
+// Walk-ins while bookings exist take the lock-free path unless the time bucket changes
+static void BM_ParkAndReleaseWithBookings(benchmark::State & state)
+{
+    ParkingSiteManager manager;
+    ParkingLot & site = *manager.addSite(0, kBenchmarkCapacity, kBenchmarkCapacity, kBenchmarkCapacity);
+    site.setEventSink(std::make_shared<NullEventSink>());
+    std::mt19937_64 rng(1);
+    bookRandomBays(site, static_cast<int>(state.range(0)), rng);
+
+    auto car = std::make_shared<Car>("WALKIN", 2.0);
+    for (auto _ : state)
+    {
+        site.tryParkVehicle(car);
+        site.tryReleaseVehicleByLicensePlate("WALKIN");
+    }
+}
+BENCHMARK(BM_ParkAndReleaseWithBookings)->Arg(0)->Arg(1000000);
+
+namespace
+{
+    /// \brief License plate like AB-123-CD from a random number
+    std::string randomLicensePlate(std::mt19937_64 & rng)
+    {
+        std::uniform_int_distribution<int> letter('A', 'Z');
+        std::uniform_int_distribution<int> digit('0', '9');
+        std::string license_plate = "AB-123-CD";
+        for (char & character : license_plate)
+        {
+            character = character == '-' ? '-' : static_cast<char>(character >= 'A' ? letter(rng) : digit(rng));
+        }
+        return license_plate;
+    }
+
+    /// \brief Parks 100k cars with random license plates and returns the plates
+    std::vector<std::string> fillWithRandomLicensePlates(ParkingLot & site, std::mt19937_64 & rng)
+    {
+        std::vector<std::string> license_plates;
+        while (license_plates.size() < 100000)
+        {
+            std::string license_plate = randomLicensePlate(rng);
+            if (site.tryParkVehicle(std::make_shared<Car>(license_plate, 1.0)).succeeded())
+            {
+                license_plates.push_back(license_plate);
+            }
+        }
+        return license_plates;
+    }
+}
+
+// Searches a misread license plate on a 100k car lot, the argument is the number of wrong characters allowed
+static void BM_ApproximateLicensePlateSearch(benchmark::State & state)
+{
+    ParkingSiteManager manager;
+    ParkingLot & site = *manager.addSite(0, kBenchmarkCapacity, kBenchmarkCapacity, kBenchmarkCapacity);
+    site.setEventSink(std::make_shared<NullEventSink>());
+    std::mt19937_64 rng(1);
+    std::vector<std::string> license_plates = fillWithRandomLicensePlates(site, rng);
+
+    // Every read has one character replaced
+    std::vector<std::string> reads;
+    for (std::size_t i = 0; i < 1000; ++i)
+    {
+        std::string read = license_plates[i * 97];
+        read[i % read.size()] = read[i % read.size()] == '-' ? ' ' : '8';
+        reads.push_back(read);
+    }
+
+    std::size_t i = 0;
+    std::size_t found = 0;
+    for (auto _ : state)
+    {
+        found += site.findVehiclesByApproximateLicensePlate(reads[i++ % reads.size()], static_cast<int>(state.range(0))).size();
+    }
+    state.counters["matches"] = benchmark::Counter(static_cast<double>(found), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_ApproximateLicensePlateSearch)->Arg(1)->Arg(2);
+
+// Searches the first characters of a license plate on a 100k car lot
+static void BM_LicensePlatePrefixSearch(benchmark::State & state)
+{
+    ParkingSiteManager manager;
+    ParkingLot & site = *manager.addSite(0, kBenchmarkCapacity, kBenchmarkCapacity, kBenchmarkCapacity);
+    site.setEventSink(std::make_shared<NullEventSink>());
+    std::mt19937_64 rng(1);
+    std::vector<std::string> license_plates = fillWithRandomLicensePlates(site, rng);
+
+    std::size_t i = 0;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(site.findVehiclesByLicensePlatePrefix(std::string_view(license_plates[i++ % license_plates.size()]).substr(0, 5)));
+    }
+}
+BENCHMARK(BM_LicensePlatePrefixSearch);
+
+// "Peak occupancy last hour" and "p95 dwell today" after up to a million vehicles came and went during the day
+static void BM_AnalyticsQueries(benchmark::State & state)
+{
+    const std::int64_t kMinute = 60LL * 1000000;
+    OccupancyAnalytics analytics;
+    std::mt19937_64 rng(1);
+    std::uniform_int_distribution<std::int64_t> dwell(5 * kMinute, 10 * 60 * kMinute);
+    std::int64_t now_us = systemClockMicroseconds();
+    std::int64_t start_us = now_us - 24 * 60 * kMinute;
+    std::int64_t count = state.range(0);
+    for (std::int64_t i = 0; i < count; ++i)
+    {
+        ParkingEvent event;
+        event.type = ParkingEventType::Released;
+        event.vehicle_type = VehicleType::Bus;
+        event.exit_time_us = start_us + (now_us - start_us) * i / count;
+        event.entry_time_us = event.exit_time_us - dwell(rng);
+        analytics.record(event, static_cast<int>(i % 1000));
+    }
+
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(analytics.getPeakOccupancy(VehicleType::Bus, 60 * kMinute, now_us));
+        benchmark::DoNotOptimize(analytics.getDwellTimes(VehicleType::Bus, 24 * 60 * kMinute, now_us).percentile(95));
+    }
+}
+BENCHMARK(BM_AnalyticsQueries)->Arg(0)->Arg(1000000);
+
+namespace
+{
+    /// \brief A park or release of a month of synthetic traffic, with the occupancy of its type after it
+    struct TrafficEvent
+    {
+        std::int64_t time_us;
+        int occupancy;
+        VehicleType type;
+        bool released;
+    };
+
+    /// \brief Poisson arrivals with a morning peak and two hour stays on average, about two million events
+    std::vector<TrafficEvent> makeOneMonthOfTraffic()
+    {
+        const std::int64_t kMinute = 60LL * 1000000;
+        const std::array<double, kVehicleTypeCount> kArrivalsPerMinute = { 20.0, 4.0, 1.0 };
+        std::mt19937_64 rng(1);
+        std::exponential_distribution<double> dwell_minutes(1.0 / 120);
+        std::uniform_int_distribution<std::int64_t> within_minute(0, kMinute - 1);
+        std::vector<TrafficEvent> events;
+        std::array<int, kVehicleTypeCount> occupancy = {};
+        std::priority_queue<std::pair<std::int64_t, VehicleType>, std::vector<std::pair<std::int64_t, VehicleType>>, std::greater<std::pair<std::int64_t, VehicleType>>> departures;
+
+        std::int64_t start = 1700000000LL * 1000000;
+        for (std::int64_t minute = 0; minute < 30 * 24 * 60; ++minute)
+        {
+            std::int64_t minute_start = start + minute * kMinute;
+            double peak = minute % (24 * 60) >= 7 * 60 && minute % (24 * 60) < 10 * 60 ? 3.0 : 1.0;
+            std::size_t first = events.size();
+            for (std::size_t type = 0; type < kVehicleTypeCount; ++type)
+            {
+                std::poisson_distribution<int> arrivals(kArrivalsPerMinute[type] * peak);
+                for (int count = arrivals(rng); count > 0; --count)
+                {
+                    std::int64_t entry = minute_start + within_minute(rng);
+                    events.push_back(TrafficEvent{ entry, 0, static_cast<VehicleType>(type), false });
+                    departures.emplace(entry + static_cast<std::int64_t>(dwell_minutes(rng) * kMinute), static_cast<VehicleType>(type));
+                }
+            }
+            for (; !departures.empty() && departures.top().first < minute_start + kMinute; departures.pop())
+            {
+                events.push_back(TrafficEvent{ departures.top().first, 0, departures.top().second, true });
+            }
+            std::sort(events.begin() + first, events.end(), [](const TrafficEvent & a, const TrafficEvent & b) { return a.time_us < b.time_us; });
+            for (std::size_t i = first; i < events.size(); ++i)
+            {
+                events[i].occupancy = occupancy[toIndex(events[i].type)] += events[i].released ? -1 : 1;
+            }
+        }
+        return events;
+    }
+}
+
+/// Learning the rates of every time of day from a month of history, as when a forecaster is trained from a log
+static void BM_ForecastTrainOneMonth(benchmark::State & state)
+{
+    std::vector<TrafficEvent> traffic = makeOneMonthOfTraffic();
+    for (auto _ : state)
+    {
+        OccupancyForecaster forecaster;
+        ParkingEvent event;
+        for (const auto & timed : traffic)
+        {
+            event.type = timed.released ? ParkingEventType::Released : ParkingEventType::Parked;
+            event.vehicle_type = timed.type;
+            event.entry_time_us = event.exit_time_us = timed.time_us;
+            forecaster.record(event, timed.occupancy);
+        }
+        benchmark::DoNotOptimize(forecaster.getTimeToFull(VehicleType::Car, 0, kBenchmarkCapacity, traffic.back().time_us, 24LL * 3600 * 1000000));
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(traffic.size()));
+    state.counters["events"] = static_cast<double>(traffic.size());
+}
+BENCHMARK(BM_ForecastTrainOneMonth)->Unit(benchmark::kMillisecond);
+
+/// Time to full asked by a signage board, projected over the slots of the next day
+static void BM_ForecastTimeToFull(benchmark::State & state)
+{
+    std::vector<TrafficEvent> traffic = makeOneMonthOfTraffic();
+    OccupancyForecaster forecaster;
+    ParkingEvent event;
+    for (const auto & timed : traffic)
+    {
+        event.type = timed.released ? ParkingEventType::Released : ParkingEventType::Parked;
+        event.vehicle_type = timed.type;
+        event.entry_time_us = event.exit_time_us = timed.time_us;
+        forecaster.record(event, timed.occupancy);
+    }
+
+    std::int64_t now_us = traffic.back().time_us;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(forecaster.getTimeToFull(VehicleType::Car, 1000, kBenchmarkCapacity, now_us, 24LL * 3600 * 1000000));
+    }
+}
+BENCHMARK(BM_ForecastTimeToFull);
+
+namespace
+{
+    /// \brief Highest thread count used by the latency benchmarks
+    const int kMaxThreads = 8;
+
+    /// \brief Latencies of one operation, a histogram per thread
+    /// Thread 0 resets them before the timed loop and merges them after it; Google Benchmark lets all threads
+    /// start and finish the timed loop together, so no thread records while they are reset or merged.
+    class Latencies
+    {
+    public:
+        explicit Latencies(const char * name) : m_name(name) {}
+
+        void reset(const benchmark::State & state)
+        {
+            if (state.thread_index() == 0)
+            {
+                for (auto & histogram : m_histograms)
+                {
+                    histogram.reset();
+                }
+            }
+        }
+
+        /// \brief Runs the operation and records how long it took in nanoseconds
+        template <typename Operation>
+        void measure(const benchmark::State & state, Operation && operation)
+        {
+            auto start = std::chrono::steady_clock::now();
+            operation();
+            auto stop = std::chrono::steady_clock::now();
+            m_histograms[state.thread_index()].record(static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count()));
+        }
+
+        /// \brief Reports the p50/p99/p999 latencies of all threads as counters, e.g. park_p99_ns
+        void report(benchmark::State & state) const
+        {
+            if (state.thread_index() != 0)
+            {
+                return;
+            }
+            LatencyHistogram merged;
+            for (const auto & histogram : m_histograms)
+            {
+                merged.merge(histogram);
+            }
+            if (merged.count() == 0)
+            {
+                return;
+            }
+            state.counters[m_name + "_p50_ns"] = static_cast<double>(merged.percentile(50.0));
+            state.counters[m_name + "_p99_ns"] = static_cast<double>(merged.percentile(99.0));
+            state.counters[m_name + "_p999_ns"] = static_cast<double>(merged.percentile(99.9));
+        }
+
+    private:
+        std::string m_name;
+        std::array<LatencyHistogram, kMaxThreads> m_histograms;
+    };
+
+    /// \brief Cars parked by thread 0 for the whole run, e.g. to give the lookups something to hit
+    /// \return Returns the license plates of the parked cars
+    std::unique_ptr<Occupancy> occupyForRun(const benchmark::State & state, const std::shared_ptr<ParkingLot> & parking_lot)
+    {
+        if (state.thread_index() != 0)
+        {
+            return nullptr;
+        }
+        return std::unique_ptr<Occupancy>(new Occupancy(parking_lot, static_cast<int>(state.range(0))));
+    }
+
+    /// \brief Whether the i-th operation of a benchmark with the hit percentage in range(1) should hit
+    bool isHit(const benchmark::State & state, const std::int64_t i)
+    {
+        return i % 100 < state.range(1);
+    }
+
+    /// \brief Occupancy levels times hit percentages of the gate benchmarks
+    void gateArguments(benchmark::internal::Benchmark * benchmark)
+    {
+        benchmark->ArgNames({ "occupancy", "hit_pct" });
+        for (int occupancy : { 0, 10000, 50000 })
+        {
+            for (int hit_percent : { 100, 50, 0 })
+            {
+                benchmark->Args({ occupancy, hit_percent });
+            }
+        }
+        benchmark->ThreadRange(1, kMaxThreads)->UseRealTime();
+    }
+}
+
+/// Every iteration is one vehicle arriving and leaving (hit) or a release of an unknown license plate (miss)
+static void BM_GateByLicensePlate(benchmark::State & state)
+{
+    static Latencies park_latencies("park");
+    static Latencies release_latencies("release");
+
+    std::shared_ptr<ParkingLot> parking_lot = getBenchmarkLot();
+    std::unique_ptr<Occupancy> occupancy = occupyForRun(state, parking_lot);
+    park_latencies.reset(state);
+    release_latencies.reset(state);
+    std::shared_ptr<Vehicle> car = std::make_shared<Car>("GATE" + std::to_string(state.thread_index()), 1.0);
+    const std::string unknown = "MISS" + std::to_string(state.thread_index());
+
+    std::int64_t i = 0;
+    for (auto _ : state)
+    {
+        if (isHit(state, i++))
+        {
+            park_latencies.measure(state, [&]() { benchmark::DoNotOptimize(parking_lot->tryParkVehicle(car)); });
+            release_latencies.measure(state, [&]() { benchmark::DoNotOptimize(parking_lot->tryReleaseVehicleByLicensePlate(car->getLicensePlate())); });
+        }
+        else
+        {
+            release_latencies.measure(state, [&]() { benchmark::DoNotOptimize(parking_lot->tryReleaseVehicleByLicensePlate(unknown)); });
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+    park_latencies.report(state);
+    release_latencies.report(state);
+}
+BENCHMARK(BM_GateByLicensePlate)->Apply(gateArguments);
+
+/// Like BM_GateByLicensePlate, the vehicles leave by their ticket ID
+static void BM_GateByTicketID(benchmark::State & state)
+{
+    static Latencies park_latencies("park");
+    static Latencies release_latencies("release");
+
+    std::shared_ptr<ParkingLot> parking_lot = getBenchmarkLot();
+    std::unique_ptr<Occupancy> occupancy = occupyForRun(state, parking_lot);
+    park_latencies.reset(state);
+    release_latencies.reset(state);
+    std::shared_ptr<Vehicle> car = std::make_shared<Car>("GATE" + std::to_string(state.thread_index()), 1.0);
+
+    // Ticket IDs are never 0
+    const TicketID unknown = 0;
+
+    std::int64_t i = 0;
+    for (auto _ : state)
+    {
+        if (isHit(state, i++))
+        {
+            ParkingResult parked;
+            park_latencies.measure(state, [&]() { parked = parking_lot->tryParkVehicle(car); });
+            release_latencies.measure(state, [&]() { benchmark::DoNotOptimize(parking_lot->tryReleaseVehicleByTicketID(parked.ticket_id)); });
+        }
+        else
+        {
+            release_latencies.measure(state, [&]() { benchmark::DoNotOptimize(parking_lot->tryReleaseVehicleByTicketID(unknown)); });
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+    park_latencies.report(state);
+    release_latencies.report(state);
+}
+BENCHMARK(BM_GateByTicketID)->Apply(gateArguments);
+
+/// Ticket lookups by license plate, hits look up the vehicles parked for the run
+static void BM_TicketLookup(benchmark::State & state)
+{
+    static Latencies lookup_latencies("lookup");
+
+    std::shared_ptr<ParkingLot> parking_lot = getBenchmarkLot();
+    std::unique_ptr<Occupancy> occupancy = occupyForRun(state, parking_lot);
+    lookup_latencies.reset(state);
+    const std::string unknown = "MISS" + std::to_string(state.thread_index());
+
+    // Same license plates as Occupancy, built up front so the loop does not allocate
+    std::vector<std::string> parked;
+    for (int j = 0; j < std::min<std::int64_t>(state.range(0), 1024); ++j)
+    {
+        parked.push_back("OCC" + std::to_string((j * 7919 + state.thread_index()) % state.range(0)));
+    }
+
+    std::int64_t i = 0;
+    for (auto _ : state)
+    {
+        const std::string & license_plate = isHit(state, i) && !parked.empty() ? parked[i % parked.size()] : unknown;
+        ++i;
+        lookup_latencies.measure(state, [&]() { benchmark::DoNotOptimize(parking_lot->tryGetTicketIDByLicensePlate(license_plate)); });
+    }
+    state.SetItemsProcessed(state.iterations());
+    lookup_latencies.report(state);
+}
+BENCHMARK(BM_TicketLookup)->Apply(gateArguments);
+
+static void BM_OccupancyQuery(benchmark::State & state)
+{
+    static Latencies query_latencies("query");
+
+    std::shared_ptr<ParkingLot> parking_lot = getBenchmarkLot();
+    query_latencies.reset(state);
+    for (auto _ : state)
+    {
+        query_latencies.measure(state, [&]() { benchmark::DoNotOptimize(parking_lot->getOccupancySnapshot()); });
+    }
+    state.SetItemsProcessed(state.iterations());
+    query_latencies.report(state);
+}
+BENCHMARK(BM_OccupancyQuery)->ThreadRange(1, kMaxThreads)->UseRealTime();
+
+// Counts a park and a release into the analytics of one lot, as the gates do inline with every event
+static void BM_AnalyticsRecord(benchmark::State & state)
+{
+    static OccupancyAnalytics analytics;
+    static Latencies record_latencies("analytics record");
+
+    std::int64_t now_us = systemClockMicroseconds();
+    ParkingEvent parked;
+    parked.type = ParkingEventType::Parked;
+    parked.entry_time_us = now_us;
+    ParkingEvent released = parked;
+    released.type = ParkingEventType::Released;
+    released.exit_time_us = now_us + 2 * 3600LL * 1000000;
+
+    record_latencies.reset(state);
+    for (auto _ : state)
+    {
+        record_latencies.measure(state, [&]() {
+            analytics.record(parked, 1);
+            analytics.record(released, 0);
+        });
+    }
+    state.SetItemsProcessed(state.iterations() * 2);
+    record_latencies.report(state);
+}
+BENCHMARK(BM_AnalyticsRecord)->ThreadRange(1, kMaxThreads)->UseRealTime();
+
+namespace
+{
+    /// \brief 100k bays over 20 floors of 5 zones, 90% of the car bays taken, one lot per policy
+    ZonedBayAllocator & getBenchmarkZones(const int policy)
+    {
+        static std::array<std::unique_ptr<ZonedBayAllocator>, 3> zones = []()
+        {
+            LotTopology topology;
+            topology.addFloors(20, 5, { 100, 100, 600, 100, 0, 100 });
+            std::array<std::shared_ptr<const BayAllocationPolicy>, 3> policies = { std::make_shared<NearestToExitPolicy>(), std::make_shared<LowestFloorPolicy>(),
+                                                                                    std::make_shared<BalancedPolicy>() };
+            std::array<std::unique_ptr<ZonedBayAllocator>, 3> lots;
+            for (std::size_t i = 0; i < lots.size(); ++i)
+            {
+                lots[i].reset(new ZonedBayAllocator(topology, policies[i]));
+                for (int bay = 0; bay < topology.usableBays(VehicleType::Car) * 9 / 10; ++bay)
+                {
+                    lots[i]->allocate(VehicleType::Car);
+                }
+            }
+            return lots;
+        }();
+        return *zones[policy];
+    }
+}
+
+// Takes and frees a car bay of a lot with floors and zones, the gates search the zones concurrently
+static void BM_ZonedBayAllocation(benchmark::State & state)
+{
+    static Latencies allocation_latencies("bay allocation");
+
+    ZonedBayAllocator & zones = getBenchmarkZones(static_cast<int>(state.range(0)));
+    allocation_latencies.reset(state);
+    for (auto _ : state)
+    {
+        allocation_latencies.measure(state, [&]() { zones.release(zones.allocate(VehicleType::Car)); });
+    }
+    state.SetItemsProcessed(state.iterations());
+    allocation_latencies.report(state);
+}
+BENCHMARK(BM_ZonedBayAllocation)->ArgName("policy")->DenseRange(0, 2)->ThreadRange(1, kMaxThreads)->UseRealTime();
+
+/// Entries queued by the gates, the writer thread writes them to the file while the benchmark runs
+static void BM_Logging(benchmark::State & state)
+{
+    static Latencies log_latencies("log");
+    static std::unique_ptr<AsyncLogger> logger;
+    static const std::string kLogPath = "bench_log.txt";
+
+    if (state.thread_index() == 0)
+    {
+        AsyncLoggerConfig config;
+        config.file_path = kLogPath;
+        config.format = state.range(0) == 0 ? LogFormat::Text : LogFormat::Binary;
+        logger.reset(new AsyncLogger(config));
+    }
+    log_latencies.reset(state);
+    const std::string license_plate = "LOG" + std::to_string(state.thread_index());
+
+    TicketID ticket_id = 1;
+    for (auto _ : state)
+    {
+        log_latencies.measure(state, [&]() { logger->log("Entry", VehicleType::Car, license_plate, ticket_id++, systemClockMicroseconds()); });
+    }
+    state.SetItemsProcessed(state.iterations());
+    log_latencies.report(state);
+
+    if (state.thread_index() == 0)
+    {
+        logger.reset();
+        for (const auto & path : BinaryLogWriter::segmentPaths(kLogPath))
+        {
+            std::filesystem::remove(path);
+        }
+        std::filesystem::remove(BinaryLogWriter::dictionaryPath(kLogPath));
+        std::filesystem::remove(kLogPath);
+    }
+}
+BENCHMARK(BM_Logging)->ArgName("binary")->Arg(0)->Arg(1)->ThreadRange(1, kMaxThreads)->UseRealTime();
+
+namespace
+{
+    /// \brief A day of departures of a busy site in exit order: 20k regular license plates, stays of 10 minutes to 10 hours
+    std::vector<ParkingEvent> makeClosedTickets(const std::size_t count)
+    {
+        std::mt19937_64 random(25);
+        std::uniform_int_distribution<int> visitor(0, 19999);
+        std::uniform_int_distribution<std::int64_t> gap_us(0, 20000);
+        std::uniform_int_distribution<std::int64_t> stay_us(10LL * 60 * 1000000, 10LL * 3600 * 1000000);
+
+        std::vector<ParkingEvent> tickets(count);
+        std::int64_t entry_time_us = 1700000000LL * 1000000;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            ParkingEvent & event = tickets[i];
+            event.type = ParkingEventType::Released;
+            event.vehicle_type = static_cast<VehicleType>(i % 7 == 0 ? 2 : i % 3 == 0 ? 1 : 0);
+            event.license_plate = "KA-" + std::to_string(visitor(random));
+            event.ticket_id = static_cast<TicketID>(i + 1) * 16 + static_cast<TicketID>(i % 16);
+            event.bay = 1 + static_cast<int>(i % 5000);
+            entry_time_us += gap_us(random);
+            event.entry_time_us = entry_time_us;
+            event.exit_time_us = entry_time_us + stay_us(random);
+            event.charge = 2.0 + static_cast<double>(event.exit_time_us - event.entry_time_us) / 3600e6;
+        }
+        std::sort(tickets.begin(), tickets.end(), [](const ParkingEvent & left, const ParkingEvent & right) { return left.exit_time_us < right.exit_time_us; });
+        return tickets;
+    }
+
+    const std::string kExportPath = "bench_export.plcol";
+}
+
+static void BM_ColumnarExportWrite(benchmark::State & state)
+{
+    std::vector<ParkingEvent> tickets = makeClosedTickets(static_cast<std::size_t>(state.range(0)));
+
+    // What the text log would take for the same tickets, an entry and an exit line each
+    std::size_t text_size = 0;
+    for (const auto & ticket : tickets)
+    {
+        std::size_t line_size = std::strlen(" Ticket ID , ") + std::to_string(ticket.ticket_id).size() + std::strlen(toString(ticket.vehicle_type))
+                              + std::strlen(" with license plate \n") + ticket.license_plate.view().size();
+        text_size += line_size * 2 + std::strlen("Entry:") + std::strlen("Exit:");
+    }
+
+    std::uint64_t export_size = 0;
+    for (auto _ : state)
+    {
+        ColumnarExportWriter writer(kExportPath);
+        for (const auto & ticket : tickets)
+        {
+            writer.addClosedTicket(ticket);
+        }
+        writer.close();
+        export_size = writer.bytesWritten();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * export_size));
+    state.counters["bytes_per_ticket"] = static_cast<double>(export_size) / static_cast<double>(tickets.size());
+    state.counters["text_log_ratio"] = static_cast<double>(text_size) / static_cast<double>(export_size);
+}
+BENCHMARK(BM_ColumnarExportWrite)->Arg(1000000)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_ColumnarExportRead(benchmark::State & state)
+{
+    {
+        ColumnarExportWriter writer(kExportPath);
+        for (const auto & ticket : makeClosedTickets(static_cast<std::size_t>(state.range(0))))
+        {
+            writer.addClosedTicket(ticket);
+        }
+    }
+
+    // A settlement: the revenue of every vehicle type
+    for (auto _ : state)
+    {
+        std::array<double, kVehicleTypeCount> revenue = {};
+        ColumnarExportReader reader(kExportPath);
+        ExportBlock block;
+        while (reader.readBlock(block))
+        {
+            for (std::size_t row = 0; row < block.size(); ++row)
+            {
+                revenue[toIndex(block.types[row])] += block.charges[row];
+            }
+        }
+        benchmark::DoNotOptimize(revenue);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    std::filesystem::remove(kExportPath);
+}
+BENCHMARK(BM_ColumnarExportRead)->Arg(1000000)->Unit(benchmark::kMillisecond)->UseRealTime();
\ No newline at end of file
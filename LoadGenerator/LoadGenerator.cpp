@@ -0,0 +1,495 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <queue>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Bus.h"
+#include "Car.h"
+#include "LatencyHistogram.h"
+#include "Motorcycle.h"
+#include "NullEventSink.h"
+#include "ParkingLot.h"
+#include "TrafficModel.h"
+
+namespace
+{
+    void printUsage()
+    {
+        std::cout << "Usage:\n"
+                  << "  LoadGenerator synthetic [options]        Poisson arrivals and random stays per vehicle type\n"
+                  << "  LoadGenerator replay <log path> [options] Entries and exits of a log written by the parking lot\n"
+                  << "Options:\n"
+                  << "  --gates <n>                          Threads driving the parking lot (default 4)\n"
+                  << "  --capacity <cars> <motorcycles> <buses> (default 2500 1000 200)\n"
+                  << "  --speed <factor>                     Simulated seconds per second, e.g. 60 runs an hour in a minute (default 1)\n"
+                  << "  --metrics                            Also print the metrics of the parking lot\n"
+                  << "Synthetic options, times in simulated seconds:\n"
+                  << "  --duration <seconds>                 Length of the run (default 10)\n"
+                  << "  --rate <type> <schedule>             Arrivals per second, e.g. 50 or 0:50,600:400 (default Car 200, Motorcycle 50, Bus 10)\n"
+                  << "  --dwell <type> fixed <mean> | exponential <mean> | lognormal <mean> <deviation> (default exponential 10)\n"
+                  << "  --prefill <type> <count>             Vehicles parked before the run starts, they leave after their dwell time\n"
+                  << "  --seed <n>                           Seed of the random numbers (default 1)\n"
+                  << "Replay options:\n"
+                  << "  --text-rate <events per second>      Pace of a text log, it has no timestamps (default 1000)\n"
+                  << "Types are Car, Motorcycle and Bus.\n";
+    }
+
+    struct Options
+    {
+        bool replay = false;
+        std::string log_path;
+        unsigned gates = 4;
+        std::array<int, kVehicleTypeCount> capacity{ { 2500, 1000, 200 } };
+        double speed = 1.0;
+        bool print_metrics = false;
+
+        double duration = 10.0;
+        std::array<TrafficProfile, kVehicleTypeCount> profiles;
+        std::uint64_t seed = 1;
+
+        double text_rate = 1000.0;
+    };
+
+    bool parseType(const std::string & name, VehicleType & vehicle_type)
+    {
+        for (std::size_t index = 0; index < kVehicleTypeCount; ++index)
+        {
+            if (name == toString(static_cast<VehicleType>(index)))
+            {
+                vehicle_type = static_cast<VehicleType>(index);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool parseOptions(const std::vector<std::string> & args, Options & options)
+    {
+        RateSchedule::parse("200", options.profiles[toIndex(VehicleType::Car)].arrivals);
+        RateSchedule::parse("50", options.profiles[toIndex(VehicleType::Motorcycle)].arrivals);
+        RateSchedule::parse("10", options.profiles[toIndex(VehicleType::Bus)].arrivals);
+        for (auto & profile : options.profiles)
+        {
+            DwellTime::parse({ "exponential", "10" }, profile.dwell_time);
+        }
+
+        if (args.empty() || (args[0] != "synthetic" && args[0] != "replay"))
+        {
+            return false;
+        }
+        std::size_t i = 1;
+        options.replay = args[0] == "replay";
+        if (options.replay)
+        {
+            if (args.size() < 2)
+            {
+                return false;
+            }
+            options.log_path = args[i++];
+        }
+
+        // Returns the next argument, or an empty string once they are used up
+        auto next = [&args, &i]() { return i < args.size() ? args[i++] : std::string(); };
+        VehicleType vehicle_type = VehicleType::Car;
+        while (i < args.size())
+        {
+            std::string option = next();
+            if (option == "--gates")
+            {
+                options.gates = static_cast<unsigned>(std::strtoul(next().c_str(), nullptr, 10));
+            }
+            else if (option == "--capacity")
+            {
+                for (auto & capacity : options.capacity)
+                {
+                    capacity = std::atoi(next().c_str());
+                }
+            }
+            else if (option == "--speed")
+            {
+                options.speed = std::atof(next().c_str());
+            }
+            else if (option == "--metrics")
+            {
+                options.print_metrics = true;
+            }
+            else if (option == "--duration")
+            {
+                options.duration = std::atof(next().c_str());
+            }
+            else if (option == "--rate")
+            {
+                if (!parseType(next(), vehicle_type) || !RateSchedule::parse(next(), options.profiles[toIndex(vehicle_type)].arrivals))
+                {
+                    return false;
+                }
+            }
+            else if (option == "--dwell")
+            {
+                if (!parseType(next(), vehicle_type))
+                {
+                    return false;
+                }
+                std::vector<std::string> words{ next(), next() };
+                if (words[0] == "lognormal")
+                {
+                    words.push_back(next());
+                }
+                if (!DwellTime::parse(words, options.profiles[toIndex(vehicle_type)].dwell_time))
+                {
+                    return false;
+                }
+            }
+            else if (option == "--prefill")
+            {
+                if (!parseType(next(), vehicle_type))
+                {
+                    return false;
+                }
+                options.profiles[toIndex(vehicle_type)].prefill = std::atoi(next().c_str());
+            }
+            else if (option == "--seed")
+            {
+                options.seed = std::strtoull(next().c_str(), nullptr, 10);
+            }
+            else if (option == "--text-rate")
+            {
+                options.text_rate = std::atof(next().c_str());
+            }
+            else
+            {
+                return false;
+            }
+        }
+        return options.gates > 0 && options.speed > 0.0 && options.duration > 0.0 && options.text_rate > 0.0;
+    }
+
+    std::shared_ptr<Vehicle> makeVehicle(const VehicleType vehicle_type, const std::string & license_plate, const double dwell_time)
+    {
+        double hours = dwell_time / 3600.0;
+        switch (vehicle_type)
+        {
+        case VehicleType::Motorcycle:
+            return std::make_shared<Motorcycle>(license_plate, hours);
+        case VehicleType::Bus:
+            return std::make_shared<Bus>(license_plate, hours);
+        default:
+            return std::make_shared<Car>(license_plate, hours);
+        }
+    }
+
+    /// \brief What one gate did, merged over all gates at the end
+    struct GateStats
+    {
+        std::uint64_t parked = 0;
+        std::uint64_t rejected = 0;
+        std::uint64_t already_parked = 0;
+        std::uint64_t released = 0;
+        std::uint64_t not_found = 0;
+
+        /// Time of the calls into the parking lot, in nanoseconds
+        LatencyHistogram park_latency;
+        LatencyHistogram release_latency;
+
+        /// How late the operations started compared to their schedule, in nanoseconds
+        LatencyHistogram lag;
+
+        void merge(const GateStats & other)
+        {
+            parked += other.parked;
+            rejected += other.rejected;
+            already_parked += other.already_parked;
+            released += other.released;
+            not_found += other.not_found;
+            park_latency.merge(other.park_latency);
+            release_latency.merge(other.release_latency);
+            lag.merge(other.lag);
+        }
+
+        std::uint64_t operations() const { return parked + rejected + already_parked + released + not_found; }
+    };
+
+    /// \brief Drives the parking lot from one thread, keeping to the schedule of the operations
+    class Gate
+    {
+    public:
+        Gate(ParkingLot & parking_lot, const std::chrono::steady_clock::time_point start, const double speed)
+            : m_parking_lot(parking_lot), m_start(start), m_speed(speed)
+        {
+        }
+
+        /// \brief Parks a vehicle at the given simulated time
+        /// \return Returns true if the vehicle was parked
+        bool park(const double time, const std::shared_ptr<Vehicle> & vehicle)
+        {
+            auto started = waitFor(time);
+            ParkingResult result = m_parking_lot.tryParkVehicle(vehicle);
+            m_stats.park_latency.record(nanosecondsSince(started));
+            switch (result.status)
+            {
+            case ParkingEventType::Parked:
+                ++m_stats.parked;
+                return true;
+            case ParkingEventType::Full:
+            case ParkingEventType::NoTicket:
+                ++m_stats.rejected;
+                break;
+            default:
+                ++m_stats.already_parked;
+                break;
+            }
+            return false;
+        }
+
+        void release(const double time, const std::string & license_plate)
+        {
+            auto started = waitFor(time);
+            ParkingResult result = m_parking_lot.tryReleaseVehicleByLicensePlate(license_plate);
+            m_stats.release_latency.record(nanosecondsSince(started));
+            ++(result.succeeded() ? m_stats.released : m_stats.not_found);
+        }
+
+        const GateStats & stats() const { return m_stats; }
+
+    private:
+        /// \brief Sleeps until the simulated time is due and records how late the gate is
+        /// \return Returns the time the operation starts
+        std::chrono::steady_clock::time_point waitFor(const double time)
+        {
+            auto due = m_start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(time / m_speed));
+            auto now = std::chrono::steady_clock::now();
+            if (now < due)
+            {
+                std::this_thread::sleep_until(due);
+                now = std::chrono::steady_clock::now();
+            }
+            m_stats.lag.record(nanosecondsBetween(due, now));
+            return now;
+        }
+
+        static std::uint64_t nanosecondsBetween(const std::chrono::steady_clock::time_point from, const std::chrono::steady_clock::time_point to)
+        {
+            return to <= from ? 0 : static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(to - from).count());
+        }
+
+        static std::uint64_t nanosecondsSince(const std::chrono::steady_clock::time_point from)
+        {
+            return nanosecondsBetween(from, std::chrono::steady_clock::now());
+        }
+
+    private:
+        ParkingLot & m_parking_lot;
+        std::chrono::steady_clock::time_point m_start;
+        double m_speed;
+        GateStats m_stats;
+    };
+
+    /// \brief A parked vehicle that leaves at the given simulated time
+    struct Departure
+    {
+        double time;
+        std::string license_plate;
+
+        bool operator>(const Departure & other) const { return time > other.time; }
+    };
+
+    using DepartureQueue = std::priority_queue<Departure, std::vector<Departure>, std::greater<Departure>>;
+
+    /// \brief Arrivals and departures of one gate; every gate gets its share of the arrival rates and
+    /// releases the vehicles it parked, so its events are independent of the other gates
+    void runSyntheticGate(ParkingLot & parking_lot, const Options & options, const unsigned gate_index, DepartureQueue departures,
+                          const std::chrono::steady_clock::time_point start, GateStats & stats)
+    {
+        Gate gate(parking_lot, start, options.speed);
+        std::mt19937_64 rng(options.seed * 7919 + gate_index);
+
+        std::array<RateSchedule, kVehicleTypeCount> arrivals;
+        std::array<double, kVehicleTypeCount> next_arrival;
+        for (std::size_t index = 0; index < kVehicleTypeCount; ++index)
+        {
+            arrivals[index] = options.profiles[index].arrivals.scaled(1.0 / options.gates);
+            next_arrival[index] = arrivals[index].nextArrival(0.0, rng);
+        }
+
+        std::uint64_t vehicle_number = 0;
+        for (;;)
+        {
+            std::size_t type = static_cast<std::size_t>(std::min_element(next_arrival.begin(), next_arrival.end()) - next_arrival.begin());
+            double departure_time = departures.empty() ? std::numeric_limits<double>::infinity() : departures.top().time;
+            if (std::min(next_arrival[type], departure_time) >= options.duration)
+            {
+                break;
+            }
+
+            if (departure_time <= next_arrival[type])
+            {
+                gate.release(departure_time, departures.top().license_plate);
+                departures.pop();
+                continue;
+            }
+
+            double time = next_arrival[type];
+            VehicleType vehicle_type = static_cast<VehicleType>(type);
+            double dwell_time = options.profiles[type].dwell_time.sample(rng);
+            std::string license_plate = "G" + std::to_string(gate_index) + "-" + std::to_string(++vehicle_number);
+            if (gate.park(time, makeVehicle(vehicle_type, license_plate, dwell_time)))
+            {
+                departures.push(Departure{ time + dwell_time, std::move(license_plate) });
+            }
+            next_arrival[type] = arrivals[type].nextArrival(time, rng);
+        }
+        stats = gate.stats();
+    }
+
+    /// \brief Replays the events of one gate in trace order
+    void runReplayGate(ParkingLot & parking_lot, const Options & options, const std::vector<const TraceEvent *> & events,
+                       const std::chrono::steady_clock::time_point start, GateStats & stats)
+    {
+        Gate gate(parking_lot, start, options.speed);
+        for (const TraceEvent * event : events)
+        {
+            if (event->action == LogAction::Entry)
+            {
+                gate.park(event->time, makeVehicle(event->vehicle_type, event->license_plate, 0.0));
+            }
+            else
+            {
+                gate.release(event->time, event->license_plate);
+            }
+        }
+        stats = gate.stats();
+    }
+
+    void printLatency(const char * name, const LatencyHistogram & histogram)
+    {
+        std::cout << std::left << std::setw(18) << name << std::right << std::fixed << std::setprecision(1)
+                  << "p50 " << std::setw(9) << histogram.percentile(50.0) / 1000.0 << " us   "
+                  << "p99 " << std::setw(9) << histogram.percentile(99.0) / 1000.0 << " us   "
+                  << "p999 " << std::setw(9) << histogram.percentile(99.9) / 1000.0 << " us\n";
+    }
+
+    void printReport(const GateStats & total, const double elapsed_seconds, const double target_rate, const ParkingLot & parking_lot)
+    {
+        std::uint64_t park_attempts = total.parked + total.rejected + total.already_parked;
+        double rejection_rate = park_attempts == 0 ? 0.0 : 100.0 * static_cast<double>(total.rejected) / static_cast<double>(park_attempts);
+        std::cout << std::fixed << std::setprecision(1)
+                  << "Operations:       " << total.operations() << " in " << elapsed_seconds << " s, "
+                  << static_cast<double>(total.operations()) / elapsed_seconds << " per second (target " << target_rate << ")\n"
+                  << "Parked:           " << total.parked << ", rejected (full): " << total.rejected << " (" << rejection_rate << "% of park attempts)"
+                  << ", already parked: " << total.already_parked << '\n'
+                  << "Released:         " << total.released << ", not found: " << total.not_found << '\n';
+        printLatency("Park latency", total.park_latency);
+        printLatency("Release latency", total.release_latency);
+        printLatency("Behind schedule", total.lag);
+
+        OccupancySnapshot occupancy = parking_lot.getOccupancySnapshot();
+        std::cout << "Occupancy at end:";
+        for (std::size_t index = 0; index < kVehicleTypeCount; ++index)
+        {
+            std::cout << ' ' << toString(static_cast<VehicleType>(index)) << ' ' << occupancy.types[index].occupied << '/' << occupancy.types[index].capacity;
+        }
+        std::cout << '\n';
+    }
+}
+
+int main(int argc, char * argv[])
+{
+    Options options;
+    if (!parseOptions(std::vector<std::string>(argv + 1, argv + argc), options))
+    {
+        printUsage();
+        return 1;
+    }
+
+    std::vector<TraceEvent> trace;
+    if (options.replay && !readTrace(options.log_path, options.text_rate, trace))
+    {
+        std::cerr << "Cannot read the log " << options.log_path << '\n';
+        return 1;
+    }
+
+    // The lot logs to its own file, a replayed log is never appended to
+    AsyncLoggerConfig log_config;
+    log_config.file_path = "load_generator_log.txt";
+    std::shared_ptr<ParkingLot> parking_lot = ParkingLot::getInstance(options.capacity[0], options.capacity[1], options.capacity[2], log_config);
+    parking_lot->setEventSink(std::make_shared<NullEventSink>());
+
+    std::vector<GateStats> stats(options.gates);
+    std::vector<std::vector<const TraceEvent *>> gate_events(options.gates);
+    std::vector<DepartureQueue> departures(options.gates);
+    double simulated_seconds = options.duration;
+
+    if (options.replay)
+    {
+        // All events of a vehicle go through the same gate, so its entry is never overtaken by its exit
+        for (const auto & event : trace)
+        {
+            gate_events[std::hash<std::string>()(event.license_plate) % options.gates].push_back(&event);
+        }
+        simulated_seconds = trace.empty() ? 0.0 : trace.back().time;
+    }
+    else
+    {
+        // Vehicles parked before the start leave through the gates like the others
+        std::mt19937_64 rng(options.seed);
+        for (std::size_t index = 0; index < kVehicleTypeCount; ++index)
+        {
+            const TrafficProfile & profile = options.profiles[index];
+            for (int i = 0; i < profile.prefill; ++i)
+            {
+                std::string license_plate = "P" + std::to_string(index) + "-" + std::to_string(i);
+                double dwell_time = profile.dwell_time.sample(rng);
+                if (parking_lot->tryParkVehicle(makeVehicle(static_cast<VehicleType>(index), license_plate, dwell_time)).succeeded())
+                {
+                    departures[static_cast<std::size_t>(i) % options.gates].push(Departure{ dwell_time, license_plate });
+                }
+            }
+        }
+    }
+
+    std::vector<std::thread> gates;
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned gate = 0; gate < options.gates; ++gate)
+    {
+        if (options.replay)
+        {
+            gates.emplace_back([&, gate]() { runReplayGate(*parking_lot, options, gate_events[gate], start, stats[gate]); });
+        }
+        else
+        {
+            gates.emplace_back([&, gate]() { runSyntheticGate(*parking_lot, options, gate, std::move(departures[gate]), start, stats[gate]); });
+        }
+    }
+    for (auto & gate : gates)
+    {
+        gate.join();
+    }
+    double elapsed_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    GateStats total;
+    for (const auto & gate_stats : stats)
+    {
+        total.merge(gate_stats);
+    }
+    // The gates run open loop, every scheduled operation is carried out, only later than planned if the lot cannot keep up
+    double scheduled_seconds = std::max(simulated_seconds / options.speed, 1e-9);
+    std::cout << (options.replay ? "Replayed " + options.log_path : std::string("Synthetic traffic")) << " through " << options.gates << " gates\n";
+    printReport(total, std::max(elapsed_seconds, 1e-9), static_cast<double>(total.operations()) / scheduled_seconds, *parking_lot);
+    if (options.print_metrics)
+    {
+        std::cout << parking_lot->getMetricsSnapshot().toText();
+    }
+    return 0;
+}
\ No newline at end of file
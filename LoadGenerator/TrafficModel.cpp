@@ -0,0 +1,211 @@
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+#include "TrafficModel.h"
+
+namespace
+{
+    bool parseNumber(const std::string & text, double & value)
+    {
+        std::istringstream stream(text);
+        stream >> value;
+        return stream && stream.eof() && value >= 0.0;
+    }
+
+    bool parseVehicleTypeName(const std::string & name, VehicleType & vehicle_type)
+    {
+        for (std::size_t index = 0; index < kVehicleTypeCount; ++index)
+        {
+            if (name == toString(static_cast<VehicleType>(index)))
+            {
+                vehicle_type = static_cast<VehicleType>(index);
+                return true;
+            }
+        }
+        return false;
+    }
+}
+
+bool RateSchedule::parse(const std::string & text, RateSchedule & schedule)
+{
+    schedule.m_steps.clear();
+    std::istringstream stream(text);
+    std::string step;
+    while (std::getline(stream, step, ','))
+    {
+        std::size_t colon = step.find(':');
+        double from = 0.0;
+        double rate = 0.0;
+        if (colon == std::string::npos)
+        {
+            if (!parseNumber(step, rate) || !schedule.m_steps.empty())
+            {
+                return false;
+            }
+        }
+        else if (!parseNumber(step.substr(0, colon), from) || !parseNumber(step.substr(colon + 1), rate))
+        {
+            return false;
+        }
+        if (!schedule.m_steps.empty() && from <= schedule.m_steps.back().first)
+        {
+            return false;
+        }
+        schedule.m_steps.emplace_back(from, rate);
+    }
+    return !schedule.m_steps.empty();
+}
+
+RateSchedule RateSchedule::scaled(const double factor) const
+{
+    RateSchedule schedule = *this;
+    for (auto & step : schedule.m_steps)
+    {
+        step.second *= factor;
+    }
+    return schedule;
+}
+
+double RateSchedule::nextArrival(double time, std::mt19937_64 & rng) const
+{
+    // The process is memoryless, so at every rate change the next arrival is drawn again with the new rate
+    const double kNever = std::numeric_limits<double>::infinity();
+    for (;;)
+    {
+        auto next = std::upper_bound(m_steps.begin(), m_steps.end(), time, [](double t, const std::pair<double, double> & step) { return t < step.first; });
+        double rate = next == m_steps.begin() ? 0.0 : std::prev(next)->second;
+        double change = next == m_steps.end() ? kNever : next->first;
+        if (rate > 0.0)
+        {
+            double arrival = time + std::exponential_distribution<double>(rate)(rng);
+            if (arrival < change)
+            {
+                return arrival;
+            }
+        }
+        if (change == kNever)
+        {
+            return kNever;
+        }
+        time = change;
+    }
+}
+
+double RateSchedule::expectedArrivals(const double until) const
+{
+    double arrivals = 0.0;
+    for (std::size_t i = 0; i < m_steps.size() && m_steps[i].first < until; ++i)
+    {
+        double end = i + 1 < m_steps.size() ? std::min(m_steps[i + 1].first, until) : until;
+        arrivals += (end - m_steps[i].first) * m_steps[i].second;
+    }
+    return arrivals;
+}
+
+bool DwellTime::parse(const std::vector<std::string> & words, DwellTime & dwell_time)
+{
+    if (words.size() < 2 || !parseNumber(words[1], dwell_time.m_mean) || dwell_time.m_mean <= 0.0)
+    {
+        return false;
+    }
+    if (words[0] == "fixed" && words.size() == 2)
+    {
+        dwell_time.m_kind = Kind::Fixed;
+        return true;
+    }
+    if (words[0] == "exponential" && words.size() == 2)
+    {
+        dwell_time.m_kind = Kind::Exponential;
+        return true;
+    }
+    double deviation = 0.0;
+    if (words[0] == "lognormal" && words.size() == 3 && parseNumber(words[2], deviation))
+    {
+        // Parameters of the underlying normal distribution that give the requested mean and deviation
+        dwell_time.m_kind = Kind::LogNormal;
+        dwell_time.m_sigma = std::sqrt(std::log(1.0 + (deviation * deviation) / (dwell_time.m_mean * dwell_time.m_mean)));
+        dwell_time.m_mu = std::log(dwell_time.m_mean) - dwell_time.m_sigma * dwell_time.m_sigma / 2.0;
+        return true;
+    }
+    return false;
+}
+
+double DwellTime::sample(std::mt19937_64 & rng) const
+{
+    switch (m_kind)
+    {
+    case Kind::Fixed:
+        return m_mean;
+    case Kind::Exponential:
+        return std::exponential_distribution<double>(1.0 / m_mean)(rng);
+    case Kind::LogNormal:
+        return std::lognormal_distribution<double>(m_mu, m_sigma)(rng);
+    }
+    return m_mean;
+}
+
+bool parseTextLogLine(const std::string & line, TraceEvent & event)
+{
+    // Written by AsyncLogger::writeRecord: "<action>: Ticket ID <id>, <vehicle type> with license plate <plate>"
+    const std::string kPlateMarker = " with license plate ";
+    std::size_t colon = line.find(": Ticket ID ");
+    std::size_t comma = line.find(", ", colon == std::string::npos ? 0 : colon);
+    std::size_t plate = line.find(kPlateMarker, comma == std::string::npos ? 0 : comma);
+    if (colon == std::string::npos || comma == std::string::npos || plate == std::string::npos)
+    {
+        return false;
+    }
+
+    std::string action = line.substr(0, colon);
+    event.action = action == "Entry" ? LogAction::Entry : (action == "Exit" ? LogAction::Exit : LogAction::Unknown);
+    event.license_plate = line.substr(plate + kPlateMarker.size());
+    return event.action != LogAction::Unknown && !event.license_plate.empty()
+        && parseVehicleTypeName(line.substr(comma + 2, plate - comma - 2), event.vehicle_type);
+}
+
+bool readTrace(const std::string & log_path, const double text_rate, std::vector<TraceEvent> & events)
+{
+    events.clear();
+    BinaryLogReader reader(log_path);
+    if (reader.segmentCount() > 0)
+    {
+        std::int64_t first_timestamp_us = 0;
+        reader.forEachRecord([&](const BinaryLogRecord & record)
+        {
+            if (record.action == LogAction::Unknown || toIndex(record.vehicle_type) >= kVehicleTypeCount)
+            {
+                return;
+            }
+            if (events.empty())
+            {
+                first_timestamp_us = record.timestamp_us;
+            }
+            TraceEvent event;
+            event.time = static_cast<double>(record.timestamp_us - first_timestamp_us) / 1000000.0;
+            event.action = record.action;
+            event.vehicle_type = record.vehicle_type;
+            event.license_plate = std::string(reader.plate(record.plate_id));
+            events.push_back(std::move(event));
+        });
+        return true;
+    }
+
+    std::ifstream file(log_path);
+    if (!file || text_rate <= 0.0)
+    {
+        return false;
+    }
+    std::string line;
+    TraceEvent event;
+    while (std::getline(file, line))
+    {
+        if (parseTextLogLine(line, event))
+        {
+            event.time = static_cast<double>(events.size()) / text_rate;
+            events.push_back(event);
+        }
+    }
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "BinaryLog.h"
+#include "VehicleType.h"
+
+/// \brief Arrival rate that changes at given times, e.g. a quiet night followed by the morning rush
+/// "50" is a constant rate, "0:50,3600:400,7200:80" starts at 50 per second, rises to 400 after an hour
+/// and drops to 80 after two hours. Times are simulated seconds from the start of the run.
+class RateSchedule
+{
+public:
+    RateSchedule() = default;
+
+    /// \brief Parses a schedule as described above
+    /// \return Returns false if the text is not a valid schedule
+    static bool parse(const std::string & text, RateSchedule & schedule);
+
+    /// \brief Divides all rates, e.g. to split the arrivals across gates
+    RateSchedule scaled(const double factor) const;
+
+    /// \brief Draws the next arrival of the Poisson process after the given time
+    /// \return Returns infinity if no further vehicle arrives
+    double nextArrival(const double time, std::mt19937_64 & rng) const;
+
+    /// \brief Expected number of arrivals from 0 to the given time
+    double expectedArrivals(const double until) const;
+
+private:
+    /// Pairs of start time and arrivals per second, sorted by time
+    std::vector<std::pair<double, double>> m_steps;
+};
+
+/// \brief Distribution of how long vehicles stay, in simulated seconds
+/// "fixed 600", "exponential 600" or "lognormal 600 300" (mean and standard deviation)
+class DwellTime
+{
+public:
+    DwellTime() = default;
+
+    /// \brief Parses the distribution from its words as described above
+    /// \return Returns false if the words are not a valid distribution
+    static bool parse(const std::vector<std::string> & words, DwellTime & dwell_time);
+
+    double sample(std::mt19937_64 & rng) const;
+
+private:
+    enum class Kind
+    {
+        Fixed,
+        Exponential,
+        LogNormal
+    };
+
+    Kind m_kind = Kind::Exponential;
+    double m_mean = 600.0;
+
+    /// Parameters of the normal distribution of the logarithm
+    double m_mu = 0.0;
+    double m_sigma = 0.0;
+};
+
+/// \brief Arrivals and stays of one vehicle type
+struct TrafficProfile
+{
+    RateSchedule arrivals;
+    DwellTime dwell_time;
+
+    /// Vehicles already parked when the run starts, e.g. for an evening exodus
+    int prefill = 0;
+};
+
+/// \brief One entry or exit of a recorded trace
+struct TraceEvent
+{
+    /// Seconds since the first event of the trace
+    double time = 0.0;
+    LogAction action = LogAction::Unknown;
+    VehicleType vehicle_type = VehicleType::Car;
+    std::string license_plate;
+};
+
+/// \brief Reads a trace from a log written by AsyncLogger
+/// Binary logs carry timestamps; text logs do not, their events are spaced evenly at text_rate events per second.
+/// \param[in] log_path AsyncLoggerConfig::file_path of the log, binary if segment files exist next to it
+/// \param[in] text_rate Events per second of a text log
+/// \param[out] events Events in log order
+/// \return Returns false if the log cannot be read
+bool readTrace(const std::string & log_path, const double text_rate, std::vector<TraceEvent> & events);
+
+/// \brief Parses one line of a text log, e.g. "Entry: Ticket ID 5, Car with license plate AB123"
+/// \return Returns false if the line is not an entry or exit
+bool parseTextLogLine(const std::string & line, TraceEvent & event);
\ No newline at end of file
@@ -0,0 +1,163 @@
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <string>
+
+#include "BinaryLog.h"
+#include "OccupancyForecaster.h"
+
+namespace
+{
+    void printUsage()
+    {
+        std::cout << "Usage:\n"
+                  << "  LogQueryTool <log path> plate <license plate>     All events of a vehicle\n"
+                  << "  LogQueryTool <log path> occupancy <unix seconds>  Parked vehicles at the given time\n"
+                  << "  LogQueryTool <log path> forecast <unix seconds> <car capacity> <motorcycle capacity> <bus capacity>\n"
+                  << "                                                    Time until every vehicle type is projected to be full,\n"
+                  << "                                                    learned from the log up to the given time\n"
+                  << "The log path is AsyncLoggerConfig::file_path of a logger using LogFormat::Binary.\n";
+    }
+
+    std::string formatTimestamp(const std::int64_t timestamp_us)
+    {
+        std::time_t seconds = static_cast<std::time_t>(timestamp_us / 1000000);
+        std::tm time = {};
+#ifdef _WIN32
+        gmtime_s(&time, &seconds);
+#else
+        gmtime_r(&seconds, &time);
+#endif
+        char buffer[32];
+        std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &time);
+        std::string microseconds = std::to_string(timestamp_us % 1000000);
+        return std::string(buffer) + "." + std::string(6 - microseconds.size(), '0') + microseconds + " UTC";
+    }
+
+    int queryPlate(const BinaryLogReader & reader, const std::string & license_plate)
+    {
+        std::uint32_t plate_id = reader.findPlate(license_plate);
+        if (plate_id == BinaryLogReader::kUnknownPlate)
+        {
+            std::cout << "No events for license plate " << license_plate << '\n';
+            return 0;
+        }
+
+        // Records are compared by plate ID only, the plate itself is never touched while scanning
+        std::size_t matches = 0;
+        reader.forEachRecord([&](const BinaryLogRecord & record)
+        {
+            if (record.plate_id == plate_id)
+            {
+                std::cout << formatTimestamp(record.timestamp_us) << ' ' << (record.action == LogAction::Entry ? "Entry" : "Exit")
+                          << ": Ticket ID " << record.ticket_id << ", " << toString(record.vehicle_type) << '\n';
+                ++matches;
+            }
+        });
+        std::cout << matches << " events for license plate " << license_plate << '\n';
+        return 0;
+    }
+
+    int queryOccupancy(const BinaryLogReader & reader, const std::int64_t unix_seconds)
+    {
+        const std::int64_t until_us = unix_seconds * 1000000;
+        std::array<std::int64_t, kVehicleTypeCount> occupied = {};
+        reader.forEachRecord([&](const BinaryLogRecord & record)
+        {
+            if (record.timestamp_us <= until_us && toIndex(record.vehicle_type) < occupied.size())
+            {
+                occupied[toIndex(record.vehicle_type)] += record.action == LogAction::Entry ? 1 : (record.action == LogAction::Exit ? -1 : 0);
+            }
+        });
+
+        std::cout << "Occupancy at " << formatTimestamp(until_us) << '\n';
+        for (VehicleType type : { VehicleType::Car, VehicleType::Motorcycle, VehicleType::Bus })
+        {
+            std::cout << toString(type) << ": " << occupied[toIndex(type)] << '\n';
+        }
+        return 0;
+    }
+
+    int queryForecast(const BinaryLogReader & reader, const std::int64_t unix_seconds, const std::array<int, kVehicleTypeCount> & capacity)
+    {
+        const std::int64_t until_us = unix_seconds * 1000000;
+        OccupancyForecaster forecaster;
+        std::array<int, kVehicleTypeCount> occupied = {};
+        reader.forEachRecord([&](const BinaryLogRecord & record)
+        {
+            if (record.timestamp_us > until_us || toIndex(record.vehicle_type) >= occupied.size() || record.action == LogAction::Unknown)
+            {
+                return;
+            }
+            ParkingEvent event;
+            event.vehicle_type = record.vehicle_type;
+            event.ticket_id = record.ticket_id;
+            if (record.action == LogAction::Entry)
+            {
+                event.type = ParkingEventType::Parked;
+                event.entry_time_us = record.timestamp_us;
+                ++occupied[toIndex(record.vehicle_type)];
+            }
+            else
+            {
+                event.type = ParkingEventType::Released;
+                event.exit_time_us = record.timestamp_us;
+                --occupied[toIndex(record.vehicle_type)];
+            }
+            forecaster.record(event, occupied[toIndex(record.vehicle_type)]);
+        });
+
+        const std::int64_t horizon_us = 24ll * 3600 * 1000000;
+        std::cout << "Forecast at " << formatTimestamp(until_us) << '\n';
+        for (VehicleType type : { VehicleType::Car, VehicleType::Motorcycle, VehicleType::Bus })
+        {
+            std::size_t index = toIndex(type);
+            std::int64_t time_to_full = forecaster.getTimeToFull(type, occupied[index], capacity[index], until_us, horizon_us);
+            std::cout << toString(type) << ": " << occupied[index] << " of " << capacity[index] << ", ";
+            if (time_to_full == OccupancyForecaster::kNotFull)
+            {
+                std::cout << "not full within 24 hours\n";
+            }
+            else
+            {
+                std::cout << "full in " << time_to_full / (60ll * 1000000) << " minutes\n";
+            }
+        }
+        return 0;
+    }
+}
+
+int main(int argc, char * argv[])
+{
+    if (argc < 4)
+    {
+        printUsage();
+        return 1;
+    }
+
+    BinaryLogReader reader(argv[1]);
+    if (reader.segmentCount() == 0)
+    {
+        std::cerr << "No binary log segments found for " << argv[1] << '\n';
+        return 1;
+    }
+
+    std::string command = argv[2];
+    if (command == "plate")
+    {
+        return queryPlate(reader, argv[3]);
+    }
+    if (command == "occupancy")
+    {
+        return queryOccupancy(reader, std::strtoll(argv[3], nullptr, 10));
+    }
+    if (command == "forecast" && argc == 7)
+    {
+        std::array<int, kVehicleTypeCount> capacity = { std::atoi(argv[4]), std::atoi(argv[5]), std::atoi(argv[6]) };
+        return queryForecast(reader, std::strtoll(argv[3], nullptr, 10), capacity);
+    }
+    printUsage();
+    return 1;
+}
\ No newline at end of file
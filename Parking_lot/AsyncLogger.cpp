@@ -0,0 +1,299 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#include "AsyncLogger.h"
+#include "BinaryLog.h"
+
+namespace
+{
+    /// \brief Copies a string into a fixed size field, truncating it if needed
+    template <std::size_t N>
+    void copyTruncated(char (&destination)[N], const std::string_view source)
+    {
+        std::size_t length = std::min(source.size(), N - 1);
+        std::memcpy(destination, source.data(), length);
+        destination[length] = '\0';
+    }
+}
+
+AsyncLogger::AsyncLogger(const AsyncLoggerConfig & config)
+    : m_config(config)
+{
+    std::size_t capacity = 2;
+    while (capacity < m_config.buffer_capacity)
+    {
+        capacity <<= 1;
+    }
+    m_mask = capacity - 1;
+    m_cells.reset(new Cell[capacity]);
+    for (std::size_t i = 0; i < capacity; ++i)
+    {
+        m_cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    if (m_config.flush_batch_size == 0)
+    {
+        m_config.flush_batch_size = 1;
+    }
+
+    if (m_config.format == LogFormat::Binary)
+    {
+        m_binary_writer.reset(new BinaryLogWriter(m_config.file_path, m_config.max_segment_size));
+    }
+    else
+    {
+        m_file.open(m_config.file_path, std::ios_base::app);
+    }
+    m_writer = std::thread(&AsyncLogger::writerLoop, this);
+}
+
+AsyncLogger::~AsyncLogger()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_wake_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_one();
+    m_writer.join();
+}
+
+bool AsyncLogger::log(const std::string_view action, const VehicleType vehicle_type, const std::string_view license_plate, const TicketID ticket_id,
+                      const std::int64_t timestamp_us)
+{
+    LogRecord record = makeRecord(action, vehicle_type, license_plate, ticket_id, timestamp_us);
+    while (!tryPush(record))
+    {
+        if (m_config.overflow_policy == LogOverflowPolicy::DropNewest)
+        {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        wakeWriter();
+        std::this_thread::yield();
+    }
+    return true;
+}
+
+std::size_t AsyncLogger::logBatch(const LogRecord * records, const std::size_t count)
+{
+    std::size_t capacity = m_mask + 1;
+    std::size_t queued = 0;
+    while (queued < count)
+    {
+        std::size_t chunk = std::min(count - queued, capacity);
+        if (tryPushBatch(records + queued, chunk))
+        {
+            queued += chunk;
+        }
+        else if (m_config.overflow_policy == LogOverflowPolicy::DropNewest)
+        {
+            m_dropped.fetch_add(count - queued, std::memory_order_relaxed);
+            break;
+        }
+        else
+        {
+            wakeWriter();
+            std::this_thread::yield();
+        }
+    }
+    return queued;
+}
+
+LogRecord AsyncLogger::makeRecord(const std::string_view action, const VehicleType vehicle_type, const std::string_view license_plate, const TicketID ticket_id,
+                                  const std::int64_t timestamp_us)
+{
+    LogRecord record;
+    copyTruncated(record.action, action);
+    record.vehicle_type = vehicle_type;
+    copyTruncated(record.license_plate, license_plate);
+    record.ticket_id = ticket_id;
+    record.timestamp_us = timestamp_us;
+    return record;
+}
+
+void AsyncLogger::flush()
+{
+    std::size_t target = m_enqueue_position.load(std::memory_order_acquire);
+    std::unique_lock<std::mutex> lock(m_wake_mutex);
+    while (m_flushed_position.load(std::memory_order_acquire) < target)
+    {
+        // A producer may still be filling its slot, so the request is repeated until the writer gets past it
+        m_flush_requested = true;
+        m_wake.notify_one();
+        m_flushed.wait_for(lock, m_config.flush_interval);
+    }
+}
+
+bool AsyncLogger::tryPush(const LogRecord & record)
+{
+    std::size_t position = m_enqueue_position.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        Cell & cell = m_cells[position & m_mask];
+        std::size_t sequence = cell.sequence.load(std::memory_order_acquire);
+        std::intptr_t difference = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position);
+        if (difference == 0)
+        {
+            if (m_enqueue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+            {
+                cell.record = record;
+                cell.sequence.store(position + 1, std::memory_order_release);
+
+                // A full batch is waiting, no need to let the writer sleep until the flush interval expires
+                if (position + 1 - m_dequeue_position.load(std::memory_order_relaxed) == m_config.flush_batch_size)
+                {
+                    wakeWriter();
+                }
+                return true;
+            }
+        }
+        else if (difference < 0)
+        {
+            // The writer has not consumed this slot yet, the buffer is full
+            return false;
+        }
+        else
+        {
+            position = m_enqueue_position.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+bool AsyncLogger::tryPushBatch(const LogRecord * records, const std::size_t count)
+{
+    std::size_t position = m_enqueue_position.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        // The writer frees slots in order, so the range is free if its first and last slots are
+        std::size_t first_sequence = m_cells[position & m_mask].sequence.load(std::memory_order_acquire);
+        std::size_t last_sequence = m_cells[(position + count - 1) & m_mask].sequence.load(std::memory_order_acquire);
+        std::intptr_t first_difference = static_cast<std::intptr_t>(first_sequence) - static_cast<std::intptr_t>(position);
+        std::intptr_t last_difference = static_cast<std::intptr_t>(last_sequence) - static_cast<std::intptr_t>(position + count - 1);
+        if (first_difference < 0 || last_difference < 0)
+        {
+            // The writer has not consumed these slots yet, the buffer is too full for the batch
+            return false;
+        }
+        if (first_difference > 0 || last_difference > 0)
+        {
+            position = m_enqueue_position.load(std::memory_order_relaxed);
+            continue;
+        }
+        if (m_enqueue_position.compare_exchange_weak(position, position + count, std::memory_order_relaxed))
+        {
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                Cell & cell = m_cells[(position + i) & m_mask];
+                cell.record = records[i];
+                cell.sequence.store(position + i + 1, std::memory_order_release);
+            }
+            if (position + count - m_dequeue_position.load(std::memory_order_relaxed) >= m_config.flush_batch_size)
+            {
+                wakeWriter();
+            }
+            return true;
+        }
+    }
+}
+
+bool AsyncLogger::tryPop(LogRecord & record)
+{
+    // Only the writer thread pops, so the dequeue position needs no compare-exchange
+    std::size_t position = m_dequeue_position.load(std::memory_order_relaxed);
+    Cell & cell = m_cells[position & m_mask];
+    std::size_t sequence = cell.sequence.load(std::memory_order_acquire);
+    if (static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position + 1) < 0)
+    {
+        return false;
+    }
+    record = cell.record;
+    cell.sequence.store(position + m_mask + 1, std::memory_order_release);
+    m_dequeue_position.store(position + 1, std::memory_order_relaxed);
+    return true;
+}
+
+void AsyncLogger::wakeWriter()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_wake_mutex);
+        m_wake_requested = true;
+    }
+    m_wake.notify_one();
+}
+
+void AsyncLogger::writerLoop()
+{
+    LogRecord record;
+    std::size_t unflushed = 0;
+    auto last_flush = std::chrono::steady_clock::now();
+
+    for (;;)
+    {
+        bool drained = false;
+        while (!drained && unflushed < m_config.flush_batch_size)
+        {
+            if (tryPop(record))
+            {
+                writeRecord(record);
+                ++unflushed;
+            }
+            else
+            {
+                drained = true;
+            }
+        }
+
+        bool stop = false;
+        bool flush_requested = false;
+        {
+            std::lock_guard<std::mutex> lock(m_wake_mutex);
+            stop = m_stop;
+            flush_requested = m_flush_requested;
+            m_flush_requested = false;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (unflushed >= m_config.flush_batch_size || stop || flush_requested
+            || (unflushed > 0 && now - last_flush >= m_config.flush_interval))
+        {
+            if (m_binary_writer)
+            {
+                m_binary_writer->flush();
+            }
+            else
+            {
+                m_file.flush();
+            }
+            unflushed = 0;
+            last_flush = now;
+            m_flushed_position.store(m_dequeue_position.load(std::memory_order_relaxed), std::memory_order_release);
+            {
+                std::lock_guard<std::mutex> lock(m_wake_mutex);
+            }
+            m_flushed.notify_all();
+        }
+
+        if (!drained)
+        {
+            continue;
+        }
+        if (stop)
+        {
+            break;
+        }
+
+        std::unique_lock<std::mutex> lock(m_wake_mutex);
+        m_wake.wait_for(lock, m_config.flush_interval, [this]() { return m_stop || m_wake_requested || m_flush_requested; });
+        m_wake_requested = false;
+    }
+}
+
+void AsyncLogger::writeRecord(const LogRecord & record)
+{
+    if (m_binary_writer)
+    {
+        m_binary_writer->write(record);
+        return;
+    }
+    m_file << record.action << ": Ticket ID " << record.ticket_id << ", " << toString(record.vehicle_type) << " with license plate " << record.license_plate << '\n';
+}
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "TicketID.h"
+#include "VehicleType.h"
+
+/// \brief What a producer does when the log buffer is full
+enum class LogOverflowPolicy
+{
+    Block,      ///< Wait until the writer thread frees a slot, no entry is lost
+    DropNewest  ///< Drop the new entry and count it, the producer never waits
+};
+
+/// \brief Format of the log file
+enum class LogFormat
+{
+    Text,   ///< One line per entry, appended to the file
+    Binary  ///< Fixed-width records in segment files, see BinaryLogWriter
+};
+
+class BinaryLogWriter;
+
+/// \brief Settings of the AsyncLogger
+struct AsyncLoggerConfig
+{
+    /// File the entries are appended to, the binary format derives its file names from it
+    std::string file_path = "parking_log.txt";
+
+    LogFormat format = LogFormat::Text;
+
+    /// Binary format only: a new segment is started once the current one reaches this size in bytes
+    std::size_t max_segment_size = 64 * 1024 * 1024;
+
+    /// Number of entries the buffer holds, rounded up to a power of two
+    std::size_t buffer_capacity = 4096;
+
+    /// The file is flushed after this many entries were written
+    std::size_t flush_batch_size = 256;
+
+    /// The file is flushed at least this often while there are unflushed entries
+    std::chrono::milliseconds flush_interval{ 100 };
+
+    LogOverflowPolicy overflow_policy = LogOverflowPolicy::Block;
+};
+
+/// \brief Fixed size log entry, longer strings are truncated
+struct LogRecord
+{
+    char action[8];
+    VehicleType vehicle_type;
+    char license_plate[32];
+    TicketID ticket_id;
+
+    /// Time of the entry or exit, microseconds since 1970-01-01 UTC
+    std::int64_t timestamp_us;
+};
+
+/// \brief Writes log entries to a file from a background thread
+/// Producers push entries into a lock-free ring buffer and return immediately,
+/// the writer thread keeps the file open and writes the entries in batches.
+class AsyncLogger
+{
+public:
+    /// \brief Constructor, opens the log file and starts the writer thread
+    /// \param[in] config Settings of the logger
+    explicit AsyncLogger(const AsyncLoggerConfig & config = AsyncLoggerConfig());
+
+    /// \brief Destructor, writes all pending entries and stops the writer thread
+    ~AsyncLogger();
+
+    AsyncLogger(const AsyncLogger &) = delete;
+    AsyncLogger & operator=(const AsyncLogger &) = delete;
+
+    /// \brief Queues a log entry, safe to call from any number of threads
+    /// \param[in] action Action (Entry or Exit)
+    /// \param[in] vehicle_type Type of the vehicle
+    /// \param[in] license_plate License plate of the vehicle
+    /// \param[in] ticket_id Ticket ID of the vehicle
+    /// \param[in] timestamp_us Time of the entry or exit, microseconds since 1970-01-01 UTC, e.g. from the parking lot's clock
+    /// \return Returns false if the entry was dropped because the buffer is full
+    bool log(const std::string_view action, const VehicleType vehicle_type, const std::string_view license_plate, const TicketID ticket_id,
+             const std::int64_t timestamp_us);
+
+    /// \brief Queues a group of log entries in one go, they stay together in the log file
+    /// \param[in] records Log entries, see makeRecord
+    /// \param[in] count Number of log entries
+    /// \return Returns the number of queued entries, the others were dropped because the buffer is full
+    std::size_t logBatch(const LogRecord * records, const std::size_t count);
+
+    /// \brief Builds a log entry for logBatch
+    static LogRecord makeRecord(const std::string_view action, const VehicleType vehicle_type, const std::string_view license_plate, const TicketID ticket_id,
+                                const std::int64_t timestamp_us);
+
+    /// \brief Blocks until all entries queued before the call are written and flushed to the file
+    void flush();
+
+    /// \brief Number of entries dropped because of LogOverflowPolicy::DropNewest
+    std::size_t droppedCount() const { return m_dropped.load(std::memory_order_relaxed); }
+
+private:
+    /// One slot of the ring buffer, the sequence tells whose turn it is to use the slot
+    struct Cell
+    {
+        std::atomic<std::size_t> sequence;
+        LogRecord record;
+    };
+
+    bool tryPush(const LogRecord & record);
+
+    /// \brief Claims consecutive slots for all records with a single compare-exchange
+    bool tryPushBatch(const LogRecord * records, const std::size_t count);
+    bool tryPop(LogRecord & record);
+
+    /// \brief Wakes the writer thread up before its flush interval expires
+    void wakeWriter();
+
+    /// \brief Body of the writer thread
+    void writerLoop();
+
+    void writeRecord(const LogRecord & record);
+
+private:
+    AsyncLoggerConfig m_config;
+    std::size_t m_mask;
+    std::unique_ptr<Cell[]> m_cells;
+
+    alignas(64) std::atomic<std::size_t> m_enqueue_position{ 0 };
+    alignas(64) std::atomic<std::size_t> m_dequeue_position{ 0 };
+    alignas(64) std::atomic<std::size_t> m_flushed_position{ 0 };
+    std::atomic<std::size_t> m_dropped{ 0 };
+
+    std::mutex m_wake_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_flushed;
+    bool m_wake_requested = false;
+    bool m_flush_requested = false;
+    bool m_stop = false;
+
+    std::ofstream m_file;
+    std::unique_ptr<BinaryLogWriter> m_binary_writer;
+    std::thread m_writer;
+};
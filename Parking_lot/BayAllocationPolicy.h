@@ -0,0 +1,158 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <tuple>
+#include <vector>
+
+#include "LotTopology.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+/// \brief The zones that have a free bay of one kind, handed to BayAllocationPolicy::chooseZone
+/// Zones are addressed by their rank, their position in the order of BayAllocationPolicy::rankZones. The view
+/// reads the counters of the ZonedBayAllocator while other gates allocate, so a zone may fill up meanwhile.
+class FreeZones
+{
+public:
+    /// Returned by next and first if no zone after the given rank has a free bay
+    static constexpr std::size_t kNone = static_cast<std::size_t>(-1);
+
+    /// \param[in] free_ranks One bit per rank, set if the zone may have a free bay
+    /// \param[in] free_bays Free bays per rank
+    /// \param[in] bay_counts Bays per rank
+    /// \param[in] rank_count Number of ranks, the number of zones
+    FreeZones(const std::atomic<std::uint64_t> * free_ranks, const std::atomic<int> * free_bays, const int * bay_counts, const std::size_t rank_count)
+        : m_free_ranks(free_ranks), m_free_bays(free_bays), m_bay_counts(bay_counts), m_rank_count(rank_count)
+    {
+    }
+
+    /// \brief Gets the best-ranked zone with a free bay
+    std::size_t first() const { return next(0); }
+
+    /// \brief Gets the best-ranked zone with a free bay at or after the given rank
+    std::size_t next(const std::size_t rank) const
+    {
+        std::size_t word_count = (m_rank_count + 63) / 64;
+        for (std::size_t word_index = rank / 64; word_index < word_count; ++word_index)
+        {
+            std::uint64_t word = m_free_ranks[word_index].load(std::memory_order_acquire);
+            if (word_index == rank / 64)
+            {
+                word &= ~std::uint64_t(0) << (rank % 64);
+            }
+            if (word != 0)
+            {
+                return word_index * 64 + lowestSetBit(word);
+            }
+        }
+        return kNone;
+    }
+
+    int freeBays(const std::size_t rank) const { return m_free_bays[rank].load(std::memory_order_relaxed); }
+    int bayCount(const std::size_t rank) const { return m_bay_counts[rank]; }
+    std::size_t rankCount() const { return m_rank_count; }
+
+private:
+    static std::size_t lowestSetBit(const std::uint64_t value)
+    {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward64(&index, value);
+        return index;
+#else
+        return static_cast<std::size_t>(__builtin_ctzll(value));
+#endif
+    }
+
+private:
+    const std::atomic<std::uint64_t> * m_free_ranks;
+    const std::atomic<int> * m_free_bays;
+    const int * m_bay_counts;
+    std::size_t m_rank_count;
+};
+
+/// \brief Abstract base class for the rules that pick the zone a vehicle is parked in
+/// rankZones orders the zones once when the ZonedBayAllocator is created; chooseZone is called by the gates for
+/// every vehicle, possibly from several threads at once, and must not allocate.
+class BayAllocationPolicy
+{
+public:
+    /// Destructor
+    virtual ~BayAllocationPolicy() {}
+
+    /// \brief Orders the zones of a topology by preference
+    /// \return Returns every zone index once, preferred zones first
+    virtual std::vector<std::size_t> rankZones(const LotTopology & topology) const = 0;
+
+    /// \brief Picks a zone with a free bay of the kind searched
+    /// \return Returns the rank of the zone or FreeZones::kNone, by default the best-ranked zone with a free bay
+    virtual std::size_t chooseZone(const FreeZones & free_zones) const { return free_zones.first(); }
+
+protected:
+    /// \brief Orders the zone indexes by the given key, ties keep the order the zones were added in
+    template <typename Key>
+    static std::vector<std::size_t> sortZones(const LotTopology & topology, Key key)
+    {
+        std::vector<std::size_t> zones(topology.zones().size());
+        std::iota(zones.begin(), zones.end(), std::size_t(0));
+        std::stable_sort(zones.begin(), zones.end(), [&](const std::size_t a, const std::size_t b) { return key(topology.zones()[a]) < key(topology.zones()[b]); });
+        return zones;
+    }
+};
+
+/// \brief Parks vehicles in the zone closest to the exit that has a free bay, the default
+class NearestToExitPolicy : public BayAllocationPolicy
+{
+public:
+    std::vector<std::size_t> rankZones(const LotTopology & topology) const override
+    {
+        return sortZones(topology, [](const ZoneSpec & zone) { return std::make_tuple(zone.distance_to_exit, zone.floor); });
+    }
+};
+
+/// \brief Fills the lowest floor first, so upper floors can be closed at quiet times
+class LowestFloorPolicy : public BayAllocationPolicy
+{
+public:
+    std::vector<std::size_t> rankZones(const LotTopology & topology) const override
+    {
+        return sortZones(topology, [](const ZoneSpec & zone) { return std::make_tuple(zone.floor, zone.distance_to_exit); });
+    }
+};
+
+/// \brief Parks vehicles in the zone with the largest share of free bays, spreading the traffic over all floors
+/// Looks at every zone with a free bay, which takes longer than the other policies on lots with hundreds of zones.
+class BalancedPolicy : public BayAllocationPolicy
+{
+public:
+    std::vector<std::size_t> rankZones(const LotTopology & topology) const override
+    {
+        return sortZones(topology, [](const ZoneSpec & zone) { return std::make_tuple(zone.floor, zone.distance_to_exit); });
+    }
+
+    std::size_t chooseZone(const FreeZones & free_zones) const override
+    {
+        // free / bays > best_free / best_bays without dividing
+        std::size_t best = FreeZones::kNone;
+        std::int64_t best_free = 0;
+        std::int64_t best_bays = 1;
+        for (std::size_t rank = free_zones.first(); rank != FreeZones::kNone; rank = free_zones.next(rank + 1))
+        {
+            std::int64_t free = free_zones.freeBays(rank);
+            std::int64_t bays = free_zones.bayCount(rank);
+            if (free * best_bays > best_free * bays)
+            {
+                best = rank;
+                best_free = free;
+                best_bays = bays;
+            }
+        }
+        return best;
+    }
+};
\ No newline at end of file
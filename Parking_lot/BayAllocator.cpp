@@ -0,0 +1,113 @@
+#include "BayAllocator.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace
+{
+    const std::size_t kBitsPerWord = 64;
+
+    /// \brief Index of the lowest set bit, the value must not be 0
+    inline std::size_t lowestSetBit(const std::uint64_t value)
+    {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward64(&index, value);
+        return index;
+#else
+        return static_cast<std::size_t>(__builtin_ctzll(value));
+#endif
+    }
+
+    /// \brief Word with the lowest count bits set
+    inline std::uint64_t lowBits(const std::size_t count)
+    {
+        return count >= kBitsPerWord ? ~std::uint64_t(0) : (std::uint64_t(1) << count) - 1;
+    }
+}
+
+BayAllocator::BayAllocator(const int bay_count)
+    : m_bay_count(bay_count > 0 ? bay_count : 0),
+      m_word_count((static_cast<std::size_t>(m_bay_count) + kBitsPerWord - 1) / kBitsPerWord),
+      m_summary_count((m_word_count + kBitsPerWord - 1) / kBitsPerWord),
+      m_words(new std::atomic<std::uint64_t>[m_word_count]),
+      m_summary(new std::atomic<std::uint64_t>[m_summary_count])
+{
+    for (std::size_t word = 0; word < m_word_count; ++word)
+    {
+        m_words[word].store(lowBits(m_bay_count - word * kBitsPerWord), std::memory_order_relaxed);
+    }
+    for (std::size_t summary = 0; summary < m_summary_count; ++summary)
+    {
+        m_summary[summary].store(lowBits(m_word_count - summary * kBitsPerWord), std::memory_order_relaxed);
+    }
+}
+
+int BayAllocator::allocate()
+{
+    for (std::size_t summary_index = 0; summary_index < m_summary_count; ++summary_index)
+    {
+        std::uint64_t summary = m_summary[summary_index].load(std::memory_order_acquire);
+        while (summary != 0)
+        {
+            std::size_t word_index = summary_index * kBitsPerWord + lowestSetBit(summary);
+            std::atomic<std::uint64_t> & word = m_words[word_index];
+            std::uint64_t bays = word.load(std::memory_order_relaxed);
+            while (bays != 0)
+            {
+                std::uint64_t bay_bit = bays & (~bays + 1);
+                if (word.compare_exchange_weak(bays, bays & ~bay_bit, std::memory_order_acq_rel, std::memory_order_relaxed))
+                {
+                    if ((bays & ~bay_bit) == 0)
+                    {
+                        clearSummary(word_index);
+                    }
+                    return static_cast<int>(word_index * kBitsPerWord + lowestSetBit(bay_bit));
+                }
+            }
+
+            // Taken by other threads in the meantime, go on with the next word
+            summary &= summary - 1;
+        }
+    }
+    return kNoBay;
+}
+
+bool BayAllocator::acquire(const int bay)
+{
+    std::size_t word_index = static_cast<std::size_t>(bay) / kBitsPerWord;
+    std::uint64_t bay_bit = std::uint64_t(1) << (bay % kBitsPerWord);
+    std::uint64_t bays = m_words[word_index].fetch_and(~bay_bit, std::memory_order_acq_rel);
+    if ((bays & ~bay_bit) == 0)
+    {
+        clearSummary(word_index);
+    }
+    return (bays & bay_bit) != 0;
+}
+
+void BayAllocator::release(const int bay)
+{
+    std::size_t word_index = static_cast<std::size_t>(bay) / kBitsPerWord;
+    m_words[word_index].fetch_or(std::uint64_t(1) << (bay % kBitsPerWord), std::memory_order_release);
+    m_summary[word_index / kBitsPerWord].fetch_or(std::uint64_t(1) << (word_index % kBitsPerWord), std::memory_order_release);
+}
+
+bool BayAllocator::isFree(const int bay) const
+{
+    std::size_t word_index = static_cast<std::size_t>(bay) / kBitsPerWord;
+    return (m_words[word_index].load(std::memory_order_acquire) >> (bay % kBitsPerWord)) & 1;
+}
+
+void BayAllocator::clearSummary(const std::size_t word_index)
+{
+    std::atomic<std::uint64_t> & summary = m_summary[word_index / kBitsPerWord];
+    std::uint64_t summary_bit = std::uint64_t(1) << (word_index % kBitsPerWord);
+    summary.fetch_and(~summary_bit, std::memory_order_acq_rel);
+
+    // A bay of the word may have been released before the bit was cleared, its release must stay visible
+    if (m_words[word_index].load(std::memory_order_acquire) != 0)
+    {
+        summary.fetch_or(summary_bit, std::memory_order_release);
+    }
+}
\ No newline at end of file
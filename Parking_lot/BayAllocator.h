@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/// \brief Tracks which bays of one vehicle type are free, safe to use from any number of threads
+/// Every bay is one bit in an array of 64-bit words and a summary word marks the words that may
+/// still have a free bay, so finding the first free bay of a 100k bay lot scans at most a few
+/// dozen summary words and one word of bays. Allocation always picks the lowest free bay.
+class BayAllocator
+{
+public:
+    /// Returned by allocate if every bay is taken
+    static constexpr int kNoBay = -1;
+
+    /// \brief Constructor, all bays are free
+    /// \param[in] bay_count Number of bays
+    explicit BayAllocator(const int bay_count);
+
+    /// \brief Takes the lowest free bay
+    /// \return Returns the bay index (0 to bayCount() - 1) or kNoBay
+    int allocate();
+
+    /// \brief Takes a specific bay, e.g. to restore a parked vehicle
+    /// \return Returns false if the bay is already taken
+    bool acquire(const int bay);
+
+    /// \brief Frees a bay taken by allocate
+    void release(const int bay);
+
+    /// \brief Whether the bay is free
+    bool isFree(const int bay) const;
+
+    int bayCount() const { return m_bay_count; }
+
+private:
+    /// \brief Clears the summary bit of a word that ran out of free bays
+    void clearSummary(const std::size_t word);
+
+private:
+    int m_bay_count;
+    std::size_t m_word_count;
+    std::size_t m_summary_count;
+
+    /// One bit per bay, set if the bay is free
+    std::unique_ptr<std::atomic<std::uint64_t>[]> m_words;
+
+    /// One bit per word of m_words, set if the word may have a free bay
+    std::unique_ptr<std::atomic<std::uint64_t>[]> m_summary;
+};
\ No newline at end of file
@@ -0,0 +1,254 @@
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+
+#include "BinaryLog.h"
+
+namespace
+{
+    /// Segment header: magic, record size, unused bytes up to the size of a record
+    const char kSegmentMagic[8] = { 'P', 'L', 'B', 'L', 'O', 'G', '0', '2' };
+    const std::size_t kSegmentHeaderSize = sizeof(BinaryLogRecord);
+
+    /// Records are written to the segment file in blocks of this size
+    const std::size_t kSegmentBufferSize = 1 << 20;
+
+    LogAction toLogAction(const char * action)
+    {
+        if (std::strcmp(action, "Entry") == 0)
+        {
+            return LogAction::Entry;
+        }
+        if (std::strcmp(action, "Exit") == 0)
+        {
+            return LogAction::Exit;
+        }
+        return LogAction::Unknown;
+    }
+}
+
+BinaryLogWriter::BinaryLogWriter(const std::string & log_path, const std::size_t max_segment_size)
+    : m_log_path(log_path), m_max_segment_size(std::max(max_segment_size, kSegmentHeaderSize + sizeof(BinaryLogRecord)))
+{
+    // Dictionary entries are a length byte and the license plate, a torn entry at the end is cut off
+    std::string dictionary_path = dictionaryPath(log_path);
+    std::size_t intact_size = 0;
+    {
+        MappedFile dictionary(dictionary_path);
+        while (intact_size < dictionary.size() && intact_size + 1 + static_cast<unsigned char>(dictionary.data()[intact_size]) <= dictionary.size())
+        {
+            std::size_t length = static_cast<unsigned char>(dictionary.data()[intact_size]);
+            std::string license_plate(dictionary.data() + intact_size + 1, length);
+            m_plate_ids.emplace(license_plate, static_cast<std::uint32_t>(m_plate_ids.size()));
+            intact_size += 1 + length;
+        }
+    }
+    std::error_code error;
+    if (std::filesystem::exists(dictionary_path, error) && std::filesystem::file_size(dictionary_path, error) != intact_size)
+    {
+        std::filesystem::resize_file(dictionary_path, intact_size, error);
+    }
+    m_dictionary = std::fopen(dictionary_path.c_str(), "ab");
+    m_buffer.reserve(kSegmentBufferSize);
+
+    std::vector<std::string> segments = segmentPaths(log_path);
+    if (!segments.empty())
+    {
+        m_segment_index = std::stoull(segments.back().substr(log_path.size() + 1)) + 1;
+    }
+    openSegment();
+}
+
+BinaryLogWriter::~BinaryLogWriter()
+{
+    writeBuffer();
+    if (m_dictionary)
+    {
+        std::fclose(m_dictionary);
+    }
+    if (m_segment)
+    {
+        std::fclose(m_segment);
+    }
+}
+
+void BinaryLogWriter::write(const LogRecord & record)
+{
+    if (!m_segment)
+    {
+        return;
+    }
+    if (m_segment_size + sizeof(BinaryLogRecord) > m_max_segment_size)
+    {
+        writeBuffer();
+        std::fclose(m_segment);
+        ++m_segment_index;
+        openSegment();
+        if (!m_segment)
+        {
+            return;
+        }
+    }
+
+    BinaryLogRecord binary_record = {};
+    binary_record.timestamp_us = record.timestamp_us;
+    binary_record.ticket_id = record.ticket_id;
+    binary_record.plate_id = intern(record.license_plate);
+    binary_record.action = toLogAction(record.action);
+    binary_record.vehicle_type = record.vehicle_type;
+    const char * bytes = reinterpret_cast<const char *>(&binary_record);
+    m_buffer.insert(m_buffer.end(), bytes, bytes + sizeof(binary_record));
+    m_segment_size += sizeof(binary_record);
+    if (m_buffer.size() >= kSegmentBufferSize)
+    {
+        writeBuffer();
+    }
+}
+
+void BinaryLogWriter::flush()
+{
+    writeBuffer();
+    if (m_segment)
+    {
+        std::fflush(m_segment);
+    }
+}
+
+void BinaryLogWriter::writeBuffer()
+{
+    // The dictionary first, so a written record never refers to a license plate that is not in the file
+    if (m_dictionary)
+    {
+        std::fflush(m_dictionary);
+    }
+    if (m_segment && !m_buffer.empty())
+    {
+        std::fwrite(m_buffer.data(), 1, m_buffer.size(), m_segment);
+    }
+    m_buffer.clear();
+}
+
+std::string BinaryLogWriter::segmentPath(const std::string & log_path, const std::size_t index)
+{
+    return log_path + "." + std::to_string(index);
+}
+
+std::string BinaryLogWriter::dictionaryPath(const std::string & log_path)
+{
+    return log_path + ".plates";
+}
+
+std::vector<std::string> BinaryLogWriter::segmentPaths(const std::string & log_path)
+{
+    std::filesystem::path path(log_path);
+    std::filesystem::path directory = path.has_parent_path() ? path.parent_path() : std::filesystem::path(".");
+    std::string prefix = path.filename().string() + ".";
+
+    std::vector<std::pair<std::size_t, std::string>> segments;
+    std::error_code error;
+    for (std::filesystem::directory_iterator it(directory, error), end; !error && it != end; it.increment(error))
+    {
+        std::string file_name = it->path().filename().string();
+        if (file_name.size() > prefix.size() && file_name.compare(0, prefix.size(), prefix) == 0
+            && std::all_of(file_name.begin() + prefix.size(), file_name.end(), [](char c) { return c >= '0' && c <= '9'; }))
+        {
+            std::size_t index = std::stoull(file_name.substr(prefix.size()));
+            segments.emplace_back(index, segmentPath(log_path, index));
+        }
+    }
+    std::sort(segments.begin(), segments.end());
+
+    std::vector<std::string> segment_paths;
+    for (auto & segment : segments)
+    {
+        segment_paths.push_back(std::move(segment.second));
+    }
+    return segment_paths;
+}
+
+std::uint32_t BinaryLogWriter::intern(const std::string_view license_plate)
+{
+    // Looked up by std::string because heterogeneous lookup of unordered_map needs C++20
+    std::string key(license_plate);
+    auto it = m_plate_ids.find(key);
+    if (it != m_plate_ids.end())
+    {
+        return it->second;
+    }
+
+    std::uint32_t plate_id = static_cast<std::uint32_t>(m_plate_ids.size());
+    m_plate_ids.emplace(std::move(key), plate_id);
+    if (m_dictionary)
+    {
+        unsigned char length = static_cast<unsigned char>(license_plate.size());
+        std::fputc(length, m_dictionary);
+        std::fwrite(license_plate.data(), 1, length, m_dictionary);
+    }
+    return plate_id;
+}
+
+void BinaryLogWriter::openSegment()
+{
+    m_segment = std::fopen(segmentPath(m_log_path, m_segment_index).c_str(), "wb");
+    m_segment_size = 0;
+    if (!m_segment)
+    {
+        return;
+    }
+
+    // Records are buffered by the writer, see writeBuffer
+    std::setvbuf(m_segment, nullptr, _IONBF, 0);
+
+    char header[kSegmentHeaderSize] = {};
+    std::memcpy(header, kSegmentMagic, sizeof(kSegmentMagic));
+    std::uint32_t record_size = sizeof(BinaryLogRecord);
+    std::memcpy(header + sizeof(kSegmentMagic), &record_size, sizeof(record_size));
+    m_buffer.insert(m_buffer.end(), header, header + kSegmentHeaderSize);
+    m_segment_size = kSegmentHeaderSize;
+}
+
+BinaryLogReader::BinaryLogReader(const std::string & log_path)
+    : m_segment_paths(BinaryLogWriter::segmentPaths(log_path)),
+      m_dictionary(new MappedFile(BinaryLogWriter::dictionaryPath(log_path)))
+{
+    const char * data = m_dictionary->data();
+    std::size_t offset = 0;
+    while (offset < m_dictionary->size() && offset + 1 + static_cast<unsigned char>(data[offset]) <= m_dictionary->size())
+    {
+        std::size_t length = static_cast<unsigned char>(data[offset]);
+        std::string_view license_plate(data + offset + 1, length);
+        m_plate_ids.emplace(license_plate, static_cast<std::uint32_t>(m_plates.size()));
+        m_plates.push_back(license_plate);
+        offset += 1 + length;
+    }
+}
+
+std::uint32_t BinaryLogReader::findPlate(const std::string_view license_plate) const
+{
+    auto it = m_plate_ids.find(license_plate);
+    return it != m_plate_ids.end() ? it->second : kUnknownPlate;
+}
+
+std::string_view BinaryLogReader::plate(const std::uint32_t plate_id) const
+{
+    return plate_id < m_plates.size() ? m_plates[plate_id] : std::string_view();
+}
+
+const BinaryLogRecord * BinaryLogReader::recordsOf(const MappedFile & segment, std::size_t & count)
+{
+    count = 0;
+    std::uint32_t record_size = 0;
+    if (!segment.data() || segment.size() < kSegmentHeaderSize || std::memcmp(segment.data(), kSegmentMagic, sizeof(kSegmentMagic)) != 0)
+    {
+        return nullptr;
+    }
+    std::memcpy(&record_size, segment.data() + sizeof(kSegmentMagic), sizeof(record_size));
+    if (record_size != sizeof(BinaryLogRecord))
+    {
+        return nullptr;
+    }
+
+    // A record torn by a crash at the end of the segment is not counted
+    count = (segment.size() - kSegmentHeaderSize) / sizeof(BinaryLogRecord);
+    return reinterpret_cast<const BinaryLogRecord *>(segment.data() + kSegmentHeaderSize);
+}
\ No newline at end of file
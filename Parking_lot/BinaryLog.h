@@ -0,0 +1,144 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "AsyncLogger.h"
+#include "MappedFile.h"
+#include "TicketID.h"
+#include "VehicleType.h"
+
+/// \brief Action of a binary log record
+enum class LogAction : std::uint8_t
+{
+    Unknown = 0,
+    Entry = 1,
+    Exit = 2
+};
+
+/// \brief Fixed-width record of the binary log format, segments are arrays of it after a header
+/// License plates are stored once in the dictionary file <log path>.plates and referenced by their index.
+/// Integers are in host byte order.
+struct BinaryLogRecord
+{
+    /// Microseconds since 1970-01-01 UTC
+    std::int64_t timestamp_us;
+    TicketID ticket_id;
+    std::uint32_t plate_id;
+    LogAction action;
+    VehicleType vehicle_type;
+    std::uint8_t reserved[2];
+};
+
+static_assert(sizeof(BinaryLogRecord) == 24, "Binary log records are read from the file as they are");
+
+/// \brief Writes binary log segments <log path>.<index> and the license plate dictionary, not thread-safe
+/// Used by the writer thread of the AsyncLogger. A new segment is started when the current one is full
+/// and every time the writer is created, so existing segments are never appended to.
+/// Records are collected in a buffer of the writer and the dictionary is flushed before the buffer is written,
+/// so a record in a segment file never refers to a license plate that is not in the dictionary file.
+class BinaryLogWriter
+{
+public:
+    /// \brief Constructor, loads the license plate dictionary and creates the next segment
+    /// \param[in] log_path Path the segment and dictionary file names are derived from
+    /// \param[in] max_segment_size A new segment is started once the current one reaches this size
+    BinaryLogWriter(const std::string & log_path, const std::size_t max_segment_size);
+
+    /// \brief Destructor, flushes and closes the files
+    ~BinaryLogWriter();
+
+    BinaryLogWriter(const BinaryLogWriter &) = delete;
+    BinaryLogWriter & operator=(const BinaryLogWriter &) = delete;
+
+    void write(const LogRecord & record);
+    void flush();
+
+    /// \brief Path of the segment with the given index
+    static std::string segmentPath(const std::string & log_path, const std::size_t index);
+
+    /// \brief Path of the license plate dictionary
+    static std::string dictionaryPath(const std::string & log_path);
+
+    /// \brief Paths of all segments in the order they were written
+    static std::vector<std::string> segmentPaths(const std::string & log_path);
+
+private:
+    /// \brief Gets the index of a license plate in the dictionary, adding it if needed
+    std::uint32_t intern(const std::string_view license_plate);
+
+    void openSegment();
+
+    /// \brief Writes the buffered records to the segment, after the license plates they refer to
+    void writeBuffer();
+
+private:
+    std::string m_log_path;
+    std::size_t m_max_segment_size;
+
+    std::FILE * m_segment = nullptr;
+    std::size_t m_segment_index = 0;
+    std::size_t m_segment_size = 0;
+
+    /// Records not written to the segment yet
+    std::vector<char> m_buffer;
+
+    std::FILE * m_dictionary = nullptr;
+    std::unordered_map<std::string, std::uint32_t> m_plate_ids;
+};
+
+/// \brief Reads binary log segments through memory mappings
+class BinaryLogReader
+{
+public:
+    /// Returned by findPlate for license plates that are not in the dictionary
+    static constexpr std::uint32_t kUnknownPlate = 0xFFFFFFFFu;
+
+    /// \brief Constructor, maps the license plate dictionary and finds the segments
+    /// \param[in] log_path Path the log was written to, see AsyncLoggerConfig::file_path
+    explicit BinaryLogReader(const std::string & log_path);
+
+    /// \brief Gets the dictionary index of a license plate
+    /// \return Returns the index or kUnknownPlate
+    std::uint32_t findPlate(const std::string_view license_plate) const;
+
+    /// \brief Gets the license plate with the given dictionary index
+    std::string_view plate(const std::uint32_t plate_id) const;
+
+    std::size_t segmentCount() const { return m_segment_paths.size(); }
+
+    /// \brief Calls visit for every record of every segment in the order they were written
+    /// Every segment is mapped in turn and its records are read directly from the mapping.
+    template <typename Visit>
+    void forEachRecord(Visit visit) const
+    {
+        for (const auto & segment_path : m_segment_paths)
+        {
+            MappedFile segment(segment_path);
+            std::size_t count = 0;
+            const BinaryLogRecord * records = recordsOf(segment, count);
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                visit(records[i]);
+            }
+        }
+    }
+
+private:
+    /// \brief Checks the segment header and gets the complete records after it
+    static const BinaryLogRecord * recordsOf(const MappedFile & segment, std::size_t & count);
+
+private:
+    std::vector<std::string> m_segment_paths;
+    std::unique_ptr<MappedFile> m_dictionary;
+
+    /// Views into the dictionary mapping, indexed by plate ID
+    std::vector<std::string_view> m_plates;
+    std::unordered_map<std::string_view, std::uint32_t> m_plate_ids;
+};
\ No newline at end of file
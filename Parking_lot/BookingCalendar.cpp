@@ -0,0 +1,380 @@
+#include <algorithm>
+#include <limits>
+#include <string>
+
+#include "BookingCalendar.h"
+#include "BookingException.h"
+#include "InvalidVehicleTypeException.h"
+
+namespace
+{
+    /// \brief Rounds the quotient towards minus infinity, also for times before 1970
+    inline std::int64_t floorDivide(const std::int64_t value, const std::int64_t divisor)
+    {
+        std::int64_t quotient = value / divisor;
+        return quotient * divisor > value ? quotient - 1 : quotient;
+    }
+
+    inline void checkVehicleType(const VehicleType vehicle_type)
+    {
+        if (toIndex(vehicle_type) >= kVehicleTypeCount)
+        {
+            throw InvalidVehicleTypeException("Invalid vehicle type: " + std::to_string(toIndex(vehicle_type)));
+        }
+    }
+}
+
+BookingCalendar::RangeMaxTree::RangeMaxTree(const std::size_t size)
+    : m_size(size), m_max(4 * size, 0), m_added(4 * size, 0)
+{
+}
+
+void BookingCalendar::RangeMaxTree::add(const std::size_t from, const std::size_t to, const int value)
+{
+    add(1, 0, m_size, from, to, value);
+}
+
+int BookingCalendar::RangeMaxTree::max(const std::size_t from, const std::size_t to) const
+{
+    return max(1, 0, m_size, from, to);
+}
+
+void BookingCalendar::RangeMaxTree::clear()
+{
+    std::fill(m_max.begin(), m_max.end(), 0);
+    std::fill(m_added.begin(), m_added.end(), 0);
+}
+
+void BookingCalendar::RangeMaxTree::add(const std::size_t node, const std::size_t low, const std::size_t high, const std::size_t from,
+                                        const std::size_t to, const int value)
+{
+    if (to <= low || high <= from)
+    {
+        return;
+    }
+    if (from <= low && high <= to)
+    {
+        m_max[node] += value;
+        m_added[node] += value;
+        return;
+    }
+    std::size_t middle = low + (high - low) / 2;
+    add(2 * node, low, middle, from, to, value);
+    add(2 * node + 1, middle, high, from, to, value);
+    m_max[node] = std::max(m_max[2 * node], m_max[2 * node + 1]) + m_added[node];
+}
+
+int BookingCalendar::RangeMaxTree::max(const std::size_t node, const std::size_t low, const std::size_t high, const std::size_t from,
+                                       const std::size_t to) const
+{
+    if (to <= low || high <= from)
+    {
+        return std::numeric_limits<int>::min();
+    }
+    if (from <= low && high <= to)
+    {
+        return m_max[node];
+    }
+    std::size_t middle = low + (high - low) / 2;
+    return std::max(max(2 * node, low, middle, from, to), max(2 * node + 1, middle, high, from, to)) + m_added[node];
+}
+
+BookingCalendar::BookingCalendar(const std::array<int, kVehicleTypeCount> & capacity, const BookingConfig & config)
+    : m_capacity(capacity), m_bucket_us(std::max<std::int64_t>(config.bucket_us, 1)), m_bucket_count(std::max<std::size_t>(config.bucket_count, 1)),
+      m_booked(kVehicleTypeCount, RangeMaxTree(m_bucket_count)), m_current_bucket(std::numeric_limits<std::int64_t>::min())
+{
+    for (auto & held : m_held)
+    {
+        held.store(0);
+    }
+}
+
+int BookingCalendar::getFreeBays(const VehicleType vehicle_type, const std::int64_t from_us, const std::int64_t to_us, const std::int64_t now_us)
+{
+    checkVehicleType(vehicle_type);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    advance(bucketOf(now_us));
+    std::pair<std::int64_t, std::int64_t> buckets = toBuckets(from_us, to_us);
+    return m_capacity[toIndex(vehicle_type)] - maxOfBuckets(vehicle_type, buckets.first, buckets.second);
+}
+
+BookingID BookingCalendar::book(const VehicleType vehicle_type, const std::string_view license_plate, const std::int64_t from_us,
+                                const std::int64_t to_us, const std::int64_t now_us)
+{
+    checkVehicleType(vehicle_type);
+    LicensePlate plate(license_plate);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    advance(bucketOf(now_us));
+    std::pair<std::int64_t, std::int64_t> buckets = toBuckets(from_us, to_us);
+    if (maxOfBuckets(vehicle_type, buckets.first, buckets.second) >= m_capacity[toIndex(vehicle_type)])
+    {
+        return kNoBooking;
+    }
+
+    std::uint32_t slot = 0;
+    if (m_free_slots.empty())
+    {
+        slot = static_cast<std::uint32_t>(m_bookings.size());
+        m_bookings.emplace_back();
+    }
+    else
+    {
+        slot = m_free_slots.back();
+        m_free_slots.pop_back();
+    }
+    Booking & booking = m_bookings[slot];
+    booking.license_plate = plate;
+    booking.type = vehicle_type;
+    booking.from_bucket = buckets.first;
+    booking.to_bucket = buckets.second;
+    booking.active = true;
+    m_by_license_plate.emplace(plate.hash(), slot);
+    m_ends.emplace(booking.to_bucket, toID(booking));
+
+    // The size is raised before the held bays, a gate that parked a vehicle meanwhile either sees the booking
+    // when it checks the held bays again or has already raised the count of parked vehicles the lot checks next
+    m_size.fetch_add(1);
+    addToBuckets(vehicle_type, booking.from_bucket, booking.to_bucket, 1);
+    updateHeldBays(vehicle_type);
+    return toID(booking);
+}
+
+bool BookingCalendar::cancel(const BookingID booking_id, const std::int64_t now_us)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    advance(bucketOf(now_us));
+    Booking * booking = find(booking_id);
+    if (!booking)
+    {
+        return false;
+    }
+    remove(*booking);
+    updateHeldBays(booking->type);
+    return true;
+}
+
+BookingID BookingCalendar::findHeld(const VehicleType vehicle_type, const std::string_view license_plate, const std::int64_t now_us)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::int64_t bucket = bucketOf(now_us);
+    advance(bucket);
+    auto range = m_by_license_plate.equal_range(LicensePlate::hash(license_plate));
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        const Booking & booking = m_bookings[it->second];
+        if (booking.type == vehicle_type && booking.from_bucket <= bucket && booking.license_plate.view() == license_plate)
+        {
+            return toID(booking);
+        }
+    }
+    return kNoBooking;
+}
+
+bool BookingCalendar::arrive(const BookingID booking_id, const std::int64_t now_us)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::int64_t bucket = bucketOf(now_us);
+    advance(bucket);
+    Booking * booking = find(booking_id);
+    if (!booking || booking->from_bucket > bucket || booking->arrived)
+    {
+        return false;
+    }
+    booking->arrived = true;
+    ++m_arrived[toIndex(booking->type)];
+    updateHeldBays(booking->type);
+    return true;
+}
+
+void BookingCalendar::leave(const BookingID booking_id)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Booking * booking = find(booking_id);
+    if (booking && booking->arrived)
+    {
+        booking->arrived = false;
+        --m_arrived[toIndex(booking->type)];
+        updateHeldBays(booking->type);
+    }
+}
+
+bool BookingCalendar::claim(const BookingID booking_id, const std::int64_t now_us)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::int64_t bucket = bucketOf(now_us);
+    advance(bucket);
+    Booking * booking = find(booking_id);
+    if (!booking || booking->from_bucket > bucket)
+    {
+        return false;
+    }
+    remove(*booking);
+    updateHeldBays(booking->type);
+    return true;
+}
+
+int BookingCalendar::getHeldBays(const VehicleType vehicle_type, const std::int64_t now_us)
+{
+    std::int64_t bucket = bucketOf(now_us);
+    if (bucket > m_current_bucket.load(std::memory_order_acquire))
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        advance(bucket);
+    }
+    return m_held[toIndex(vehicle_type)].load();
+}
+
+std::int64_t BookingCalendar::bucketOf(const std::int64_t time_us) const
+{
+    return floorDivide(time_us, m_bucket_us);
+}
+
+std::pair<std::int64_t, std::int64_t> BookingCalendar::toBuckets(const std::int64_t from_us, const std::int64_t to_us) const
+{
+    if (from_us >= to_us)
+    {
+        throw BookingException("Booking interval " + std::to_string(from_us) + " to " + std::to_string(to_us) + " is empty.");
+    }
+
+    std::int64_t current_bucket = m_current_bucket.load(std::memory_order_relaxed);
+    std::int64_t from = std::max(bucketOf(from_us), current_bucket);
+    std::int64_t to = bucketOf(to_us - 1) + 1;
+    if (to <= current_bucket)
+    {
+        throw BookingException("Booking interval " + std::to_string(from_us) + " to " + std::to_string(to_us) + " is over.");
+    }
+    if (to - current_bucket > static_cast<std::int64_t>(m_bucket_count))
+    {
+        throw BookingException("Booking interval " + std::to_string(from_us) + " to " + std::to_string(to_us) + " ends beyond the "
+            + std::to_string(m_bucket_count) + " buckets that can be booked.");
+    }
+    return std::make_pair(from, to);
+}
+
+void BookingCalendar::advance(const std::int64_t bucket)
+{
+    std::int64_t current_bucket = m_current_bucket.load(std::memory_order_relaxed);
+    if (bucket <= current_bucket)
+    {
+        return;
+    }
+
+    // The buckets that passed become the end of the horizon, bookings never reach that far yet
+    if (current_bucket == std::numeric_limits<std::int64_t>::min() || bucket - current_bucket >= static_cast<std::int64_t>(m_bucket_count))
+    {
+        for (auto & booked : m_booked)
+        {
+            booked.clear();
+        }
+    }
+    else
+    {
+        for (std::int64_t passed = current_bucket; passed < bucket; ++passed)
+        {
+            for (std::size_t index = 0; index < kVehicleTypeCount; ++index)
+            {
+                VehicleType vehicle_type = static_cast<VehicleType>(index);
+                addToBuckets(vehicle_type, passed, passed + 1, -maxOfBuckets(vehicle_type, passed, passed + 1));
+            }
+        }
+    }
+    m_current_bucket.store(bucket, std::memory_order_release);
+
+    // Their buckets were cleared above, the held bays are updated once all of them are removed
+    while (!m_ends.empty() && m_ends.top().first <= bucket)
+    {
+        Booking * booking = find(m_ends.top().second);
+        m_ends.pop();
+        if (booking)
+        {
+            remove(*booking);
+        }
+    }
+
+    for (std::size_t index = 0; index < kVehicleTypeCount; ++index)
+    {
+        updateHeldBays(static_cast<VehicleType>(index));
+    }
+}
+
+void BookingCalendar::addToBuckets(const VehicleType vehicle_type, const std::int64_t from, const std::int64_t to, const int value)
+{
+    if (from >= to)
+    {
+        return;
+    }
+
+    // The buckets may wrap around the end of the ring
+    RangeMaxTree & booked = m_booked[toIndex(vehicle_type)];
+    std::size_t first = static_cast<std::size_t>(from % static_cast<std::int64_t>(m_bucket_count));
+    std::size_t length = static_cast<std::size_t>(to - from);
+    booked.add(first, std::min(first + length, m_bucket_count), value);
+    if (first + length > m_bucket_count)
+    {
+        booked.add(0, first + length - m_bucket_count, value);
+    }
+}
+
+int BookingCalendar::maxOfBuckets(const VehicleType vehicle_type, const std::int64_t from, const std::int64_t to) const
+{
+    const RangeMaxTree & booked = m_booked[toIndex(vehicle_type)];
+    std::size_t first = static_cast<std::size_t>(from % static_cast<std::int64_t>(m_bucket_count));
+    std::size_t length = static_cast<std::size_t>(to - from);
+    int result = booked.max(first, std::min(first + length, m_bucket_count));
+    if (first + length > m_bucket_count)
+    {
+        result = std::max(result, booked.max(0, first + length - m_bucket_count));
+    }
+    return result;
+}
+
+void BookingCalendar::updateHeldBays(const VehicleType vehicle_type)
+{
+    // The bays of arrived bookings are in the buckets until they are claimed, their vehicles are already counted
+    std::int64_t current_bucket = m_current_bucket.load(std::memory_order_relaxed);
+    std::size_t index = toIndex(vehicle_type);
+    m_held[index].store(maxOfBuckets(vehicle_type, current_bucket, current_bucket + 1) - m_arrived[index]);
+}
+
+BookingCalendar::Booking * BookingCalendar::find(const BookingID booking_id)
+{
+    std::uint64_t slot = (booking_id & 0xffffffffu) - 1;
+    if (booking_id == kNoBooking || slot >= m_bookings.size())
+    {
+        return nullptr;
+    }
+    Booking & booking = m_bookings[slot];
+    return booking.active && toID(booking) == booking_id ? &booking : nullptr;
+}
+
+void BookingCalendar::remove(Booking & booking)
+{
+    std::uint32_t slot = static_cast<std::uint32_t>(&booking - m_bookings.data());
+    addToBuckets(booking.type, std::max(booking.from_bucket, m_current_bucket.load(std::memory_order_relaxed)), booking.to_bucket, -1);
+    if (booking.arrived)
+    {
+        booking.arrived = false;
+        --m_arrived[toIndex(booking.type)];
+    }
+
+    auto range = m_by_license_plate.equal_range(booking.license_plate.hash());
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        if (it->second == slot)
+        {
+            m_by_license_plate.erase(it);
+            break;
+        }
+    }
+
+    booking.active = false;
+    ++booking.generation;
+    m_free_slots.push_back(slot);
+    m_size.fetch_sub(1);
+}
+
+BookingID BookingCalendar::toID(const Booking & booking) const
+{
+    std::uint64_t slot = static_cast<std::uint64_t>(&booking - m_bookings.data());
+    return (static_cast<BookingID>(booking.generation) << 32) | (slot + 1);
+}
\ No newline at end of file
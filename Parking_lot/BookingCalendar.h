@@ -0,0 +1,189 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "LicensePlate.h"
+#include "VehicleType.h"
+
+/// \brief ID of a booking, 0 means that there is no booking
+using BookingID = std::uint64_t;
+
+const BookingID kNoBooking = 0;
+
+/// \brief Settings of the booking calendar
+struct BookingConfig
+{
+    /// Length of the time buckets in microseconds, bookings are widened to whole buckets
+    std::int64_t bucket_us = 15ll * 60 * 1000000;
+
+    /// Number of buckets that can be booked, counted from the current one; 90 days of 15 minutes by default
+    std::size_t bucket_count = 90 * 24 * 4;
+};
+
+/// \brief Bays of every vehicle type booked ahead of time
+/// The number of booked bays is kept per time bucket in a ring of bucket_count buckets, with a segment tree per
+/// vehicle type on top that adds to and finds the maximum of a range of buckets in O(log bucket_count). Asking for
+/// a free bay during an interval therefore takes as long with a million bookings as with none. Buckets that
+/// passed are cleared and reused for the end of the horizon.
+/// The bays held right now, for bookings that started and whose vehicles did not arrive yet, are read by the
+/// gates without locking; everything else locks the calendar.
+class BookingCalendar
+{
+public:
+    /// \brief Constructor
+    /// \param[in] capacity Number of bays that can be booked at the same time, indexed by VehicleType
+    /// \param[in] config Length and number of the time buckets
+    BookingCalendar(const std::array<int, kVehicleTypeCount> & capacity, const BookingConfig & config = BookingConfig());
+
+    /// \brief Gets the number of bays of a vehicle type that are not booked at any time of the interval
+    /// \param[in] vehicle_type Vehicle type
+    /// \param[in] from_us Start of the interval, microseconds since 1970-01-01 UTC
+    /// \param[in] to_us End of the interval (exclusive), microseconds since 1970-01-01 UTC
+    /// \param[in] now_us Current time, the part of the interval before it is ignored
+    /// \throw Throws BookingException if the interval is empty, already over or ends beyond the horizon
+    int getFreeBays(const VehicleType vehicle_type, const std::int64_t from_us, const std::int64_t to_us, const std::int64_t now_us);
+
+    /// \brief Books a bay for a vehicle if one is free during the whole interval
+    /// \return Returns the booking ID, or kNoBooking if the bays of the vehicle type are booked out
+    /// \throw Throws BookingException like getFreeBays and InvalidLicensePlateException for a too long license plate
+    BookingID book(const VehicleType vehicle_type, const std::string_view license_plate, const std::int64_t from_us,
+                   const std::int64_t to_us, const std::int64_t now_us);
+
+    /// \brief Cancels a booking, its bay is free again from the current bucket on
+    /// \return Returns false if the booking is unknown, claimed or over
+    bool cancel(const BookingID booking_id, const std::int64_t now_us);
+
+    /// \brief Finds the booking of a vehicle that holds a bay right now
+    /// \return Returns the booking ID or kNoBooking
+    BookingID findHeld(const VehicleType vehicle_type, const std::string_view license_plate, const std::int64_t now_us);
+
+    /// \brief Whether a booking starting at from_us holds its bay right away, i.e. starts in the current bucket or before
+    bool isStarted(const std::int64_t from_us, const std::int64_t now_us) const { return bucketOf(from_us) <= bucketOf(now_us); }
+
+    /// \brief Stops holding the bay of a booking while its vehicle, already counted by the lot, gets a bay and ticket
+    /// The booking stays until claim, or holds its bay again with leave if the vehicle is turned away after all.
+    /// \return Returns false if the booking does not hold a bay right now
+    bool arrive(const BookingID booking_id, const std::int64_t now_us);
+
+    /// \brief Holds the bay of a booking again after its vehicle was turned away, see arrive
+    void leave(const BookingID booking_id);
+
+    /// \brief Hands the bay held by a booking to its arriving vehicle, the rest of the booking is cancelled
+    /// \return Returns false if the booking does not hold a bay right now
+    bool claim(const BookingID booking_id, const std::int64_t now_us);
+
+    /// \brief Gets the number of bays of a vehicle type held right now, without locking unless a new bucket started
+    int getHeldBays(const VehicleType vehicle_type, const std::int64_t now_us);
+
+    /// \brief Whether there are no bookings that are not over, without locking
+    bool empty() const { return m_size.load() == 0; }
+
+    /// \brief Number of bookings that are not over
+    std::size_t size() const { return m_size.load(); }
+
+private:
+    /// \brief Segment tree over the ring of buckets, every node keeps the maximum of its range
+    /// including what was added to the whole range, so nothing has to be pushed down to the children
+    class RangeMaxTree
+    {
+    public:
+        explicit RangeMaxTree(const std::size_t size);
+
+        /// \brief Adds a value to the buckets [from, to)
+        void add(const std::size_t from, const std::size_t to, const int value);
+
+        /// \brief Gets the maximum of the buckets [from, to), which must not be empty
+        int max(const std::size_t from, const std::size_t to) const;
+
+        void clear();
+
+    private:
+        void add(const std::size_t node, const std::size_t low, const std::size_t high, const std::size_t from, const std::size_t to, const int value);
+        int max(const std::size_t node, const std::size_t low, const std::size_t high, const std::size_t from, const std::size_t to) const;
+
+    private:
+        std::size_t m_size;
+        std::vector<int> m_max;
+        std::vector<int> m_added;
+    };
+
+    struct Booking
+    {
+        LicensePlate license_plate;
+        VehicleType type = VehicleType::Car;
+
+        /// Buckets [from_bucket, to_bucket) counted since 1970-01-01 UTC
+        std::int64_t from_bucket = 0;
+        std::int64_t to_bucket = 0;
+
+        /// Incremented whenever the slot is freed, so IDs of old bookings do not match new ones
+        std::uint32_t generation = 0;
+        bool active = false;
+
+        /// Set by arrive, the bay is no longer counted as held
+        bool arrived = false;
+    };
+
+    std::int64_t bucketOf(const std::int64_t time_us) const;
+
+    /// \brief Converts and checks an interval, must be called with the mutex held after advance
+    /// \return Returns the buckets [from, to) of the interval that are not over
+    std::pair<std::int64_t, std::int64_t> toBuckets(const std::int64_t from_us, const std::int64_t to_us) const;
+
+    /// \brief Clears the buckets that passed and drops the bookings that are over, must be called with the mutex held
+    void advance(const std::int64_t bucket);
+
+    /// \brief Adds to or finds the maximum of the buckets [from, to), which lie within the ring
+    void addToBuckets(const VehicleType vehicle_type, const std::int64_t from, const std::int64_t to, const int value);
+    int maxOfBuckets(const VehicleType vehicle_type, const std::int64_t from, const std::int64_t to) const;
+
+    /// \brief Updates the bays held right now after the tree of the vehicle type changed
+    void updateHeldBays(const VehicleType vehicle_type);
+
+    /// \return Returns the slot of an active booking or nullptr
+    Booking * find(const BookingID booking_id);
+
+    /// \brief Cancels a booking from the current bucket on and frees its slot, must be called with the mutex held
+    /// and followed by updateHeldBays
+    void remove(Booking & booking);
+
+    BookingID toID(const Booking & booking) const;
+
+private:
+    std::array<int, kVehicleTypeCount> m_capacity;
+    std::int64_t m_bucket_us;
+    std::size_t m_bucket_count;
+
+    std::mutex m_mutex;
+
+    /// Booked bays per bucket, indexed by VehicleType
+    std::vector<RangeMaxTree> m_booked;
+
+    /// Bookings, free slots are reused
+    std::vector<Booking> m_bookings;
+    std::vector<std::uint32_t> m_free_slots;
+
+    /// Slots of the bookings by LicensePlate::hash of their license plate
+    std::unordered_multimap<std::uint64_t, std::uint32_t> m_by_license_plate;
+
+    /// End buckets and IDs of the bookings, the bookings that are over are dropped from the top
+    std::priority_queue<std::pair<std::int64_t, BookingID>, std::vector<std::pair<std::int64_t, BookingID>>, std::greater<std::pair<std::int64_t, BookingID>>> m_ends;
+
+    /// Written with the mutex held, read by the gates without it
+    std::atomic<std::int64_t> m_current_bucket;
+    std::array<std::atomic<int>, kVehicleTypeCount> m_held;
+
+    /// Bookings whose vehicles arrived but did not claim them yet, indexed by VehicleType
+    std::array<int, kVehicleTypeCount> m_arrived{};
+    std::atomic<std::size_t> m_size{ 0 };
+};
\ No newline at end of file
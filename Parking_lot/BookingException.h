@@ -0,0 +1,15 @@
+#pragma once
+
+#include <exception>
+#include <string>
+
+// Custom exception for a booking interval that is empty, already over or beyond the booking horizon
+class BookingException : public std::exception
+{
+public:
+    BookingException(const std::string & message) : m_message(message) {}
+    const char* what() const noexcept override { return m_message.c_str(); }
+
+private:
+    std::string m_message;
+};
\ No newline at end of file
@@ -0,0 +1,56 @@
+#include "BufferedEventSink.h"
+
+BufferedEventSink::BufferedEventSink(std::ostream & out, std::size_t batch_size)
+    : m_out(out), m_batch_size(batch_size == 0 ? 1 : batch_size)
+{
+    m_events.reserve(m_batch_size);
+}
+
+BufferedEventSink::~BufferedEventSink()
+{
+    flush();
+}
+
+void BufferedEventSink::onEvent(const ParkingEvent & event)
+{
+    std::vector<ParkingEvent> batch;
+    std::uint64_t sequence = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_buffer_mutex);
+        m_events.push_back(event);
+        if (m_events.size() < m_batch_size)
+        {
+            return;
+        }
+        batch.swap(m_events);
+        m_events.reserve(m_batch_size);
+        sequence = m_batches_taken++;
+    }
+    write(batch, sequence);
+}
+
+void BufferedEventSink::flush()
+{
+    std::vector<ParkingEvent> batch;
+    std::uint64_t sequence = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_buffer_mutex);
+        batch.swap(m_events);
+        sequence = m_batches_taken++;
+    }
+    write(batch, sequence);
+    std::lock_guard<std::mutex> lock(m_out_mutex);
+    m_out.flush();
+}
+
+void BufferedEventSink::write(const std::vector<ParkingEvent> & events, const std::uint64_t sequence)
+{
+    std::unique_lock<std::mutex> lock(m_out_mutex);
+    m_written.wait(lock, [this, sequence]() { return m_batches_written == sequence; });
+    for (const auto & event : events)
+    {
+        m_out << event << '\n';
+    }
+    ++m_batches_written;
+    m_written.notify_all();
+}
\ No newline at end of file
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+#include "ParkingEventSink.h"
+
+/// \brief Event sink that collects events and writes them to a stream in batches
+/// Batches are numbered when they are taken from the buffer and written in that order, so the stream keeps
+/// the order of the events even if the gates that filled two batches write them at the same time.
+class BufferedEventSink : public ParkingEventSink
+{
+public:
+    /// Constructor
+    /// \param[in] out Stream the events are written to, must outlive the sink
+    /// \param[in] batch_size Number of events collected before they are written
+    explicit BufferedEventSink(std::ostream & out, std::size_t batch_size = 256);
+
+    /// Destructor, writes the remaining events
+    ~BufferedEventSink();
+
+    void onEvent(const ParkingEvent & event) override;
+
+    /// Writes all collected events to the stream
+    void flush();
+
+private:
+    /// \brief Writes a batch of events once all batches taken before it are written,
+    /// the events are formatted outside of the buffer mutex
+    /// \param[in] sequence Number of the batch, taken from m_batches_taken with the buffer mutex held
+    void write(const std::vector<ParkingEvent> & events, const std::uint64_t sequence);
+
+private:
+    std::ostream & m_out;
+    std::size_t m_batch_size;
+    std::vector<ParkingEvent> m_events;
+    std::mutex m_buffer_mutex;
+    std::mutex m_out_mutex;
+    std::condition_variable m_written;
+
+    /// Batches taken from the buffer, guarded by the buffer mutex, and written, guarded by the out mutex
+    std::uint64_t m_batches_taken = 0;
+    std::uint64_t m_batches_written = 0;
+};
\ No newline at end of file
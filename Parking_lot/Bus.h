@@ -7,7 +7,5 @@ class Bus : public Vehicle
 {
 public:
     Bus(const std::string & license_plate, double parking_duration)
-        : Vehicle(license_plate, parking_duration) {}
-
-    std::string getVehicleType() const override { return "Bus"; }
+        : Vehicle(VehicleType::Bus, license_plate, parking_duration) {}
 };
\ No newline at end of file
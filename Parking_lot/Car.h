@@ -7,7 +7,5 @@ class Car : public Vehicle
 {
 public:
     Car(const std::string& license_plate, double parking_duration)
-        : Vehicle(license_plate, parking_duration) {}
-
-    std::string getVehicleType() const override { return "Car"; }
+        : Vehicle(VehicleType::Car, license_plate, parking_duration) {}
 };
\ No newline at end of file
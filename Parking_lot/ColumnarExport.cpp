@@ -0,0 +1,415 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "ColumnarExport.h"
+#include "ExportException.h"
+
+namespace
+{
+    /// File header: magic, then the blocks
+    const char kExportMagic[8] = { 'P', 'L', 'C', 'O', 'L', 'X', '0', '1' };
+
+    /// Block header: kind, 3 unused bytes, row count, size of the payload after the header
+    const std::size_t kBlockHeaderSize = 12;
+
+    /// Buffer of the export file, blocks are written and read in large chunks
+    const std::size_t kExportBufferSize = 1 << 20;
+
+    /// Charges are stored in 1/10000 of the currency unit
+    const double kChargeUnitsPerCurrencyUnit = 10000.0;
+
+    /// Most bytes a row takes: 5 for the plate ID and the bay, 10 for the other integers and 1 for the type
+    const std::size_t kMaxRowSize = 2 * 5 + 4 * 10 + 1;
+
+    /// \brief Writes an unsigned integer 7 bits per byte, low bits first, the high bit set on all but the last byte
+    /// \return Returns the position after the integer
+    inline char * putVarint(char * out, std::uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            *out++ = static_cast<char>((value & 0x7F) | 0x80);
+            value >>= 7;
+        }
+        *out++ = static_cast<char>(value);
+        return out;
+    }
+
+    /// \brief Writes a signed integer, small negative numbers take as few bytes as small positive ones
+    inline char * putZigzag(char * out, const std::int64_t value)
+    {
+        return putVarint(out, (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63));
+    }
+
+    /// \brief Reads the columns of a block payload, throws ExportException when reading past its end
+    class ColumnDecoder
+    {
+    public:
+        ColumnDecoder(const char * data, const std::size_t size) : m_position(data), m_end(data + size) {}
+
+        std::uint64_t varint()
+        {
+            std::uint64_t value = 0;
+            for (int shift = 0; shift < 64; shift += 7)
+            {
+                std::uint8_t byte = next();
+                value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+                if ((byte & 0x80) == 0)
+                {
+                    return value;
+                }
+            }
+            throw ExportException("Export block has an integer longer than 64 bits.");
+        }
+
+        std::int64_t zigzag()
+        {
+            std::uint64_t value = varint();
+            return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+        }
+
+        std::uint8_t next()
+        {
+            if (m_position == m_end)
+            {
+                throw ExportException("Export block ends before its columns.");
+            }
+            return static_cast<std::uint8_t>(*m_position++);
+        }
+
+        std::string_view bytes(const std::size_t count)
+        {
+            if (static_cast<std::size_t>(m_end - m_position) < count)
+            {
+                throw ExportException("Export block ends before its columns.");
+            }
+            std::string_view bytes(m_position, count);
+            m_position += count;
+            return bytes;
+        }
+
+        bool atEnd() const { return m_position == m_end; }
+
+    private:
+        const char * m_position;
+        const char * m_end;
+    };
+}
+
+ColumnarExportWriter::ColumnarExportWriter(const std::string & path)
+{
+    m_file = std::fopen(path.c_str(), "wb");
+    if (!m_file)
+    {
+        throw ExportException("Export file " + path + " cannot be created.");
+    }
+    std::setvbuf(m_file, nullptr, _IOFBF, kExportBufferSize);
+    m_failed = std::fwrite(kExportMagic, 1, sizeof(kExportMagic), m_file) != sizeof(kExportMagic);
+    m_bytes_written = sizeof(kExportMagic);
+}
+
+ColumnarExportWriter::~ColumnarExportWriter()
+{
+    try
+    {
+        close();
+    }
+    catch (...)
+    {
+    }
+}
+
+void ColumnarExportWriter::addParkedVehicle(const ParkedRecord & record)
+{
+    if (m_parked.ticket_ids.size() == kBlockRows)
+    {
+        writeBlock(ExportBlockKind::ParkedVehicles, m_parked);
+    }
+    m_parked.plate_ids.push_back(intern(record.license_plate.view()));
+    m_parked.ticket_ids.push_back(record.ticket_id);
+    m_parked.types.push_back(record.type);
+    m_parked.entry_times_us.push_back(record.entry_time_us);
+    m_parked.bays.push_back(record.bay);
+}
+
+void ColumnarExportWriter::addParkedVehicles(const ParkedVehicleSnapshot & snapshot)
+{
+    for (const ParkedRecord & record : snapshot)
+    {
+        addParkedVehicle(record);
+    }
+}
+
+void ColumnarExportWriter::addClosedTicket(const ParkingEvent & event)
+{
+    if (event.type != ParkingEventType::Released)
+    {
+        return;
+    }
+    if (m_closed.ticket_ids.size() == kBlockRows)
+    {
+        writeBlock(ExportBlockKind::ClosedTickets, m_closed);
+    }
+    m_closed.plate_ids.push_back(intern(event.license_plate.view()));
+    m_closed.ticket_ids.push_back(event.ticket_id);
+    m_closed.types.push_back(event.vehicle_type);
+    m_closed.entry_times_us.push_back(event.entry_time_us);
+    m_closed.exit_times_us.push_back(event.exit_time_us);
+    m_closed.bays.push_back(event.bay);
+    m_closed.charges.push_back(std::llround(event.charge * kChargeUnitsPerCurrencyUnit));
+}
+
+void ColumnarExportWriter::close()
+{
+    if (!m_file)
+    {
+        return;
+    }
+    writeBlock(ExportBlockKind::ParkedVehicles, m_parked);
+    writeBlock(ExportBlockKind::ClosedTickets, m_closed);
+    bool failed = m_failed || std::fflush(m_file) != 0;
+    failed = std::fclose(m_file) != 0 || failed;
+    m_file = nullptr;
+    if (failed)
+    {
+        throw ExportException("Export file could not be written.");
+    }
+}
+
+void ColumnarExportWriter::PendingRows::clear()
+{
+    plate_ids.clear();
+    ticket_ids.clear();
+    types.clear();
+    entry_times_us.clear();
+    exit_times_us.clear();
+    bays.clear();
+    charges.clear();
+}
+
+std::uint32_t ColumnarExportWriter::intern(const std::string_view license_plate)
+{
+    auto it = m_plate_ids.find(license_plate);
+    if (it != m_plate_ids.end())
+    {
+        return it->second;
+    }
+
+    std::uint32_t plate_id = static_cast<std::uint32_t>(m_plates.size());
+    m_plates.emplace_back(license_plate);
+    m_plate_ids.emplace(m_plates.back(), plate_id);
+    return plate_id;
+}
+
+void ColumnarExportWriter::writeBlock(const ExportBlockKind kind, PendingRows & rows)
+{
+    std::size_t count = rows.ticket_ids.size();
+    if (count == 0 || !m_file)
+    {
+        return;
+    }
+    bool closed = kind == ExportBlockKind::ClosedTickets;
+
+    // In entry time order the entry times and ticket IDs differ little from one row to the next
+    m_order.resize(count);
+    for (std::uint32_t row = 0; row < count; ++row)
+    {
+        m_order[row] = std::make_pair(rows.entry_times_us[row], row);
+    }
+    std::sort(m_order.begin(), m_order.end());
+
+    // Sized for the longest possible encoding, so the columns are written without checking for room
+    std::size_t max_size = 5 + count * kMaxRowSize;
+    for (std::size_t plate = m_first_new_plate; plate < m_plates.size(); ++plate)
+    {
+        max_size += 1 + m_plates[plate].size();
+    }
+    if (m_payload.size() < max_size)
+    {
+        m_payload.resize(max_size);
+    }
+
+    char * out = putVarint(m_payload.data(), m_plates.size() - m_first_new_plate);
+    for (; m_first_new_plate < m_plates.size(); ++m_first_new_plate)
+    {
+        const std::string & license_plate = m_plates[m_first_new_plate];
+        *out++ = static_cast<char>(license_plate.size());
+        out = std::copy(license_plate.begin(), license_plate.end(), out);
+    }
+
+    for (const auto & order : m_order)
+    {
+        out = putVarint(out, rows.plate_ids[order.second]);
+    }
+    TicketID previous_ticket_id = 0;
+    for (const auto & order : m_order)
+    {
+        out = putZigzag(out, rows.ticket_ids[order.second] - previous_ticket_id);
+        previous_ticket_id = rows.ticket_ids[order.second];
+    }
+    for (std::size_t first = 0; first < count; first += 4)
+    {
+        std::uint8_t packed = 0;
+        for (std::size_t i = first; i < std::min(first + 4, count); ++i)
+        {
+            packed |= static_cast<std::uint8_t>(static_cast<std::uint8_t>(rows.types[m_order[i].second]) << (2 * (i - first)));
+        }
+        *out++ = static_cast<char>(packed);
+    }
+    std::int64_t previous_entry_time_us = 0;
+    for (const auto & order : m_order)
+    {
+        out = putZigzag(out, order.first - previous_entry_time_us);
+        previous_entry_time_us = order.first;
+    }
+    if (closed)
+    {
+        for (const auto & order : m_order)
+        {
+            out = putZigzag(out, rows.exit_times_us[order.second] - order.first);
+        }
+    }
+    for (const auto & order : m_order)
+    {
+        out = putZigzag(out, rows.bays[order.second]);
+    }
+    if (closed)
+    {
+        for (const auto & order : m_order)
+        {
+            out = putZigzag(out, rows.charges[order.second]);
+        }
+    }
+    rows.clear();
+
+    std::size_t size = static_cast<std::size_t>(out - m_payload.data());
+    char header[kBlockHeaderSize] = {};
+    header[0] = static_cast<char>(kind);
+    std::uint32_t row_count = static_cast<std::uint32_t>(count);
+    std::uint32_t payload_size = static_cast<std::uint32_t>(size);
+    std::memcpy(header + 4, &row_count, sizeof(row_count));
+    std::memcpy(header + 8, &payload_size, sizeof(payload_size));
+    if (std::fwrite(header, 1, kBlockHeaderSize, m_file) != kBlockHeaderSize || std::fwrite(m_payload.data(), 1, size, m_file) != size)
+    {
+        m_failed = true;
+    }
+    m_bytes_written += kBlockHeaderSize + size;
+}
+
+ColumnarExportReader::ColumnarExportReader(const std::string & path)
+{
+    m_file = std::fopen(path.c_str(), "rb");
+    if (!m_file)
+    {
+        throw ExportException("Export file " + path + " cannot be opened.");
+    }
+    std::setvbuf(m_file, nullptr, _IOFBF, kExportBufferSize);
+
+    char magic[sizeof(kExportMagic)] = {};
+    if (std::fread(magic, 1, sizeof(magic), m_file) != sizeof(magic) || std::memcmp(magic, kExportMagic, sizeof(magic)) != 0)
+    {
+        std::fclose(m_file);
+        m_file = nullptr;
+        throw ExportException("File " + path + " is not an export.");
+    }
+}
+
+ColumnarExportReader::~ColumnarExportReader()
+{
+    if (m_file)
+    {
+        std::fclose(m_file);
+    }
+}
+
+bool ColumnarExportReader::readBlock(ExportBlock & block)
+{
+    char header[kBlockHeaderSize];
+    if (!m_file || std::fread(header, 1, kBlockHeaderSize, m_file) != kBlockHeaderSize)
+    {
+        return false;
+    }
+    ExportBlockKind kind = static_cast<ExportBlockKind>(header[0]);
+    if (kind != ExportBlockKind::ParkedVehicles && kind != ExportBlockKind::ClosedTickets)
+    {
+        throw ExportException("Export block of unknown kind " + std::to_string(static_cast<int>(header[0])) + ".");
+    }
+    std::uint32_t row_count = 0;
+    std::uint32_t payload_size = 0;
+    std::memcpy(&row_count, header + 4, sizeof(row_count));
+    std::memcpy(&payload_size, header + 8, sizeof(payload_size));
+    m_payload.resize(payload_size);
+    if (std::fread(m_payload.data(), 1, payload_size, m_file) != payload_size)
+    {
+        return false;
+    }
+
+    ColumnDecoder decoder(m_payload.data(), m_payload.size());
+    for (std::uint64_t new_plates = decoder.varint(); new_plates > 0; --new_plates)
+    {
+        std::string_view license_plate = decoder.bytes(decoder.next());
+        m_plates.emplace_back(license_plate);
+    }
+
+    bool closed = kind == ExportBlockKind::ClosedTickets;
+    block.kind = kind;
+    block.license_plates.resize(row_count);
+    block.ticket_ids.resize(row_count);
+    block.types.resize(row_count);
+    block.entry_times_us.resize(row_count);
+    block.exit_times_us.resize(closed ? row_count : 0);
+    block.bays.resize(row_count);
+    block.charges.resize(closed ? row_count : 0);
+
+    for (auto & license_plate : block.license_plates)
+    {
+        std::uint64_t plate_id = decoder.varint();
+        if (plate_id >= m_plates.size())
+        {
+            throw ExportException("Export block refers to license plate " + std::to_string(plate_id) + " that is not in the dictionary.");
+        }
+        license_plate = m_plates[plate_id];
+    }
+    TicketID ticket_id = 0;
+    for (auto & row_ticket_id : block.ticket_ids)
+    {
+        ticket_id += static_cast<TicketID>(decoder.zigzag());
+        row_ticket_id = ticket_id;
+    }
+    for (std::size_t first = 0; first < row_count; first += 4)
+    {
+        std::uint8_t packed = decoder.next();
+        for (std::size_t i = first; i < std::min<std::size_t>(first + 4, row_count); ++i)
+        {
+            std::uint8_t type = (packed >> (2 * (i - first))) & 0x3;
+            if (type >= kVehicleTypeCount)
+            {
+                throw ExportException("Export block has an unknown vehicle type.");
+            }
+            block.types[i] = static_cast<VehicleType>(type);
+        }
+    }
+    std::int64_t entry_time_us = 0;
+    for (auto & row_entry_time_us : block.entry_times_us)
+    {
+        entry_time_us += decoder.zigzag();
+        row_entry_time_us = entry_time_us;
+    }
+    for (std::size_t row = 0; row < block.exit_times_us.size(); ++row)
+    {
+        block.exit_times_us[row] = block.entry_times_us[row] + decoder.zigzag();
+    }
+    for (auto & bay : block.bays)
+    {
+        bay = static_cast<int>(decoder.zigzag());
+    }
+    for (auto & charge : block.charges)
+    {
+        charge = static_cast<double>(decoder.zigzag()) / kChargeUnitsPerCurrencyUnit;
+    }
+    if (!decoder.atEnd())
+    {
+        throw ExportException("Export block is longer than its columns.");
+    }
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "ParkedVehicleSnapshot.h"
+#include "ParkingEvent.h"
+#include "TicketID.h"
+#include "VehicleType.h"
+
+/// \brief What the rows of an export block are
+enum class ExportBlockKind : std::uint8_t
+{
+    ParkedVehicles = 1,
+    ClosedTickets = 2
+};
+
+/// \brief The rows of one block of a columnar export, one vector per column
+struct ExportBlock
+{
+    ExportBlockKind kind = ExportBlockKind::ParkedVehicles;
+
+    /// Views into the license plate dictionary of the ColumnarExportReader, valid as long as the reader
+    std::vector<std::string_view> license_plates;
+    std::vector<TicketID> ticket_ids;
+    std::vector<VehicleType> types;
+
+    /// Microseconds since 1970-01-01 UTC, exit times are empty for parked vehicles
+    std::vector<std::int64_t> entry_times_us;
+    std::vector<std::int64_t> exit_times_us;
+
+    std::vector<int> bays;
+
+    /// Charges of closed tickets rounded to 1/100 of a cent, empty for parked vehicles
+    std::vector<double> charges;
+
+    std::size_t size() const { return ticket_ids.size(); }
+};
+
+/// \brief Writes parked vehicles and closed tickets to a file as compressed columnar blocks, not thread-safe
+/// Rows are collected per kind and written in blocks of up to kBlockRows rows ordered by entry time. Every column
+/// of a block is stored on its own: license plates as indexes into a dictionary that grows with the file (a block
+/// carries the license plates first seen since the previous block), ticket IDs and entry times as the difference
+/// to the previous row, exit times as the time parked, vehicle types in 2 bits and all integers as variable-length
+/// integers of 7 bits per byte. A closed ticket takes about 18 bytes instead of the two lines of parking_log.txt.
+/// Integers of the block header are in host byte order.
+class ColumnarExportWriter
+{
+public:
+    /// Number of rows of a full block
+    static const std::size_t kBlockRows = 65536;
+
+    /// \brief Constructor, creates or truncates the file
+    /// \throw Throws ExportException if the file cannot be created
+    explicit ColumnarExportWriter(const std::string & path);
+
+    /// \brief Destructor, writes the rows not written yet; call close to learn whether writing failed
+    ~ColumnarExportWriter();
+
+    ColumnarExportWriter(const ColumnarExportWriter &) = delete;
+    ColumnarExportWriter & operator=(const ColumnarExportWriter &) = delete;
+
+    /// \brief Adds a parked vehicle
+    void addParkedVehicle(const ParkedRecord & record);
+
+    /// \brief Adds all vehicles of a snapshot, see ParkingLot::getParkedVehicleSnapshot
+    void addParkedVehicles(const ParkedVehicleSnapshot & snapshot);
+
+    /// \brief Adds the closed ticket of a Released event, other events are ignored
+    void addClosedTicket(const ParkingEvent & event);
+
+    /// \brief Writes the rows not written yet and closes the file, nothing can be added afterwards
+    /// \throw Throws ExportException if the file could not be written
+    void close();
+
+    /// \brief Number of bytes written to the file so far
+    std::uint64_t bytesWritten() const { return m_bytes_written; }
+
+private:
+    /// Rows of one kind not written yet, the columns as they are encoded
+    struct PendingRows
+    {
+        std::vector<std::uint32_t> plate_ids;
+        std::vector<TicketID> ticket_ids;
+        std::vector<VehicleType> types;
+        std::vector<std::int64_t> entry_times_us;
+        std::vector<std::int64_t> exit_times_us;
+        std::vector<int> bays;
+
+        /// Charges in 1/10000 of the currency unit
+        std::vector<std::int64_t> charges;
+
+        void clear();
+    };
+
+    /// \brief Gets the dictionary index of a license plate, adding it if needed
+    std::uint32_t intern(const std::string_view license_plate);
+
+    /// \brief Encodes the pending rows of one kind into a block and writes it
+    void writeBlock(const ExportBlockKind kind, PendingRows & rows);
+
+private:
+    std::FILE * m_file = nullptr;
+    bool m_failed = false;
+    std::uint64_t m_bytes_written = 0;
+
+    PendingRows m_parked;
+    PendingRows m_closed;
+
+    /// Indexed by plate ID, a deque keeps the license plates in place for the views of m_plate_ids
+    std::deque<std::string> m_plates;
+    std::unordered_map<std::string_view, std::uint32_t> m_plate_ids;
+
+    /// License plates from this index on were added since the last block, written with the next block of either kind
+    std::size_t m_first_new_plate = 0;
+
+    /// Reused for encoding, so writing a block does not allocate once they have grown
+    std::vector<char> m_payload;
+    std::vector<std::pair<std::int64_t, std::uint32_t>> m_order;
+};
+
+/// \brief Reads a file written by ColumnarExportWriter one block at a time, so memory does not grow with the file
+class ColumnarExportReader
+{
+public:
+    /// \brief Constructor, opens the file and checks its header
+    /// \throw Throws ExportException if the file cannot be opened or is not an export
+    explicit ColumnarExportReader(const std::string & path);
+
+    /// \brief Destructor, closes the file
+    ~ColumnarExportReader();
+
+    ColumnarExportReader(const ColumnarExportReader &) = delete;
+    ColumnarExportReader & operator=(const ColumnarExportReader &) = delete;
+
+    /// \brief Reads the next block
+    /// \param[out] block Receives the rows, its vectors are reused
+    /// \return Returns false at the end of the file or at a block torn by a crash while it was written
+    /// \throw Throws ExportException if a complete block is damaged
+    bool readBlock(ExportBlock & block);
+
+    /// \brief Number of license plates in the dictionary read so far
+    std::size_t plateCount() const { return m_plates.size(); }
+
+private:
+    std::FILE * m_file = nullptr;
+    std::vector<char> m_payload;
+
+    /// A deque keeps the license plates in place while it grows, blocks hold views into it
+    std::deque<std::string> m_plates;
+};
\ No newline at end of file
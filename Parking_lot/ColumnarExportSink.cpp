@@ -0,0 +1,105 @@
+#include <algorithm>
+#include <utility>
+
+#include "ColumnarExportSink.h"
+
+ColumnarExportSink::ColumnarExportSink(ColumnarExportWriter & writer, const std::size_t batch_size)
+    : m_writer(writer), m_batch_size(std::max<std::size_t>(batch_size, 1))
+{
+    m_events.reserve(m_batch_size);
+    m_thread = std::thread(&ColumnarExportSink::run, this);
+}
+
+ColumnarExportSink::~ColumnarExportSink()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        queueBatch();
+        m_stop = true;
+    }
+    m_wake.notify_one();
+    m_thread.join();
+}
+
+void ColumnarExportSink::onEvent(const ParkingEvent & event)
+{
+    if (event.type != ParkingEventType::Released)
+    {
+        return;
+    }
+
+    bool full = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_events.push_back(event);
+        if (m_events.size() >= m_batch_size)
+        {
+            queueBatch();
+            full = true;
+        }
+    }
+    if (full)
+    {
+        m_wake.notify_one();
+    }
+}
+
+void ColumnarExportSink::flush()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    queueBatch();
+    std::uint64_t target = m_batches_queued;
+    m_wake.notify_one();
+    m_added.wait(lock, [this, target]() { return m_batches_added >= target; });
+}
+
+void ColumnarExportSink::queueBatch()
+{
+    if (m_events.empty())
+    {
+        return;
+    }
+    m_batches.push_back(std::move(m_events));
+    ++m_batches_queued;
+
+    // An emptied batch keeps its capacity, so filling the next one does not allocate
+    if (!m_spare_batches.empty())
+    {
+        m_events = std::move(m_spare_batches.back());
+        m_spare_batches.pop_back();
+    }
+    else
+    {
+        m_events = std::vector<ParkingEvent>();
+        m_events.reserve(m_batch_size);
+    }
+}
+
+void ColumnarExportSink::run()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;)
+    {
+        m_wake.wait(lock, [this]() { return m_stop || !m_batches.empty(); });
+        if (m_batches.empty())
+        {
+            // Stopping, every batch queued before is added
+            return;
+        }
+        std::vector<ParkingEvent> batch = std::move(m_batches.front());
+        m_batches.pop_front();
+        lock.unlock();
+
+        // Filling a block also sorts, encodes and writes it, the gates go on meanwhile
+        for (const auto & event : batch)
+        {
+            m_writer.addClosedTicket(event);
+        }
+        batch.clear();
+
+        lock.lock();
+        m_spare_batches.push_back(std::move(batch));
+        ++m_batches_added;
+        m_added.notify_all();
+    }
+}
\ No newline at end of file
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "ColumnarExport.h"
+#include "ParkingEventSink.h"
+
+/// \brief Event sink that adds the closed ticket of every released vehicle to a columnar export, e.g. for the daily settlement
+/// The gates only append Released events to a batch; full batches are handed to a background thread in the order they
+/// were filled, which adds the tickets to the export and sorts, encodes and writes its blocks. No gate waits for a block.
+class ColumnarExportSink : public ParkingEventSink
+{
+public:
+    /// Default number of events handed to the writer thread at once
+    static const std::size_t kDefaultBatchSize = 1024;
+
+    /// \brief Constructor, starts the writer thread
+    /// \param[in] writer Export the closed tickets are added to, must outlive the sink and is only used by the
+    /// writer thread until the sink is destroyed
+    /// \param[in] batch_size Number of events handed to the writer thread at once
+    explicit ColumnarExportSink(ColumnarExportWriter & writer, const std::size_t batch_size = kDefaultBatchSize);
+
+    /// \brief Destructor, adds all received events to the export and stops the writer thread
+    ~ColumnarExportSink() override;
+
+    ColumnarExportSink(const ColumnarExportSink &) = delete;
+    ColumnarExportSink & operator=(const ColumnarExportSink &) = delete;
+
+    void onEvent(const ParkingEvent & event) override;
+
+    /// \brief Blocks until all events received before the call are added to the export
+    void flush();
+
+private:
+    /// \brief Queues the batch being filled, must be called with the mutex held
+    void queueBatch();
+
+    /// \brief Body of the writer thread
+    void run();
+
+private:
+    ColumnarExportWriter & m_writer;
+    std::size_t m_batch_size;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_added;
+
+    /// Batch filled by the gates, full batches wait in m_batches and come back emptied through m_spare_batches
+    std::vector<ParkingEvent> m_events;
+    std::deque<std::vector<ParkingEvent>> m_batches;
+    std::vector<std::vector<ParkingEvent>> m_spare_batches;
+
+    std::uint64_t m_batches_queued = 0;
+    std::uint64_t m_batches_added = 0;
+    bool m_stop = false;
+
+    std::thread m_thread;
+};
\ No newline at end of file
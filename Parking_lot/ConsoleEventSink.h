@@ -0,0 +1,25 @@
+#pragma once
+
+#include <iostream>
+#include <mutex>
+#include <sstream>
+
+#include "ParkingEventSink.h"
+
+/// \brief Event sink that prints every event to std::cout
+class ConsoleEventSink : public ParkingEventSink
+{
+public:
+    void onEvent(const ParkingEvent & event) override
+    {
+        // Formatted before taking the mutex, so only the write itself is serialized
+        std::ostringstream line;
+        line << event << '\n';
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::cout << line.str();
+    }
+
+private:
+    std::mutex m_mutex;
+};
\ No newline at end of file
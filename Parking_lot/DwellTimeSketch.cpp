@@ -0,0 +1,24 @@
+#include <algorithm>
+
+#include "DwellTimeSketch.h"
+
+namespace
+{
+    const std::int64_t kMicrosecondsPerSecond = 1000000;
+}
+
+std::int64_t DwellTimeSketch::percentile(const double percentile) const
+{
+    if (m_seconds.count() == 0)
+    {
+        return 0;
+    }
+    // The last microsecond of the highest second in the bucket
+    return static_cast<std::int64_t>(m_seconds.percentile(percentile) + 1) * kMicrosecondsPerSecond - 1;
+}
+
+std::uint64_t DwellTimeSketch::secondsOf(const std::int64_t dwell_time_us)
+{
+    std::uint64_t seconds = dwell_time_us > 0 ? static_cast<std::uint64_t>(dwell_time_us / kMicrosecondsPerSecond) : 0;
+    return std::min(seconds, (std::uint64_t(1) << kMaxSecondBits) - 1);
+}
\ No newline at end of file
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "LatencyHistogram.h"
+
+/// \brief Counts how long vehicles stayed in logarithmic buckets of seconds, e.g. for the p95 dwell time of buses
+/// A LatencyHistogram of whole seconds: stays below 64 seconds get a bucket each, longer ones are split into 32
+/// buckets per power of two up to about half a year, so a percentile is off by at most about 3%. Sketches of
+/// different times or lots can be merged.
+/// Not thread safe, OccupancyAnalytics counts into atomics and hands out sketches of time windows.
+class DwellTimeSketch
+{
+public:
+    /// Stays of 2^kMaxSecondBits seconds and longer are counted in the last bucket
+    static constexpr std::size_t kMaxSecondBits = 24;
+    static constexpr std::size_t kBucketCount = LatencyHistogram::bucketCountBelow(kMaxSecondBits);
+
+    /// \brief Counts one stay
+    /// \param[in] dwell_time_us Time between entry and exit in microseconds, negative times count as 0
+    void record(const std::int64_t dwell_time_us) { m_seconds.record(secondsOf(dwell_time_us)); }
+
+    /// \brief Counts stays by their bucket, see bucketOf
+    void addToBucket(const std::size_t bucket, const std::uint64_t count) { m_seconds.addToBucket(bucket, count); }
+
+    /// \brief Adds the stays of another sketch
+    void merge(const DwellTimeSketch & other) { m_seconds.merge(other.m_seconds); }
+
+    void reset() { m_seconds.reset(); }
+
+    /// \brief Number of recorded stays
+    std::uint64_t count() const { return m_seconds.count(); }
+
+    /// \brief Dwell time at or below which the given share of the stays lies
+    /// \param[in] percentile Percentile from 0 to 100, e.g. 95
+    /// \return Returns the upper bound of the bucket holding the percentile in microseconds, 0 if nothing was recorded
+    std::int64_t percentile(const double percentile) const;
+
+    /// \brief Bucket a dwell time in microseconds is counted in, below kBucketCount
+    static std::size_t bucketOf(const std::int64_t dwell_time_us) { return LatencyHistogram::bucketOf(secondsOf(dwell_time_us)); }
+
+private:
+    static std::uint64_t secondsOf(const std::int64_t dwell_time_us);
+
+private:
+    LatencyHistogram m_seconds;
+};
\ No newline at end of file
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <exception>
+#include <string>
+
+// Custom exception for export files that cannot be written or read
+class ExportException : public std::exception
+{
+public:
+    ExportException(const std::string & message) : m_message(message) {}
+    const char* what() const noexcept override { return m_message.c_str(); }
+
+private:
+    std::string m_message;
+};
\ No newline at end of file
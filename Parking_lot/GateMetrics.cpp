@@ -0,0 +1,17 @@
+#include "GateMetrics.h"
+
+void GateMetrics::addTo(MetricsSnapshot & snapshot) const
+{
+#if PARKING_LOT_METRICS
+    for (std::size_t type = 0; type < kParkingEventTypeCount; ++type)
+    {
+        snapshot.events[type] += m_events[type].load(std::memory_order_relaxed);
+    }
+    for (std::size_t latency = 0; latency < kGateLatencyCount; ++latency)
+    {
+        m_latencies[latency].addTo(snapshot.latencies[latency]);
+    }
+#else
+    (void)snapshot;
+#endif
+}
\ No newline at end of file
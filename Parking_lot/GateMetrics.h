@@ -0,0 +1,186 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+#include "LatencyHistogram.h"
+#include "MetricsSnapshot.h"
+
+/// Define PARKING_LOT_METRICS as 0 (e.g. in the preprocessor definitions of the project) to build the parking lot
+/// without any instrumentation: no clock is read and nothing is counted, ParkingLot::getMetricsSnapshot returns zeros.
+#ifndef PARKING_LOT_METRICS
+#define PARKING_LOT_METRICS 1
+#endif
+
+/// \brief Decides whether the latencies of the gate operation running on this thread are measured
+/// Reading the clock costs about as much as the rest of the instrumentation, so only every period-th operation of a
+/// thread is timed; the counters are exact. Operations can nest, an inner sample keeps the decision of the outer one.
+class MetricsSample
+{
+public:
+    /// \param[in] period 1 to time every operation, 8 to time every eighth
+    explicit MetricsSample(const unsigned period)
+    {
+#if PARKING_LOT_METRICS
+        State & state = threadState();
+        m_outer = state.active;
+        if (!m_outer)
+        {
+            state.active = ++state.operations % (period == 0 ? 1 : period) == 0;
+        }
+#else
+        (void)period;
+#endif
+    }
+
+    ~MetricsSample()
+    {
+#if PARKING_LOT_METRICS
+        if (!m_outer)
+        {
+            threadState().active = false;
+        }
+#endif
+    }
+
+    MetricsSample(const MetricsSample &) = delete;
+    MetricsSample & operator=(const MetricsSample &) = delete;
+
+    /// \brief Whether the operation running on this thread is timed
+    static bool active()
+    {
+#if PARKING_LOT_METRICS
+        return threadState().active;
+#else
+        return false;
+#endif
+    }
+
+private:
+#if PARKING_LOT_METRICS
+    struct State
+    {
+        unsigned operations = 0;
+        bool active = false;
+    };
+
+    static State & threadState()
+    {
+        thread_local State state;
+        return state;
+    }
+
+    bool m_outer;
+#endif
+};
+
+/// \brief Measures the time since it was created if the operation of the thread is sampled, see MetricsSample
+class MetricsStopwatch
+{
+public:
+#if PARKING_LOT_METRICS
+    MetricsStopwatch()
+        : m_running(MetricsSample::active()), m_start(m_running ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point())
+    {
+    }
+
+    bool running() const { return m_running; }
+
+    std::uint64_t elapsedNanoseconds() const
+    {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start).count());
+    }
+
+    /// \brief Returns the elapsed time and starts measuring again from now, with a single clock read
+    std::uint64_t lap()
+    {
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        std::uint64_t elapsed = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - m_start).count());
+        m_start = now;
+        return elapsed;
+    }
+
+private:
+    bool m_running;
+    std::chrono::steady_clock::time_point m_start;
+#else
+    bool running() const { return false; }
+    std::uint64_t elapsedNanoseconds() const { return 0; }
+    std::uint64_t lap() { return 0; }
+#endif
+};
+
+/// \brief Counters and latency histograms of the gate operations of one shard, safe to update from any number of threads
+/// Every shard of a ParkingLot has its own, so gates only share metrics when they already share a shard mutex.
+/// The updates are relaxed atomic increments; they compile to nothing if the instrumentation is compiled out.
+class GateMetrics
+{
+public:
+    void countEvent(const ParkingEventType type)
+    {
+#if PARKING_LOT_METRICS
+        m_events[static_cast<std::size_t>(type)].fetch_add(1, std::memory_order_relaxed);
+#else
+        (void)type;
+#endif
+    }
+
+    /// \brief Records how long a part of an operation took, in nanoseconds
+    void record(const GateLatency latency, const std::uint64_t nanoseconds)
+    {
+#if PARKING_LOT_METRICS
+        m_latencies[static_cast<std::size_t>(latency)].record(nanoseconds);
+#else
+        (void)latency;
+        (void)nanoseconds;
+#endif
+    }
+
+    /// \brief Records the time measured by the stopwatch, if it was running
+    void record(const GateLatency latency, const MetricsStopwatch & stopwatch)
+    {
+        if (stopwatch.running())
+        {
+            record(latency, stopwatch.elapsedNanoseconds());
+        }
+    }
+
+    /// \brief Adds the counters and latencies to a snapshot
+    void addTo(MetricsSnapshot & snapshot) const;
+
+private:
+#if PARKING_LOT_METRICS
+    std::array<std::atomic<std::uint64_t>, kParkingEventTypeCount> m_events{};
+    std::array<ConcurrentLatencyHistogram, kGateLatencyCount> m_latencies;
+#endif
+};
+
+/// \brief Locks a mutex like std::lock_guard and records how long it waited for the mutex and held it
+class MeteredLock
+{
+public:
+    MeteredLock(std::mutex & mutex, GateMetrics & metrics)
+        : m_metrics(metrics), m_lock(mutex)
+    {
+        if (m_stopwatch.running())
+        {
+            m_metrics.record(GateLatency::LockWait, m_stopwatch.lap());
+        }
+    }
+
+    /// \brief Records the hold time before the member lock releases the mutex
+    ~MeteredLock() { m_metrics.record(GateLatency::LockHold, m_stopwatch); }
+
+    MeteredLock(const MeteredLock &) = delete;
+    MeteredLock & operator=(const MeteredLock &) = delete;
+
+private:
+    GateMetrics & m_metrics;
+
+    /// Started before the mutex is locked, the members are initialized in this order
+    MetricsStopwatch m_stopwatch;
+    std::unique_lock<std::mutex> m_lock;
+};
\ No newline at end of file
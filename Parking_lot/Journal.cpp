@@ -0,0 +1,434 @@
+#include <array>
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "Journal.h"
+#include "JournalException.h"
+
+namespace
+{
+    /// Record layout: CRC-32 of the bytes after it, kind, vehicle type, license plate length,
+    /// license plate, 2 unused bytes, ticket ID, bay, 4 unused bytes, entry time. Integers are in host byte order.
+    const std::size_t kCrcOffset = 0;
+    const std::size_t kKindOffset = 4;
+    const std::size_t kVehicleTypeOffset = 5;
+    const std::size_t kLicensePlateLengthOffset = 6;
+    const std::size_t kLicensePlateOffset = 7;
+    const std::size_t kTicketIDOffset = 32;
+    const std::size_t kBayOffset = 40;
+    const std::size_t kEntryTimeOffset = 48;
+
+    /// Snapshot layout: magic, record count, next ticket sequence, CRC-32 of the bytes before it, 4 unused bytes,
+    /// then the records in the journal record layout
+    const char kSnapshotMagic[8] = { 'P', 'L', 'S', 'N', 'A', 'P', '0', '2' };
+    const std::size_t kSnapshotCrcOffset = 24;
+    const std::size_t kSnapshotHeaderSize = 32;
+
+    /// Number of records read or written with one call
+    const std::size_t kRecordsPerChunk = 4096;
+
+    std::array<std::uint32_t, 256> makeCrcTable()
+    {
+        std::array<std::uint32_t, 256> table{};
+        for (std::uint32_t i = 0; i < 256; ++i)
+        {
+            std::uint32_t crc = i;
+            for (int bit = 0; bit < 8; ++bit)
+            {
+                crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+            }
+            table[i] = crc;
+        }
+        return table;
+    }
+
+    const std::array<std::uint32_t, 256> kCrcTable = makeCrcTable();
+
+    /// \brief CRC-32 (IEEE 802.3)
+    std::uint32_t crc32(const char * data, const std::size_t size, std::uint32_t crc = 0)
+    {
+        crc = ~crc;
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            crc = kCrcTable[(crc ^ static_cast<unsigned char>(data[i])) & 0xFF] ^ (crc >> 8);
+        }
+        return ~crc;
+    }
+
+    template <typename T>
+    void put(char * out, const std::size_t offset, const T value)
+    {
+        std::memcpy(out + offset, &value, sizeof(T));
+    }
+
+    template <typename T>
+    T get(const char * in, const std::size_t offset)
+    {
+        T value;
+        std::memcpy(&value, in + offset, sizeof(T));
+        return value;
+    }
+
+    void encodeRecord(const JournalRecordKind kind, const ParkedRecord & record, char * out)
+    {
+        std::memset(out, 0, Journal::kRecordSize);
+        std::string_view license_plate = record.license_plate.view();
+        put(out, kKindOffset, static_cast<std::uint8_t>(kind));
+        put(out, kVehicleTypeOffset, static_cast<std::uint8_t>(record.type));
+        put(out, kLicensePlateLengthOffset, static_cast<std::uint8_t>(license_plate.size()));
+        std::memcpy(out + kLicensePlateOffset, license_plate.data(), license_plate.size());
+        put(out, kTicketIDOffset, static_cast<std::int64_t>(record.ticket_id));
+        put(out, kBayOffset, static_cast<std::int32_t>(record.bay));
+        put(out, kEntryTimeOffset, static_cast<std::int64_t>(record.entry_time_us));
+        put(out, kCrcOffset, crc32(out + kKindOffset, Journal::kRecordSize - kKindOffset));
+    }
+
+    bool decodeRecord(const char * in, JournalRecordKind & kind, ParkedRecord & record)
+    {
+        if (get<std::uint32_t>(in, kCrcOffset) != crc32(in + kKindOffset, Journal::kRecordSize - kKindOffset))
+        {
+            return false;
+        }
+        std::uint8_t raw_kind = get<std::uint8_t>(in, kKindOffset);
+        std::uint8_t vehicle_type = get<std::uint8_t>(in, kVehicleTypeOffset);
+        std::uint8_t license_plate_length = get<std::uint8_t>(in, kLicensePlateLengthOffset);
+        if ((raw_kind != static_cast<std::uint8_t>(JournalRecordKind::Park) && raw_kind != static_cast<std::uint8_t>(JournalRecordKind::Release))
+            || vehicle_type >= kVehicleTypeCount || license_plate_length > LicensePlate::kMaxLength)
+        {
+            return false;
+        }
+
+        kind = static_cast<JournalRecordKind>(raw_kind);
+        record.type = static_cast<VehicleType>(vehicle_type);
+        record.license_plate = LicensePlate(std::string_view(in + kLicensePlateOffset, license_plate_length));
+        record.ticket_id = get<std::int64_t>(in, kTicketIDOffset);
+        record.bay = get<std::int32_t>(in, kBayOffset);
+        record.entry_time_us = get<std::int64_t>(in, kEntryTimeOffset);
+        return true;
+    }
+
+    /// \brief Flushes the C library buffer and asks the OS to put the file on the disk
+    bool syncFile(std::FILE * file, const bool sync)
+    {
+        if (std::fflush(file) != 0)
+        {
+            return false;
+        }
+#ifdef _WIN32
+        return !sync || _commit(_fileno(file)) == 0;
+#else
+        return !sync || fsync(fileno(file)) == 0;
+#endif
+    }
+}
+
+Journal::Journal(const JournalConfig & config, const std::uint64_t generation)
+    : m_config(config), m_generation(generation), m_file(open(config, generation))
+{
+
+}
+
+Journal::~Journal()
+{
+    try
+    {
+        if (m_retired_file)
+        {
+            finishRotation();
+        }
+        waitDurable(m_appended);
+    }
+    catch (const JournalException &)
+    {
+        // Nothing left to report the failure to, the records are lost like in a crash
+    }
+    std::fclose(m_file);
+    if (m_next_file)
+    {
+        std::fclose(m_next_file);
+    }
+}
+
+std::uint64_t Journal::append(const JournalRecordKind kind, const ParkedRecord & record)
+{
+    char encoded[kRecordSize];
+    encodeRecord(kind, record, encoded);
+    m_records_since_rotation.fetch_add(1, std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pending.insert(m_pending.end(), encoded, encoded + kRecordSize);
+    return ++m_appended;
+}
+
+std::uint64_t Journal::lastSequence()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_appended;
+}
+
+void Journal::waitDurable(const std::uint64_t sequence)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (m_durable < sequence)
+    {
+        if (m_failed)
+        {
+            // The parking lot cannot promise that a vehicle survives a restart, stopping beats losing tickets silently
+            throw JournalException("Journal file " + journalPath(m_config, m_generation) + " cannot be written.");
+        }
+        if (m_committing || m_retired_file)
+        {
+            // Another thread is writing, or the records of the previous file are not written yet,
+            // a later write covers this record
+            m_written.wait(lock);
+            continue;
+        }
+
+        // Become the committing thread for everything appended so far
+        m_committing = true;
+        m_pending.swap(m_writing);
+        std::uint64_t committed = m_appended;
+        std::FILE * file = m_file;
+        lock.unlock();
+
+        bool written = writeBuffer(file, m_writing);
+        m_writing.clear();
+
+        lock.lock();
+        m_committing = false;
+        if (written)
+        {
+            m_durable = committed;
+        }
+        else
+        {
+            m_failed = true;
+        }
+        m_written.notify_all();
+    }
+}
+
+void Journal::prepareRotation(const std::uint64_t generation)
+{
+    waitDurable(lastSequence());
+
+    // Records keep going to the current file until rotate
+    std::FILE * file = open(m_config, generation);
+    if (m_next_file)
+    {
+        std::fclose(m_next_file);
+    }
+    m_next_file = file;
+    m_next_generation = generation;
+}
+
+void Journal::rotate()
+{
+    // A group commit in progress still writes to the previous file, finishRotation waits for it
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_retired_file = m_file;
+    m_retired_generation = m_generation;
+    m_retired.swap(m_pending);
+    m_retired_sequence = m_appended;
+    m_file = m_next_file;
+    m_generation = m_next_generation;
+    m_next_file = nullptr;
+    m_records_since_rotation.store(0, std::memory_order_relaxed);
+}
+
+void Journal::finishRotation()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_written.wait(lock, [this]() { return !m_committing; });
+    m_committing = true;
+    std::FILE * file = m_retired_file;
+    lock.unlock();
+
+    bool written = writeBuffer(file, m_retired);
+    std::fclose(file);
+    m_retired.clear();
+
+    lock.lock();
+    m_committing = false;
+    m_retired_file = nullptr;
+    if (written && !m_failed)
+    {
+        m_durable = m_retired_sequence;
+    }
+    else
+    {
+        m_failed = true;
+    }
+    m_written.notify_all();
+    if (m_failed)
+    {
+        throw JournalException("Journal file " + journalPath(m_config, m_retired_generation) + " cannot be written.");
+    }
+}
+
+bool Journal::failed()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_failed;
+}
+
+std::FILE * Journal::open(const JournalConfig & config, const std::uint64_t generation)
+{
+    std::string path = journalPath(config, generation);
+    std::FILE * file = std::fopen(path.c_str(), "ab");
+    if (!file)
+    {
+        throw JournalException("Journal file " + path + " cannot be opened.");
+    }
+    return file;
+}
+
+bool Journal::writeBuffer(std::FILE * file, const std::vector<char> & buffer)
+{
+    return buffer.empty() || (std::fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size() && syncFile(file, m_config.sync));
+}
+
+std::string Journal::journalPath(const JournalConfig & config, const std::uint64_t generation)
+{
+    return (std::filesystem::path(config.directory) / (config.name + ".journal." + std::to_string(generation))).string();
+}
+
+std::string Journal::snapshotPath(const JournalConfig & config, const std::uint64_t generation)
+{
+    return (std::filesystem::path(config.directory) / (config.name + ".snapshot." + std::to_string(generation))).string();
+}
+
+std::vector<std::uint64_t> Journal::listGenerations(const JournalConfig & config, const bool snapshots)
+{
+    std::string prefix = config.name + (snapshots ? ".snapshot." : ".journal.");
+    std::vector<std::uint64_t> generations;
+    for (const auto & entry : std::filesystem::directory_iterator(config.directory))
+    {
+        std::string file_name = entry.path().filename().string();
+        if (file_name.compare(0, prefix.size(), prefix) != 0 || file_name.size() == prefix.size())
+        {
+            continue;
+        }
+        std::string suffix = file_name.substr(prefix.size());
+        if (std::all_of(suffix.begin(), suffix.end(), [](char c) { return c >= '0' && c <= '9'; }))
+        {
+            generations.push_back(std::stoull(suffix));
+        }
+    }
+    std::sort(generations.begin(), generations.end());
+    return generations;
+}
+
+std::size_t Journal::replay(const std::string & path, const std::function<void(JournalRecordKind, const ParkedRecord &)> & apply)
+{
+    std::FILE * file = std::fopen(path.c_str(), "rb");
+    if (!file)
+    {
+        return 0;
+    }
+
+    std::vector<char> chunk(kRecordsPerChunk * kRecordSize);
+    std::size_t count = 0;
+    bool intact = true;
+    while (intact)
+    {
+        std::size_t records = std::fread(chunk.data(), 1, chunk.size(), file) / kRecordSize;
+        for (std::size_t i = 0; i < records && intact; ++i)
+        {
+            JournalRecordKind kind;
+            ParkedRecord record;
+            intact = decodeRecord(chunk.data() + i * kRecordSize, kind, record);
+            if (intact)
+            {
+                apply(kind, record);
+                ++count;
+            }
+        }
+        intact = intact && records == kRecordsPerChunk;
+    }
+    std::fclose(file);
+    return count;
+}
+
+void Journal::writeSnapshot(const std::string & path, const JournalSnapshot & snapshot, const bool sync)
+{
+    std::string temporary_path = path + ".tmp";
+    std::FILE * file = std::fopen(temporary_path.c_str(), "wb");
+    if (!file)
+    {
+        throw JournalException("Snapshot file " + temporary_path + " cannot be created.");
+    }
+
+    std::vector<char> buffer(kSnapshotHeaderSize, 0);
+    std::memcpy(buffer.data(), kSnapshotMagic, sizeof(kSnapshotMagic));
+    put(buffer.data(), 8, static_cast<std::uint64_t>(snapshot.records.size()));
+    put(buffer.data(), 16, static_cast<std::int64_t>(snapshot.next_ticket_sequence));
+    put(buffer.data(), kSnapshotCrcOffset, crc32(buffer.data(), kSnapshotCrcOffset));
+
+    bool written = std::fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+    buffer.resize(kRecordsPerChunk * kRecordSize);
+    for (std::size_t begin = 0; written && begin < snapshot.records.size(); begin += kRecordsPerChunk)
+    {
+        std::size_t end = std::min(begin + kRecordsPerChunk, snapshot.records.size());
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            encodeRecord(JournalRecordKind::Park, snapshot.records[i], buffer.data() + (i - begin) * kRecordSize);
+        }
+        written = std::fwrite(buffer.data(), 1, (end - begin) * kRecordSize, file) == (end - begin) * kRecordSize;
+    }
+    written = written && syncFile(file, sync);
+    std::fclose(file);
+
+    std::error_code error;
+    if (written)
+    {
+        std::filesystem::rename(temporary_path, path, error);
+    }
+    if (!written || error)
+    {
+        std::filesystem::remove(temporary_path, error);
+        throw JournalException("Snapshot file " + path + " cannot be written.");
+    }
+}
+
+bool Journal::readSnapshot(const std::string & path, JournalSnapshot & snapshot)
+{
+    std::FILE * file = std::fopen(path.c_str(), "rb");
+    if (!file)
+    {
+        return false;
+    }
+
+    char header[kSnapshotHeaderSize];
+    bool intact = std::fread(header, 1, kSnapshotHeaderSize, file) == kSnapshotHeaderSize
+        && std::memcmp(header, kSnapshotMagic, sizeof(kSnapshotMagic)) == 0;
+    intact = intact && get<std::uint32_t>(header, kSnapshotCrcOffset) == crc32(header, kSnapshotCrcOffset);
+    std::uint64_t record_count = intact ? get<std::uint64_t>(header, 8) : 0;
+    snapshot.next_ticket_sequence = intact ? get<std::int64_t>(header, 16) : 1;
+
+    std::vector<char> buffer;
+    snapshot.records.clear();
+    snapshot.records.reserve(intact ? static_cast<std::size_t>(record_count) : 0);
+    buffer.resize(kRecordsPerChunk * kRecordSize);
+    while (intact && snapshot.records.size() < record_count)
+    {
+        std::size_t records = static_cast<std::size_t>(std::min<std::uint64_t>(kRecordsPerChunk, record_count - snapshot.records.size()));
+        intact = std::fread(buffer.data(), 1, records * kRecordSize, file) == records * kRecordSize;
+        for (std::size_t i = 0; i < records && intact; ++i)
+        {
+            JournalRecordKind kind;
+            ParkedRecord record;
+            intact = decodeRecord(buffer.data() + i * kRecordSize, kind, record) && kind == JournalRecordKind::Park;
+            snapshot.records.push_back(record);
+        }
+    }
+    std::fclose(file);
+    return intact;
+}
\ No newline at end of file
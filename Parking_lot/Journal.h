@@ -0,0 +1,170 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "ParkedVehicleTable.h"
+
+/// \brief Kind of a journal record
+enum class JournalRecordKind : std::uint8_t
+{
+    Park = 1,
+    Release = 2
+};
+
+/// \brief Settings of the Journal
+struct JournalConfig
+{
+    /// Directory of the journal and snapshot files, it must exist
+    std::string directory = ".";
+
+    /// Files are named <name>.journal.<generation> and <name>.snapshot.<generation>
+    std::string name = "parking";
+
+    /// Whether every group commit is synced to the disk, otherwise records survive a process crash but not an OS crash
+    bool sync = true;
+
+    /// A snapshot is taken after this many journal records, 0 leaves snapshots to ParkingLot::checkpoint
+    std::size_t snapshot_interval = 100000;
+};
+
+/// \brief What ParkingLot::openJournal restored
+struct JournalRecoveryStats
+{
+    std::size_t snapshot_records = 0;
+    std::size_t journal_records = 0;
+    std::size_t parked_vehicles = 0;
+};
+
+/// \brief Parked vehicles and ticket sequence of a parking lot at the start of a journal generation
+struct JournalSnapshot
+{
+    /// TicketGenerator::nextSequence, no ticket issued before the snapshot has a higher sequence number
+    TicketID next_ticket_sequence = 1;
+    std::vector<ParkedRecord> records;
+};
+
+/// \brief Append-only binary journal of park and release records
+/// Records have a fixed size and a CRC-32, so a torn write at the end of the file is detected and ignored on replay.
+/// Appending only copies the record into a buffer; waitDurable writes the buffer with a single write (and sync)
+/// for all threads that appended in the meantime (group commit).
+class Journal
+{
+public:
+    /// Size of an encoded record in bytes
+    static const std::size_t kRecordSize = 56;
+
+    /// \brief Constructor, creates the journal file of the given generation
+    /// \throw Throws JournalException if the file cannot be created
+    Journal(const JournalConfig & config, const std::uint64_t generation);
+
+    /// \brief Destructor, writes the records that are not durable yet
+    ~Journal();
+
+    Journal(const Journal &) = delete;
+    Journal & operator=(const Journal &) = delete;
+
+    /// \brief Queues a record, the records of a vehicle must be appended in the order of its park and release
+    /// \return Returns the sequence number to pass to waitDurable
+    std::uint64_t append(const JournalRecordKind kind, const ParkedRecord & record);
+
+    /// \brief Blocks until the record with the given sequence number and all before it are written
+    /// \throw Throws JournalException if the journal file cannot be written
+    void waitDurable(const std::uint64_t sequence);
+
+    /// \brief Writes the queued records and opens the file of the next generation for rotate,
+    /// the records appended meanwhile still go to the current file. Called by one thread at a time.
+    /// \throw Throws JournalException if the current file cannot be written or the new one cannot be opened,
+    /// the journal then stays in the current file
+    void prepareRotation(const std::uint64_t generation);
+
+    /// \brief Continues in the file opened by prepareRotation, only swaps the files and the queued records.
+    /// The records queued until now stay with the previous file, finishRotation must be called next.
+    /// No record may be appended concurrently.
+    void rotate();
+
+    /// \brief Writes the records queued before rotate to the previous file and closes it, records of the
+    /// new file become durable only after them
+    /// \throw Throws JournalException if the previous file cannot be written
+    void finishRotation();
+
+    /// \brief Whether a write failed, no record appended since then becomes durable
+    bool failed();
+
+    std::uint64_t generation() const { return m_generation; }
+
+    const JournalConfig & config() const { return m_config; }
+
+    /// \brief Sequence number of the last appended record
+    std::uint64_t lastSequence();
+
+    /// \brief Number of records appended since the file was created
+    std::size_t recordsSinceRotation() const { return m_records_since_rotation.load(std::memory_order_relaxed); }
+
+    /// \brief Path of the journal file of a generation
+    static std::string journalPath(const JournalConfig & config, const std::uint64_t generation);
+
+    /// \brief Path of the snapshot file of a generation
+    static std::string snapshotPath(const JournalConfig & config, const std::uint64_t generation);
+
+    /// \brief Generations of the journal or snapshot files in the directory, in ascending order
+    static std::vector<std::uint64_t> listGenerations(const JournalConfig & config, const bool snapshots);
+
+    /// \brief Reads a journal file up to its end or its first damaged record
+    /// \param[in] apply Called for every intact record
+    /// \return Returns the number of intact records
+    static std::size_t replay(const std::string & path, const std::function<void(JournalRecordKind, const ParkedRecord &)> & apply);
+
+    /// \brief Writes a snapshot file, it only appears under its name once it is complete
+    /// \throw Throws JournalException if the file cannot be written
+    static void writeSnapshot(const std::string & path, const JournalSnapshot & snapshot, const bool sync);
+
+    /// \brief Reads a snapshot file
+    /// \return Returns false if the file is missing or damaged
+    static bool readSnapshot(const std::string & path, JournalSnapshot & snapshot);
+
+private:
+    /// \brief Opens the journal file of a generation for appending
+    /// \throw Throws JournalException if the file cannot be opened
+    static std::FILE * open(const JournalConfig & config, const std::uint64_t generation);
+
+    /// \brief Writes the queued records, called by one thread at a time without m_mutex held
+    /// \return Returns false if the records could not be written
+    bool writeBuffer(std::FILE * file, const std::vector<char> & buffer);
+
+private:
+    JournalConfig m_config;
+    std::uint64_t m_generation = 0;
+    std::FILE * m_file = nullptr;
+
+    std::mutex m_mutex;
+    std::condition_variable m_written;
+
+    /// Encoded records waiting for the next group commit, swapped with m_writing by the committing thread
+    std::vector<char> m_pending;
+    std::vector<char> m_writing;
+
+    std::uint64_t m_appended = 0;
+    std::uint64_t m_durable = 0;
+    bool m_committing = false;
+    bool m_failed = false;
+
+    /// File of the next generation, opened by prepareRotation
+    std::FILE * m_next_file = nullptr;
+    std::uint64_t m_next_generation = 0;
+
+    /// Previous file and the records queued for it from rotate until finishRotation, no group commit starts meanwhile
+    std::FILE * m_retired_file = nullptr;
+    std::uint64_t m_retired_generation = 0;
+    std::vector<char> m_retired;
+    std::uint64_t m_retired_sequence = 0;
+
+    std::atomic<std::size_t> m_records_since_rotation{ 0 };
+};
\ No newline at end of file
@@ -0,0 +1,106 @@
+#include <cmath>
+
+#include "LatencyHistogram.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace
+{
+    /// \brief Index of the highest set bit, the value must not be 0
+    inline std::size_t highestSetBit(const std::uint64_t value)
+    {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanReverse64(&index, value);
+        return index;
+#else
+        return static_cast<std::size_t>(63 - __builtin_clzll(value));
+#endif
+    }
+}
+
+void LatencyHistogram::merge(const LatencyHistogram & other)
+{
+    for (std::size_t bucket = 0; bucket < kBucketCount; ++bucket)
+    {
+        m_counts[bucket] += other.m_counts[bucket];
+    }
+    m_count += other.m_count;
+    m_sum += other.m_sum;
+}
+
+void LatencyHistogram::reset()
+{
+    m_counts.fill(0);
+    m_count = 0;
+    m_sum = 0;
+}
+
+std::uint64_t LatencyHistogram::percentile(const double percentile) const
+{
+    if (m_count == 0)
+    {
+        return 0;
+    }
+    // Rank of the value, 1-based: the p50 of 1000 values is the 500th smallest
+    std::uint64_t rank = static_cast<std::uint64_t>(std::ceil(percentile / 100.0 * static_cast<double>(m_count)));
+    if (rank == 0)
+    {
+        rank = 1;
+    }
+
+    std::uint64_t seen = 0;
+    for (std::size_t bucket = 0; bucket < kBucketCount; ++bucket)
+    {
+        seen += m_counts[bucket];
+        if (seen >= rank)
+        {
+            return upperBoundOf(bucket);
+        }
+    }
+    return upperBoundOf(kBucketCount - 1);
+}
+
+std::size_t LatencyHistogram::bucketOf(const std::uint64_t value)
+{
+    if (value < kLinearCount)
+    {
+        return static_cast<std::size_t>(value);
+    }
+    // The top kSubBucketBits + 1 bits of the value select the bucket within its power of two
+    std::size_t shift = highestSetBit(value) - kSubBucketBits;
+    return kLinearCount + (shift - 1) * kSubBucketCount + static_cast<std::size_t>((value >> shift) & (kSubBucketCount - 1));
+}
+
+std::uint64_t LatencyHistogram::upperBoundOf(const std::size_t bucket)
+{
+    if (bucket < kLinearCount)
+    {
+        return bucket;
+    }
+    std::size_t shift = (bucket - kLinearCount) / kSubBucketCount + 1;
+    std::uint64_t sub_bucket = (bucket - kLinearCount) % kSubBucketCount;
+    std::uint64_t lowest = (kSubBucketCount + sub_bucket) << shift;
+    return lowest + ((std::uint64_t(1) << shift) - 1);
+}
+
+ConcurrentLatencyHistogram::ConcurrentLatencyHistogram()
+{
+    for (auto & count : m_counts)
+    {
+        count.store(0, std::memory_order_relaxed);
+    }
+}
+
+void ConcurrentLatencyHistogram::addTo(LatencyHistogram & histogram) const
+{
+    for (std::size_t bucket = 0; bucket < LatencyHistogram::kBucketCount; ++bucket)
+    {
+        std::uint64_t count = m_counts[bucket].load(std::memory_order_relaxed);
+        histogram.m_counts[bucket] += count;
+        histogram.m_count += count;
+    }
+    histogram.m_sum += m_sum.load(std::memory_order_relaxed);
+}
\ No newline at end of file
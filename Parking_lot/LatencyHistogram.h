@@ -0,0 +1,93 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/// \brief Counts latencies in logarithmic buckets, e.g. to report p50/p99/p999 of the gate operations
+/// Values below 64 get a bucket each, larger values are split into 32 buckets per power of two,
+/// so a percentile is off by at most about 3% and recording a value is a few instructions.
+/// Not thread safe, every thread records into its own histogram and the histograms are merged afterwards.
+class LatencyHistogram
+{
+public:
+    LatencyHistogram() { reset(); }
+
+    /// \brief Counts one value, e.g. a latency in nanoseconds
+    void record(const std::uint64_t value)
+    {
+        ++m_counts[bucketOf(value)];
+        ++m_count;
+        m_sum += value;
+    }
+
+    /// \brief Adds the values of another histogram
+    void merge(const LatencyHistogram & other);
+
+    void reset();
+
+    /// \brief Number of recorded values
+    std::uint64_t count() const { return m_count; }
+
+    /// \brief Sum of the recorded values, e.g. for the mean
+    std::uint64_t sum() const { return m_sum; }
+
+    /// \brief Value at or below which the given share of the recorded values lies
+    /// \param[in] percentile Percentile from 0 to 100, e.g. 99.9
+    /// \return Returns the upper bound of the bucket holding the percentile, 0 if nothing was recorded
+    std::uint64_t percentile(const double percentile) const;
+
+    /// \brief Counts values by their bucket, e.g. counted elsewhere with bucketOf; they add nothing to the sum
+    void addToBucket(const std::size_t bucket, const std::uint64_t count)
+    {
+        m_counts[bucket] += count;
+        m_count += count;
+    }
+
+    /// \brief Bucket a value is counted in
+    static std::size_t bucketOf(const std::uint64_t value);
+
+    /// \brief Number of buckets the values below 2^bits are counted in, they are the first buckets
+    static constexpr std::size_t bucketCountBelow(const std::size_t bits)
+    {
+        return bits <= kSubBucketBits + 1 ? std::size_t(1) << bits : kLinearCount + (bits - kSubBucketBits - 1) * kSubBucketCount;
+    }
+
+private:
+    friend class ConcurrentLatencyHistogram;
+
+    static constexpr std::size_t kSubBucketBits = 5;
+    static constexpr std::size_t kSubBucketCount = std::size_t(1) << kSubBucketBits;
+    static constexpr std::size_t kLinearCount = kSubBucketCount * 2;
+    static constexpr std::size_t kBucketCount = kLinearCount + (64 - kSubBucketBits - 1) * kSubBucketCount;
+
+    /// \brief Highest value counted in the bucket
+    static std::uint64_t upperBoundOf(const std::size_t bucket);
+
+private:
+    std::array<std::uint64_t, kBucketCount> m_counts;
+    std::uint64_t m_count;
+    std::uint64_t m_sum;
+};
+
+/// \brief LatencyHistogram that any number of threads can record into at the same time
+/// Every value is one relaxed atomic increment, the buckets are read into a LatencyHistogram for evaluation.
+class ConcurrentLatencyHistogram
+{
+public:
+    ConcurrentLatencyHistogram();
+
+    void record(const std::uint64_t value)
+    {
+        m_counts[LatencyHistogram::bucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+        m_sum.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    /// \brief Adds the recorded values to a histogram, values recorded meanwhile may be left out
+    void addTo(LatencyHistogram & histogram) const;
+
+private:
+    std::array<std::atomic<std::uint64_t>, LatencyHistogram::kBucketCount> m_counts;
+    std::atomic<std::uint64_t> m_sum{ 0 };
+};
\ No newline at end of file
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+#include "InvalidLicensePlateException.h"
+
+/// \brief License plate stored inline in a fixed size buffer, so copying it never allocates
+class LicensePlate
+{
+public:
+    /// Longest supported license plate
+    static const std::size_t kMaxLength = 23;
+
+    /// Constructor of an empty license plate
+    LicensePlate() : m_characters(), m_length(0) {}
+
+    /// Constructor
+    /// \param[in] license_plate License plate text
+    /// \throw Throws InvalidLicensePlateException if the license plate is longer than kMaxLength
+    LicensePlate(const std::string_view license_plate)
+    {
+        if (license_plate.size() > kMaxLength)
+        {
+            throw InvalidLicensePlateException("License plate " + std::string(license_plate) + " is longer than "
+                + std::to_string(kMaxLength) + " characters.");
+        }
+        std::memcpy(m_characters, license_plate.data(), license_plate.size());
+        m_length = static_cast<std::uint8_t>(license_plate.size());
+    }
+
+    LicensePlate(const std::string & license_plate) : LicensePlate(std::string_view(license_plate)) {}
+    LicensePlate(const char * license_plate) : LicensePlate(std::string_view(license_plate)) {}
+
+    /// \return Returns the license plate text, valid as long as this object
+    std::string_view view() const { return std::string_view(m_characters, m_length); }
+
+    /// \return Returns a copy of the license plate text
+    std::string str() const { return std::string(m_characters, m_length); }
+
+    bool empty() const { return m_length == 0; }
+
+    /// \brief FNV-1a hash of the license plate text
+    static std::uint64_t hash(const std::string_view license_plate)
+    {
+        std::uint64_t hash = 14695981039346656037ull;
+        for (char character : license_plate)
+        {
+            hash ^= static_cast<unsigned char>(character);
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    std::uint64_t hash() const { return hash(view()); }
+
+    bool operator==(const LicensePlate & other) const { return view() == other.view(); }
+    bool operator!=(const LicensePlate & other) const { return view() != other.view(); }
+
+private:
+    char m_characters[kMaxLength];
+    std::uint8_t m_length;
+};
\ No newline at end of file
@@ -0,0 +1,307 @@
+#include <algorithm>
+
+#include "LicensePlateTrie.h"
+
+namespace
+{
+    /// \brief Copies the license plate backwards into the buffer, which holds LicensePlate::kMaxLength + LicensePlateTrie::kMaxDistance characters
+    std::string_view reverseInto(const std::string_view license_plate, char * buffer)
+    {
+        std::reverse_copy(license_plate.begin(), license_plate.end(), buffer);
+        return std::string_view(buffer, license_plate.size());
+    }
+}
+
+LicensePlateTrie::LicensePlateTrie()
+{
+}
+
+void LicensePlateTrie::insert(const std::string_view license_plate, const std::uint32_t value)
+{
+    if (license_plate.size() > LicensePlate::kMaxLength)
+    {
+        return;
+    }
+    char reversed[LicensePlate::kMaxLength];
+    m_forward.insert(license_plate, value);
+    m_reversed.insert(reverseInto(license_plate, reversed), value);
+}
+
+void LicensePlateTrie::erase(const std::string_view license_plate)
+{
+    if (license_plate.size() > LicensePlate::kMaxLength)
+    {
+        return;
+    }
+    char reversed[LicensePlate::kMaxLength];
+    m_forward.erase(license_plate);
+    m_reversed.erase(reverseInto(license_plate, reversed));
+}
+
+void LicensePlateTrie::findByPrefix(const std::string_view prefix, const std::size_t max_count, std::vector<std::uint32_t> & values) const
+{
+    std::uint32_t node = 0;
+    for (std::size_t i = 0; i < prefix.size() && node != kNoNode; ++i)
+    {
+        node = m_forward.findChild(node, prefix[i]);
+    }
+    if (node != kNoNode)
+    {
+        collect(node, values.size() + max_count, values);
+    }
+}
+
+void LicensePlateTrie::findWithin(const std::string_view license_plate, const int max_distance, std::vector<std::pair<std::uint32_t, int>> & matches) const
+{
+    int distance = std::min(std::max(max_distance, 0), kMaxDistance);
+    std::size_t length = license_plate.size();
+    if (length > LicensePlate::kMaxLength + static_cast<std::size_t>(distance))
+    {
+        return;
+    }
+    std::size_t first = matches.size();
+    if (m_forward.nodes[0].value != kNoValue && static_cast<int>(length) <= distance)
+    {
+        matches.emplace_back(m_forward.nodes[0].value, static_cast<int>(length));
+    }
+
+    char reversed[LicensePlate::kMaxLength + kMaxDistance];
+    Search forward;
+    forward.license_plate = license_plate;
+    forward.max_distance = distance;
+    Search backward = forward;
+    backward.license_plate = reverseInto(license_plate, reversed);
+
+    // Within d edits, one half of the plate has at most d / 2 of them; with two edits and three parts, either the
+    // first or the last part has none, or each of them has one and the middle part none
+    DistanceRows rows;
+    if (distance == 2)
+    {
+        std::size_t first_part = length / 3;
+        std::size_t last_part = length / 3;
+        forward.condition_count = 1;
+        forward.lengths[0] = first_part;
+        backward.condition_count = 1;
+        backward.lengths[0] = last_part;
+        findWithin(m_forward, forward, rows, matches);
+        findWithin(m_reversed, backward, rows, matches);
+
+        forward.condition_count = 2;
+        forward.distances[0] = 1;
+        forward.lengths[1] = length - last_part;
+        forward.distances[1] = 1;
+        findWithin(m_forward, forward, rows, matches);
+    }
+    else
+    {
+        forward.condition_count = 1;
+        forward.lengths[0] = (length + 1) / 2;
+        forward.distances[0] = distance / 2;
+        backward.condition_count = 1;
+        backward.lengths[0] = length - forward.lengths[0];
+        backward.distances[0] = distance / 2;
+        findWithin(m_forward, forward, rows, matches);
+        findWithin(m_reversed, backward, rows, matches);
+    }
+
+    // Plates meeting the conditions of several searches are found by each of them
+    std::sort(matches.begin() + first, matches.end());
+    matches.erase(std::unique(matches.begin() + first, matches.end()), matches.end());
+}
+
+void LicensePlateTrie::findWithin(const Tree & tree, const Search & search, DistanceRows & rows, std::vector<std::pair<std::uint32_t, int>> & matches)
+{
+    // Row of the root: the license plate prefixes are that many deletions away from the empty string
+    for (std::size_t j = 0; j <= search.license_plate.size(); ++j)
+    {
+        rows[0][j] = static_cast<std::uint8_t>(j);
+    }
+    unsigned met = 0;
+    for (std::size_t i = 0; i < search.condition_count; ++i)
+    {
+        met |= static_cast<int>(search.lengths[i]) <= search.distances[i] ? 1u << i : 0u;
+    }
+    findWithin(tree, search, 0, 0, met, rows, matches);
+}
+
+void LicensePlateTrie::findWithin(const Tree & tree, const Search & search, const std::uint32_t node, const std::size_t depth,
+                                  const unsigned met, DistanceRows & rows, std::vector<std::pair<std::uint32_t, int>> & matches)
+{
+    if (depth == LicensePlate::kMaxLength)
+    {
+        return;
+    }
+
+    const std::uint8_t * above = rows[depth];
+    std::uint8_t * row = rows[depth + 1];
+    std::size_t length = search.license_plate.size();
+    unsigned all_met = (1u << search.condition_count) - 1;
+    for (std::uint32_t child = tree.nodes[node].first_child; child != kNoNode; child = tree.nodes[child].next_sibling)
+    {
+        char character = tree.nodes[child].character;
+        row[0] = static_cast<std::uint8_t>(above[0] + 1);
+        int lowest = row[0];
+        int lowest_within[2] = { lowest, lowest };
+        for (std::size_t j = 1; j <= length; ++j)
+        {
+            int replaced = above[j - 1] + (search.license_plate[j - 1] == character ? 0 : 1);
+            int cost = std::min({ above[j] + 1, row[j - 1] + 1, replaced });
+            row[j] = static_cast<std::uint8_t>(cost);
+            lowest = std::min(lowest, cost);
+            lowest_within[0] = j <= search.lengths[0] ? lowest : lowest_within[0];
+            lowest_within[1] = j <= search.lengths[1] ? lowest : lowest_within[1];
+        }
+        if (lowest > search.max_distance)
+        {
+            continue;
+        }
+
+        // A condition not met yet can only be met below if a cell up to its length is close enough, the cells
+        // never get smaller further down
+        unsigned child_met = met;
+        bool hopeless = false;
+        for (std::size_t i = 0; i < search.condition_count; ++i)
+        {
+            if (row[search.lengths[i]] <= search.distances[i])
+            {
+                child_met |= 1u << i;
+            }
+            hopeless = hopeless || ((child_met & (1u << i)) == 0 && lowest_within[i] > search.distances[i]);
+        }
+        if (hopeless)
+        {
+            continue;
+        }
+
+        if (tree.nodes[child].value != kNoValue && row[length] <= search.max_distance && child_met == all_met)
+        {
+            matches.emplace_back(tree.nodes[child].value, row[length]);
+        }
+        if (lowest < search.max_distance)
+        {
+            findWithin(tree, search, child, depth + 1, child_met, rows, matches);
+            continue;
+        }
+
+        // No edit is left, a match must continue with exactly the rest of the license plate after a cell at the
+        // maximum distance; following those few paths is much cheaper than computing rows for all children
+        for (std::size_t j = 0; j < length; ++j)
+        {
+            if (row[j] != search.max_distance)
+            {
+                continue;
+            }
+            std::uint32_t descendant = child;
+            for (std::size_t i = j; i < length && descendant != kNoNode; ++i)
+            {
+                descendant = tree.findChild(descendant, search.license_plate[i]);
+            }
+            if (descendant != kNoNode && tree.nodes[descendant].value != kNoValue)
+            {
+                matches.emplace_back(tree.nodes[descendant].value, search.max_distance);
+            }
+        }
+    }
+}
+
+void LicensePlateTrie::collect(const std::uint32_t node, const std::size_t max_count, std::vector<std::uint32_t> & values) const
+{
+    if (values.size() >= max_count)
+    {
+        return;
+    }
+    const Node & current = m_forward.nodes[node];
+    if (current.value != kNoValue)
+    {
+        values.push_back(current.value);
+    }
+    for (std::uint32_t child = current.first_child; child != kNoNode && values.size() < max_count; child = m_forward.nodes[child].next_sibling)
+    {
+        collect(child, max_count, values);
+    }
+}
+
+void LicensePlateTrie::Tree::insert(const std::string_view license_plate, const std::uint32_t value)
+{
+    std::uint32_t node = 0;
+    for (char character : license_plate)
+    {
+        // Siblings stay sorted, so the subtrees are visited in license plate order
+        std::uint32_t previous = kNoNode;
+        std::uint32_t child = nodes[node].first_child;
+        while (child != kNoNode && nodes[child].character < character)
+        {
+            previous = child;
+            child = nodes[child].next_sibling;
+        }
+        if (child == kNoNode || nodes[child].character != character)
+        {
+            std::uint32_t added = allocateNode(character);
+            nodes[added].next_sibling = child;
+            (previous == kNoNode ? nodes[node].first_child : nodes[previous].next_sibling) = added;
+            child = added;
+        }
+        node = child;
+    }
+    nodes[node].value = value;
+}
+
+void LicensePlateTrie::Tree::erase(const std::string_view license_plate)
+{
+    std::uint32_t path[LicensePlate::kMaxLength + 1];
+    path[0] = 0;
+    for (std::size_t depth = 0; depth < license_plate.size(); ++depth)
+    {
+        path[depth + 1] = findChild(path[depth], license_plate[depth]);
+        if (path[depth + 1] == kNoNode)
+        {
+            return;
+        }
+    }
+    nodes[path[license_plate.size()]].value = kNoValue;
+
+    // Unlinks the nodes that end no other license plate and lead to none, from the bottom up
+    for (std::size_t depth = license_plate.size(); depth > 0; --depth)
+    {
+        std::uint32_t node = path[depth];
+        if (nodes[node].value != kNoValue || nodes[node].first_child != kNoNode)
+        {
+            break;
+        }
+        std::uint32_t * link = &nodes[path[depth - 1]].first_child;
+        while (*link != node)
+        {
+            link = &nodes[*link].next_sibling;
+        }
+        *link = nodes[node].next_sibling;
+        nodes[node].next_sibling = free_head;
+        free_head = node;
+    }
+}
+
+std::uint32_t LicensePlateTrie::Tree::findChild(const std::uint32_t parent, const char character) const
+{
+    std::uint32_t child = nodes[parent].first_child;
+    while (child != kNoNode && nodes[child].character < character)
+    {
+        child = nodes[child].next_sibling;
+    }
+    return child != kNoNode && nodes[child].character == character ? child : kNoNode;
+}
+
+std::uint32_t LicensePlateTrie::Tree::allocateNode(const char character)
+{
+    std::uint32_t node = free_head;
+    if (node != kNoNode)
+    {
+        free_head = nodes[node].next_sibling;
+        nodes[node] = Node();
+    }
+    else
+    {
+        node = static_cast<std::uint32_t>(nodes.size());
+        nodes.emplace_back();
+    }
+    nodes[node].character = character;
+    return node;
+}
\ No newline at end of file
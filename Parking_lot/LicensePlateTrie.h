@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "LicensePlate.h"
+
+/// \brief Prefix trees of license plates, each mapped to a value, not thread-safe
+/// Nodes live in one array per tree and link to their first child and next sibling by index, siblings are sorted
+/// by character. Prefix queries walk down the prefix and return its subtree in license plate order.
+/// Approximate queries walk a tree with one row of the edit distance matrix per node and skip every subtree whose
+/// row already exceeds the maximum distance. Near the root almost every node is within a few edits of the first
+/// characters, so the query is split into parts and searched several times, each search allowing fewer edits in
+/// the parts it starts with: a plate one edit away has no edit in its first or in its second half, which is found
+/// in the forward tree or in a second tree of reversed license plates. Every search visits a small part of a tree.
+/// Freed nodes are reused, so once the trees have grown to their high-water mark, inserting and erasing never allocate.
+class LicensePlateTrie
+{
+public:
+    /// Value of nodes that end no license plate
+    static constexpr std::uint32_t kNoValue = 0xFFFFFFFFu;
+
+    /// Highest maximum distance of findWithin, the visited part of the trees grows quickly with it
+    static constexpr int kMaxDistance = 3;
+
+    LicensePlateTrie();
+
+    /// \brief Maps a license plate to a value, replacing its previous value
+    void insert(const std::string_view license_plate, const std::uint32_t value);
+
+    /// \brief Removes a license plate and the nodes no other license plate uses
+    void erase(const std::string_view license_plate);
+
+    /// \brief Appends the values of the license plates starting with prefix in license plate order
+    /// \param[in] prefix Beginning of the license plates, an empty prefix matches all of them
+    /// \param[in] max_count No more than this number of values is appended
+    /// \param[out] values Receives the values
+    void findByPrefix(const std::string_view prefix, const std::size_t max_count, std::vector<std::uint32_t> & values) const;
+
+    /// \brief Appends the values of the license plates that are at most max_distance characters inserted,
+    /// deleted or replaced away from license_plate (Levenshtein distance), together with their distance
+    /// \param[in] license_plate License plate to compare with
+    /// \param[in] max_distance Maximum distance, at most kMaxDistance
+    /// \param[out] matches Receives pairs of value and distance, sorted by value
+    void findWithin(const std::string_view license_plate, const int max_distance, std::vector<std::pair<std::uint32_t, int>> & matches) const;
+
+private:
+    static constexpr std::uint32_t kNoNode = 0xFFFFFFFFu;
+
+    struct Node
+    {
+        std::uint32_t first_child = kNoNode;
+        std::uint32_t next_sibling = kNoNode;
+        std::uint32_t value = kNoValue;
+        char character = 0;
+    };
+
+    /// \brief One prefix tree, node 0 is the root and free nodes are chained through next_sibling
+    struct Tree
+    {
+        std::vector<Node> nodes;
+        std::uint32_t free_head = kNoNode;
+
+        Tree() : nodes(1) {}
+
+        void insert(const std::string_view license_plate, const std::uint32_t value);
+        void erase(const std::string_view license_plate);
+
+        /// \brief Finds the child of a node with the given character
+        /// \return Returns the child or kNoNode
+        std::uint32_t findChild(const std::uint32_t parent, const char character) const;
+
+        std::uint32_t allocateNode(const char character);
+    };
+
+    /// \brief Search of one tree by findWithin
+    /// Subtrees are skipped unless every condition can still be met: some license plate prefix on the path must be
+    /// at most distances[i] edits away from the first lengths[i] characters. Conditions only prune, the reported
+    /// distances are those of the whole license plates.
+    struct Search
+    {
+        /// License plate, reversed for the tree of reversed license plates
+        std::string_view license_plate;
+        int max_distance = 0;
+
+        std::size_t condition_count = 0;
+        std::size_t lengths[2] = {};
+        int distances[2] = {};
+    };
+
+    /// Rows of the edit distance matrix, one per character of a stored license plate plus the root
+    static constexpr std::size_t kMaxRowLength = LicensePlate::kMaxLength + kMaxDistance + 1;
+    using DistanceRows = std::uint8_t[LicensePlate::kMaxLength + 1][kMaxRowLength];
+
+    /// \brief Searches a tree from the root
+    static void findWithin(const Tree & tree, const Search & search, DistanceRows & rows, std::vector<std::pair<std::uint32_t, int>> & matches);
+
+    /// \brief Visits the children of a node, rows[depth] belongs to the node
+    /// \param[in] met Bit i is set if condition i of the search is met on the path to the node
+    static void findWithin(const Tree & tree, const Search & search, const std::uint32_t node, const std::size_t depth,
+                           const unsigned met, DistanceRows & rows, std::vector<std::pair<std::uint32_t, int>> & matches);
+
+    /// \brief Appends the values of the subtree of a node in license plate order
+    void collect(const std::uint32_t node, const std::size_t max_count, std::vector<std::uint32_t> & values) const;
+
+private:
+    Tree m_forward;
+
+    /// The same license plates written backwards
+    Tree m_reversed;
+};
\ No newline at end of file
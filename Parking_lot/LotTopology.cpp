@@ -0,0 +1,75 @@
+#include <algorithm>
+
+#include "LotTopology.h"
+
+LotTopology::LotTopology()
+{
+    m_bay_kinds[toIndex(VehicleType::Car)] = { BayKind::Standard, BayKind::Compact, BayKind::EV, BayKind::Bus };
+    m_bay_kinds[toIndex(VehicleType::Motorcycle)] = { BayKind::Motorcycle, BayKind::Compact, BayKind::Standard };
+    m_bay_kinds[toIndex(VehicleType::Bus)] = { BayKind::Bus };
+}
+
+std::size_t LotTopology::addZone(const ZoneSpec & zone)
+{
+    m_zones.push_back(zone);
+    for (auto & bays : m_zones.back().bays)
+    {
+        bays = std::max(bays, 0);
+    }
+    return m_zones.size() - 1;
+}
+
+void LotTopology::addFloors(const int floor_count, const int zones_per_floor, const std::array<int, kBayKindCount> & bays_per_zone)
+{
+    for (int floor = 0; floor < floor_count; ++floor)
+    {
+        for (int zone = 0; zone < zones_per_floor; ++zone)
+        {
+            addZone(ZoneSpec{ floor, std::to_string(floor) + "-" + std::string(1, static_cast<char>('A' + zone % 26)), zone + 1, bays_per_zone });
+        }
+    }
+}
+
+void LotTopology::setBayKinds(const VehicleType vehicle_type, const std::vector<BayKind> & kinds)
+{
+    // A kind listed twice would only be searched twice
+    std::vector<BayKind> unique_kinds;
+    for (BayKind kind : kinds)
+    {
+        if (std::find(unique_kinds.begin(), unique_kinds.end(), kind) == unique_kinds.end())
+        {
+            unique_kinds.push_back(kind);
+        }
+    }
+    m_bay_kinds[toIndex(vehicle_type)] = unique_kinds;
+}
+
+int LotTopology::bayCount() const
+{
+    int count = 0;
+    for (std::size_t kind = 0; kind < kBayKindCount; ++kind)
+    {
+        count += bayCount(static_cast<BayKind>(kind));
+    }
+    return count;
+}
+
+int LotTopology::bayCount(const BayKind kind) const
+{
+    int count = 0;
+    for (const auto & zone : m_zones)
+    {
+        count += zone.bays[toIndex(kind)];
+    }
+    return count;
+}
+
+int LotTopology::usableBays(const VehicleType vehicle_type) const
+{
+    int count = 0;
+    for (BayKind kind : bayKinds(vehicle_type))
+    {
+        count += bayCount(kind);
+    }
+    return count;
+}
\ No newline at end of file
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "VehicleType.h"
+
+/// \brief Kind of a bay, what it is built for
+enum class BayKind : std::uint8_t
+{
+    Motorcycle,
+    Compact,
+    Standard,
+    EV,
+    Accessible,
+    Bus
+};
+
+/// Number of bay kinds, the size of per-kind arrays
+const std::size_t kBayKindCount = 6;
+
+/// \brief Converts the bay kind to an array index
+inline std::size_t toIndex(const BayKind kind)
+{
+    return static_cast<std::size_t>(kind);
+}
+
+/// \brief Name of the bay kind, for printing only
+inline const char * toString(const BayKind kind)
+{
+    switch (kind)
+    {
+    case BayKind::Motorcycle:
+        return "Motorcycle";
+    case BayKind::Compact:
+        return "Compact";
+    case BayKind::Standard:
+        return "Standard";
+    case BayKind::EV:
+        return "EV";
+    case BayKind::Accessible:
+        return "Accessible";
+    case BayKind::Bus:
+        return "Bus";
+    }
+    return "Unknown";
+}
+
+/// \brief A zone of a floor with its bays
+struct ZoneSpec
+{
+    /// Floor of the zone, e.g. -1 for the first basement
+    int floor = 0;
+    std::string name;
+
+    /// Distance from the zone to the exit in any unit, used by NearestToExitPolicy
+    int distance_to_exit = 0;
+
+    /// Number of bays of every kind, indexed by BayKind
+    std::array<int, kBayKindCount> bays = {};
+};
+
+/// \brief Where a bay is, see ZonedBayAllocator::locate
+struct BayLocation
+{
+    /// Index of the zone in LotTopology::zones, LotTopology::kNoZone if the bay is unknown
+    std::size_t zone = static_cast<std::size_t>(-1);
+    int floor = 0;
+    BayKind kind = BayKind::Standard;
+
+    /// Number of the bay among the bays of its kind in the zone, from 1
+    int number = 0;
+};
+
+/// \brief Floors and zones of a lot and the bay kinds every vehicle type may be parked in
+/// A vehicle is parked in a bay of the first of its bay kinds that has a free bay, so the later kinds are the
+/// fallback when its own bays are full. By default cars take standard, then compact, EV and bus bays,
+/// motorcycles take motorcycle, then compact and standard bays, and buses take bus bays only; accessible bays are
+/// not given to any vehicle type unless setBayKinds adds them.
+class LotTopology
+{
+public:
+    /// Zone index of a BayLocation of an unknown bay
+    static constexpr std::size_t kNoZone = static_cast<std::size_t>(-1);
+
+    /// \brief Constructor, a lot without zones and with the default bay kinds of every vehicle type
+    LotTopology();
+
+    /// \brief Adds a zone, its bays are numbered after those of the zones added before
+    /// \return Returns the index of the zone
+    std::size_t addZone(const ZoneSpec & zone);
+
+    /// \brief Adds floors with the same zones, e.g. for tests and benchmarks
+    /// \param[in] floor_count Number of floors, numbered from 0
+    /// \param[in] zones_per_floor Number of zones on every floor, zone z of a floor is z + 1 away from the exit
+    /// \param[in] bays_per_zone Bays of every kind in every zone, indexed by BayKind
+    void addFloors(const int floor_count, const int zones_per_floor, const std::array<int, kBayKindCount> & bays_per_zone);
+
+    /// \brief Sets the bay kinds a vehicle type may be parked in, in the order they are tried
+    void setBayKinds(const VehicleType vehicle_type, const std::vector<BayKind> & kinds);
+
+    const std::vector<BayKind> & bayKinds(const VehicleType vehicle_type) const { return m_bay_kinds[toIndex(vehicle_type)]; }
+
+    const std::vector<ZoneSpec> & zones() const { return m_zones; }
+
+    /// \brief Number of bays of all zones
+    int bayCount() const;
+
+    /// \brief Number of bays of the given kind in all zones
+    int bayCount(const BayKind kind) const;
+
+    /// \brief Number of bays a vehicle type may be parked in, bays of fallback kinds included
+    int usableBays(const VehicleType vehicle_type) const;
+
+private:
+    std::vector<ZoneSpec> m_zones;
+
+    /// Indexed by VehicleType
+    std::array<std::vector<BayKind>, kVehicleTypeCount> m_bay_kinds;
+};
\ No newline at end of file
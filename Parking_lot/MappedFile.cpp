@@ -0,0 +1,103 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string & path)
+{
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return;
+    }
+    m_file = file;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size))
+    {
+        return;
+    }
+    if (size.QuadPart == 0)
+    {
+        m_open_empty = true;
+        return;
+    }
+
+    m_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (m_mapping)
+    {
+        m_data = static_cast<const char *>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+        m_size = m_data ? static_cast<std::size_t>(size.QuadPart) : 0;
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    if (m_data)
+    {
+        UnmapViewOfFile(m_data);
+    }
+    if (m_mapping)
+    {
+        CloseHandle(m_mapping);
+    }
+    if (m_file)
+    {
+        CloseHandle(m_file);
+    }
+}
+
+#else
+
+MappedFile::MappedFile(const std::string & path)
+{
+    m_descriptor = open(path.c_str(), O_RDONLY);
+    if (m_descriptor < 0)
+    {
+        return;
+    }
+
+    struct stat status;
+    if (fstat(m_descriptor, &status) != 0)
+    {
+        return;
+    }
+    std::size_t size = static_cast<std::size_t>(status.st_size);
+    if (size == 0)
+    {
+        m_open_empty = true;
+        return;
+    }
+
+    void * data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, m_descriptor, 0);
+    if (data != MAP_FAILED)
+    {
+        // Queries scan the whole file once, read-ahead keeps the scan at disk or memory bandwidth
+        madvise(data, size, MADV_SEQUENTIAL);
+        m_data = static_cast<const char *>(data);
+        m_size = size;
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    if (m_data)
+    {
+        munmap(const_cast<char *>(m_data), m_size);
+    }
+    if (m_descriptor >= 0)
+    {
+        close(m_descriptor);
+    }
+}
+
+#endif
\ No newline at end of file
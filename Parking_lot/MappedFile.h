@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+/// \brief Read-only memory mapping of a whole file
+class MappedFile
+{
+public:
+    /// \brief Constructor, maps the file
+    /// \param[in] path Path of the file, isOpen tells whether it could be mapped
+    explicit MappedFile(const std::string & path);
+
+    /// \brief Destructor, unmaps the file
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile & operator=(const MappedFile &) = delete;
+
+    bool isOpen() const { return m_data != nullptr || m_open_empty; }
+
+    const char * data() const { return m_data; }
+
+    /// \brief Size of the mapping, 0 if the file could not be mapped
+    std::size_t size() const { return m_size; }
+
+private:
+    const char * m_data = nullptr;
+    std::size_t m_size = 0;
+
+    /// Empty files cannot be mapped but are valid
+    bool m_open_empty = false;
+
+#ifdef _WIN32
+    void * m_file = nullptr;
+    void * m_mapping = nullptr;
+#else
+    int m_descriptor = -1;
+#endif
+};
\ No newline at end of file
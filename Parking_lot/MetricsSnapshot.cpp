@@ -0,0 +1,40 @@
+#include <sstream>
+#include <utility>
+
+#include "MetricsSnapshot.h"
+
+namespace
+{
+    /// Indexed by ParkingEventType
+    const char * const kEventNames[kParkingEventTypeCount] = { "parked", "already_parked", "full", "released", "not_found", "no_ticket" };
+
+    /// Indexed by GateLatency
+    const char * const kLatencyNames[kGateLatencyCount] = { "park", "release", "log", "lock_wait", "lock_hold" };
+
+    /// Reported percentiles and their labels
+    const std::pair<const char *, double> kQuantiles[] = { { "0.5", 50.0 }, { "0.99", 99.0 }, { "0.999", 99.9 } };
+}
+
+std::string MetricsSnapshot::toText() const
+{
+    std::ostringstream out;
+    out << "# TYPE parking_lot_events_total counter\n";
+    for (std::size_t type = 0; type < kParkingEventTypeCount; ++type)
+    {
+        out << "parking_lot_events_total{event=\"" << kEventNames[type] << "\"} " << events[type] << '\n';
+    }
+
+    for (std::size_t latency = 0; latency < kGateLatencyCount; ++latency)
+    {
+        const LatencyHistogram & histogram = latencies[latency];
+        std::string name = std::string("parking_lot_") + kLatencyNames[latency] + "_ns";
+        out << "# TYPE " << name << " summary\n";
+        for (const auto & quantile : kQuantiles)
+        {
+            out << name << "{quantile=\"" << quantile.first << "\"} " << histogram.percentile(quantile.second) << '\n';
+        }
+        out << name << "_sum " << histogram.sum() << '\n';
+        out << name << "_count " << histogram.count() << '\n';
+    }
+    return out.str();
+}
\ No newline at end of file
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "LatencyHistogram.h"
+#include "ParkingEvent.h"
+
+/// \brief Timed parts of the gate operations
+enum class GateLatency
+{
+    Park,      ///< tryParkVehicle from the call until the event was passed to the sink
+    Release,   ///< tryReleaseVehicleByTicketID and tryReleaseVehicleByLicensePlate, like Park
+    Log,       ///< Queuing the log entries of an operation
+    LockWait,  ///< Waiting for a shard mutex
+    LockHold   ///< Holding a shard mutex
+};
+
+/// Number of timed parts, the size of per-part arrays
+const std::size_t kGateLatencyCount = 5;
+
+/// \brief Counters and latencies of the gate operations of a parking lot since it was created
+/// All latencies are in nanoseconds. Without instrumentation (PARKING_LOT_METRICS 0) everything is 0.
+struct MetricsSnapshot
+{
+    /// Number of park and release attempts per outcome, indexed by ParkingEventType
+    std::array<std::uint64_t, kParkingEventTypeCount> events{};
+
+    /// Indexed by GateLatency
+    std::array<LatencyHistogram, kGateLatencyCount> latencies;
+
+    std::uint64_t operator[](const ParkingEventType type) const { return events[static_cast<std::size_t>(type)]; }
+    const LatencyHistogram & operator[](const GateLatency latency) const { return latencies[static_cast<std::size_t>(latency)]; }
+
+    /// \brief Formats the metrics in the Prometheus text exposition format, e.g. for a /metrics endpoint
+    /// Counters are named parking_lot_events_total{event="full"}, latencies parking_lot_lock_wait_ns{quantile="0.99"}.
+    std::string toText() const;
+};
\ No newline at end of file
@@ -7,7 +7,5 @@ class Motorcycle : public Vehicle
 {
 public:
     Motorcycle(const std::string& license_plate, double parking_duration)
-        : Vehicle(license_plate, parking_duration) {}
-
-    std::string getVehicleType() const override { return "Motorcycle"; }
+        : Vehicle(VehicleType::Motorcycle, license_plate, parking_duration) {}
 };
\ No newline at end of file
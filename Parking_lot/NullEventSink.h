@@ -0,0 +1,10 @@
+#pragma once
+
+#include "ParkingEventSink.h"
+
+/// \brief Event sink that ignores all events, for running the parking lot silently
+class NullEventSink : public ParkingEventSink
+{
+public:
+    void onEvent(const ParkingEvent &) override {}
+};
\ No newline at end of file
@@ -0,0 +1,175 @@
+#include <algorithm>
+#include <string>
+
+#include "InvalidVehicleTypeException.h"
+#include "OccupancyAnalytics.h"
+
+namespace
+{
+    inline std::size_t indexOfVehicleType(const VehicleType vehicle_type)
+    {
+        std::size_t index = toIndex(vehicle_type);
+        if (index >= kVehicleTypeCount)
+        {
+            throw InvalidVehicleTypeException("Invalid vehicle type: " + std::to_string(index));
+        }
+        return index;
+    }
+}
+
+OccupancyAnalytics::OccupancyAnalytics(const AnalyticsConfig & config)
+    : m_config{ std::max<std::int64_t>(config.bucket_us, 1), std::max<std::size_t>(config.bucket_count, 2) }, m_buckets(new Bucket[m_config.bucket_count])
+{
+    for (std::size_t type = 0; type < kVehicleTypeCount; ++type)
+    {
+        m_occupancy[type].store(0, std::memory_order_relaxed);
+        for (auto & count : m_dwell_counts[type])
+        {
+            count.store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+void OccupancyAnalytics::record(const ParkingEvent & event, const int occupancy)
+{
+    if (event.type != ParkingEventType::Parked && event.type != ParkingEventType::Released)
+    {
+        return;
+    }
+    std::size_t type = toIndex(event.vehicle_type);
+    if (type >= kVehicleTypeCount)
+    {
+        return;
+    }
+
+    std::int64_t bucket = bucketOf(event.type == ParkingEventType::Parked ? event.entry_time_us : event.exit_time_us);
+    if (bucket > m_current.load(std::memory_order_acquire))
+    {
+        advanceTo(bucket);
+    }
+    m_occupancy[type].store(occupancy, std::memory_order_relaxed);
+
+    // Events from before the oldest bucket kept still count towards the dwell times
+    if (bucket > m_current.load(std::memory_order_acquire) - static_cast<std::int64_t>(m_config.bucket_count))
+    {
+        Bucket & slot = slotOf(bucket);
+        int peak = slot.peak[type].load(std::memory_order_relaxed);
+        while (occupancy > peak && !slot.peak[type].compare_exchange_weak(peak, occupancy, std::memory_order_relaxed))
+        {
+        }
+        int low = slot.low[type].load(std::memory_order_relaxed);
+        while (occupancy < low && !slot.low[type].compare_exchange_weak(low, occupancy, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    if (event.type == ParkingEventType::Released)
+    {
+        m_dwell_counts[type][DwellTimeSketch::bucketOf(event.exit_time_us - event.entry_time_us)].fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+int OccupancyAnalytics::getPeakOccupancy(const VehicleType vehicle_type, const std::int64_t window_us, const std::int64_t now_us)
+{
+    std::size_t type = indexOfVehicleType(vehicle_type);
+    std::pair<std::int64_t, std::int64_t> buckets = window(window_us, now_us);
+    int peak = m_occupancy[type].load(std::memory_order_relaxed);
+    for (std::int64_t bucket = buckets.first; bucket <= buckets.second; ++bucket)
+    {
+        peak = std::max(peak, slotOf(bucket).peak[type].load(std::memory_order_relaxed));
+    }
+    return peak;
+}
+
+std::vector<OccupancySample> OccupancyAnalytics::getOccupancyHistory(const VehicleType vehicle_type, const std::int64_t window_us, const std::int64_t now_us)
+{
+    std::size_t type = indexOfVehicleType(vehicle_type);
+    std::pair<std::int64_t, std::int64_t> buckets = window(window_us, now_us);
+    std::vector<OccupancySample> history;
+    for (std::int64_t bucket = buckets.first; bucket <= buckets.second; ++bucket)
+    {
+        const Bucket & slot = slotOf(bucket);
+        history.push_back(OccupancySample{ bucket * m_config.bucket_us, slot.low[type].load(std::memory_order_relaxed),
+                                           slot.peak[type].load(std::memory_order_relaxed) });
+    }
+    return history;
+}
+
+DwellTimeSketch OccupancyAnalytics::getDwellTimes(const VehicleType vehicle_type, const std::int64_t window_us, const std::int64_t now_us)
+{
+    std::size_t type = indexOfVehicleType(vehicle_type);
+    std::pair<std::int64_t, std::int64_t> buckets = window(window_us, now_us);
+    DwellTimeSketch sketch;
+    if (buckets.first > buckets.second)
+    {
+        return sketch;
+    }
+
+    // The counts only grow, so the difference is right even after they wrapped around
+    const DwellCounts & before = slotOf(buckets.first).dwell_counts_before[type];
+    for (std::size_t i = 0; i < DwellTimeSketch::kBucketCount; ++i)
+    {
+        std::uint32_t count = m_dwell_counts[type][i].load(std::memory_order_relaxed) - before[i].load(std::memory_order_relaxed);
+        sketch.addToBucket(i, count);
+    }
+    return sketch;
+}
+
+std::int64_t OccupancyAnalytics::bucketOf(const std::int64_t time_us) const
+{
+    std::int64_t bucket = time_us / m_config.bucket_us;
+    return time_us % m_config.bucket_us < 0 ? bucket - 1 : bucket;
+}
+
+void OccupancyAnalytics::advanceTo(const std::int64_t bucket)
+{
+    std::lock_guard<std::mutex> lock(m_advance_mutex);
+    std::int64_t current = m_current.load(std::memory_order_relaxed);
+    if (current >= bucket)
+    {
+        return;
+    }
+
+    // Buckets without events start with the occupancy and counts of the last one; after a long pause only the
+    // buckets still kept are prepared
+    std::int64_t first = bucket - static_cast<std::int64_t>(m_config.bucket_count) + 1;
+    if (current == kNoBucket)
+    {
+        first = bucket;
+        m_first.store(bucket, std::memory_order_relaxed);
+    }
+    for (std::int64_t started = std::max(first, current + 1); started <= bucket; ++started)
+    {
+        Bucket & slot = slotOf(started);
+        for (std::size_t type = 0; type < kVehicleTypeCount; ++type)
+        {
+            int occupancy = m_occupancy[type].load(std::memory_order_relaxed);
+            slot.low[type].store(occupancy, std::memory_order_relaxed);
+            slot.peak[type].store(occupancy, std::memory_order_relaxed);
+            for (std::size_t i = 0; i < DwellTimeSketch::kBucketCount; ++i)
+            {
+                slot.dwell_counts_before[type][i].store(m_dwell_counts[type][i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+            }
+        }
+    }
+    m_current.store(bucket, std::memory_order_release);
+}
+
+std::pair<std::int64_t, std::int64_t> OccupancyAnalytics::window(const std::int64_t window_us, const std::int64_t now_us)
+{
+    std::int64_t now_bucket = bucketOf(now_us);
+    if (now_bucket > m_current.load(std::memory_order_acquire))
+    {
+        advanceTo(now_bucket);
+    }
+    std::int64_t current = m_current.load(std::memory_order_acquire);
+    std::int64_t first = bucketOf(now_us - std::max<std::int64_t>(window_us, 0));
+    first = std::max({ first, current - static_cast<std::int64_t>(m_config.bucket_count) + 1, m_first.load(std::memory_order_relaxed) });
+    return std::make_pair(first, current);
+}
+
+OccupancyAnalytics::Bucket & OccupancyAnalytics::slotOf(const std::int64_t bucket)
+{
+    std::int64_t count = static_cast<std::int64_t>(m_config.bucket_count);
+    return m_buckets[static_cast<std::size_t>((bucket % count + count) % count)];
+}
\ No newline at end of file
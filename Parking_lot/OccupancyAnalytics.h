@@ -0,0 +1,103 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "DwellTimeSketch.h"
+#include "ParkingEvent.h"
+#include "VehicleType.h"
+
+/// \brief Settings of the occupancy analytics
+struct AnalyticsConfig
+{
+    /// Length of the time buckets in microseconds, the resolution of the occupancy history and of the windows
+    std::int64_t bucket_us = 5ll * 60 * 1000000;
+
+    /// Number of buckets kept, the longest window is one bucket less; one day of 5 minutes by default
+    std::size_t bucket_count = 24 * 12 + 1;
+};
+
+/// \brief Lowest and highest number of parked vehicles of a type during one time bucket
+struct OccupancySample
+{
+    /// Start of the bucket, microseconds since 1970-01-01 UTC
+    std::int64_t start_us = 0;
+    int low = 0;
+    int peak = 0;
+};
+
+/// \brief Occupancy over time and dwell times of the parked vehicles, fed with the park and release events of a lot
+/// Time is split into buckets kept in a ring of fixed size, every bucket holds the lowest and highest occupancy
+/// per vehicle type and the dwell time counts of the vehicles that left before it started. Dwell times are counted
+/// in one DwellTimeSketch per vehicle type, so the dwell times of a window are the counts now minus those at the
+/// start of its first bucket: every query reads a fixed amount of memory however many vehicles came and went.
+/// Recording an event is a few relaxed atomic operations and can be done by the gates without locking; only the
+/// first event of a new bucket locks to prepare the bucket.
+class OccupancyAnalytics
+{
+public:
+    /// \brief Constructor
+    /// \param[in] config Length and number of the time buckets
+    explicit OccupancyAnalytics(const AnalyticsConfig & config = AnalyticsConfig());
+
+    /// \brief Counts a Parked or Released event, other events are ignored
+    /// \param[in] event Event with its entry or exit time
+    /// \param[in] occupancy Number of parked vehicles of the event's type after the event
+    void record(const ParkingEvent & event, const int occupancy);
+
+    /// \brief Gets the highest number of parked vehicles of a type during the window ending now
+    /// \param[in] window_us Length of the window, widened to whole buckets and limited to the buckets kept
+    /// \param[in] now_us Current time, microseconds since 1970-01-01 UTC
+    int getPeakOccupancy(const VehicleType vehicle_type, const std::int64_t window_us, const std::int64_t now_us);
+
+    /// \brief Gets the lowest and highest occupancy of every bucket of the window ending now, oldest first
+    std::vector<OccupancySample> getOccupancyHistory(const VehicleType vehicle_type, const std::int64_t window_us, const std::int64_t now_us);
+
+    /// \brief Gets the dwell times of the vehicles of a type that left during the window ending now
+    /// \return Returns a sketch, e.g. getDwellTimes(VehicleType::Bus, kDay, now).percentile(95)
+    DwellTimeSketch getDwellTimes(const VehicleType vehicle_type, const std::int64_t window_us, const std::int64_t now_us);
+
+private:
+    using DwellCounts = std::array<std::atomic<std::uint32_t>, DwellTimeSketch::kBucketCount>;
+
+    struct Bucket
+    {
+        std::array<std::atomic<int>, kVehicleTypeCount> low;
+        std::array<std::atomic<int>, kVehicleTypeCount> peak;
+
+        /// Dwell time counts when the bucket started, subtracted from the current ones modulo 2^32
+        std::array<DwellCounts, kVehicleTypeCount> dwell_counts_before;
+    };
+
+    std::int64_t bucketOf(const std::int64_t time_us) const;
+
+    /// \brief Starts the buckets up to the given one if they have not started yet
+    void advanceTo(const std::int64_t bucket);
+
+    /// \brief Gets the first bucket of a window ending now that is still kept, and the current bucket
+    std::pair<std::int64_t, std::int64_t> window(const std::int64_t window_us, const std::int64_t now_us);
+
+    Bucket & slotOf(const std::int64_t bucket);
+
+private:
+    static constexpr std::int64_t kNoBucket = std::numeric_limits<std::int64_t>::min();
+
+    AnalyticsConfig m_config;
+    std::unique_ptr<Bucket[]> m_buckets;
+
+    /// Newest bucket started and the first one ever started, written with m_advance_mutex held
+    std::atomic<std::int64_t> m_current{ kNoBucket };
+    std::atomic<std::int64_t> m_first{ kNoBucket };
+    std::mutex m_advance_mutex;
+
+    /// Occupancy of the last event and dwell time counts since the start, indexed by VehicleType
+    std::array<std::atomic<int>, kVehicleTypeCount> m_occupancy;
+    std::array<DwellCounts, kVehicleTypeCount> m_dwell_counts;
+};
\ No newline at end of file
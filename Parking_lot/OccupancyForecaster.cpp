@@ -0,0 +1,193 @@
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+#include "InvalidVehicleTypeException.h"
+#include "OccupancyForecaster.h"
+
+namespace
+{
+    const std::int64_t kMicrosecondsPerDay = 24ll * 3600 * 1000000;
+
+    inline std::size_t checkedTypeIndex(const VehicleType vehicle_type)
+    {
+        std::size_t index = toIndex(vehicle_type);
+        if (index >= kVehicleTypeCount)
+        {
+            throw InvalidVehicleTypeException("Invalid vehicle type: " + std::to_string(index));
+        }
+        return index;
+    }
+}
+
+OccupancyForecaster::OccupancyForecaster(const ForecastConfig & config, const std::array<int, kVehicleTypeCount> & occupancy)
+    : m_config(config), m_utc_offset_us(static_cast<std::int64_t>(config.utc_offset_minutes) * 60 * 1000000)
+{
+    // A day is split into whole slots, the slot length is adjusted if it does not divide it
+    std::int64_t slot_count = std::max<std::int64_t>(kMicrosecondsPerDay / std::max<std::int64_t>(config.slot_us, 1), 1);
+    m_config.slot_us = kMicrosecondsPerDay / slot_count;
+    m_config.smoothing = std::min(std::max(config.smoothing, 0.0), 1.0);
+    m_rates.resize(static_cast<std::size_t>(slot_count));
+
+    for (std::size_t type = 0; type < kVehicleTypeCount; ++type)
+    {
+        m_arrivals[type].store(0, std::memory_order_relaxed);
+        m_departures[type].store(0, std::memory_order_relaxed);
+        m_occupancy_at_start[type] = occupancy[type];
+        m_occupancy[type].store(occupancy[type], std::memory_order_relaxed);
+    }
+}
+
+template <typename Step>
+void OccupancyForecaster::project(const std::size_t type, const double occupancy, const std::int64_t now_us, const std::int64_t horizon_us, Step step)
+{
+    // Arrivals and departures are spread evenly over a slot, the first slot is only projected from now on
+    double projected = occupancy;
+    std::int64_t end_us = now_us + std::max<std::int64_t>(horizon_us, 0);
+    for (std::int64_t time_us = now_us; time_us < end_us;)
+    {
+        std::int64_t slot = slotOf(time_us);
+        std::int64_t length_us = std::min((slot + 1) * m_config.slot_us - m_utc_offset_us, end_us) - time_us;
+        const SlotRates & rates = m_rates[timeOfDayOf(slot)][type];
+        double change = rates.arrivals - rates.departure_share * (projected + rates.arrivals);
+        double slope_per_us = change / static_cast<double>(m_config.slot_us);
+        if (!step(time_us, projected, slope_per_us, length_us))
+        {
+            return;
+        }
+        projected = std::max(projected + slope_per_us * static_cast<double>(length_us), 0.0);
+        time_us += length_us;
+    }
+}
+
+void OccupancyForecaster::record(const ParkingEvent & event, const int occupancy)
+{
+    bool released = event.type == ParkingEventType::Released;
+    if (!released && event.type != ParkingEventType::Parked && event.type != ParkingEventType::Full)
+    {
+        return;
+    }
+    std::size_t type = toIndex(event.vehicle_type);
+    if (type >= kVehicleTypeCount)
+    {
+        return;
+    }
+
+    std::int64_t slot = slotOf(released ? event.exit_time_us : event.entry_time_us);
+    if (slot > m_current.load(std::memory_order_acquire))
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        advanceTo(slot);
+    }
+    (released ? m_departures : m_arrivals)[type].fetch_add(1, std::memory_order_relaxed);
+    m_occupancy[type].store(occupancy, std::memory_order_relaxed);
+}
+
+std::int64_t OccupancyForecaster::getTimeToFull(const VehicleType vehicle_type, const int occupancy, const int capacity, const std::int64_t now_us,
+                                                const std::int64_t horizon_us)
+{
+    std::size_t type = checkedTypeIndex(vehicle_type);
+    if (occupancy >= capacity)
+    {
+        return 0;
+    }
+
+    std::int64_t time_to_full = kNotFull;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    advanceTo(slotOf(now_us));
+    project(type, occupancy, now_us, horizon_us, [&](const std::int64_t time_us, const double before, const double slope_per_us, const std::int64_t length_us)
+    {
+        if (slope_per_us <= 0.0 || before + slope_per_us * static_cast<double>(length_us) < capacity)
+        {
+            return true;
+        }
+        time_to_full = time_us - now_us + static_cast<std::int64_t>(std::ceil((capacity - before) / slope_per_us));
+        return false;
+    });
+    return time_to_full;
+}
+
+std::vector<OccupancyForecast> OccupancyForecaster::getForecast(const VehicleType vehicle_type, const int occupancy, const std::int64_t now_us,
+                                                                const std::int64_t horizon_us)
+{
+    std::size_t type = checkedTypeIndex(vehicle_type);
+    std::vector<OccupancyForecast> forecast;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    advanceTo(slotOf(now_us));
+    project(type, occupancy, now_us, horizon_us, [&](const std::int64_t time_us, const double before, const double slope_per_us, const std::int64_t length_us)
+    {
+        forecast.push_back(OccupancyForecast{ time_us + length_us, std::max(before + slope_per_us * static_cast<double>(length_us), 0.0) });
+        return true;
+    });
+    return forecast;
+}
+
+SlotRates OccupancyForecaster::getRates(const VehicleType vehicle_type, const std::int64_t time_us)
+{
+    std::size_t type = checkedTypeIndex(vehicle_type);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_rates[timeOfDayOf(slotOf(time_us))][type];
+}
+
+std::int64_t OccupancyForecaster::slotOf(const std::int64_t time_us) const
+{
+    std::int64_t local_us = time_us + m_utc_offset_us;
+    std::int64_t slot = local_us / m_config.slot_us;
+    return local_us % m_config.slot_us < 0 ? slot - 1 : slot;
+}
+
+std::size_t OccupancyForecaster::timeOfDayOf(const std::int64_t slot) const
+{
+    std::int64_t count = static_cast<std::int64_t>(m_rates.size());
+    return static_cast<std::size_t>((slot % count + count) % count);
+}
+
+void OccupancyForecaster::advanceTo(const std::int64_t slot)
+{
+    std::int64_t current = m_current.load(std::memory_order_relaxed);
+    if (current >= slot)
+    {
+        return;
+    }
+
+    // Counting starts with the first event, somewhere within its slot, so that slot is not learned
+    for (std::size_t type = 0; type < kVehicleTypeCount; ++type)
+    {
+        int arrivals = m_arrivals[type].exchange(0, std::memory_order_relaxed);
+        int departures = m_departures[type].exchange(0, std::memory_order_relaxed);
+        int occupancy = m_occupancy[type].load(std::memory_order_relaxed);
+        if (current != kNoSlot)
+        {
+            if (!m_first_slot)
+            {
+                learn(timeOfDayOf(current), type, arrivals, departures, m_occupancy_at_start[type]);
+            }
+
+            // Slots without events are learned as quiet, after a long pause every time of day once
+            std::int64_t quiet = std::max(current + 1, slot - static_cast<std::int64_t>(m_rates.size()));
+            for (; quiet < slot; ++quiet)
+            {
+                learn(timeOfDayOf(quiet), type, 0, 0, occupancy);
+            }
+        }
+        m_occupancy_at_start[type] = occupancy;
+    }
+    m_first_slot = current == kNoSlot;
+    m_current.store(slot, std::memory_order_release);
+}
+
+void OccupancyForecaster::learn(const std::size_t time_of_day, const std::size_t type, const int arrivals, const int departures, const int occupancy_at_start)
+{
+    SlotRates & rates = m_rates[time_of_day][type];
+    int present = occupancy_at_start + arrivals;
+    double share = present > 0 ? std::min(static_cast<double>(departures) / present, 1.0) : rates.departure_share;
+    if (!rates.trained)
+    {
+        rates.arrivals = arrivals;
+        rates.departure_share = share;
+        rates.trained = true;
+        return;
+    }
+    rates.arrivals += m_config.smoothing * (arrivals - rates.arrivals);
+    rates.departure_share += m_config.smoothing * (share - rates.departure_share);
+}
\ No newline at end of file
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <vector>
+
+#include "ParkingEvent.h"
+#include "VehicleType.h"
+
+/// \brief Settings of the occupancy forecast
+struct ForecastConfig
+{
+    /// Length of the time-of-day slots in microseconds, rates are learned per slot; must divide a day
+    std::int64_t slot_us = 15ll * 60 * 1000000;
+
+    /// Weight of the newest day when a slot's rates are updated, from 0 (never learn) to 1 (forget the past)
+    double smoothing = 0.2;
+
+    /// Offset of the local time from UTC, so slots start at local midnight
+    int utc_offset_minutes = 0;
+};
+
+/// \brief Learned traffic of a vehicle type during one time-of-day slot
+struct SlotRates
+{
+    /// Expected arrivals during the slot, vehicles turned away included
+    double arrivals = 0.0;
+
+    /// Expected share of the vehicles present during the slot (parked at its start or arriving) that leave in it
+    double departure_share = 0.0;
+
+    /// Whether the slot was observed at least once
+    bool trained = false;
+};
+
+/// \brief Projected occupancy of a vehicle type at the end of a forecast slot
+struct OccupancyForecast
+{
+    /// End of the slot, microseconds since 1970-01-01 UTC
+    std::int64_t time_us = 0;
+    double occupancy = 0.0;
+};
+
+/// \brief Learns the arrival and departure rates of every vehicle type per time-of-day slot from the park and release
+/// events of a lot and projects its occupancy, e.g. how long until the car bays are full
+/// Events are counted per slot; when a slot is over its counts update the rates of its time of day by exponential
+/// smoothing, so a slot's rates follow the last days with weight smoothing for the newest one. The occupancy is then
+/// projected slot by slot: of the vehicles parked at a slot's start and those arriving in it, departure_share leave.
+/// Recording an event is a relaxed atomic increment and can be done by the gates without locking; only the first
+/// event of a new slot locks to update the rates. Events must be recorded roughly in time order, an event of a slot
+/// that is already over counts towards the current one.
+class OccupancyForecaster
+{
+public:
+    /// Returned by getTimeToFull if the vehicle type is not projected to be full within the horizon
+    static constexpr std::int64_t kNotFull = -1;
+
+    /// \brief Constructor
+    /// \param[in] config Slot length, smoothing and time zone
+    /// \param[in] occupancy Number of parked vehicles now, indexed by VehicleType; the occupancy of a type until its first event
+    explicit OccupancyForecaster(const ForecastConfig & config = ForecastConfig(), const std::array<int, kVehicleTypeCount> & occupancy = {});
+
+    /// \brief Counts a Parked or Full event as an arrival and a Released event as a departure, other events are ignored
+    /// \param[in] event Event with its entry time (also set for Full) or exit time
+    /// \param[in] occupancy Number of parked vehicles of the event's type after the event
+    void record(const ParkingEvent & event, const int occupancy);
+
+    /// \brief Gets the time until a vehicle type is projected to be full
+    /// \param[in] occupancy Number of bays of the type taken now
+    /// \param[in] capacity Number of bays of the type
+    /// \param[in] now_us Current time, microseconds since 1970-01-01 UTC
+    /// \param[in] horizon_us How far to look ahead
+    /// \return Returns the time in microseconds, 0 if full now, or kNotFull if it stays below the capacity within the horizon
+    std::int64_t getTimeToFull(const VehicleType vehicle_type, const int occupancy, const int capacity, const std::int64_t now_us,
+                               const std::int64_t horizon_us);
+
+    /// \brief Gets the projected occupancy of a vehicle type at the end of every slot within the horizon
+    /// \param[in] occupancy Number of bays of the type taken now
+    /// \param[in] now_us Current time, microseconds since 1970-01-01 UTC
+    /// \param[in] horizon_us How far to look ahead
+    std::vector<OccupancyForecast> getForecast(const VehicleType vehicle_type, const int occupancy, const std::int64_t now_us, const std::int64_t horizon_us);
+
+    /// \brief Gets the learned rates of the time-of-day slot that contains the given time
+    SlotRates getRates(const VehicleType vehicle_type, const std::int64_t time_us);
+
+    /// \brief Number of slots per day
+    std::size_t slotCount() const { return m_rates.size(); }
+
+private:
+    /// \brief Number of the slot a time falls into, counted since 1970-01-01 local time
+    std::int64_t slotOf(const std::int64_t time_us) const;
+
+    /// \brief Time-of-day index of a slot
+    std::size_t timeOfDayOf(const std::int64_t slot) const;
+
+    /// \brief Folds the counts of the current slot into the rates and starts the slots up to the given one,
+    /// must be called with the mutex held
+    void advanceTo(const std::int64_t slot);
+
+    /// \brief Updates the rates of a time of day with the counts of one of its slots, must be called with the mutex held
+    void learn(const std::size_t time_of_day, const std::size_t type, const int arrivals, const int departures, const int occupancy_at_start);
+
+    /// \brief Projects the occupancy slot by slot, calling step(time_us, occupancy_before, slope_per_us, length_us)
+    /// for every part of a slot until step returns false or the horizon is reached
+    template <typename Step>
+    void project(const std::size_t type, const double occupancy, const std::int64_t now_us, const std::int64_t horizon_us, Step step);
+
+private:
+    static constexpr std::int64_t kNoSlot = std::numeric_limits<std::int64_t>::min();
+
+    ForecastConfig m_config;
+    std::int64_t m_utc_offset_us;
+
+    /// Learned rates per time of day, guarded by the mutex
+    std::vector<std::array<SlotRates, kVehicleTypeCount>> m_rates;
+    std::mutex m_mutex;
+
+    /// Slot the counts belong to, written with the mutex held
+    std::atomic<std::int64_t> m_current{ kNoSlot };
+
+    /// Whether the current slot is the first one, counted only from somewhere within it; guarded by the mutex
+    bool m_first_slot = true;
+
+    /// Counts of the current slot, occupancy at its start and of the last event, indexed by VehicleType
+    std::array<std::atomic<int>, kVehicleTypeCount> m_arrivals;
+    std::array<std::atomic<int>, kVehicleTypeCount> m_departures;
+    std::array<int, kVehicleTypeCount> m_occupancy_at_start;
+    std::array<std::atomic<int>, kVehicleTypeCount> m_occupancy;
+};
\ No newline at end of file
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <array>
+
+#include "VehicleType.h"
+
+/// \brief Occupancy of the bays of one vehicle type
+struct VehicleTypeOccupancy
+{
+    int capacity = 0;
+    int occupied = 0;
+
+    int available() const { return capacity - occupied; }
+};
+
+/// \brief Occupancy of the parking lot, e.g. for signage boards
+/// The values of every vehicle type are consistent with each other, the vehicle types are read one after another.
+struct OccupancySnapshot
+{
+    /// Indexed by VehicleType
+    std::array<VehicleTypeOccupancy, kVehicleTypeCount> types;
+
+    const VehicleTypeOccupancy & operator[](const VehicleType type) const { return types[toIndex(type)]; }
+};
\ No newline at end of file
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "ParkedVehicleTable.h"
+
+/// \brief The vehicles parked at one point in time, e.g. for reports that go through all of them
+/// Holds the pages of the shards' ParkedVehicleTable as they were when the snapshot was taken. The gates go on
+/// parking and releasing meanwhile and copy a page before changing it, so reading the snapshot needs no lock and
+/// never holds up a gate; a page is freed when neither the lot nor any snapshot uses it anymore. Copies are cheap
+/// to pass around, they share the pages.
+class ParkedVehicleSnapshot
+{
+public:
+    /// \brief Goes through the parked vehicles in storage order
+    class Iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = ParkedRecord;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const ParkedRecord *;
+        using reference = const ParkedRecord &;
+
+        Iterator() = default;
+
+        reference operator*() const { return (*m_pages)[m_page]->records[m_slot]; }
+        pointer operator->() const { return &**this; }
+
+        Iterator & operator++()
+        {
+            ++m_slot;
+            skipFreeSlots();
+            return *this;
+        }
+
+        Iterator operator++(int)
+        {
+            Iterator previous = *this;
+            ++*this;
+            return previous;
+        }
+
+        bool operator==(const Iterator & other) const { return m_page == other.m_page && m_slot == other.m_slot; }
+        bool operator!=(const Iterator & other) const { return !(*this == other); }
+
+    private:
+        friend class ParkedVehicleSnapshot;
+
+        Iterator(const std::vector<std::shared_ptr<const ParkedRecordPage>> * pages, const std::size_t page)
+            : m_pages(pages), m_page(page)
+        {
+            skipFreeSlots();
+        }
+
+        /// \brief Moves on to the next slot holding a vehicle or to the end
+        void skipFreeSlots()
+        {
+            for (; m_page < m_pages->size(); ++m_page, m_slot = 0)
+            {
+                for (; m_slot < ParkedRecordPage::kSize; ++m_slot)
+                {
+                    // Free slots have ticket ID 0, see ParkedVehicleTable::erase
+                    if ((*m_pages)[m_page]->records[m_slot].ticket_id != 0)
+                    {
+                        return;
+                    }
+                }
+            }
+        }
+
+    private:
+        const std::vector<std::shared_ptr<const ParkedRecordPage>> * m_pages = nullptr;
+        std::size_t m_page = 0;
+        std::size_t m_slot = 0;
+    };
+
+    /// \brief Constructor of an empty snapshot
+    ParkedVehicleSnapshot() = default;
+
+    /// \brief Constructor, see ParkingLot::getParkedVehicleSnapshot
+    /// \param[in] pages Pages shared by ParkedVehicleTable::sharePages
+    /// \param[in] size Number of parked vehicles in the pages
+    /// \param[in] time_us Time the snapshot was taken, microseconds since 1970-01-01 UTC
+    ParkedVehicleSnapshot(std::vector<std::shared_ptr<const ParkedRecordPage>> pages, const std::size_t size, const std::int64_t time_us)
+        : m_pages(std::make_shared<const std::vector<std::shared_ptr<const ParkedRecordPage>>>(std::move(pages))), m_size(size), m_time_us(time_us)
+    {
+    }
+
+    Iterator begin() const { return m_pages ? Iterator(m_pages.get(), 0) : Iterator(); }
+    Iterator end() const { return m_pages ? Iterator(m_pages.get(), m_pages->size()) : Iterator(); }
+
+    /// \brief Number of parked vehicles
+    std::size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+
+    /// \brief Time the snapshot was taken, microseconds since 1970-01-01 UTC, e.g. to tell how long the vehicles have been parked
+    std::int64_t timeUs() const { return m_time_us; }
+
+private:
+    /// Shared by the copies of the snapshot, so copying does not touch the reference counts of the pages
+    std::shared_ptr<const std::vector<std::shared_ptr<const ParkedRecordPage>>> m_pages;
+    std::size_t m_size = 0;
+    std::int64_t m_time_us = 0;
+};
\ No newline at end of file
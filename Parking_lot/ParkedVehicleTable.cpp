@@ -0,0 +1,203 @@
+#include "ParkedVehicleTable.h"
+
+namespace
+{
+    const std::size_t kInitialIndexSize = 16;
+}
+
+ParkedVehicleTable::ParkedVehicleTable()
+    : m_license_plate_index(kInitialIndexSize, kNotFound), m_ticket_index(kInitialIndexSize, kNotFound), m_index_mask(kInitialIndexSize - 1),
+      m_license_plate_trie(std::make_shared<LicensePlateTrie>())
+{
+
+}
+
+std::uint32_t ParkedVehicleTable::findByLicensePlate(const std::string_view license_plate, const std::uint64_t license_plate_hash) const
+{
+    std::size_t position = probe(m_license_plate_index, license_plate_hash, [this, license_plate](std::uint32_t slot)
+    {
+        return record(slot).license_plate.view() == license_plate;
+    });
+    return m_license_plate_index[position];
+}
+
+std::uint32_t ParkedVehicleTable::findByTicketID(const TicketID ticket_id) const
+{
+    std::size_t position = probe(m_ticket_index, hashTicketID(ticket_id), [this, ticket_id](std::uint32_t slot)
+    {
+        return record(slot).ticket_id == ticket_id;
+    });
+    return m_ticket_index[position];
+}
+
+std::uint32_t ParkedVehicleTable::insert(const ParkedRecord & record, const std::uint64_t license_plate_hash)
+{
+    if ((m_size + 1) * 2 > m_license_plate_index.size())
+    {
+        grow();
+    }
+
+    std::uint32_t slot = m_free_head;
+    if (slot != kNotFound)
+    {
+        m_free_head = m_slots[slot].next_free;
+    }
+    else
+    {
+        slot = static_cast<std::uint32_t>(m_slots.size());
+        m_slots.emplace_back();
+        if (slot / ParkedRecordPage::kSize == m_pages.size())
+        {
+            m_pages.push_back(std::make_shared<ParkedRecordPage>());
+            m_pages.back()->epoch = m_epoch;
+        }
+    }
+    writableRecord(slot) = record;
+    m_slots[slot].license_plate_hash = license_plate_hash;
+    m_slots[slot].next_free = kNotFound;
+    ++m_size;
+
+    auto never = [](std::uint32_t) { return false; };
+    m_license_plate_index[probe(m_license_plate_index, license_plate_hash, never)] = slot;
+    m_ticket_index[probe(m_ticket_index, hashTicketID(record.ticket_id), never)] = slot;
+    writableLicensePlateTrie().insert(record.license_plate.view(), slot);
+    return slot;
+}
+
+void ParkedVehicleTable::erase(const std::uint32_t slot)
+{
+    const Slot & erased = m_slots[slot];
+    const ParkedRecord & erased_record = record(slot);
+    auto is_erased = [slot](std::uint32_t other) { return other == slot; };
+    eraseAt(m_license_plate_index, probe(m_license_plate_index, erased.license_plate_hash, is_erased),
+        [this](std::uint32_t other) { return m_slots[other].license_plate_hash; });
+    eraseAt(m_ticket_index, probe(m_ticket_index, hashTicketID(erased_record.ticket_id), is_erased),
+        [this](std::uint32_t other) { return hashTicketID(record(other).ticket_id); });
+    writableLicensePlateTrie().erase(erased_record.license_plate.view());
+
+    // Ticket IDs are never 0, so it marks the slot as free
+    writableRecord(slot).ticket_id = 0;
+    m_slots[slot].next_free = m_free_head;
+    m_free_head = slot;
+    --m_size;
+}
+
+void ParkedVehicleTable::reserve(const std::size_t count)
+{
+    m_slots.reserve(count);
+    std::size_t page_count = (count + ParkedRecordPage::kSize - 1) / ParkedRecordPage::kSize;
+    m_pages.reserve(page_count);
+    while (m_pages.size() < page_count)
+    {
+        m_pages.push_back(std::make_shared<ParkedRecordPage>());
+        m_pages.back()->epoch = m_epoch;
+    }
+    while (count * 2 > m_license_plate_index.size())
+    {
+        grow();
+    }
+}
+
+void ParkedVehicleTable::sharePages(std::vector<std::shared_ptr<const ParkedRecordPage>> & pages)
+{
+    std::size_t used_pages = (m_slots.size() + ParkedRecordPage::kSize - 1) / ParkedRecordPage::kSize;
+    pages.insert(pages.end(), m_pages.begin(), m_pages.begin() + used_pages);
+    ++m_epoch;
+
+    // Reserved pages hold no records yet and are not shared
+    for (std::size_t page = used_pages; page < m_pages.size(); ++page)
+    {
+        m_pages[page]->epoch = m_epoch;
+    }
+}
+
+ParkedRecord & ParkedVehicleTable::writableRecord(const std::uint32_t slot)
+{
+    std::shared_ptr<ParkedRecordPage> & page = m_pages[slot / ParkedRecordPage::kSize];
+    if (page->epoch != m_epoch)
+    {
+        // Snapshots may still read the page, the table goes on with a copy and the last snapshot frees the original
+        page = std::make_shared<ParkedRecordPage>(*page);
+        page->epoch = m_epoch;
+    }
+    return page->records[slot % ParkedRecordPage::kSize];
+}
+
+LicensePlateTrie & ParkedVehicleTable::writableLicensePlateTrie()
+{
+    // The tree is only shared with the shard mutex held, so a count of one cannot grow meanwhile
+    if (m_license_plate_trie.use_count() > 1)
+    {
+        m_license_plate_trie = std::make_shared<LicensePlateTrie>(*m_license_plate_trie);
+    }
+    else
+    {
+        // The last query released the tree, its reads happen before the tree is changed
+        std::atomic_thread_fence(std::memory_order_acquire);
+    }
+    return *m_license_plate_trie;
+}
+
+std::uint64_t ParkedVehicleTable::hashTicketID(const TicketID ticket_id)
+{
+    // Finalizer of MurmurHash3
+    std::uint64_t hash = static_cast<std::uint64_t>(ticket_id);
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdull;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+template <typename Matches>
+std::size_t ParkedVehicleTable::probe(const std::vector<std::uint32_t> & index, const std::uint64_t hash, Matches matches) const
+{
+    std::size_t position = static_cast<std::size_t>(hash) & m_index_mask;
+    while (index[position] != kNotFound && !matches(index[position]))
+    {
+        position = (position + 1) & m_index_mask;
+    }
+    return position;
+}
+
+template <typename HashOfSlot>
+void ParkedVehicleTable::eraseAt(std::vector<std::uint32_t> & index, std::size_t position, HashOfSlot hash_of_slot)
+{
+    // Backward shift deletion keeps every probe sequence free of gaps without tombstones
+    std::size_t next = position;
+    for (;;)
+    {
+        next = (next + 1) & m_index_mask;
+        if (index[next] == kNotFound)
+        {
+            break;
+        }
+        std::size_t home = static_cast<std::size_t>(hash_of_slot(index[next])) & m_index_mask;
+        // The entry may move into the gap only if the gap lies between its home position and its current position
+        bool movable = (position <= next) ? (home <= position || home > next) : (home <= position && home > next);
+        if (movable)
+        {
+            index[position] = index[next];
+            position = next;
+        }
+    }
+    index[position] = kNotFound;
+}
+
+void ParkedVehicleTable::grow()
+{
+    std::size_t size = m_license_plate_index.size() * 2;
+    m_index_mask = size - 1;
+    m_license_plate_index.assign(size, kNotFound);
+    m_ticket_index.assign(size, kNotFound);
+
+    auto never = [](std::uint32_t) { return false; };
+    for (std::uint32_t slot = 0; slot < m_slots.size(); ++slot)
+    {
+        if (record(slot).ticket_id == 0)
+        {
+            continue;
+        }
+        m_license_plate_index[probe(m_license_plate_index, m_slots[slot].license_plate_hash, never)] = slot;
+        m_ticket_index[probe(m_ticket_index, hashTicketID(record(slot).ticket_id), never)] = slot;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "LicensePlate.h"
+#include "LicensePlateTrie.h"
+#include "TicketID.h"
+#include "VehicleType.h"
+
+/// \brief Parked vehicle as stored by the parking lot
+struct ParkedRecord
+{
+    LicensePlate license_plate;
+    TicketID ticket_id = 0;
+    VehicleType type = VehicleType::Car;
+
+    /// Time the vehicle was parked, microseconds since 1970-01-01 UTC
+    std::int64_t entry_time_us = 0;
+
+    int bay = 0;
+};
+
+/// \brief Parked vehicle found by an approximate license plate search
+struct LicensePlateMatch
+{
+    ParkedRecord record;
+
+    /// Number of characters inserted, deleted or replaced to get from the searched license plate to that of the record
+    int distance = 0;
+};
+
+/// \brief Block of slots of a ParkedVehicleTable, shared with the snapshots taken of the table
+struct ParkedRecordPage
+{
+    /// Number of slots of a page
+    static const std::size_t kSize = 256;
+
+    /// Free slots have ticket ID 0
+    std::array<ParkedRecord, kSize> records;
+
+    /// Value of the table's snapshot epoch when the page was created, a page of an older epoch may be shared
+    std::uint64_t epoch = 0;
+};
+
+/// \brief Storage of the parked vehicles of one shard, not thread-safe
+/// Records live in a slab of pages whose freed slots are reused, two open-addressing indexes find them
+/// by license plate and by ticket ID and a prefix tree finds them by partial or misread license plates.
+/// sharePages hands the pages to a snapshot; the first change of a shared page afterwards replaces it with a
+/// copy, so the snapshot keeps the records as they were without any lock (copy-on-write). The prefix tree is
+/// shared the same way with approximate queries, which search it without the shard mutex. Once the table has
+/// grown to its high-water mark, inserting and erasing records never allocate unless they copy a shared page or tree.
+class ParkedVehicleTable
+{
+public:
+    /// Returned by the find functions if there is no such record
+    static constexpr std::uint32_t kNotFound = 0xFFFFFFFFu;
+
+    ParkedVehicleTable();
+
+    /// \brief Finds the slot of the record with the given license plate
+    /// \param[in] license_plate License plate to look for
+    /// \param[in] license_plate_hash LicensePlate::hash of the license plate
+    /// \return Returns the slot or kNotFound
+    std::uint32_t findByLicensePlate(const std::string_view license_plate, const std::uint64_t license_plate_hash) const;
+
+    /// \brief Finds the slot of the record with the given ticket ID
+    /// \return Returns the slot or kNotFound
+    std::uint32_t findByTicketID(const TicketID ticket_id) const;
+
+    /// \brief Appends the slots of the records whose license plate starts with prefix, in license plate order
+    /// \param[in] prefix Beginning of the license plates
+    /// \param[in] max_count No more than this number of slots is appended
+    /// \param[out] slots Receives the slots
+    void findByLicensePlatePrefix(const std::string_view prefix, const std::size_t max_count, std::vector<std::uint32_t> & slots) const
+    {
+        m_license_plate_trie->findByPrefix(prefix, max_count, slots);
+    }
+
+    /// \brief Shares the prefix tree of the license plates, whose values are slots, with a query that searches it
+    /// without the shard mutex, e.g. with LicensePlateTrie::findWithin. The first insert or erase while it is
+    /// shared goes on with a copy of the tree; the slots are those of the pages shared at the same time.
+    std::shared_ptr<const LicensePlateTrie> shareLicensePlateTrie() const { return m_license_plate_trie; }
+
+    /// \brief Stores a record, there must be no record with the same license plate or ticket ID
+    /// \param[in] record Record to store
+    /// \param[in] license_plate_hash LicensePlate::hash of the license plate of the record
+    /// \return Returns the slot of the record
+    std::uint32_t insert(const ParkedRecord & record, const std::uint64_t license_plate_hash);
+
+    /// \brief Removes the record in the given slot, the slot is reused by later inserts
+    void erase(const std::uint32_t slot);
+
+    /// \brief Gets the record in the given slot
+    const ParkedRecord & record(const std::uint32_t slot) const { return m_pages[slot / ParkedRecordPage::kSize]->records[slot % ParkedRecordPage::kSize]; }
+
+    /// \brief Calls visit for every stored record
+    template <typename Visit>
+    void forEach(Visit visit) const
+    {
+        for (std::uint32_t slot = 0; slot < m_slots.size(); ++slot)
+        {
+            // Free slots have ticket ID 0, see erase
+            if (record(slot).ticket_id != 0)
+            {
+                visit(record(slot));
+            }
+        }
+    }
+
+    /// \brief Appends the pages holding the records to a snapshot, they are not changed anymore
+    /// \param[out] pages Receives the pages, free slots have ticket ID 0
+    void sharePages(std::vector<std::shared_ptr<const ParkedRecordPage>> & pages);
+
+    /// \brief Number of stored records
+    std::size_t size() const { return m_size; }
+
+    /// \brief Makes room for the given number of records, so inserting up to it does not allocate
+    void reserve(const std::size_t count);
+
+private:
+    /// Bookkeeping of a slot, its record is in m_pages
+    struct Slot
+    {
+        std::uint64_t license_plate_hash = 0;
+        std::uint32_t next_free = kNotFound;
+    };
+
+    /// \brief Gets the record in the given slot for writing, copying its page first if a snapshot may share it
+    ParkedRecord & writableRecord(const std::uint32_t slot);
+
+    /// \brief Gets the prefix tree for writing, copying it first if a query still searches it
+    LicensePlateTrie & writableLicensePlateTrie();
+
+    /// \brief Spreads ticket IDs over the index, they share their low bits within a shard
+    static std::uint64_t hashTicketID(const TicketID ticket_id);
+
+    /// \brief Linear probing: finds the index position holding a matching slot or the empty position ending the probe
+    template <typename Matches>
+    std::size_t probe(const std::vector<std::uint32_t> & index, const std::uint64_t hash, Matches matches) const;
+
+    /// \brief Removes the entry at the given position and shifts the following entries back to close the gap
+    template <typename HashOfSlot>
+    void eraseAt(std::vector<std::uint32_t> & index, std::size_t position, HashOfSlot hash_of_slot);
+
+    /// \brief Doubles both indexes and reinserts all records
+    void grow();
+
+private:
+    std::vector<Slot> m_slots;
+
+    /// Page i holds the records of slots i * ParkedRecordPage::kSize and up, pages beyond the last slot are reserved
+    std::vector<std::shared_ptr<ParkedRecordPage>> m_pages;
+
+    /// Incremented by sharePages, pages of older epochs are copied before they are written
+    std::uint64_t m_epoch = 0;
+    std::uint32_t m_free_head = kNotFound;
+    std::size_t m_size = 0;
+
+    /// Positions hold slot numbers or kNotFound, the load factor is kept at or below one half
+    std::vector<std::uint32_t> m_license_plate_index;
+    std::vector<std::uint32_t> m_ticket_index;
+    std::size_t m_index_mask;
+
+    /// Slots by license plate, for prefix and approximate queries, shared with approximate queries while they run
+    std::shared_ptr<LicensePlateTrie> m_license_plate_trie;
+};
\ No newline at end of file
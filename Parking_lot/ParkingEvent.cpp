@@ -0,0 +1,34 @@
+#include "ParkingEvent.h"
+
+std::ostream & operator<<(std::ostream & out, const ParkingEvent & event)
+{
+    switch (event.type)
+    {
+    case ParkingEventType::Parked:
+        out << toString(event.vehicle_type) << " with license plate " << event.license_plate.view() << " parked. Ticket ID: " << event.ticket_id << ", bay: " << event.bay;
+        break;
+    case ParkingEventType::AlreadyParked:
+        out << toString(event.vehicle_type) << " with license plate " << event.license_plate.view() << " is already parked.";
+        break;
+    case ParkingEventType::Full:
+        out << "Parking lot is full for " << toString(event.vehicle_type) << ", " << toString(event.vehicle_type) << " with license plate " << event.license_plate.view() << " is not parked.";
+        break;
+    case ParkingEventType::Released:
+        out << toString(event.vehicle_type) << " with license plate " << event.license_plate.view() << " released. Charge: $" << event.charge;
+        break;
+    case ParkingEventType::NotFound:
+        if (event.license_plate.empty())
+        {
+            out << "Vehicle with ticket ID " << event.ticket_id << " is not found in the parking lot.";
+        }
+        else
+        {
+            out << "Vehicle with license plate " << event.license_plate.view() << " is not found in the parking lot.";
+        }
+        break;
+    case ParkingEventType::NoTicket:
+        out << "No ticket can be issued, " << toString(event.vehicle_type) << " with license plate " << event.license_plate.view() << " is not parked.";
+        break;
+    }
+    return out;
+}
\ No newline at end of file
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include "LicensePlate.h"
+#include "TicketID.h"
+#include "VehicleType.h"
+
+/// \brief What happened to a vehicle at a gate
+enum class ParkingEventType
+{
+    Parked,
+    AlreadyParked,
+    Full,
+    Released,
+    NotFound,
+
+    /// The vehicle is not parked because the TicketGenerator cannot reserve ticket numbers
+    NoTicket
+};
+
+/// Number of event types, the size of per-type arrays
+const std::size_t kParkingEventTypeCount = 6;
+
+/// \brief Event emitted by the ParkingLot for every park and release attempt
+struct ParkingEvent
+{
+    ParkingEventType type = ParkingEventType::NotFound;
+    VehicleType vehicle_type = VehicleType::Car;
+    LicensePlate license_plate;
+    TicketID ticket_id = 0;
+    double charge = 0.0;
+
+    /// Bay of the parked or released vehicle, numbered from 1 per vehicle type (across the lot with a LotTopology), 0 if there is none
+    int bay = 0;
+
+    /// Times the vehicle was parked and released, microseconds since 1970-01-01 UTC, 0 if not known;
+    /// for Full the entry time is when the vehicle was turned away
+    std::int64_t entry_time_us = 0;
+    std::int64_t exit_time_us = 0;
+};
+
+/// \brief Writes a human readable description of the event (without a line break)
+std::ostream & operator<<(std::ostream & out, const ParkingEvent & event);
\ No newline at end of file
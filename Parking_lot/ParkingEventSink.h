@@ -0,0 +1,16 @@
+#pragma once
+
+#include "ParkingEvent.h"
+
+/// \brief Abstract base class for receivers of the ParkingLot events
+/// The ParkingLot calls onEvent after it released its locks, possibly from several threads at once.
+class ParkingEventSink
+{
+public:
+    /// Destructor
+    virtual ~ParkingEventSink() {}
+
+    /// Called for every park and release attempt
+    /// \param[in] event Event describing the attempt
+    virtual void onEvent(const ParkingEvent & event) = 0;
+};
\ No newline at end of file
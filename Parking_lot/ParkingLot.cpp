@@ -1,222 +1,1128 @@
+#include <algorithm>
+#include <exception>
+#include <filesystem>
 #include <mutex>
 #include <iostream>
-#include <fstream>
 
 #include "ParkingLot.h"
+#include "ConsoleEventSink.h"
+#include "NullEventSink.h"
 #include "ParkingLotFullException.h"
 #include "VehicleNotFoundException.h"
 #include "InvalidVehicleTypeException.h"
+#include "JournalException.h"
+#include "BookingException.h"
+#include "TicketGeneratorException.h"
 
 std::shared_ptr<ParkingLot> ParkingLot::instance_ = nullptr;
 std::mutex ParkingLot::instance_mutex_;
-std::mutex ParkingLot::count_mutex_;
 
 ParkingLot::ParkingLot() 
-    : m_car_capacity(0), m_motorcycle_capacity(0), m_bus_capacity(0) 
+    : m_capacity{ { 0, 0, 0 } }, m_bays{ { BayAllocator(0), BayAllocator(0), BayAllocator(0) } }, m_bookings(new BookingCalendar(m_capacity)), m_analytics(std::make_shared<OccupancyAnalytics>()), m_forecaster(std::make_shared<OccupancyForecaster>()), m_logger(new AsyncLogger()), m_ticket_generator(std::make_shared<TicketGenerator>()), m_event_sink(std::make_shared<ConsoleEventSink>()),
+      m_tariffs(std::make_shared<const TariffTable>())
 {
     
 }
 
-ParkingLot::ParkingLot(const int car_capacity, const int motorcycle_capacity, const int bus_capacity)
-    : m_car_capacity(car_capacity), m_motorcycle_capacity(motorcycle_capacity), m_bus_capacity(motorcycle_capacity)
+ParkingLot::ParkingLot(const int car_capacity, const int motorcycle_capacity, const int bus_capacity, const AsyncLoggerConfig & log_config)
+    : m_capacity{ { car_capacity, motorcycle_capacity, bus_capacity } },
+      m_bays{ { BayAllocator(car_capacity), BayAllocator(motorcycle_capacity), BayAllocator(bus_capacity) } }, m_bookings(new BookingCalendar(m_capacity)),
+      m_analytics(std::make_shared<OccupancyAnalytics>()), m_forecaster(std::make_shared<OccupancyForecaster>()), m_logger(new AsyncLogger(log_config)), m_ticket_generator(std::make_shared<TicketGenerator>()), m_event_sink(std::make_shared<ConsoleEventSink>()),
+      m_tariffs(std::make_shared<const TariffTable>())
 {
 
 }
 
-std::shared_ptr<ParkingLot> ParkingLot::getInstance(int car_capacity, int motorcycle_capacity, int bus_capacity)
+ParkingLot::~ParkingLot()
+{
+    // The logger drains its buffer before the writer thread stops
+    m_logger.reset();
+}
+
+std::shared_ptr<ParkingLot> ParkingLot::getInstance(int car_capacity, int motorcycle_capacity, int bus_capacity, const AsyncLoggerConfig & log_config)
 {
     std::lock_guard<std::mutex> lock(instance_mutex_);
 
     if (!instance_)
     {
-        instance_ = std::shared_ptr<ParkingLot>(new ParkingLot(car_capacity, motorcycle_capacity, bus_capacity));
+        instance_ = std::shared_ptr<ParkingLot>(new ParkingLot(car_capacity, motorcycle_capacity, bus_capacity, log_config));
     }
     return instance_;
 }
 
 bool ParkingLot::parkVehicle(const std::shared_ptr<Vehicle> & vehicle)
 {
-    const std::string& license_plate = vehicle->getLicensePlate();
-    std::lock_guard<std::mutex> lock(instance_mutex_);
+    ParkingResult result = tryParkVehicle(vehicle);
+    if (result.status == ParkingEventType::Full)
+    {
+        throw ParkingLotFullException("Parking lot is full for " + vehicle->getVehicleType());
+    }
+    if (result.status == ParkingEventType::NoTicket)
+    {
+        throw TicketGeneratorException("No ticket can be issued for " + vehicle->getLicensePlate() + ".");
+    }
+    throwIfNotDurable(result);
+    return result.succeeded();
+}
+
+ParkingResult ParkingLot::makeResult(const ParkingEvent & event, const bool durable)
+{
+    ParkingResult result{ event.type, event.ticket_id, event.charge, event.bay };
+    result.durable = durable || !result.succeeded();
+    return result;
+}
 
-    if (m_parked_vehicles.find(license_plate) == m_parked_vehicles.end())
+void ParkingLot::throwIfNotDurable(const ParkingResult & result)
+{
+    if (!result.durable)
     {
-        if (isParkingFull(vehicle->getVehicleType()))
+        throw JournalException("Journal cannot be written, ticket " + std::to_string(result.ticket_id) + " would be lost on a restart.");
+    }
+}
+
+bool ParkingLot::releaseVehicleByTicketID(const TicketID ticket_id)
+{
+    ParkingResult result = tryReleaseVehicleByTicketID(ticket_id);
+    if (result.status == ParkingEventType::NotFound)
+    {
+        throw VehicleNotFoundException("Vehicle with ticket ID " + std::to_string(ticket_id) + " is not found in the parking lot.");
+    }
+    throwIfNotDurable(result);
+    return result.succeeded();
+}
+
+bool ParkingLot::releaseVehicleByLicensePlate(const std::string_view license_plate)
+{
+    ParkingResult result = tryReleaseVehicleByLicensePlate(license_plate);
+    if (result.status == ParkingEventType::NotFound)
+    {
+        throw VehicleNotFoundException("Vehicle with license plate " + std::string(license_plate) + " is not found in the parking lot.");
+    }
+    throwIfNotDurable(result);
+    return result.succeeded();
+}
+
+ParkingResult ParkingLot::tryParkVehicle(const std::shared_ptr<Vehicle> & vehicle)
+{
+    MetricsSample sample(m_metrics_sample_period.load(std::memory_order_relaxed));
+    MetricsStopwatch stopwatch;
+    ParkingEvent event;
+    Shard & shard = shardForLicensePlate(LicensePlate::hash(vehicle->getLicensePlateView()));
+    {
+        MeteredLock lock(shard.mutex, shard.metrics);
+        event = parkInShard(shard, vehicle);
+        logEntry(shard, event);
+    }
+
+    bool durable = syncJournal();
+    emitEvent(event);
+    shard.metrics.countEvent(event.type);
+    shard.metrics.record(GateLatency::Park, stopwatch);
+    durable = checkpointIfDue() && durable;
+    return makeResult(event, durable);
+}
+
+ParkingResult ParkingLot::tryReleaseVehicleByTicketID(const TicketID ticket_id)
+{
+    MetricsSample sample(m_metrics_sample_period.load(std::memory_order_relaxed));
+    MetricsStopwatch stopwatch;
+    ParkingEvent event{ ParkingEventType::NotFound, VehicleType::Car, LicensePlate(), ticket_id };
+
+    // Ticket IDs no shard could have issued are counted by the first one
+    Shard * shard = shardForTicketID(ticket_id);
+    if (shard)
+    {
+        MeteredLock lock(shard->mutex, shard->metrics);
+        std::uint32_t slot = shard->parked_vehicles.findByTicketID(ticket_id);
+        if (slot != ParkedVehicleTable::kNotFound)
         {
-            throw ParkingLotFullException("Parking lot is full for " + vehicle->getVehicleType());
+            event = releaseSlot(*shard, slot);
+            logEntry(*shard, event);
         }
+    }
+    else
+    {
+        shard = &m_shards[0];
+    }
 
-        // Generate a unique ticket ID for the parked vehicle
-        int ticket_id = generateTicketID();
-        m_parked_vehicles[vehicle->getLicensePlate()] = std::make_pair(vehicle, ticket_id);
+    bool durable = syncJournal();
+    emitEvent(event);
+    shard->metrics.countEvent(event.type);
+    shard->metrics.record(GateLatency::Release, stopwatch);
+    durable = checkpointIfDue() && durable;
+    return makeResult(event, durable);
+}
+
+ParkingResult ParkingLot::tryReleaseVehicleByLicensePlate(const std::string_view license_plate)
+{
+    MetricsSample sample(m_metrics_sample_period.load(std::memory_order_relaxed));
+    MetricsStopwatch stopwatch;
+    ParkingEvent event;
+    Shard & shard = shardForLicensePlate(LicensePlate::hash(license_plate));
+    {
+        MeteredLock lock(shard.mutex, shard.metrics);
+        event = releaseFromShard(shard, license_plate);
+        logEntry(shard, event);
+    }
 
-        updateCount(vehicle->getVehicleType(), 1);
+    bool durable = syncJournal();
+    emitEvent(event);
+    shard.metrics.countEvent(event.type);
+    shard.metrics.record(GateLatency::Release, stopwatch);
+    durable = checkpointIfDue() && durable;
+    return makeResult(event, durable);
+}
 
-        std::cout << vehicle->getVehicleType() << " with license plate " << license_plate << " parked. Ticket ID: " << ticket_id << std::endl;
+std::vector<ParkingResult> ParkingLot::parkVehicles(const std::vector<std::shared_ptr<Vehicle>> & vehicles)
+{
+    // A batch takes few locks, its lock and log times are always measured
+    MetricsSample sample(1);
+    std::vector<ParkingResult> results(vehicles.size());
+    std::vector<ParkingEvent> events;
+    std::vector<LogRecord> log_records;
 
-        // Log the vehicle entry
-        logEntry("Entry", vehicle, ticket_id);
+    events.reserve(vehicles.size());
+    log_records.reserve(vehicles.size());
 
-        return true;
+    std::vector<std::pair<std::size_t, std::size_t>> order = groupByShard(vehicles.size(), [&vehicles](std::size_t i) { return vehicles[i]->getLicensePlateView(); });
+    std::exception_ptr error;
+    for (std::size_t begin = 0; begin < order.size() && !error;)
+    {
+        Shard & shard = m_shards[order[begin].first];
+        std::size_t end = begin;
+        {
+            MeteredLock lock(shard.mutex, shard.metrics);
+            try
+            {
+                for (; end < order.size() && order[end].first == order[begin].first; ++end)
+                {
+                    ParkingEvent event = parkInShard(shard, vehicles[order[end].second]);
+                    results[order[end].second] = makeResult(event, true);
+                    if (event.type == ParkingEventType::Parked)
+                    {
+                        log_records.push_back(AsyncLogger::makeRecord("Entry", event.vehicle_type, event.license_plate.view(), event.ticket_id, event.entry_time_us));
+                    }
+                    shard.metrics.countEvent(event.type);
+                    events.push_back(std::move(event));
+                }
+            }
+            catch (...)
+            {
+                // The vehicles handled before the failure are logged, synced and reported before it is rethrown
+                error = std::current_exception();
+            }
+            MetricsStopwatch logging;
+            m_logger->logBatch(log_records.data(), log_records.size());
+            shard.metrics.record(GateLatency::Log, logging);
+        }
+        log_records.clear();
+        begin = end;
     }
-    else
+
+    bool durable = syncJournal();
+    for (const auto & event : events)
     {
-        std::cout << vehicle->getVehicleType() << " with license plate " << license_plate << " is already parked." << std::endl;
-        return false;
+        emitEvent(event);
+    }
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+    if (!checkpointIfDue() || !durable)
+    {
+        for (auto & result : results)
+        {
+            result.durable = !result.succeeded();
+        }
     }
+    return results;
 }
 
-bool ParkingLot::releaseVehicleByTicketID(const int ticket_id)
+std::vector<ParkingResult> ParkingLot::releaseVehicles(const std::vector<std::string> & license_plates)
 {
-    std::lock_guard<std::mutex> lock(instance_mutex_);
-    for (auto it = m_parked_vehicles.begin(); it != m_parked_vehicles.end(); ++it)
+    // A batch takes few locks, its lock and log times are always measured
+    MetricsSample sample(1);
+    std::vector<ParkingResult> results(license_plates.size());
+    std::vector<ParkingEvent> events;
+    std::vector<LogRecord> log_records;
+
+    events.reserve(license_plates.size());
+    log_records.reserve(license_plates.size());
+
+    std::vector<std::pair<std::size_t, std::size_t>> order = groupByShard(license_plates.size(), [&license_plates](std::size_t i) { return std::string_view(license_plates[i]); });
+    std::exception_ptr error;
+    for (std::size_t begin = 0; begin < order.size() && !error;)
+    {
+        Shard & shard = m_shards[order[begin].first];
+        std::size_t end = begin;
+        {
+            MeteredLock lock(shard.mutex, shard.metrics);
+            try
+            {
+                for (; end < order.size() && order[end].first == order[begin].first; ++end)
+                {
+                    ParkingEvent event = releaseFromShard(shard, license_plates[order[end].second]);
+                    results[order[end].second] = makeResult(event, true);
+                    if (event.type == ParkingEventType::Released)
+                    {
+                        log_records.push_back(AsyncLogger::makeRecord("Exit", event.vehicle_type, event.license_plate.view(), event.ticket_id, event.exit_time_us));
+                    }
+                    shard.metrics.countEvent(event.type);
+                    events.push_back(std::move(event));
+                }
+            }
+            catch (...)
+            {
+                // The vehicles handled before the failure are logged, synced and reported before it is rethrown
+                error = std::current_exception();
+            }
+            MetricsStopwatch logging;
+            m_logger->logBatch(log_records.data(), log_records.size());
+            shard.metrics.record(GateLatency::Log, logging);
+        }
+        log_records.clear();
+        begin = end;
+    }
+
+    bool durable = syncJournal();
+    for (const auto & event : events)
+    {
+        emitEvent(event);
+    }
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+    if (!checkpointIfDue() || !durable)
+    {
+        for (auto & result : results)
+        {
+            result.durable = !result.succeeded();
+        }
+    }
+    return results;
+}
+
+ParkingEvent ParkingLot::parkInShard(Shard & shard, const std::shared_ptr<Vehicle> & vehicle)
+{
+    std::string_view license_plate = vehicle->getLicensePlateView();
+    std::uint64_t license_plate_hash = LicensePlate::hash(license_plate);
+    ParkingEvent event{ ParkingEventType::Parked, vehicle->getType(), license_plate };
+    std::int64_t now_us = m_clock.load(std::memory_order_relaxed)();
+    BookingID booking_id = kNoBooking;
+
+    if (shard.parked_vehicles.findByLicensePlate(license_plate, license_plate_hash) != ParkedVehicleTable::kNotFound)
+    {
+        event.type = ParkingEventType::AlreadyParked;
+    }
+    else if (!tryReserveSlot(event.vehicle_type, license_plate, now_us, booking_id) || !tryAllocateBay(event, booking_id))
+    {
+        event.type = ParkingEventType::Full;
+        event.entry_time_us = now_us;
+    }
+    else
     {
-        if (it->second.second == ticket_id)
+        // Generate a unique ticket ID for the parked vehicle
+        TicketID ticket_id = 0;
+        try
+        {
+            ticket_id = generateTicketID(shard);
+        }
+        catch (const TicketGeneratorException &)
         {
-            auto vehicle = it->second.first;
-            double charge = calculateCharge(vehicle);
-            std::string license_plate = it->first;
-            std::cout << vehicle->getVehicleType() << " with license plate " << license_plate << " released. Charge: $" << charge << std::endl;
-            m_parked_vehicles.erase(it);
+            // The gate turns the vehicle away like for a full lot, a booking keeps its bay
+            releaseBay(event.vehicle_type, event.bay);
+            unreserveSlot(event.vehicle_type, booking_id);
+            event.type = ParkingEventType::NoTicket;
+            event.bay = 0;
+            event.entry_time_us = now_us;
+            return event;
+        }
 
-            updateCount(vehicle->getVehicleType(), -1);
+        // The booking ends only once the vehicle has its bay and ticket, a vehicle turned away keeps it.
+        // One cancelled or over meanwhile has no bay to hand over, the vehicle already has the one it had held.
+        if (booking_id != kNoBooking)
+        {
+            m_bookings->claim(booking_id, now_us);
+        }
+        ParkedRecord record{ event.license_plate, ticket_id, event.vehicle_type, now_us, event.bay };
+        shard.parked_vehicles.insert(record, license_plate_hash);
+        event.ticket_id = ticket_id;
+        event.entry_time_us = record.entry_time_us;
 
-            // Log the vehicle exit
-            logEntry("Exit", vehicle, ticket_id);
-            return true;
+        if (m_journal)
+        {
+            m_journal->append(JournalRecordKind::Park, record);
         }
     }
-    throw VehicleNotFoundException("Vehicle with ticket ID " + std::to_string(ticket_id) + " is not found in the parking lot.");
+    return event;
 }
 
-bool ParkingLot::releaseVehicleByLicensePlate(const std::string& license_plate)
+ParkingEvent ParkingLot::releaseFromShard(Shard & shard, const std::string_view license_plate)
 {
-    std::lock_guard<std::mutex> lock(instance_mutex_);
-    auto it = m_parked_vehicles.find(license_plate);
-    if (it != m_parked_vehicles.end())
+    std::uint32_t slot = shard.parked_vehicles.findByLicensePlate(license_plate, LicensePlate::hash(license_plate));
+    if (slot == ParkedVehicleTable::kNotFound)
     {
-        auto vehicle = it->second.first;
-        int ticket_id = it->second.second;
-        double charge = calculateCharge(vehicle);
-        std::cout << vehicle->getVehicleType() << " with license plate " << license_plate << " released. Charge: $" << charge << std::endl;
-        m_parked_vehicles.erase(it);
+        // A license plate too long to be stored cannot be parked, the event reports its beginning
+        return ParkingEvent{ ParkingEventType::NotFound, VehicleType::Car, license_plate.substr(0, LicensePlate::kMaxLength) };
+    }
+    return releaseSlot(shard, slot);
+}
 
-        updateCount(vehicle->getVehicleType(), -1);
+ParkingEvent ParkingLot::releaseSlot(Shard & shard, const std::uint32_t slot)
+{
+    const ParkedRecord & record = shard.parked_vehicles.record(slot);
+    std::int64_t exit_time_us = m_clock.load(std::memory_order_relaxed)();
+    ParkingEvent event{ ParkingEventType::Released, record.type, record.license_plate, record.ticket_id, calculateCharge(record, exit_time_us), record.bay,
+                        record.entry_time_us, exit_time_us };
+    if (m_journal)
+    {
+        m_journal->append(JournalRecordKind::Release, record);
+    }
+    shard.parked_vehicles.erase(slot);
 
-        // Log the vehicle exit
-        logEntry("Exit", vehicle, ticket_id);
-        return true;
+    // The bay is freed before the slot, a vehicle that reserves the slot always finds a free bay.
+    // Only a vehicle restored into a lot with fewer bays has none.
+    if (event.bay > 0)
+    {
+        releaseBay(event.vehicle_type, event.bay);
+    }
+    updateCount(event.vehicle_type, -1);
+    return event;
+}
+
+template <typename GetLicensePlate>
+std::vector<std::pair<std::size_t, std::size_t>> ParkingLot::groupByShard(const std::size_t count, GetLicensePlate get_license_plate)
+{
+    // Counting sort by shard index, items of the same shard keep their relative order
+    std::vector<std::size_t> shard_indices(count);
+    std::array<std::size_t, kShardCount + 1> offsets{};
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        shard_indices[i] = static_cast<std::size_t>(&shardForLicensePlate(LicensePlate::hash(get_license_plate(i))) - m_shards.data());
+        ++offsets[shard_indices[i] + 1];
+    }
+    for (std::size_t shard = 0; shard < kShardCount; ++shard)
+    {
+        offsets[shard + 1] += offsets[shard];
+    }
+
+    std::vector<std::pair<std::size_t, std::size_t>> order(count);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        order[offsets[shard_indices[i]]++] = std::make_pair(shard_indices[i], i);
     }
-    throw VehicleNotFoundException("Vehicle with license plate " + license_plate + " is not found in the parking lot.");
+    return order;
 }
 
 void ParkingLot::queryAvailableCarsSlots()
 {
-    std::cout << "Available Cars slots: " << m_car_capacity - m_car_count << " out of " << m_car_capacity << std::endl;
+    VehicleTypeOccupancy occupancy = getOccupancy(VehicleType::Car);
+    std::cout << "Available Cars slots: " << occupancy.available() << " out of " << occupancy.capacity << std::endl;
 }
 
 void ParkingLot::queryAvailableMotorcyclesSlots()
 {
-    std::cout << "Available Motorcycles slots: " << m_motorcycle_capacity - m_motorcycle_count << " out of " << m_motorcycle_capacity << std::endl;
+    VehicleTypeOccupancy occupancy = getOccupancy(VehicleType::Motorcycle);
+    std::cout << "Available Motorcycles slots: " << occupancy.available() << " out of " << occupancy.capacity << std::endl;
 }
 
 void ParkingLot::queryAvailableBusesSlots()
 {
-    std::cout << "Available Buses slots: " << m_bus_capacity - m_bus_count << " out of " << m_bus_capacity << std::endl;
+    VehicleTypeOccupancy occupancy = getOccupancy(VehicleType::Bus);
+    std::cout << "Available Buses slots: " << occupancy.available() << " out of " << occupancy.capacity << std::endl;
+}
+
+VehicleTypeOccupancy ParkingLot::getOccupancy(const VehicleType vehicle_type) const
+{
+    // A single atomic load, the count never exceeds the capacity because slots are reserved by compare-exchange
+    std::size_t index = toIndex(vehicle_type);
+    return VehicleTypeOccupancy{ m_capacity[index], m_count[index].value.load(std::memory_order_acquire) };
+}
+
+OccupancySnapshot ParkingLot::getOccupancySnapshot() const
+{
+    OccupancySnapshot snapshot;
+    for (std::size_t index = 0; index < kVehicleTypeCount; ++index)
+    {
+        snapshot.types[index] = getOccupancy(static_cast<VehicleType>(index));
+    }
+    return snapshot;
+}
+
+BookingID ParkingLot::bookBay(const VehicleType vehicle_type, const std::string_view license_plate, const std::int64_t from_us, const std::int64_t to_us)
+{
+    BookingID booking_id = tryBookBay(vehicle_type, license_plate, from_us, to_us);
+    if (booking_id == kNoBooking)
+    {
+        throw ParkingLotFullException("Parking lot is booked out for " + std::string(toString(vehicle_type)));
+    }
+    return booking_id;
+}
+
+BookingID ParkingLot::tryBookBay(const VehicleType vehicle_type, const std::string_view license_plate, const std::int64_t from_us, const std::int64_t to_us)
+{
+    std::int64_t now_us = m_clock.load(std::memory_order_relaxed)();
+    BookingID booking_id = m_bookings->book(vehicle_type, license_plate, from_us, to_us, now_us);
+
+    // A booking that holds a slot right away also needs one that no parked vehicle takes; the held slots were
+    // raised before the count is read, see tryReserveSlot
+    std::size_t index = toIndex(vehicle_type);
+    if (booking_id != kNoBooking && m_bookings->isStarted(from_us, now_us)
+        && m_count[index].value.load() + m_bookings->getHeldBays(vehicle_type, now_us) > m_capacity[index])
+    {
+        m_bookings->cancel(booking_id, now_us);
+        booking_id = kNoBooking;
+    }
+    return booking_id;
+}
+
+bool ParkingLot::cancelBooking(const BookingID booking_id)
+{
+    return m_bookings->cancel(booking_id, m_clock.load(std::memory_order_relaxed)());
 }
 
-bool ParkingLot::isParkingFull(const std::string & vehicle_type)
+int ParkingLot::getBookableBays(const VehicleType vehicle_type, const std::int64_t from_us, const std::int64_t to_us)
 {
-    if (vehicle_type == "Car")
+    std::int64_t now_us = m_clock.load(std::memory_order_relaxed)();
+    int bookable = m_bookings->getFreeBays(vehicle_type, from_us, to_us, now_us);
+    if (m_bookings->isStarted(from_us, now_us))
     {
-        return m_car_count >= m_car_capacity;
+        std::size_t index = toIndex(vehicle_type);
+        bookable = std::min(bookable, m_capacity[index] - m_count[index].value.load() - m_bookings->getHeldBays(vehicle_type, now_us));
     }
-    else if (vehicle_type == "Motorcycle")
+    return std::max(bookable, 0);
+}
+
+void ParkingLot::setBookingConfig(const BookingConfig & config)
+{
+    m_booking_config = config;
+    m_bookings.reset(new BookingCalendar(m_capacity, config));
+}
+
+void ParkingLot::setTopology(const LotTopology & topology, const std::shared_ptr<const BayAllocationPolicy> & policy)
+{
+    m_zones.reset(new ZonedBayAllocator(topology, policy));
+    for (std::size_t index = 0; index < kVehicleTypeCount; ++index)
     {
-        return m_motorcycle_count >= m_motorcycle_capacity;
+        m_capacity[index] = topology.usableBays(static_cast<VehicleType>(index));
     }
-    else if (vehicle_type == "Bus")
+    m_bookings.reset(new BookingCalendar(m_capacity, m_booking_config));
+}
+
+BayLocation ParkingLot::getBayLocation(const int bay) const
+{
+    return m_zones ? m_zones->locate(bay) : BayLocation();
+}
+
+int ParkingLot::getPeakOccupancy(const VehicleType vehicle_type, const std::int64_t window_us)
+{
+    return std::atomic_load(&m_analytics)->getPeakOccupancy(vehicle_type, window_us, m_clock.load(std::memory_order_relaxed)());
+}
+
+std::vector<OccupancySample> ParkingLot::getOccupancyHistory(const VehicleType vehicle_type, const std::int64_t window_us)
+{
+    return std::atomic_load(&m_analytics)->getOccupancyHistory(vehicle_type, window_us, m_clock.load(std::memory_order_relaxed)());
+}
+
+DwellTimeSketch ParkingLot::getDwellTimes(const VehicleType vehicle_type, const std::int64_t window_us)
+{
+    return std::atomic_load(&m_analytics)->getDwellTimes(vehicle_type, window_us, m_clock.load(std::memory_order_relaxed)());
+}
+
+void ParkingLot::setAnalyticsConfig(const AnalyticsConfig & config)
+{
+    std::shared_ptr<OccupancyAnalytics> analytics = std::make_shared<OccupancyAnalytics>(config);
+    std::atomic_store(&m_analytics, analytics);
+}
+
+std::int64_t ParkingLot::getTimeToFull(const VehicleType vehicle_type, const std::int64_t horizon_us)
+{
+    std::int64_t now_us = m_clock.load(std::memory_order_relaxed)();
+    int taken = getTakenBays(vehicle_type, now_us);
+    return std::atomic_load(&m_forecaster)->getTimeToFull(vehicle_type, taken, m_capacity[toIndex(vehicle_type)], now_us, horizon_us);
+}
+
+std::vector<OccupancyForecast> ParkingLot::getOccupancyForecast(const VehicleType vehicle_type, const std::int64_t horizon_us)
+{
+    std::int64_t now_us = m_clock.load(std::memory_order_relaxed)();
+    return std::atomic_load(&m_forecaster)->getForecast(vehicle_type, getTakenBays(vehicle_type, now_us), now_us, horizon_us);
+}
+
+void ParkingLot::setForecastConfig(const ForecastConfig & config)
+{
+    // Vehicles parked before are present in the first slots learned, even if their type has no events for a while
+    std::array<int, kVehicleTypeCount> occupancy{};
+    for (std::size_t index = 0; index < kVehicleTypeCount; ++index)
     {
-        return m_bus_count >= m_bus_capacity;
+        occupancy[index] = m_count[index].value.load(std::memory_order_relaxed);
     }
-    throw InvalidVehicleTypeException("Invalid vehicle type: " + vehicle_type);
+    std::shared_ptr<OccupancyForecaster> forecaster = std::make_shared<OccupancyForecaster>(config, occupancy);
+    std::atomic_store(&m_forecaster, forecaster);
 }
 
-double ParkingLot::calculateCharge(const std::shared_ptr<Vehicle>& vehicle)
+bool ParkingLot::tryReserveSlot(const VehicleType vehicle_type, const std::string_view license_plate, const std::int64_t now_us, BookingID & booking_id)
 {
-    double charge = 0.0;
+    std::size_t index = toIndex(vehicle_type);
+    if (index >= kVehicleTypeCount)
+    {
+        throw InvalidVehicleTypeException("Invalid vehicle type: " + std::to_string(index));
+    }
+
+    // Slots held for bookings that started are not given to other vehicles, a booked vehicle takes its own
+    int limit = m_capacity[index];
+    booking_id = kNoBooking;
+    if (!m_bookings->empty())
+    {
+        int held = m_bookings->getHeldBays(vehicle_type, now_us);
+        booking_id = held > 0 ? m_bookings->findHeld(vehicle_type, license_plate, now_us) : kNoBooking;
+        limit -= booking_id == kNoBooking ? held : held - 1;
+    }
+
+    // Vehicles of the same type may be parked through different shards at the same time,
+    // so the count is only incremented while it stays within the capacity
+    std::atomic<int> & count = m_count[index].value;
+    int current = count.load(std::memory_order_relaxed);
+    while (true)
+    {
+        if (current >= limit)
+        {
+            return false;
+        }
+        if (count.compare_exchange_weak(current, current + 1))
+        {
+            break;
+        }
+    }
+
+    // Right after the count is raised the booking stops holding its bay, so the vehicle is not counted twice
+    // while it gets its bay and ticket. A booking cancelled or over since it was found held nothing more.
+    if (booking_id != kNoBooking && !m_bookings->arrive(booking_id, now_us))
+    {
+        booking_id = kNoBooking;
+    }
+
+    if (booking_id == kNoBooking && !m_bookings->empty() && count.load() + m_bookings->getHeldBays(vehicle_type, now_us) > m_capacity[index])
+    {
+        // A booking made after the held slots were read; it raised them before checking the count, so either
+        // it sees this vehicle or this check sees its slot
+        count.fetch_sub(1);
+        return false;
+    }
+    return true;
+}
 
-    double charge_cars_first_hour = 2.0;
-    double charge_cars_subsequent_hours = 1.0;
-    double charge_motorcycles_first_hour = 1.0;
-    double charge_motorcycles_subsequent_hours = 0.5;
-    double charge_buses_first_hour = 5.0;
-    double charge_buses_subsequent_hours = 3.0;
+void ParkingLot::unreserveSlot(const VehicleType vehicle_type, const BookingID booking_id)
+{
+    // The booking holds its bay again before the count drops, never the other way round
+    if (booking_id != kNoBooking)
+    {
+        m_bookings->leave(booking_id);
+    }
+    updateCount(vehicle_type, -1);
+}
 
-    if (vehicle->getVehicleType() == "Car")
+int ParkingLot::allocateBay(const VehicleType vehicle_type)
+{
+    if (m_zones)
     {
-        charge = charge_cars_first_hour + std::max(0.0, vehicle->getParkingDuration() - 1.0) * charge_cars_subsequent_hours;
+        return m_zones->allocate(vehicle_type);
     }
-    else if (vehicle->getVehicleType() == "Motorcycle")
+
+    // Other gates may take the bay found by a scan first, but the reserved slot guarantees that a free bay is left
+    BayAllocator & bays = m_bays[toIndex(vehicle_type)];
+    int bay = bays.allocate();
+    while (bay == BayAllocator::kNoBay)
     {
-        charge = charge_motorcycles_first_hour + std::max(0.0, vehicle->getParkingDuration() - 1.0) * charge_motorcycles_subsequent_hours;
+        bay = bays.allocate();
     }
-    else if (vehicle->getVehicleType() == "Bus")
+    return bay + 1;
+}
+
+bool ParkingLot::tryAllocateBay(ParkingEvent & event, const BookingID booking_id)
+{
+    event.bay = allocateBay(event.vehicle_type);
+    if (event.bay == 0)
     {
-        charge = charge_buses_first_hour + std::max(0.0, vehicle->getParkingDuration() - 1.0) * charge_buses_subsequent_hours;
+        // Bays shared by several vehicle types were taken by the others
+        unreserveSlot(event.vehicle_type, booking_id);
+        return false;
+    }
+    return true;
+}
+
+void ParkingLot::releaseBay(const VehicleType vehicle_type, const int bay)
+{
+    if (m_zones)
+    {
+        m_zones->release(bay);
     }
     else
     {
-        throw InvalidVehicleTypeException("Invalid vehicle type: " + vehicle->getVehicleType());
+        m_bays[toIndex(vehicle_type)].release(bay - 1);
+    }
+}
+
+double ParkingLot::calculateCharge(const ParkedRecord & record, const std::int64_t exit_time_us)
+{
+    std::size_t index = toIndex(record.type);
+    if (index >= kVehicleTypeCount)
+    {
+        throw InvalidVehicleTypeException("Invalid vehicle type: " + std::to_string(index));
     }
-    return charge;
+
+    std::shared_ptr<const TariffTable> tariffs = std::atomic_load(&m_tariffs);
+    return tariffs->charge(record.type, record.entry_time_us, exit_time_us);
 }
 
-void ParkingLot::logEntry(const std::string& action, const std::shared_ptr<Vehicle>& vehicle, const int ticket_id)
+void ParkingLot::logEntry(Shard & shard, const ParkingEvent & event)
 {
-    std::ofstream log_file("parking_log.txt", std::ios_base::app);
-    if (log_file.is_open())
+    MetricsStopwatch stopwatch;
+    if (event.type == ParkingEventType::Parked)
+    {
+        m_logger->log("Entry", event.vehicle_type, event.license_plate.view(), event.ticket_id, event.entry_time_us);
+    }
+    else if (event.type == ParkingEventType::Released)
     {
-        log_file << action << ": Ticket ID " << ticket_id << ", " << vehicle->getVehicleType() << " with license plate " << vehicle->getLicensePlate() << std::endl;
-        log_file.close();
+        m_logger->log("Exit", event.vehicle_type, event.license_plate.view(), event.ticket_id, event.exit_time_us);
     }
+    else
+    {
+        return;
+    }
+    shard.metrics.record(GateLatency::Log, stopwatch);
 }
 
-int ParkingLot::generateTicketID()
+ParkingLot::Shard & ParkingLot::shardForLicensePlate(const std::uint64_t license_plate_hash)
 {
-    // Is initialized once
-    static int ticket_counter = 1;
-    return ticket_counter++;
+    return m_shards[(license_plate_hash >> 32) % kShardCount];
 }
 
-void ParkingLot::updateCount(const std::string& vehicle_type, int change)
+ParkingLot::Shard * ParkingLot::shardForTicketID(const TicketID ticket_id)
 {
-    std::lock_guard<std::mutex> lock(count_mutex_);
-    if (vehicle_type == "Car")
+    if (ticket_id <= 0)
     {
-        m_car_count += change;
+        return nullptr;
     }
-    else if (vehicle_type == "Motorcycle")
+    return &m_shards[ticket_id % kShardCount];
+}
+
+int ParkingLot::getTakenBays(const VehicleType vehicle_type, const std::int64_t now_us)
+{
+    std::size_t index = toIndex(vehicle_type);
+    if (index >= kVehicleTypeCount)
     {
-        m_motorcycle_count += change;
+        throw InvalidVehicleTypeException("Invalid vehicle type: " + std::to_string(index));
     }
-    else if (vehicle_type == "Bus")
+    int taken = m_count[index].value.load(std::memory_order_relaxed);
+    return m_bookings->empty() ? taken : taken + m_bookings->getHeldBays(vehicle_type, now_us);
+}
+
+void ParkingLot::emitEvent(const ParkingEvent & event)
+{
+    if (event.type == ParkingEventType::Parked || event.type == ParkingEventType::Released || event.type == ParkingEventType::Full)
     {
-        m_bus_count += change;
+        int occupancy = m_count[toIndex(event.vehicle_type)].value.load(std::memory_order_relaxed);
+        std::atomic_load(&m_analytics)->record(event, occupancy);
+        std::atomic_load(&m_forecaster)->record(event, occupancy);
     }
+    std::shared_ptr<ParkingEventSink> event_sink = std::atomic_load(&m_event_sink);
+    event_sink->onEvent(event);
 }
 
-int ParkingLot::getTicketIDByLicensePlate(const std::string & license_plate)
+TicketID ParkingLot::generateTicketID(Shard & shard)
 {
-    std::lock_guard<std::mutex> lock(instance_mutex_);
+    // Every shard issues the sequence numbers of its own block, the shard index in the low part
+    // keeps IDs unique across shards and tells which shard stores the vehicle
+    if (shard.ticket_block.empty())
+    {
+        shard.ticket_block = m_ticket_generator->nextBlock();
+    }
+    TicketID shard_index = static_cast<TicketID>(&shard - m_shards.data());
+    return shard.ticket_block.first++ * kShardCount + shard_index;
+}
+
+void ParkingLot::updateCount(const VehicleType vehicle_type, int change)
+{
+    m_count[toIndex(vehicle_type)].value.fetch_add(change, std::memory_order_acq_rel);
+}
+
+TicketID ParkingLot::getTicketIDByLicensePlate(const std::string_view license_plate)
+{
+    ParkingResult result = tryGetTicketIDByLicensePlate(license_plate);
+    if (result.status == ParkingEventType::NotFound)
+    {
+        throw VehicleNotFoundException("Vehicle with license plate " + std::string(license_plate) + " is not found in the parking lot.");
+    }
+    return result.ticket_id;
+}
+
+ParkingResult ParkingLot::tryGetTicketIDByLicensePlate(const std::string_view license_plate)
+{
+    MetricsSample sample(m_metrics_sample_period.load(std::memory_order_relaxed));
+    std::uint64_t license_plate_hash = LicensePlate::hash(license_plate);
+    Shard & shard = shardForLicensePlate(license_plate_hash);
+    MeteredLock lock(shard.mutex, shard.metrics);
+
+    std::uint32_t slot = shard.parked_vehicles.findByLicensePlate(license_plate, license_plate_hash);
+    if (slot != ParkedVehicleTable::kNotFound)
+    {
+        const ParkedRecord & record = shard.parked_vehicles.record(slot);
+        return ParkingResult{ ParkingEventType::Parked, record.ticket_id, 0.0, record.bay };
+    }
+    return ParkingResult{ ParkingEventType::NotFound };
+}
+
+std::vector<ParkedRecord> ParkingLot::findVehiclesByLicensePlatePrefix(const std::string_view prefix, const std::size_t max_results)
+{
+    // Every shard returns its first vehicles in license plate order, the overall first ones are among them
+    std::vector<ParkedRecord> records;
+    std::vector<std::uint32_t> slots;
+    for (auto & shard : m_shards)
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        slots.clear();
+        shard.parked_vehicles.findByLicensePlatePrefix(prefix, max_results, slots);
+        for (std::uint32_t slot : slots)
+        {
+            records.push_back(shard.parked_vehicles.record(slot));
+        }
+    }
+
+    std::sort(records.begin(), records.end(), [](const ParkedRecord & left, const ParkedRecord & right)
+    {
+        return left.license_plate.view() < right.license_plate.view();
+    });
+    records.resize(std::min(records.size(), max_results));
+    return records;
+}
+
+std::vector<LicensePlateMatch> ParkingLot::findVehiclesByApproximateLicensePlate(const std::string_view license_plate, const int max_distance,
+                                                                                 const std::size_t max_results)
+{
+    std::vector<LicensePlateMatch> found;
+    std::vector<std::pair<std::uint32_t, int>> matches;
+    std::vector<std::shared_ptr<const ParkedRecordPage>> pages;
+    for (auto & shard : m_shards)
+    {
+        // The tree and the pages are shared under the mutex and searched without it,
+        // a gate that changes the shard meanwhile goes on with copies
+        std::shared_ptr<const LicensePlateTrie> license_plate_trie;
+        pages.clear();
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            license_plate_trie = shard.parked_vehicles.shareLicensePlateTrie();
+            shard.parked_vehicles.sharePages(pages);
+        }
+
+        matches.clear();
+        license_plate_trie->findWithin(license_plate, max_distance, matches);
+        license_plate_trie.reset();
+        for (const auto & match : matches)
+        {
+            const ParkedRecordPage & page = *pages[match.first / ParkedRecordPage::kSize];
+            found.push_back(LicensePlateMatch{ page.records[match.first % ParkedRecordPage::kSize], match.second });
+        }
+    }
+
+    std::sort(found.begin(), found.end(), [](const LicensePlateMatch & left, const LicensePlateMatch & right)
+    {
+        return left.distance != right.distance ? left.distance < right.distance : left.record.license_plate.view() < right.record.license_plate.view();
+    });
+    found.resize(std::min(found.size(), max_results));
+    return found;
+}
+
+ParkedVehicleSnapshot ParkingLot::getParkedVehicleSnapshot()
+{
+    std::vector<std::unique_lock<std::mutex>> locks = lockAllShards();
+    return shareParkedVehicles();
+}
+
+MetricsSnapshot ParkingLot::getMetricsSnapshot() const
+{
+    MetricsSnapshot snapshot;
+    for (const auto & shard : m_shards)
+    {
+        shard.metrics.addTo(snapshot);
+    }
+    return snapshot;
+}
+
+void ParkingLot::setMetricsSamplePeriod(const unsigned period)
+{
+    m_metrics_sample_period.store(period == 0 ? 1 : period, std::memory_order_relaxed);
+}
+
+void ParkingLot::setEventSink(const std::shared_ptr<ParkingEventSink> & event_sink)
+{
+    std::shared_ptr<ParkingEventSink> sink = event_sink ? event_sink : std::make_shared<NullEventSink>();
+    std::atomic_store(&m_event_sink, sink);
+}
+
+void ParkingLot::setTariffs(const TariffTable & tariffs)
+{
+    std::shared_ptr<const TariffTable> new_tariffs = std::make_shared<const TariffTable>(tariffs);
+    std::atomic_store(&m_tariffs, new_tariffs);
+}
+
+void ParkingLot::setClock(const BillingClock clock)
+{
+    m_clock.store(clock ? clock : &systemClockMicroseconds, std::memory_order_relaxed);
+}
+
+void ParkingLot::setTicketGenerator(const std::shared_ptr<TicketGenerator> & ticket_generator)
+{
+    std::vector<std::unique_lock<std::mutex>> locks = lockAllShards();
+    ticket_generator->advancePast(m_ticket_generator->nextSequence() - 1);
+    m_ticket_generator = ticket_generator;
+    for (auto & shard : m_shards)
+    {
+        shard.ticket_block = TicketBlock();
+    }
+}
+
+void ParkingLot::flushLog()
+{
+    m_logger->flush();
+}
+
+JournalRecoveryStats ParkingLot::openJournal(const JournalConfig & config)
+{
+    if (m_journal)
+    {
+        throw JournalException("The journal is already open.");
+    }
+
+    JournalRecoveryStats stats;
+    std::vector<std::uint64_t> snapshot_generations = Journal::listGenerations(config, true);
+    std::vector<std::uint64_t> journal_generations = Journal::listGenerations(config, false);
+
+    // A damaged snapshot can only be a disk fault, the older one and its journals are the best that is left
+    JournalSnapshot snapshot;
+    std::uint64_t base_generation = 0;
+    for (auto it = snapshot_generations.rbegin(); it != snapshot_generations.rend(); ++it)
+    {
+        if (Journal::readSnapshot(Journal::snapshotPath(config, *it), snapshot))
+        {
+            base_generation = *it;
+            break;
+        }
+        snapshot = JournalSnapshot();
+    }
+
+    std::uint64_t last_generation = base_generation;
+    if (!snapshot_generations.empty())
+    {
+        last_generation = std::max(last_generation, snapshot_generations.back());
+    }
+    {
+        std::vector<std::unique_lock<std::mutex>> locks = lockAllShards();
+        m_ticket_generator->advancePast(snapshot.next_ticket_sequence - 1);
+        for (const auto & record : snapshot.records)
+        {
+            replayJournalRecord(JournalRecordKind::Park, record);
+        }
+        stats.snapshot_records = snapshot.records.size();
+
+        for (std::uint64_t generation : journal_generations)
+        {
+            if (generation >= base_generation)
+            {
+                stats.journal_records += Journal::replay(Journal::journalPath(config, generation),
+                    [this](JournalRecordKind kind, const ParkedRecord & record) { replayJournalRecord(kind, record); });
+                last_generation = std::max(last_generation, generation);
+            }
+        }
+
+        // Blocks taken before the restore may hold sequence numbers of restored tickets
+        for (auto & shard : m_shards)
+        {
+            shard.ticket_block = TicketBlock();
+        }
+
+        // The restored state becomes the snapshot of a new generation, which also drops a torn journal tail
+        m_journal.reset(new Journal(config, last_generation + 1));
+        snapshot = makeJournalSnapshot(shareParkedVehicles(), m_ticket_generator->nextSequence());
+    }
+    stats.parked_vehicles = snapshot.records.size();
+    writeSnapshot(last_generation + 1, snapshot);
+    return stats;
+}
+
+void ParkingLot::checkpoint()
+{
+    if (!m_journal)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> checkpoint_lock(m_checkpoint_mutex);
+    std::uint64_t generation = m_journal->generation() + 1;
+    m_journal->prepareRotation(generation);
+
+    ParkedVehicleSnapshot parked_vehicles;
+    TicketID next_ticket_sequence = 0;
+    {
+        // Records are appended with a shard mutex held, so none is appended while the journal is rotated.
+        // The gates only wait for the files to be swapped, the records are written and copied after they are running again.
+        std::vector<std::unique_lock<std::mutex>> locks = lockAllShards();
+        next_ticket_sequence = m_ticket_generator->nextSequence();
+        parked_vehicles = shareParkedVehicles();
+        m_journal->rotate();
+    }
+    m_journal->finishRotation();
+    writeSnapshot(generation, makeJournalSnapshot(parked_vehicles, next_ticket_sequence));
+}
+
+std::vector<std::unique_lock<std::mutex>> ParkingLot::lockAllShards()
+{
+    std::vector<std::unique_lock<std::mutex>> locks;
+    locks.reserve(kShardCount);
+    for (auto & shard : m_shards)
+    {
+        locks.emplace_back(shard.mutex);
+    }
+    return locks;
+}
+
+ParkedVehicleSnapshot ParkingLot::shareParkedVehicles()
+{
+    std::vector<std::shared_ptr<const ParkedRecordPage>> pages;
+    std::size_t size = 0;
+    for (auto & shard : m_shards)
+    {
+        shard.parked_vehicles.sharePages(pages);
+        size += shard.parked_vehicles.size();
+    }
+    return ParkedVehicleSnapshot(std::move(pages), size, m_clock.load(std::memory_order_relaxed)());
+}
+
+JournalSnapshot ParkingLot::makeJournalSnapshot(const ParkedVehicleSnapshot & parked_vehicles, const TicketID next_ticket_sequence)
+{
+    JournalSnapshot snapshot;
+    snapshot.next_ticket_sequence = next_ticket_sequence;
+    snapshot.records.assign(parked_vehicles.begin(), parked_vehicles.end());
+    return snapshot;
+}
+
+void ParkingLot::writeSnapshot(const std::uint64_t generation, const JournalSnapshot & snapshot)
+{
+    const JournalConfig & config = m_journal->config();
+    Journal::writeSnapshot(Journal::snapshotPath(config, generation), snapshot, config.sync);
+
+    // The new snapshot replaces everything before it
+    std::error_code error;
+    for (std::uint64_t old_generation : Journal::listGenerations(config, true))
+    {
+        if (old_generation < generation)
+        {
+            std::filesystem::remove(Journal::snapshotPath(config, old_generation), error);
+        }
+    }
+    for (std::uint64_t old_generation : Journal::listGenerations(config, false))
+    {
+        if (old_generation < generation)
+        {
+            std::filesystem::remove(Journal::journalPath(config, old_generation), error);
+        }
+    }
+}
+
+void ParkingLot::restoreRecord(Shard & shard, const ParkedRecord & record)
+{
+    ParkedRecord restored = record;
+    std::size_t index = toIndex(record.type);
+    if (m_zones)
+    {
+        if (!m_zones->acquire(restored.bay))
+        {
+            restored.bay = m_zones->allocate(record.type);
+        }
+    }
+    else
+    {
+        BayAllocator & bays = m_bays[index];
+        if (restored.bay < 1 || restored.bay > bays.bayCount() || !bays.acquire(restored.bay - 1))
+        {
+            int bay = bays.allocate();
+            restored.bay = bay == BayAllocator::kNoBay ? 0 : bay + 1;
+        }
+    }
+
+    // Restored vehicles are counted even beyond a capacity that was lowered meanwhile, no new ones are let in then
+    m_count[index].value.fetch_add(1, std::memory_order_acq_rel);
+    shard.parked_vehicles.insert(restored, LicensePlate::hash(restored.license_plate.view()));
+    m_ticket_generator->advancePast(restored.ticket_id / kShardCount);
+}
 
-    auto it = m_parked_vehicles.find(license_plate);
-    if (it != m_parked_vehicles.end())
+void ParkingLot::replayJournalRecord(const JournalRecordKind kind, const ParkedRecord & record)
+{
+    if (kind == JournalRecordKind::Park)
     {
-        return it->second.second;
+        std::uint64_t license_plate_hash = LicensePlate::hash(record.license_plate.view());
+        Shard & shard = shardForLicensePlate(license_plate_hash);
+        if (shard.parked_vehicles.findByLicensePlate(record.license_plate.view(), license_plate_hash) == ParkedVehicleTable::kNotFound)
+        {
+            restoreRecord(shard, record);
+        }
     }
     else
     {
-        throw VehicleNotFoundException("Vehicle with license plate " + license_plate + " is not found in the parking lot.");
-    } 
+        Shard * shard = shardForTicketID(record.ticket_id);
+        std::uint32_t slot = shard ? shard->parked_vehicles.findByTicketID(record.ticket_id) : ParkedVehicleTable::kNotFound;
+        if (slot != ParkedVehicleTable::kNotFound)
+        {
+            releaseSlot(*shard, slot);
+        }
+    }
+}
+
+bool ParkingLot::syncJournal()
+{
+    if (!m_journal)
+    {
+        return true;
+    }
+    try
+    {
+        m_journal->waitDurable(m_journal->lastSequence());
+    }
+    catch (const JournalException &)
+    {
+        // The vehicle went through the gate, the change stays in memory and is reported as not durable
+        return false;
+    }
+    return true;
+}
+
+bool ParkingLot::checkpointIfDue()
+{
+    // A failed journal cannot be rotated, the gates already report their changes as not durable
+    if (!m_journal || m_journal->failed())
+    {
+        return true;
+    }
+
+    std::size_t snapshot_interval = m_journal->config().snapshot_interval;
+    bool checkpointed = true;
+    if (snapshot_interval > 0 && m_journal->recordsSinceRotation() >= snapshot_interval && !m_checkpointing.exchange(true))
+    {
+        try
+        {
+            checkpoint();
+        }
+        catch (const JournalException &)
+        {
+            // The vehicle went through the gate, like in syncJournal the failure is reported as not durable
+            checkpointed = false;
+        }
+        catch (...)
+        {
+            m_checkpointing.store(false);
+            throw;
+        }
+        m_checkpointing.store(false);
+    }
+    return checkpointed;
 }
\ No newline at end of file
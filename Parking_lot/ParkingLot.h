@@ -1,15 +1,36 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <cstdint>
 #include <memory>
-#include <unordered_map>
 #include <mutex>
+#include <string_view>
+#include <vector>
 
+#include "AsyncLogger.h"
+#include "BayAllocator.h"
+#include "BookingCalendar.h"
+#include "GateMetrics.h"
+#include "Journal.h"
+#include "MetricsSnapshot.h"
+#include "OccupancyAnalytics.h"
+#include "OccupancyForecaster.h"
+#include "OccupancySnapshot.h"
+#include "ParkedVehicleSnapshot.h"
+#include "ParkedVehicleTable.h"
+#include "ParkingEventSink.h"
+#include "ParkingResult.h"
+#include "TariffTable.h"
+#include "TicketGenerator.h"
 #include "Vehicle.h"
+#include "ZonedBayAllocator.h"
 
 /// \brief Singleton class representing a parking lot
 /// The Singleton pattern ensures that there is only one instance of the ParkingLot class throughout the application.
 /// This is important for managing a centralized parking lot system where all vehicles are parked and released from a single location.
 /// The Singleton pattern ensures that all threads and parts of the program access the same parking lot instance, preventing inconsistencies and resource conflicts.
+/// Processes that operate several parking lots create them through a ParkingSiteManager instead.
 class ParkingLot
 {
 public:
@@ -17,26 +38,179 @@ public:
     /// \param[in] car_capacity Capacity of the vehicles of type Car
     /// \param[in] motorcycle_capacity Capacity of the vehicles of type Motorcycle
     /// \param[in] bus_capacity Capacity of the vehicles of type Bus
+    /// \param[in] log_config Settings of the entry/exit log
     /// \return Returns shared pointer to the ParkingLot instance
-    static std::shared_ptr<ParkingLot> getInstance(int car_capacity = 10, int motorcycle_capacity = 15, int bus_capacity = 5);
+    static std::shared_ptr<ParkingLot> getInstance(int car_capacity = 10, int motorcycle_capacity = 15, int bus_capacity = 5,
+                                                   const AsyncLoggerConfig & log_config = AsyncLoggerConfig());
 
-    /// \brief Parks a vehicle in the parking lot
+    /// \brief Destructor, writes all pending log entries to the log file
+    ~ParkingLot();
+
+    /// \brief Parks a vehicle in the parking lot, see tryParkVehicle for the non-throwing version
     /// \param[in] vehicle Shared pointer to a certain vehicle to park
     /// \return Returns true if the vehicle was successfully parked, false otherwise.
-    /// \throw Throws ParkingLotFullException if the parking lot is full for the vehicle type
+    /// \throw Throws ParkingLotFullException if the parking lot is full for the vehicle type, TicketGeneratorException if
+    /// no ticket can be issued, JournalException if the vehicle was parked but its journal record could not be written,
+    /// and what tryParkVehicle throws
     bool parkVehicle(const std::shared_ptr<Vehicle> & vehicle);
 
     /// \brief Releases a vehicle from the parking lot by ticket ID
     /// \param[in] ticket_id Ticket ID of the vehicle to be released
     /// \return Returns true if the vehicle was successfully released, false otherwise.
-    /// \throw Throws VehicleNotFoundException if the vehicle with the given ticket ID is not found.
-    bool releaseVehicleByTicketID(const int ticket_id);
+    /// \throw Throws VehicleNotFoundException if the vehicle with the given ticket ID is not found, JournalException
+    /// if the vehicle was released but its journal record could not be written, and what tryReleaseVehicleByTicketID throws
+    bool releaseVehicleByTicketID(const TicketID ticket_id);
 
     /// \brief Releases a vehicle from the parking lot by license plate
     /// \param[in] license_plate License plate of the vehicle to be released
     /// \return Returns true if the vehicle was successfully released, false otherwise.
-    /// \throw Throws VehicleNotFoundException if the vehicle with the given ticket ID is not found.
-    bool releaseVehicleByLicensePlate(const std::string & license_plate);
+    /// \throw Throws VehicleNotFoundException if the vehicle with the given license plate is not found, JournalException
+    /// if the vehicle was released but its journal record could not be written, and what tryReleaseVehicleByLicensePlate throws
+    bool releaseVehicleByLicensePlate(const std::string_view license_plate);
+
+    /// \brief Parks a vehicle in the parking lot, reporting the usual outcomes without throwing
+    /// A journal or automatic snapshot that cannot be written does not undo the parking, the result reports it with durable false.
+    /// \param[in] vehicle Shared pointer to a certain vehicle to park
+    /// \return Returns the result with status Parked, the ticket ID and the assigned bay, or status AlreadyParked, Full,
+    /// or NoTicket if the TicketGenerator cannot reserve ticket numbers
+    /// \throw Throws InvalidVehicleTypeException for an invalid vehicle type and whatever the event sink throws
+    ParkingResult tryParkVehicle(const std::shared_ptr<Vehicle> & vehicle);
+
+    /// \brief Releases a vehicle from the parking lot by ticket ID, reporting the usual outcomes without throwing
+    /// A journal or automatic snapshot that cannot be written does not undo the release, the result reports it with durable false.
+    /// \param[in] ticket_id Ticket ID of the vehicle to be released
+    /// \return Returns the result with status Released and the charge, or status NotFound
+    /// \throw Throws whatever the event sink throws
+    ParkingResult tryReleaseVehicleByTicketID(const TicketID ticket_id);
+
+    /// \brief Releases a vehicle from the parking lot by license plate, reporting the usual outcomes without throwing
+    /// A journal or automatic snapshot that cannot be written does not undo the release, the result reports it with durable false.
+    /// \param[in] license_plate License plate of the vehicle to be released
+    /// \return Returns the result with status Released and the charge, or status NotFound
+    /// \throw Throws like tryReleaseVehicleByTicketID
+    ParkingResult tryReleaseVehicleByLicensePlate(const std::string_view license_plate);
+
+    /// \brief Parks a group of vehicles, e.g. a burst of arrivals reported by a gate controller
+    /// Every shard is locked once for all vehicles it stores and their entries are logged together.
+    /// \param[in] vehicles Vehicles to park
+    /// \return Returns the result for every vehicle in the same order, a full parking lot is reported as
+    /// ParkingEventType::Full instead of throwing ParkingLotFullException
+    /// \throw Throws like tryParkVehicle, the vehicles parked before the failure are logged and their events emitted first
+    std::vector<ParkingResult> parkVehicles(const std::vector<std::shared_ptr<Vehicle>> & vehicles);
+
+    /// \brief Releases a group of vehicles by license plate, e.g. a burst of departures reported by a gate controller
+    /// Every shard is locked once for all vehicles it stores and their exits are logged together.
+    /// \param[in] license_plates License plates of the vehicles to release
+    /// \return Returns the result for every license plate in the same order, an unknown license plate is reported as
+    /// ParkingEventType::NotFound instead of throwing VehicleNotFoundException
+    /// \throw Throws like tryReleaseVehicleByTicketID, the vehicles released before the failure are logged and their events emitted first
+    std::vector<ParkingResult> releaseVehicles(const std::vector<std::string> & license_plates);
+
+    /// \brief Gets the occupancy of a vehicle type without locking, safe to poll at any rate while gates are busy
+    /// \param[in] vehicle_type Vehicle type to query
+    /// \return Returns the capacity and the number of occupied bays
+    VehicleTypeOccupancy getOccupancy(const VehicleType vehicle_type) const;
+
+    /// \brief Gets the occupancy of all vehicle types without locking, see getOccupancy
+    OccupancySnapshot getOccupancySnapshot() const;
+
+    /// \brief Gets the vehicles parked now, e.g. to list all buses or the vehicles parked for more than a day
+    /// The gates wait only while the shards' pages of records are shared with the snapshot, not while it is read:
+    /// they copy a page before changing it. Taking the snapshot costs about a pointer per 256 parked vehicles.
+    /// \return Returns the snapshot, which can be read from any thread and kept as long as needed
+    ParkedVehicleSnapshot getParkedVehicleSnapshot();
+
+    /// \brief Gets the counters and latency histograms of the gate operations without locking, see MetricsSnapshot::toText
+    /// Park and release attempts are counted per outcome (a Full outcome is what parkVehicle reports with
+    /// ParkingLotFullException) and a sample of them is timed from the call until the event was passed to the sink;
+    /// the time spent waiting for and holding the shard mutexes and logging is recorded separately.
+    MetricsSnapshot getMetricsSnapshot() const;
+
+    /// \brief Sets how often single park, release and lookup operations are timed, see MetricsSample
+    /// \param[in] period 1 to time every operation, kDefaultMetricsSamplePeriod by default
+    void setMetricsSamplePeriod(const unsigned period);
+
+    /// Every eighth operation of a gate thread is timed by default
+    static const unsigned kDefaultMetricsSamplePeriod = 8;
+
+    /// \brief Books a bay for a vehicle during an interval, the bay is held from its start until the vehicle arrives
+    /// While a booking holds a bay, parkVehicle does not give it to other vehicles; when the booked vehicle arrives
+    /// within the interval it is parked in the held bay and the booking ends. Vehicles already parked when a booking
+    /// starts are not moved, so a booking that starts now needs a bay that is free now.
+    /// \param[in] vehicle_type Vehicle type
+    /// \param[in] license_plate License plate of the vehicle
+    /// \param[in] from_us Start of the interval, microseconds since 1970-01-01 UTC
+    /// \param[in] to_us End of the interval (exclusive), microseconds since 1970-01-01 UTC
+    /// \return Returns the booking ID
+    /// \throw Throws ParkingLotFullException if all bays of the vehicle type are booked at some time of the interval,
+    /// BookingException if the interval is empty, over or beyond the booking horizon
+    BookingID bookBay(const VehicleType vehicle_type, const std::string_view license_plate, const std::int64_t from_us, const std::int64_t to_us);
+
+    /// \brief Books a bay like bookBay without throwing ParkingLotFullException
+    /// \return Returns the booking ID or kNoBooking if the bays are booked out
+    /// \throw Throws BookingException if the interval is empty, over or beyond the booking horizon
+    BookingID tryBookBay(const VehicleType vehicle_type, const std::string_view license_plate, const std::int64_t from_us, const std::int64_t to_us);
+
+    /// \brief Cancels a booking, its bay is free again
+    /// \return Returns false if the booking is unknown, over or its vehicle has arrived
+    bool cancelBooking(const BookingID booking_id);
+
+    /// \brief Gets the number of bays of a vehicle type that can still be booked for the whole interval
+    /// \return Returns the bays not booked at any time of the interval; if the interval has started, the parked vehicles count too
+    /// \throw Throws BookingException if the interval is empty, over or beyond the booking horizon
+    int getBookableBays(const VehicleType vehicle_type, const std::int64_t from_us, const std::int64_t to_us);
+
+    /// \brief Sets the time buckets bookings are tracked in and discards all bookings, should be called before the gates start
+    /// \param[in] config Length and number of the buckets, 15 minutes for 90 days by default
+    void setBookingConfig(const BookingConfig & config);
+
+    /// \brief Replaces the bays of the vehicle types with floors and zones of bays of different kinds, must be called
+    /// before any vehicle is parked
+    /// A vehicle is parked in a zone the policy picks among those with a free bay of its type's first bay kind that
+    /// has one, so it falls back to e.g. bus bays when the car bays are full; only when all its bay kinds are full it is
+    /// turned away. Bays are numbered across the lot, see getBayLocation. The capacity of a vehicle type becomes the
+    /// bays of all its kinds, bays shared with other types included, and bookings are checked against it; the bookings
+    /// made so far are discarded.
+    /// \param[in] topology Zones and the bay kinds of every vehicle type
+    /// \param[in] policy Rules that pick the zone, NearestToExitPolicy by default
+    void setTopology(const LotTopology & topology, const std::shared_ptr<const BayAllocationPolicy> & policy = std::make_shared<NearestToExitPolicy>());
+
+    /// \brief Gets the floor, zone and kind of a bay returned by a park
+    /// \return Returns a location with zone LotTopology::kNoZone if no topology is set or the bay is unknown
+    BayLocation getBayLocation(const int bay) const;
+
+    /// \brief Gets the highest number of parked vehicles of a type during the last window_us microseconds
+    /// \param[in] window_us Length of the window, e.g. one hour; widened to whole analytics buckets and limited to the buckets kept
+    int getPeakOccupancy(const VehicleType vehicle_type, const std::int64_t window_us);
+
+    /// \brief Gets the lowest and highest occupancy of a vehicle type per analytics bucket of the last window_us microseconds
+    /// \return Returns the buckets oldest first
+    std::vector<OccupancySample> getOccupancyHistory(const VehicleType vehicle_type, const std::int64_t window_us);
+
+    /// \brief Gets how long the vehicles of a type that left during the last window_us microseconds stayed
+    /// \return Returns a sketch of the dwell times, e.g. getDwellTimes(VehicleType::Bus, since_midnight_us).percentile(95)
+    DwellTimeSketch getDwellTimes(const VehicleType vehicle_type, const std::int64_t window_us);
+
+    /// \brief Sets the time buckets of the occupancy and dwell time analytics and discards what was counted, may be called while gates are running
+    /// \param[in] config Length and number of the buckets, 5 minutes for one day by default
+    void setAnalyticsConfig(const AnalyticsConfig & config);
+
+    /// \brief Gets the time until the bays of a vehicle type are projected to be full, e.g. to divert traffic before arrivals are turned away
+    /// The projection starts from the vehicles parked now and the bays held for bookings and follows the arrival and
+    /// departure rates learned for every time of day from the events of this lot.
+    /// \param[in] horizon_us How far to look ahead, one day by default
+    /// \return Returns the time in microseconds, 0 if full now, or OccupancyForecaster::kNotFull if not full within the horizon
+    std::int64_t getTimeToFull(const VehicleType vehicle_type, const std::int64_t horizon_us = kDefaultForecastHorizon);
+
+    /// \brief Gets the projected number of taken bays of a vehicle type at the end of every forecast slot within the horizon
+    std::vector<OccupancyForecast> getOccupancyForecast(const VehicleType vehicle_type, const std::int64_t horizon_us = kDefaultForecastHorizon);
+
+    /// \brief Sets the time-of-day slots and smoothing of the forecast and discards what was learned, may be called while gates are running
+    /// \param[in] config Slot length, smoothing and time zone, 15 minute slots by default
+    void setForecastConfig(const ForecastConfig & config);
+
+    /// The forecast looks one day ahead by default
+    static const std::int64_t kDefaultForecastHorizon = 24ll * 3600 * 1000000;
 
     /// \brief Query and print the available parking slots for Cars
     void queryAvailableCarsSlots();
@@ -49,11 +223,71 @@ public:
 
     /// \brief Serches for ticket ID by License Plate
     /// \param[in] license_plate License plate of the vehicle to be released
-    /// \return Returns ticket ID as int
+    /// \return Returns ticket ID
     /// \throw Throws VehicleNotFoundException if license plate is not found
-    int getTicketIDByLicensePlate(const std::string & license_plate);
+    TicketID getTicketIDByLicensePlate(const std::string_view license_plate);
+
+    /// \brief Serches for ticket ID by License Plate without throwing
+    /// \param[in] license_plate License plate of the vehicle
+    /// \return Returns the result with status Parked, the ticket ID and the bay, or status NotFound
+    ParkingResult tryGetTicketIDByLicensePlate(const std::string_view license_plate);
+
+    /// \brief Finds the parked vehicles whose license plate starts with the given text, e.g. a partial plate noted by staff
+    /// \param[in] prefix Beginning of the license plate, an empty prefix matches every parked vehicle
+    /// \param[in] max_results Maximum number of vehicles returned
+    /// \return Returns the vehicles sorted by license plate
+    std::vector<ParkedRecord> findVehiclesByLicensePlatePrefix(const std::string_view prefix, const std::size_t max_results = kDefaultMaxSearchResults);
+
+    /// \brief Finds the parked vehicles whose license plate is at most max_distance characters inserted, deleted or
+    /// replaced away from the given one, e.g. a plate misread by a camera
+    /// \param[in] license_plate License plate as read
+    /// \param[in] max_distance Maximum number of wrong characters, at most LicensePlateTrie::kMaxDistance
+    /// \param[in] max_results Maximum number of vehicles returned
+    /// \return Returns the vehicles sorted by distance and license plate, an exact match comes first
+    std::vector<LicensePlateMatch> findVehiclesByApproximateLicensePlate(const std::string_view license_plate, const int max_distance = 1,
+                                                                         const std::size_t max_results = kDefaultMaxSearchResults);
+
+    /// Number of vehicles the license plate searches return by default
+    static const std::size_t kDefaultMaxSearchResults = 100;
+
+    /// \brief Sets the receiver of the park and release events, by default they are printed to the console
+    /// \param[in] event_sink Event sink, for example NullEventSink, ConsoleEventSink or BufferedEventSink
+    void setEventSink(const std::shared_ptr<ParkingEventSink> & event_sink);
+
+    /// \brief Sets the rates charged when vehicles are released, safe to call while gates are running
+    /// \param[in] tariffs Tariff table, e.g. loaded with TariffTable::load; by default the built-in rates apply
+    void setTariffs(const TariffTable & tariffs);
+
+    /// \brief Sets the clock the entry and exit times are taken from, e.g. a simulated clock in tests
+    /// \param[in] clock Clock, systemClockMicroseconds by default
+    void setClock(const BillingClock clock);
+
+    /// \brief Sets the source of the ticket sequence numbers, by default every lot has its own in-memory generator
+    /// Lots sharing a generator issue ticket IDs that are unique across all of them; a generator with a state file
+    /// keeps ticket IDs unique across restarts. Should be called before any vehicle is parked.
+    /// \param[in] ticket_generator Ticket generator, IDs already issued by this lot are not issued again
+    void setTicketGenerator(const std::shared_ptr<TicketGenerator> & ticket_generator);
+
+    /// \brief Blocks until all log entries of the vehicles parked or released so far are written to the log file
+    void flushLog();
+
+    /// \brief Restores the parked vehicles from the journal files and starts journaling every park and release
+    /// The newest snapshot is loaded and the journal written after it is replayed. From then on a park or release
+    /// returns once its journal record is written. Must be called before any vehicle is parked or released.
+    /// \param[in] config Location and settings of the journal
+    /// \return Returns what was restored
+    /// \throw Throws JournalException if the journal is already open or its files cannot be written
+    JournalRecoveryStats openJournal(const JournalConfig & config);
+
+    /// \brief Writes a snapshot of the parked vehicles and starts a new journal file, older files are deleted
+    /// Called automatically every JournalConfig::snapshot_interval records. Does nothing without a journal.
+    /// \throw Throws JournalException if the snapshot cannot be written
+    void checkpoint();
 
 private:
+    /// Creates the lots of the sites it manages, each with its own capacities and log
+    friend class ParkingSiteManager;
+
     /// \brief Constructor with default values
     ParkingLot();
 
@@ -61,46 +295,194 @@ private:
     /// \param[in] car_capacity Capacity of the cars
     /// \param[in] motorcycle_capacity Capacity of the motorcycles
     /// \param[in] bus_capacity Capacity of the buses
-    ParkingLot(const int car_capacity, const int motorcycle_capacity, const int bus_capacity);
+    /// \param[in] log_config Settings of the entry/exit log
+    ParkingLot(const int car_capacity, const int motorcycle_capacity, const int bus_capacity, const AsyncLoggerConfig & log_config);
 
-    /// \brief Checks if parking is full for a specific vehicle type
+    /// \brief Reserves a parking slot for a specific vehicle type if there is a free one
+    /// Slots held for bookings are only given to the booked vehicle; its booking stops holding the slot as soon as the
+    /// vehicle is counted and is claimed once the vehicle is parked, or holds the slot again with unreserveSlot.
     /// \param[in] vehicle_type Cpecific vehicle type (Car, Motorcycle, Bus)
-    /// \return Returns True if parking is full for the given vehicle type, false otherwise
+    /// \param[in] license_plate License plate of the vehicle, to find its booking
+    /// \param[in] now_us Current time, microseconds since 1970-01-01 UTC
+    /// \param[out] booking_id Receives the booking whose held slot was reserved and that BookingCalendar::arrive marked, or kNoBooking
+    /// \return Returns True if the slot was reserved, false if parking is full for the given vehicle type
     /// \throw Throws InvalidVehicleTypeException if an invalid vehicle type is provided
-    bool isParkingFull(const std::string & vehicle_type);
+    bool tryReserveSlot(const VehicleType vehicle_type, const std::string_view license_plate, const std::int64_t now_us, BookingID & booking_id);
+
+    /// \brief Gives back a slot reserved with tryReserveSlot for a vehicle turned away before it was parked,
+    /// its booking holds the slot again
+    void unreserveSlot(const VehicleType vehicle_type, const BookingID booking_id);
+
+    /// \brief Takes the lowest free bay for a vehicle type, a slot must have been reserved with tryReserveSlot
+    /// \return Returns the bay number, starting at 1; with a topology 0 if the bays the vehicle type shares with others are taken
+    int allocateBay(const VehicleType vehicle_type);
 
-    /// \brief Calculates the parking charge for a vehicle
-    /// \param[in] vehicle Shared pointer to the Vehicle for which to calculate the charge
+    /// \brief Takes a bay for the vehicle of a Parked event after its slot was reserved, releasing the slot if there is none
+    /// \return Returns false if the vehicle type's bays are taken, the event keeps bay 0 then
+    bool tryAllocateBay(ParkingEvent & event, const BookingID booking_id);
+
+    /// \brief Frees a bay taken by allocateBay or restoreRecord
+    void releaseBay(const VehicleType vehicle_type, const int bay);
+
+    /// \brief Calculates the parking charge for a vehicle from its entry time and the exit time
+    /// \param[in] record Parked vehicle for which to calculate the charge
+    /// \param[in] exit_time_us Time the vehicle leaves, microseconds since 1970-01-01 UTC
     /// \return Returns a parking charge as a double
     /// \throw Throws InvalidVehicleTypeException if an invalid vehicle type is encountered
-    double calculateCharge(const std::shared_ptr<Vehicle> & vehicle);
+    double calculateCharge(const ParkedRecord & record, const std::int64_t exit_time_us);
+
+    /// A part of the parked vehicles guarded by its own mutex, the shard is chosen by the license plate hash
+    struct alignas(64) Shard
+    {
+        std::mutex mutex;
+
+        /// Indexed by license plate and by ticket ID, the vehicles themselves are not kept
+        ParkedVehicleTable parked_vehicles;
+
+        /// Sequence numbers left of the block taken from the ticket generator
+        TicketBlock ticket_block;
+
+        /// Updated without the mutex, also for the time spent waiting for it
+        GateMetrics metrics;
+    };
+
+    /// \brief Queues a vehicle entry or exit for the log writer thread, must be called with the shard mutex held
+    /// \param[in] shard Shard of the vehicle, its metrics receive the time the logging took
+    /// \param[in] event Outcome of the park or release, only Parked and Released are logged
+    void logEntry(Shard & shard, const ParkingEvent & event);
+
+    /// \brief Gets the shard that stores a vehicle with the given license plate
+    /// \param[in] license_plate_hash LicensePlate::hash of the license plate, its high half picks the shard
+    /// while the low half is left to the ParkedVehicleTable indexes
+    Shard & shardForLicensePlate(const std::uint64_t license_plate_hash);
+
+    /// \brief Gets the shard that issued the given ticket ID
+    /// \return Returns nullptr if no shard could have issued the ticket ID
+    Shard * shardForTicketID(const TicketID ticket_id);
+
+    /// \brief Parks a vehicle in the given shard, must be called with the shard mutex held
+    /// \return Returns the Parked, AlreadyParked, Full or NoTicket event
+    ParkingEvent parkInShard(Shard & shard, const std::shared_ptr<Vehicle> & vehicle);
+
+    /// \brief Releases a vehicle from the given shard, must be called with the shard mutex held
+    /// \return Returns the Released or NotFound event
+    ParkingEvent releaseFromShard(Shard & shard, const std::string_view license_plate);
+
+    /// \brief Releases the vehicle stored in the given slot of the shard, must be called with the shard mutex held
+    /// \return Returns the Released event
+    ParkingEvent releaseSlot(Shard & shard, const std::uint32_t slot);
+
+    /// \brief Orders items so that items stored in the same shard are next to each other
+    /// \param[in] count Number of items
+    /// \param[in] get_license_plate Returns the license plate of the item with the given index
+    /// \return Returns pairs of shard index and item index, sorted by shard index
+    template <typename GetLicensePlate>
+    std::vector<std::pair<std::size_t, std::size_t>> groupByShard(const std::size_t count, GetLicensePlate get_license_plate);
+
+    /// \brief Locks all shards in index order, so gates and restores cannot change the parked vehicles
+    std::vector<std::unique_lock<std::mutex>> lockAllShards();
+
+    /// \brief Shares the pages of the parked vehicles of all shards, must be called with all shard mutexes held
+    ParkedVehicleSnapshot shareParkedVehicles();
+
+    /// \brief Copies the parked vehicles of a snapshot and the ticket sequence taken with it into a journal snapshot
+    static JournalSnapshot makeJournalSnapshot(const ParkedVehicleSnapshot & parked_vehicles, const TicketID next_ticket_sequence);
+
+    /// \brief Writes the snapshot of a journal generation and deletes the files of older generations
+    void writeSnapshot(const std::uint64_t generation, const JournalSnapshot & snapshot);
+
+    /// \brief Puts a vehicle back into the given shard, keeping its ticket ID and, if still free, its bay
+    void restoreRecord(Shard & shard, const ParkedRecord & record);
 
-    /// \brief Logs a vehicle entry or exit in the parking lot
-    /// \param[in] action Action (Entry or Exit)
-    /// \param[in] vehicle Shared pointer to the Vehicle being parked or released
-    /// \param[in] ticket_id Ticket ID of the vehicle
-    void logEntry(const std::string& action, const std::shared_ptr<Vehicle>& vehicle, const int ticket_id);
+    /// \brief Applies a journal record read during recovery
+    void replayJournalRecord(const JournalRecordKind kind, const ParkedRecord & record);
 
-    /// \brief Generates a unique ticket ID
-    /// \returns Returns unique ticket ID as an integer
-    int generateTicketID();
+    /// \brief Waits until the journal records appended so far are written, must be called without any shard mutex held
+    /// \return Returns false if the journal cannot be written
+    bool syncJournal();
+
+    /// \brief Takes a snapshot when JournalConfig::snapshot_interval records were appended since the last one,
+    /// must be called without any shard mutex held. Does nothing once the journal cannot be written.
+    /// \return Returns false if the snapshot cannot be written
+    bool checkpointIfDue();
+
+    /// \brief Makes the result of an event, only a vehicle parked or released can be lost on a restart
+    /// \param[in] durable Whether the journal was written, ignored for events that change nothing
+    static ParkingResult makeResult(const ParkingEvent & event, const bool durable);
+
+    /// \brief Throws JournalException if the journal record of a park or release could not be written
+    static void throwIfNotDurable(const ParkingResult & result);
+
+    /// \brief Gets the bays of a vehicle type taken by parked vehicles or held for bookings
+    int getTakenBays(const VehicleType vehicle_type, const std::int64_t now_us);
+
+    /// \brief Passes the event to the analytics, the forecast and the event sink, must be called without any shard mutex held
+    void emitEvent(const ParkingEvent & event);
+
+    /// \brief Generates a unique ticket ID, must be called with the shard mutex held
+    /// \param[in] shard Shard in which the vehicle is parked, the shard index is encoded in the ticket ID
+    /// \returns Returns unique ticket ID
+    /// \throw Throws TicketGeneratorException if the ticket generator cannot reserve more sequence numbers
+    TicketID generateTicketID(Shard & shard);
 
     /// \brief Updates number of certain vehicle after it is parked or released
     /// \param[in] vehicle_type Type of the vehicle for which the count should be updated
     /// \param[in] change Whether a value should be incremented or decremented, 1: incremented, -1: decremented
-    void updateCount(const std::string& vehicle_type, int change);
+    void updateCount(const VehicleType vehicle_type, int change);
 
 private:
-    std::unordered_map<std::string, std::pair<std::shared_ptr<Vehicle>, int>> m_parked_vehicles;
+    static const int kShardCount = 16;
+    std::array<Shard, kShardCount> m_shards;
+
+    /// Number of parked vehicles of one type, on its own cache line so that gates parking different types do not share it
+    struct alignas(64) Count
+    {
+        std::atomic<int> value{ 0 };
+    };
+
+    /// Capacities and numbers of parked vehicles, indexed by VehicleType
+    std::array<int, kVehicleTypeCount> m_capacity;
+    std::array<Count, kVehicleTypeCount> m_count;
+
+    /// Which bays are taken, indexed by VehicleType
+    std::array<BayAllocator, kVehicleTypeCount> m_bays;
+
+    /// Floors and zones set by setTopology, replace m_bays; nullptr if every vehicle type has its own bays
+    std::unique_ptr<ZonedBayAllocator> m_zones;
+
+    /// Bays booked ahead of time, replaced by setBookingConfig and setTopology
+    std::unique_ptr<BookingCalendar> m_bookings;
+    BookingConfig m_booking_config;
+
+    /// Occupancy history and dwell times fed with every event, replaced by setAnalyticsConfig;
+    /// accessed with std::atomic_load/std::atomic_store like the event sink
+    std::shared_ptr<OccupancyAnalytics> m_analytics;
+
+    /// Arrival and departure rates learned from every event, replaced by setForecastConfig like the analytics
+    std::shared_ptr<OccupancyForecaster> m_forecaster;
+
+    std::unique_ptr<AsyncLogger> m_logger;
+
+    /// Replaced by setTicketGenerator with all shard mutexes held, otherwise only used with a shard mutex held
+    std::shared_ptr<TicketGenerator> m_ticket_generator;
+
+    /// Set by openJournal before the gates start, nullptr if the parked vehicles are not journaled
+    std::unique_ptr<Journal> m_journal;
+    std::atomic<bool> m_checkpointing{ false };
+
+    /// Serializes checkpoints, the next journal file is opened before the shards are locked
+    std::mutex m_checkpoint_mutex;
+
+    /// Accessed with std::atomic_load/std::atomic_store, the sink may be replaced while gates are running
+    std::shared_ptr<ParkingEventSink> m_event_sink;
+
+    /// Accessed with std::atomic_load/std::atomic_store like the event sink
+    std::shared_ptr<const TariffTable> m_tariffs;
+
+    std::atomic<BillingClock> m_clock{ &systemClockMicroseconds };
 
-    int m_car_capacity;
-    int m_motorcycle_capacity;
-    int m_bus_capacity;
-    int m_car_count = 0;
-    int m_motorcycle_count = 0;
-    int m_bus_count = 0;
+    std::atomic<unsigned> m_metrics_sample_period{ kDefaultMetricsSamplePeriod };
 
     static std::shared_ptr<ParkingLot> instance_;
     static std::mutex instance_mutex_;
-    static std::mutex count_mutex_;
 };
\ No newline at end of file
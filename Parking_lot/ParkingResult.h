@@ -0,0 +1,26 @@
+#pragma once
+
+#include "ParkingEvent.h"
+
+/// \brief Outcome of a park or release attempt, reported without throwing
+struct ParkingResult
+{
+    /// Parked or Released on success, AlreadyParked, Full, NotFound or NoTicket otherwise
+    ParkingEventType status;
+
+    /// Ticket ID of the parked or released vehicle
+    TicketID ticket_id = 0;
+
+    /// Charge of the released vehicle
+    double charge = 0.0;
+
+    /// Bay of the parked or released vehicle, numbered from 1 per vehicle type (across the lot with a LotTopology), 0 if there is none
+    int bay = 0;
+
+    /// False if the journal could not be written: the vehicle is parked or released all the same, but a restart would not know it.
+    /// Always true for the outcomes that change nothing.
+    bool durable = true;
+
+    /// \brief Whether the vehicle was parked or released
+    bool succeeded() const { return status == ParkingEventType::Parked || status == ParkingEventType::Released; }
+};
\ No newline at end of file
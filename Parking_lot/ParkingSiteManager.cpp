@@ -0,0 +1,64 @@
+#include "ParkingSiteManager.h"
+#include "SiteNotFoundException.h"
+
+ParkingSiteManager::ParkingSiteManager(const std::shared_ptr<TicketGenerator> & ticket_generator)
+    : m_sites(std::make_shared<const SiteTable>()), m_ticket_generator(ticket_generator)
+{
+
+}
+
+std::shared_ptr<ParkingLot> ParkingSiteManager::addSite(const int site_id, const int car_capacity, const int motorcycle_capacity, const int bus_capacity)
+{
+    AsyncLoggerConfig log_config;
+    log_config.file_path = "parking_log_" + std::to_string(site_id) + ".txt";
+    return addSite(site_id, car_capacity, motorcycle_capacity, bus_capacity, log_config);
+}
+
+std::shared_ptr<ParkingLot> ParkingSiteManager::addSite(const int site_id, const int car_capacity, const int motorcycle_capacity, const int bus_capacity,
+                                                        const AsyncLoggerConfig & log_config)
+{
+    std::lock_guard<std::mutex> lock(m_update_mutex);
+
+    std::shared_ptr<const SiteTable> sites = std::atomic_load(&m_sites);
+    if (sites->find(site_id) != sites->end())
+    {
+        return nullptr;
+    }
+
+    std::shared_ptr<ParkingLot> parking_lot(new ParkingLot(car_capacity, motorcycle_capacity, bus_capacity, log_config));
+    parking_lot->setTicketGenerator(m_ticket_generator);
+    std::shared_ptr<SiteTable> new_sites = std::make_shared<SiteTable>(*sites);
+    (*new_sites)[site_id] = parking_lot;
+    std::atomic_store(&m_sites, std::shared_ptr<const SiteTable>(std::move(new_sites)));
+    return parking_lot;
+}
+
+ParkingLot & ParkingSiteManager::site(const int site_id) const
+{
+    std::shared_ptr<const SiteTable> sites = std::atomic_load(&m_sites);
+    auto it = sites->find(site_id);
+    if (it == sites->end())
+    {
+        throw SiteNotFoundException("Site " + std::to_string(site_id) + " is not found.");
+    }
+    return *it->second;
+}
+
+std::shared_ptr<ParkingLot> ParkingSiteManager::findSite(const int site_id) const
+{
+    std::shared_ptr<const SiteTable> sites = std::atomic_load(&m_sites);
+    auto it = sites->find(site_id);
+    return it != sites->end() ? it->second : nullptr;
+}
+
+std::vector<int> ParkingSiteManager::siteIDs() const
+{
+    std::shared_ptr<const SiteTable> sites = std::atomic_load(&m_sites);
+    std::vector<int> site_ids;
+    site_ids.reserve(sites->size());
+    for (const auto & site : *sites)
+    {
+        site_ids.push_back(site.first);
+    }
+    return site_ids;
+}
\ No newline at end of file
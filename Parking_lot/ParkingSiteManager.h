@@ -0,0 +1,65 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "ParkingLot.h"
+
+/// \brief Hosts many independent parking lots (sites) in one process
+/// Every site is a ParkingLot with its own shards, counters, bays and log file, so gates of
+/// different sites never share a lock. Looking a site up does not wait for sites being added: the site
+/// table is immutable once published, adding a site publishes a new copy of it and a replaced table is
+/// freed once the last lookup that still reads it is done.
+/// All sites take their ticket sequence numbers from one TicketGenerator, so ticket IDs are unique across sites.
+class ParkingSiteManager
+{
+public:
+    /// \brief Constructor
+    /// \param[in] ticket_generator Ticket generator shared by all sites, e.g. one with a state file to keep
+    /// ticket IDs unique across restarts
+    explicit ParkingSiteManager(const std::shared_ptr<TicketGenerator> & ticket_generator = std::make_shared<TicketGenerator>());
+
+    ParkingSiteManager(const ParkingSiteManager &) = delete;
+    ParkingSiteManager & operator=(const ParkingSiteManager &) = delete;
+
+    /// \brief Creates a site, its entry/exit log is written to parking_log_<site ID>.txt
+    /// \param[in] site_id ID of the new site
+    /// \param[in] car_capacity Capacity of the cars
+    /// \param[in] motorcycle_capacity Capacity of the motorcycles
+    /// \param[in] bus_capacity Capacity of the buses
+    /// \return Returns the new site, or nullptr if there already is a site with this ID
+    std::shared_ptr<ParkingLot> addSite(const int site_id, const int car_capacity, const int motorcycle_capacity, const int bus_capacity);
+
+    /// \brief Creates a site with its own log settings
+    /// \param[in] log_config Settings of the entry/exit log, every site needs its own file
+    /// \return Returns the new site, or nullptr if there already is a site with this ID
+    std::shared_ptr<ParkingLot> addSite(const int site_id, const int car_capacity, const int motorcycle_capacity, const int bus_capacity,
+                                        const AsyncLoggerConfig & log_config);
+
+    /// \brief Gets a site to route an operation to, e.g. site(7).tryParkVehicle(vehicle)
+    /// \param[in] site_id ID of the site
+    /// \return Returns the site, valid as long as the manager
+    /// \throw Throws SiteNotFoundException if there is no site with this ID
+    ParkingLot & site(const int site_id) const;
+
+    /// \brief Gets a site, for callers that keep it beyond the lifetime of the manager
+    /// \return Returns the site, or nullptr if there is no site with this ID
+    std::shared_ptr<ParkingLot> findSite(const int site_id) const;
+
+    /// \brief IDs of all sites, in no particular order
+    std::vector<int> siteIDs() const;
+
+private:
+    using SiteTable = std::unordered_map<int, std::shared_ptr<ParkingLot>>;
+
+private:
+    /// Latest site table, read and replaced with std::atomic_load and std::atomic_store
+    std::shared_ptr<const SiteTable> m_sites;
+
+    /// Serializes adding sites
+    std::mutex m_update_mutex;
+
+    std::shared_ptr<TicketGenerator> m_ticket_generator;
+};
\ No newline at end of file
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <exception>
+#include <string>
+
+// Custom exception for site IDs not registered with the ParkingSiteManager
+class SiteNotFoundException : public std::exception
+{
+public:
+    SiteNotFoundException(const std::string & message) : m_message(message) {}
+    const char* what() const noexcept override { return m_message.c_str(); }
+
+private:
+    std::string m_message;
+};
\ No newline at end of file
@@ -0,0 +1,186 @@
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <sstream>
+
+#include "TariffTable.h"
+#include "TariffException.h"
+
+namespace
+{
+    const double kMicrosecondsPerHour = 3600.0 * 1000000.0;
+
+    /// \brief Parses a vehicle type name as printed by toString
+    bool parseVehicleType(const std::string & name, VehicleType & vehicle_type)
+    {
+        for (std::size_t index = 0; index < kVehicleTypeCount; ++index)
+        {
+            if (name == toString(static_cast<VehicleType>(index)))
+            {
+                vehicle_type = static_cast<VehicleType>(index);
+                return true;
+            }
+        }
+        return false;
+    }
+}
+
+TariffTable::TariffTable()
+{
+    m_columns.first_hour = { { 2.0, 1.0, 5.0 } };
+    m_columns.subsequent_hours = { { 1.0, 0.5, 3.0 } };
+    m_columns.daily_cap.fill(std::numeric_limits<double>::infinity());
+    m_columns.factors.fill(1.0);
+}
+
+TariffTable TariffTable::load(const std::string & path)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        throw TariffException("Tariff file " + path + " cannot be read.");
+    }
+
+    TariffTable tariffs;
+    std::string line;
+    for (int line_number = 1; std::getline(file, line); ++line_number)
+    {
+        std::istringstream fields(line.substr(0, line.find('#')));
+        std::string setting;
+        if (!(fields >> setting))
+        {
+            continue;
+        }
+
+        bool valid = false;
+        std::string type_name;
+        VehicleType vehicle_type = VehicleType::Car;
+        if (setting == "rate")
+        {
+            Rates rates;
+            valid = fields >> type_name >> rates.first_hour >> rates.subsequent_hours && parseVehicleType(type_name, vehicle_type)
+                && rates.first_hour >= 0.0 && rates.subsequent_hours >= 0.0;
+            if (valid && !(fields >> rates.daily_cap))
+            {
+                rates.daily_cap = 0.0;
+                fields.clear();
+            }
+            valid = valid && rates.daily_cap >= 0.0;
+            if (valid)
+            {
+                tariffs.setRates(vehicle_type, rates);
+            }
+        }
+        else if (setting == "band")
+        {
+            int from_hour = 0;
+            int to_hour = 0;
+            double factor = 0.0;
+            valid = fields >> type_name >> from_hour >> to_hour >> factor && from_hour >= 0 && from_hour < 24
+                && to_hour >= 0 && to_hour <= 24 && factor >= 0.0;
+            if (valid && type_name == "All")
+            {
+                for (std::size_t index = 0; index < kVehicleTypeCount; ++index)
+                {
+                    tariffs.setBand(static_cast<VehicleType>(index), from_hour, to_hour, factor);
+                }
+            }
+            else if (valid && parseVehicleType(type_name, vehicle_type))
+            {
+                tariffs.setBand(vehicle_type, from_hour, to_hour, factor);
+            }
+            else
+            {
+                valid = false;
+            }
+        }
+        else if (setting == "utc_offset_minutes")
+        {
+            int minutes = 0;
+            valid = static_cast<bool>(fields >> minutes);
+            if (valid)
+            {
+                tariffs.setUtcOffsetMinutes(minutes);
+            }
+        }
+
+        std::string rest;
+        if (!valid || fields >> rest)
+        {
+            throw TariffException("Tariff file " + path + ", line " + std::to_string(line_number) + " is invalid: " + line);
+        }
+    }
+    return tariffs;
+}
+
+void TariffTable::setRates(const VehicleType vehicle_type, const Rates & rates)
+{
+    std::size_t index = toIndex(vehicle_type);
+    m_columns.first_hour[index] = rates.first_hour;
+    m_columns.subsequent_hours[index] = rates.subsequent_hours;
+    m_columns.daily_cap[index] = rates.daily_cap > 0.0 ? rates.daily_cap : std::numeric_limits<double>::infinity();
+}
+
+TariffTable::Rates TariffTable::rates(const VehicleType vehicle_type) const
+{
+    std::size_t index = toIndex(vehicle_type);
+    Rates rates;
+    rates.first_hour = m_columns.first_hour[index];
+    rates.subsequent_hours = m_columns.subsequent_hours[index];
+    rates.daily_cap = std::isinf(m_columns.daily_cap[index]) ? 0.0 : m_columns.daily_cap[index];
+    return rates;
+}
+
+void TariffTable::setBand(const VehicleType vehicle_type, const int from_hour, const int to_hour, const double factor)
+{
+    double * factors = m_columns.factors.data() + toIndex(vehicle_type) * kHoursPerDay;
+    int hours_per_day = static_cast<int>(kHoursPerDay);
+
+    // Hour 24 is midnight of the next day, a band ending where it starts covers the whole day
+    int hour_count = (to_hour % hours_per_day - from_hour + hours_per_day) % hours_per_day;
+    if (hour_count == 0)
+    {
+        hour_count = hours_per_day;
+    }
+    for (int i = 0; i < hour_count; ++i)
+    {
+        factors[(from_hour + i) % hours_per_day] = factor;
+    }
+}
+
+double TariffTable::charge(const VehicleType vehicle_type, const std::int64_t entry_time_us, const std::int64_t exit_time_us) const
+{
+    double result = 0.0;
+    calculateCharges(m_columns, &vehicle_type, &entry_time_us, &exit_time_us, 1, &result);
+    return result;
+}
+
+void TariffTable::calculateCharges(const ClosedTickets & tickets, double * charges) const
+{
+    calculateCharges(m_columns, tickets.types.data(), tickets.entry_times_us.data(), tickets.exit_times_us.data(), tickets.size(), charges);
+}
+
+
+void TariffTable::calculateCharges(const Columns & columns, const VehicleType * types, const std::int64_t * entry_times_us,
+                                   const std::int64_t * exit_times_us, const std::size_t count, double * __restrict charges)
+{
+    // Truncating int conversions instead of floor and ceil, the vector units support them without fast-math
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        int type = static_cast<int>(types[i]);
+        double hours = static_cast<double>(std::max<std::int64_t>(exit_times_us[i] - entry_times_us[i], 0)) / kMicrosecondsPerHour;
+
+        // Local hour of the day the vehicle entered in, times before 1970 count as 1970-01-01 00:00
+        double entry_hours = std::max(static_cast<double>(entry_times_us[i] + columns.utc_offset_us) / kMicrosecondsPerHour, 0.0);
+        int hours_since_epoch = static_cast<int>(entry_hours);
+        int hour_of_day = hours_since_epoch % static_cast<int>(kHoursPerDay);
+        double factor = columns.factors[type * static_cast<int>(kHoursPerDay) + hour_of_day];
+
+        double charge = (columns.first_hour[type] + std::max(hours - 1.0, 0.0) * columns.subsequent_hours[type]) * factor;
+        double days = hours / kHoursPerDay;
+        double full_days = static_cast<double>(static_cast<int>(days));
+        double started_days = std::max(full_days < days ? full_days + 1.0 : full_days, 1.0);
+        charges[i] = std::min(charge, columns.daily_cap[type] * started_days);
+    }
+}
\ No newline at end of file
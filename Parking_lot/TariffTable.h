@@ -0,0 +1,118 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "VehicleType.h"
+
+/// \brief Source of the entry and exit times, microseconds since 1970-01-01 UTC
+using BillingClock = std::int64_t (*)();
+
+/// \brief The default BillingClock, reads the system clock
+inline std::int64_t systemClockMicroseconds()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+/// \brief Closed tickets as a structure of arrays, the input of TariffTable::calculateCharges
+struct ClosedTickets
+{
+    std::vector<VehicleType> types;
+
+    /// Microseconds since 1970-01-01 UTC
+    std::vector<std::int64_t> entry_times_us;
+    std::vector<std::int64_t> exit_times_us;
+
+    void add(const VehicleType type, const std::int64_t entry_time_us, const std::int64_t exit_time_us)
+    {
+        types.push_back(type);
+        entry_times_us.push_back(entry_time_us);
+        exit_times_us.push_back(exit_time_us);
+    }
+
+    std::size_t size() const { return types.size(); }
+};
+
+/// \brief Rates of the vehicle types, applied to the real entry and exit times of a stay
+/// A stay of h hours (fractions included) costs first_hour + max(0, h - 1) * subsequent_hours, multiplied
+/// by the factor of the time-of-day band the vehicle entered in. With a daily cap, a stay costs at most
+/// the cap for every started 24 hours.
+/// The rates are kept as flat per-type arrays, so calculateCharges is a branch-free loop the compiler can vectorize.
+class TariffTable
+{
+public:
+    /// \brief Rates of one vehicle type
+    struct Rates
+    {
+        double first_hour = 0.0;
+        double subsequent_hours = 0.0;
+
+        /// Highest charge per started 24 hours, 0 for no cap
+        double daily_cap = 0.0;
+    };
+
+    /// \brief Constructor, the built-in rates: Car 2/1, Motorcycle 1/0.5, Bus 5/3, no bands and no caps
+    TariffTable();
+
+    /// \brief Loads the rates from a tariff file, settings missing in the file keep their built-in values
+    /// Every line holds one setting, # starts a comment:
+    ///     rate <vehicle type> <first hour> <subsequent hours> [<daily cap>]
+    ///     band <vehicle type or All> <from hour> <to hour> <factor>   e.g. "band All 22 6 0.5", to hour is exclusive (0 to 24)
+    ///     utc_offset_minutes <minutes>                                 local time used for the bands
+    /// \param[in] path Path of the tariff file
+    /// \return Returns the loaded tariff table
+    /// \throw Throws TariffException if the file cannot be read or a line is invalid
+    static TariffTable load(const std::string & path);
+
+    void setRates(const VehicleType vehicle_type, const Rates & rates);
+    Rates rates(const VehicleType vehicle_type) const;
+
+    /// \brief Sets the factor of the hours [from_hour, to_hour) of the day, wrapping around midnight if from_hour > to_hour
+    /// \param[in] from_hour First hour of the band, 0 to 23
+    /// \param[in] to_hour Hour after the band, 0 to 24; equal to from_hour (or 24 for 0) the band covers the whole day
+    void setBand(const VehicleType vehicle_type, const int from_hour, const int to_hour, const double factor);
+
+    /// \brief Sets the offset of the local time used for the bands from UTC
+    void setUtcOffsetMinutes(const int minutes) { m_columns.utc_offset_us = static_cast<std::int64_t>(minutes) * 60 * 1000000; }
+
+    /// \brief Calculates the charge of one stay
+    /// \param[in] vehicle_type Type of the vehicle
+    /// \param[in] entry_time_us Entry time, microseconds since 1970-01-01 UTC
+    /// \param[in] exit_time_us Exit time, microseconds since 1970-01-01 UTC
+    double charge(const VehicleType vehicle_type, const std::int64_t entry_time_us, const std::int64_t exit_time_us) const;
+
+    /// \brief Calculates the charges of many stays, e.g. for the end-of-day settlement
+    /// \param[in] tickets Closed tickets, their vehicle types must be valid
+    /// \param[out] charges Receives tickets.size() charges, equal to those of charge
+    void calculateCharges(const ClosedTickets & tickets, double * charges) const;
+
+private:
+    static constexpr std::size_t kHoursPerDay = 24;
+
+    /// \brief Rates of all vehicle types as flat arrays, indexed by VehicleType
+    struct Columns
+    {
+        std::array<double, kVehicleTypeCount> first_hour;
+        std::array<double, kVehicleTypeCount> subsequent_hours;
+
+        /// Infinity for no cap
+        std::array<double, kVehicleTypeCount> daily_cap;
+
+        /// Indexed by VehicleType * 24 + hour of the day
+        std::array<double, kVehicleTypeCount * kHoursPerDay> factors;
+
+        std::int64_t utc_offset_us = 0;
+    };
+
+    /// \brief Kernel of charge and calculateCharges, works on plain arrays
+    /// The charges must not alias the columns, otherwise the compiler cannot vectorize the loop.
+    static void calculateCharges(const Columns & columns, const VehicleType * types, const std::int64_t * entry_times_us,
+                                 const std::int64_t * exit_times_us, const std::size_t count, double * __restrict charges);
+
+private:
+    Columns m_columns;
+};
\ No newline at end of file
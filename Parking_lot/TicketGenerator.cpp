@@ -0,0 +1,107 @@
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <limits>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "TicketGenerator.h"
+#include "TicketGeneratorException.h"
+
+namespace
+{
+    /// \brief Replaces the state file with one holding the given end of the reserved range
+    /// The new content is written to a temporary file and synced first, so the file is never torn.
+    bool writeReservedEnd(const std::string & path, const TicketID reserved_end)
+    {
+        std::string temporary_path = path + ".tmp";
+        std::FILE * file = std::fopen(temporary_path.c_str(), "w");
+        if (!file)
+        {
+            return false;
+        }
+        bool written = std::fprintf(file, "%lld\n", static_cast<long long>(reserved_end)) > 0 && std::fflush(file) == 0;
+#ifdef _WIN32
+        written = written && _commit(_fileno(file)) == 0;
+#else
+        written = written && fsync(fileno(file)) == 0;
+#endif
+        std::fclose(file);
+
+        std::error_code error;
+        if (written)
+        {
+            std::filesystem::rename(temporary_path, path, error);
+        }
+        return written && !error;
+    }
+}
+
+TicketGenerator::TicketGenerator(const TicketID block_size)
+    : m_block_size(std::max<TicketID>(block_size, 1)), m_reservation_size(0), m_reserved_end(std::numeric_limits<TicketID>::max())
+{
+
+}
+
+TicketGenerator::TicketGenerator(const std::string & state_path, const TicketID block_size, const TicketID reservation_size)
+    : m_state_path(state_path), m_block_size(std::max<TicketID>(block_size, 1)), m_reservation_size(std::max(reservation_size, m_block_size)),
+      m_reserved_end(1)
+{
+    std::FILE * file = std::fopen(state_path.c_str(), "r");
+    if (file)
+    {
+        long long reserved_end = 0;
+        bool intact = std::fscanf(file, "%lld", &reserved_end) == 1 && reserved_end >= 1;
+        std::fclose(file);
+        if (!intact)
+        {
+            throw TicketGeneratorException("Ticket generator state file " + state_path + " is damaged.");
+        }
+
+        // Numbers of the earlier run's reserved range may have been issued, the new run starts after them
+        m_next.store(reserved_end, std::memory_order_relaxed);
+        m_reserved_end.store(reserved_end, std::memory_order_relaxed);
+    }
+    reserve(m_next.load(std::memory_order_relaxed) + m_block_size);
+}
+
+TicketBlock TicketGenerator::nextBlock()
+{
+    TicketBlock block;
+    block.first = m_next.fetch_add(m_block_size, std::memory_order_acq_rel);
+    block.end = block.first + m_block_size;
+    if (block.end > m_reserved_end.load(std::memory_order_acquire))
+    {
+        reserve(block.end);
+    }
+    return block;
+}
+
+void TicketGenerator::advancePast(const TicketID sequence)
+{
+    TicketID next = m_next.load(std::memory_order_relaxed);
+    while (next <= sequence && !m_next.compare_exchange_weak(next, sequence + 1, std::memory_order_acq_rel, std::memory_order_relaxed))
+    {
+    }
+}
+
+void TicketGenerator::reserve(const TicketID end)
+{
+    std::lock_guard<std::mutex> lock(m_reserve_mutex);
+    if (end <= m_reserved_end.load(std::memory_order_relaxed))
+    {
+        return;
+    }
+
+    // Blocks taken meanwhile may end further out, the new range covers them as well
+    TicketID reserved_end = std::max(end, m_next.load(std::memory_order_acquire)) + m_reservation_size;
+    if (!writeReservedEnd(m_state_path, reserved_end))
+    {
+        throw TicketGeneratorException("Ticket generator state file " + m_state_path + " cannot be written.");
+    }
+    m_reserved_end.store(reserved_end, std::memory_order_release);
+}
\ No newline at end of file
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <string>
+
+#include "TicketID.h"
+
+/// \brief Range [first, end) of ticket sequence numbers taken by one shard
+struct TicketBlock
+{
+    TicketID first = 0;
+    TicketID end = 0;
+
+    bool empty() const { return first >= end; }
+};
+
+/// \brief Hands out blocks of ticket sequence numbers, safe to call from any number of threads
+/// A shard takes a whole block with a single atomic add and issues its numbers under its own mutex,
+/// so issuing tickets needs no lock shared by the shards. Blocks are handed out in ascending order and
+/// no number is handed out twice. Numbers increase per shard; with a block size of 1 they increase
+/// across the whole generator, at the cost of an atomic add per ticket.
+/// With a state file the generator reserves numbers ahead in large ranges and records the end of the
+/// reserved range in the file, so a restarted process continues after everything an earlier run could
+/// have issued. The file is only written once per reserved range.
+class TicketGenerator
+{
+public:
+    /// Default number of sequence numbers in a block
+    static const TicketID kDefaultBlockSize = 1024;
+
+    /// Default number of sequence numbers reserved with one write of the state file
+    static const TicketID kDefaultReservationSize = TicketID(1) << 20;
+
+    /// \brief Constructor of a generator that starts at 1 in every run
+    /// \param[in] block_size Number of sequence numbers in a block
+    explicit TicketGenerator(const TicketID block_size = kDefaultBlockSize);
+
+    /// \brief Constructor of a generator that continues after the numbers reserved by earlier runs
+    /// \param[in] state_path File that keeps the end of the reserved range, created if it does not exist
+    /// \param[in] block_size Number of sequence numbers in a block
+    /// \param[in] reservation_size Number of sequence numbers reserved with one write of the state file
+    /// \throw Throws TicketGeneratorException if the state file is damaged or cannot be written
+    TicketGenerator(const std::string & state_path, const TicketID block_size = kDefaultBlockSize,
+                    const TicketID reservation_size = kDefaultReservationSize);
+
+    TicketGenerator(const TicketGenerator &) = delete;
+    TicketGenerator & operator=(const TicketGenerator &) = delete;
+
+    /// \brief Takes the next block of sequence numbers
+    /// Lock-free unless the block crosses the end of the reserved range and the state file must be written.
+    /// \throw Throws TicketGeneratorException if the state file cannot be written
+    TicketBlock nextBlock();
+
+    /// \brief Makes sure that the blocks handed out from now on start after the given sequence number,
+    /// used for the ticket IDs of vehicles restored from a journal
+    void advancePast(const TicketID sequence);
+
+    /// \brief Sequence number the next block starts with
+    TicketID nextSequence() const { return m_next.load(std::memory_order_acquire); }
+
+    TicketID blockSize() const { return m_block_size; }
+
+private:
+    /// \brief Extends the reserved range so that it covers the given end, writes the state file
+    void reserve(const TicketID end);
+
+private:
+    std::string m_state_path;
+    TicketID m_block_size;
+    TicketID m_reservation_size;
+
+    alignas(64) std::atomic<TicketID> m_next{ 1 };
+
+    /// End of the range recorded in the state file, blocks beyond it wait for reserve
+    std::atomic<TicketID> m_reserved_end;
+    std::mutex m_reserve_mutex;
+};
\ No newline at end of file
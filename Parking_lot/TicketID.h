@@ -0,0 +1,6 @@
+#pragma once
+
+#include <cstdint>
+
+/// \brief Ticket ID of a parked vehicle, 0 means that there is no ticket
+using TicketID = std::int64_t;
\ No newline at end of file
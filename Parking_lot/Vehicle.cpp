@@ -8,15 +8,15 @@ std::shared_ptr<Vehicle> Vehicle::makeVehicle(const int choice, const std::strin
 {
     if (choice == 1)
     {
-        return std::shared_ptr<Car>(new Car(license_plate, parking_duration));
+        return std::make_shared<Car>(license_plate, parking_duration);
     }
     else if (choice == 2)
     {
-        return std::shared_ptr<Motorcycle>(new Motorcycle(license_plate, parking_duration));
+        return std::make_shared<Motorcycle>(license_plate, parking_duration);
     }
     else if (choice == 3)
     {
-        return std::shared_ptr<Bus>(new Bus(license_plate, parking_duration));
+        return std::make_shared<Bus>(license_plate, parking_duration);
     }
     else
     {
@@ -1,29 +1,44 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <memory>
 
+#include "LicensePlate.h"
+#include "VehicleType.h"
+
 /// \brief Abstract base class for all vehicle types
 class Vehicle
 {
-public:
-    /// Constructor
+protected:
+    /// Constructor, called by the derived classes with their vehicle type
+    /// \param[in] type Type of the vehicle
     /// \param[in] license_plate Unique license plate of the vehicle
-    /// \param[in] parking_duration The dureation of the parking
-    Vehicle(const std::string& license_plate, const double parking_duration)
-        : m_license_plate(license_plate), m_parking_duration(parking_duration) {}
+    /// \param[in] parking_duration The expected dureation of the parking, charges are calculated from the real entry and exit times
+    /// \throw Throws InvalidLicensePlateException if the license plate is longer than LicensePlate::kMaxLength
+    Vehicle(const VehicleType type, const std::string_view license_plate, const double parking_duration)
+        : m_type(type), m_license_plate(license_plate), m_parking_duration(parking_duration) {}
 
+public:
     /// Destructor
     virtual ~Vehicle() {}
 
     /// Get the license plate of the vehicle.
     /// \return Returns license plate as a string.
-    virtual std::string getLicensePlate() const { return m_license_plate; }
+    virtual std::string getLicensePlate() const { return m_license_plate.str(); }
+
+    /// Get the license plate of the vehicle without copying it.
+    /// \return Returns license plate as a view, valid as long as the vehicle.
+    std::string_view getLicensePlateView() const { return m_license_plate.view(); }
+
+    /// Get the type of the vehicle.
+    /// \return Returns vehicle type, set by the derived class
+    VehicleType getType() const { return m_type; }
 
-    /// Abstract method to get the type of the vehicle
+    /// Get the name of the vehicle type, for printing only
     /// \return Returns vehicle type as a string
-    virtual std::string getVehicleType() const = 0;
+    std::string getVehicleType() const { return toString(m_type); }
 
-    /// Get the parking duration of the vehicle.
+    /// Get the expected parking duration of the vehicle, e.g. for simulations. The parking lot does not use it for billing.
     /// \return Returns parking duration in hours as a double.
     virtual double getParkingDuration() const { return m_parking_duration; }
 
@@ -35,6 +50,7 @@ public:
     /// \throw Throws InvalidVehicleTypeException exception in case first argument is invalid
     static std::shared_ptr<Vehicle> makeVehicle(const int choice, const std::string& license_plate, const double parking_duration);
 private:
-    std::string m_license_plate;
+    VehicleType m_type;
+    LicensePlate m_license_plate;
     double m_parking_duration;
 };
\ No newline at end of file
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/// \brief Compact vehicle type, used as an index into per-type arrays (counts, capacities, tariffs)
+enum class VehicleType : std::uint8_t
+{
+    Car,
+    Motorcycle,
+    Bus
+};
+
+/// Number of vehicle types, the size of per-type arrays
+const std::size_t kVehicleTypeCount = 3;
+
+/// \brief Converts the vehicle type to an array index
+inline std::size_t toIndex(const VehicleType type)
+{
+    return static_cast<std::size_t>(type);
+}
+
+/// \brief Name of the vehicle type, for printing and logging only
+inline const char * toString(const VehicleType type)
+{
+    switch (type)
+    {
+    case VehicleType::Car:
+        return "Car";
+    case VehicleType::Motorcycle:
+        return "Motorcycle";
+    case VehicleType::Bus:
+        return "Bus";
+    }
+    return "Unknown";
+}
\ No newline at end of file
@@ -0,0 +1,200 @@
+#include <algorithm>
+
+#include "ZonedBayAllocator.h"
+
+ZonedBayAllocator::ZonedBayAllocator(const LotTopology & topology, const std::shared_ptr<const BayAllocationPolicy> & policy)
+    : m_topology(topology), m_policy(policy ? policy : std::make_shared<NearestToExitPolicy>())
+{
+    // Zones a policy left out of its ranking are ranked last, a zone ranked twice keeps its first rank
+    std::size_t zone_count = m_topology.zones().size();
+    std::vector<std::size_t> rank_of_zone(zone_count, kNoGroup);
+    std::size_t rank_count = 0;
+    for (std::size_t zone : m_policy->rankZones(m_topology))
+    {
+        if (zone < zone_count && rank_of_zone[zone] == kNoGroup)
+        {
+            rank_of_zone[zone] = rank_count++;
+        }
+    }
+    for (auto & rank : rank_of_zone)
+    {
+        if (rank == kNoGroup)
+        {
+            rank = rank_count++;
+        }
+    }
+
+    for (std::size_t zone = 0; zone < zone_count; ++zone)
+    {
+        for (std::size_t kind = 0; kind < kBayKindCount; ++kind)
+        {
+            int bays = m_topology.zones()[zone].bays[kind];
+            if (bays > 0)
+            {
+                m_groups.push_back(Group{ BayAllocator(bays), m_bay_count, zone, static_cast<BayKind>(kind), rank_of_zone[zone] });
+                m_bay_count += bays;
+            }
+        }
+    }
+
+    std::size_t word_count = (zone_count + 63) / 64;
+    for (auto & index : m_kinds)
+    {
+        index.groups.assign(zone_count, kNoGroup);
+        index.free_bays.reset(new std::atomic<int>[zone_count]);
+        index.bay_counts.reset(new int[zone_count]);
+        index.free_ranks.reset(new std::atomic<std::uint64_t>[word_count]);
+        for (std::size_t rank = 0; rank < zone_count; ++rank)
+        {
+            index.free_bays[rank].store(0, std::memory_order_relaxed);
+            index.bay_counts[rank] = 0;
+        }
+        for (std::size_t word = 0; word < word_count; ++word)
+        {
+            index.free_ranks[word].store(0, std::memory_order_relaxed);
+        }
+    }
+    for (std::size_t group_index = 0; group_index < m_groups.size(); ++group_index)
+    {
+        const Group & group = m_groups[group_index];
+        KindIndex & index = m_kinds[toIndex(group.kind)];
+        index.groups[group.rank] = group_index;
+        index.free_bays[group.rank].store(group.bays.bayCount(), std::memory_order_relaxed);
+        index.bay_counts[group.rank] = group.bays.bayCount();
+        index.free_ranks[group.rank / 64].fetch_or(std::uint64_t(1) << (group.rank % 64), std::memory_order_relaxed);
+    }
+}
+
+int ZonedBayAllocator::allocate(const VehicleType vehicle_type)
+{
+    for (BayKind kind : m_topology.bayKinds(vehicle_type))
+    {
+        int bay = allocate(kind);
+        if (bay != kNoBay)
+        {
+            return bay;
+        }
+    }
+    return kNoBay;
+}
+
+int ZonedBayAllocator::allocate(const BayKind kind)
+{
+    KindIndex & index = m_kinds[toIndex(kind)];
+    FreeZones free_zones(index.free_ranks.get(), index.free_bays.get(), index.bay_counts.get(), index.groups.size());
+    while (true)
+    {
+        std::size_t rank = m_policy->chooseZone(free_zones);
+        if (rank >= index.groups.size() || index.groups[rank] == kNoGroup)
+        {
+            return kNoBay;
+        }
+
+        // The counter reserves a bay of the zone, other gates may fill it up between the choice and the reservation
+        std::atomic<int> & free_bays = index.free_bays[rank];
+        int current = free_bays.load(std::memory_order_relaxed);
+        while (current > 0 && !free_bays.compare_exchange_weak(current, current - 1, std::memory_order_acq_rel, std::memory_order_relaxed))
+        {
+        }
+        if (current <= 0)
+        {
+            clearFreeRank(index, rank);
+            continue;
+        }
+        if (current == 1)
+        {
+            clearFreeRank(index, rank);
+        }
+
+        // A bay released by another gate is freed before it is counted, so the reserved bay is there
+        Group & group = m_groups[index.groups[rank]];
+        int bay = group.bays.allocate();
+        while (bay == BayAllocator::kNoBay)
+        {
+            bay = group.bays.allocate();
+        }
+        return group.offset + bay + 1;
+    }
+}
+
+bool ZonedBayAllocator::acquire(const int bay)
+{
+    std::size_t group_index = groupIndexOf(bay);
+    if (group_index == kNoGroup)
+    {
+        return false;
+    }
+    Group & group = m_groups[group_index];
+    if (!group.bays.acquire(bay - group.offset - 1))
+    {
+        return false;
+    }
+
+    KindIndex & index = m_kinds[toIndex(group.kind)];
+    if (index.free_bays[group.rank].fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        clearFreeRank(index, group.rank);
+    }
+    return true;
+}
+
+void ZonedBayAllocator::release(const int bay)
+{
+    std::size_t group_index = groupIndexOf(bay);
+    if (group_index == kNoGroup)
+    {
+        return;
+    }
+    Group & group = m_groups[group_index];
+    group.bays.release(bay - group.offset - 1);
+
+    KindIndex & index = m_kinds[toIndex(group.kind)];
+    index.free_bays[group.rank].fetch_add(1, std::memory_order_acq_rel);
+    index.free_ranks[group.rank / 64].fetch_or(std::uint64_t(1) << (group.rank % 64), std::memory_order_release);
+}
+
+BayLocation ZonedBayAllocator::locate(const int bay) const
+{
+    std::size_t group_index = groupIndexOf(bay);
+    if (group_index == kNoGroup)
+    {
+        return BayLocation();
+    }
+    const Group & group = m_groups[group_index];
+    return BayLocation{ group.zone, m_topology.zones()[group.zone].floor, group.kind, bay - group.offset };
+}
+
+int ZonedBayAllocator::freeBays(const BayKind kind) const
+{
+    const KindIndex & index = m_kinds[toIndex(kind)];
+    int free_bays = 0;
+    for (std::size_t rank = 0; rank < index.groups.size(); ++rank)
+    {
+        free_bays += index.free_bays[rank].load(std::memory_order_relaxed);
+    }
+    return free_bays;
+}
+
+std::size_t ZonedBayAllocator::groupIndexOf(const int bay) const
+{
+    if (bay < 1 || bay > m_bay_count)
+    {
+        return kNoGroup;
+    }
+    // The last group whose first bay is at or before the bay
+    auto after = std::upper_bound(m_groups.begin(), m_groups.end(), bay, [](const int number, const Group & group) { return number <= group.offset; });
+    return static_cast<std::size_t>(after - m_groups.begin()) - 1;
+}
+
+void ZonedBayAllocator::clearFreeRank(KindIndex & index, const std::size_t rank)
+{
+    std::atomic<std::uint64_t> & word = index.free_ranks[rank / 64];
+    std::uint64_t rank_bit = std::uint64_t(1) << (rank % 64);
+    word.fetch_and(~rank_bit, std::memory_order_acq_rel);
+
+    // A bay of the zone may have been released before the bit was cleared, its release must stay visible
+    if (index.free_bays[rank].load(std::memory_order_acquire) > 0)
+    {
+        word.fetch_or(rank_bit, std::memory_order_release);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "BayAllocationPolicy.h"
+#include "BayAllocator.h"
+#include "LotTopology.h"
+#include "VehicleType.h"
+
+/// \brief Tracks which bays of a lot with floors and zones are free, safe to use from any number of threads
+/// Every zone keeps a BayAllocator per bay kind, and per kind the zones are ranked once by the policy with a free
+/// bay counter per zone and a bit per zone that is set while it has free bays. Parking a vehicle tries its bay
+/// kinds in order: the policy picks one of the zones whose bit is set, the zone's counter is decremented to
+/// reserve a bay and its BayAllocator finds the lowest free one. A search reads a few words of zone bits and one
+/// zone's bay bits, so it takes about as long on 100k bays over 20 floors as on a hundred; gates parking at the
+/// same time search without locking and only meet on the counters of the same zone.
+class ZonedBayAllocator
+{
+public:
+    /// Returned by allocate if every bay a vehicle type may be parked in is taken
+    static constexpr int kNoBay = 0;
+
+    /// \brief Constructor, all bays are free
+    /// \param[in] topology Zones and bay kinds of the vehicle types, bays are numbered from 1 zone by zone and kind by kind
+    /// \param[in] policy Rules that pick the zone, e.g. NearestToExitPolicy
+    ZonedBayAllocator(const LotTopology & topology, const std::shared_ptr<const BayAllocationPolicy> & policy);
+
+    /// \brief Takes a free bay for a vehicle type, falling back to its later bay kinds if the earlier ones are full
+    /// \return Returns the bay number (1 to bayCount()) or kNoBay
+    int allocate(const VehicleType vehicle_type);
+
+    /// \brief Takes a specific bay, e.g. to restore a parked vehicle
+    /// \return Returns false if the bay is unknown or already taken
+    bool acquire(const int bay);
+
+    /// \brief Frees a bay taken by allocate or acquire
+    void release(const int bay);
+
+    /// \brief Gets the zone, kind and number within the zone of a bay
+    /// \return Returns a location with zone LotTopology::kNoZone if the bay is unknown
+    BayLocation locate(const int bay) const;
+
+    /// \brief Number of free bays of a kind in all zones
+    int freeBays(const BayKind kind) const;
+
+    int bayCount() const { return m_bay_count; }
+
+    const LotTopology & topology() const { return m_topology; }
+
+private:
+    /// Bays of one kind in one zone
+    struct Group
+    {
+        BayAllocator bays;
+
+        /// Bay number of the first bay minus 1
+        int offset;
+        std::size_t zone;
+        BayKind kind;
+        std::size_t rank;
+    };
+
+    /// The zones in rank order for one bay kind
+    struct KindIndex
+    {
+        /// Index into m_groups per rank, kNoGroup if the zone has no bays of the kind
+        std::vector<std::size_t> groups;
+        std::unique_ptr<std::atomic<int>[]> free_bays;
+        std::unique_ptr<int[]> bay_counts;
+
+        /// One bit per rank, set if the zone may have a free bay
+        std::unique_ptr<std::atomic<std::uint64_t>[]> free_ranks;
+    };
+
+    /// \brief Takes a bay of one kind, returns kNoBay if the kind has no free bay
+    int allocate(const BayKind kind);
+
+    /// \brief Gets the index of the group of a bay number, kNoGroup if there is none
+    std::size_t groupIndexOf(const int bay) const;
+
+    /// \brief Clears the bit of a zone that ran out of free bays
+    void clearFreeRank(KindIndex & index, const std::size_t rank);
+
+private:
+    static constexpr std::size_t kNoGroup = static_cast<std::size_t>(-1);
+
+    LotTopology m_topology;
+    std::shared_ptr<const BayAllocationPolicy> m_policy;
+    int m_bay_count = 0;
+
+    /// Ordered by bay number
+    std::vector<Group> m_groups;
+
+    /// Indexed by BayKind
+    std::array<KindIndex, kBayKindCount> m_kinds;
+};
\ No newline at end of file
@@ -5,9 +5,127 @@
 #include "Motorcycle.h"
 #include "Bus.h"
 #include "ParkingLot.cpp"
+#include "AsyncLogger.cpp"
+#include "ParkingEvent.cpp"
+#include "BufferedEventSink.cpp"
+#include "ParkedVehicleTable.cpp"
+#include "BayAllocator.cpp"
+#include "ParkingSiteManager.cpp"
+#include "Journal.cpp"
+#include "MappedFile.cpp"
+#include "BinaryLog.cpp"
+#include "TicketGenerator.cpp"
+#include "TariffTable.cpp"
+#include "LatencyHistogram.cpp"
+#include "GateMetrics.cpp"
+#include "MetricsSnapshot.cpp"
+#include "BookingCalendar.cpp"
+#include "LicensePlateTrie.cpp"
+#include "DwellTimeSketch.cpp"
+#include "OccupancyAnalytics.cpp"
+#include "OccupancyForecaster.cpp"
+#include "LotTopology.cpp"
+#include "ZonedBayAllocator.cpp"
+#include "ColumnarExport.cpp"
+#include "ColumnarExportSink.cpp"
+#include "BinaryLog.h"
+#include "BookingCalendar.h"
+#include "BookingException.h"
+#include "ColumnarExport.h"
+#include "ColumnarExportSink.h"
+#include "ExportException.h"
+#include "LatencyHistogram.h"
+#include "LicensePlateTrie.h"
+#include "OccupancyAnalytics.h"
+#include "OccupancyForecaster.h"
+#include "ZonedBayAllocator.h"
+#include "ConsoleEventSink.h"
+#include "NullEventSink.h"
+#include "ParkingSiteManager.h"
+#include "SiteNotFoundException.h"
+#include "TariffException.h"
+#include "TariffTable.h"
 
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
 #include <iostream>
+#include <map>
 #include <memory>
+#include <queue>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+    std::vector<std::string> readLines(const std::string & file_path)
+    {
+        std::vector<std::string> lines;
+        std::ifstream file(file_path);
+        std::string line;
+        while (std::getline(file, line))
+        {
+            lines.push_back(line);
+        }
+        return lines;
+    }
+
+    thread_local bool g_count_allocations = false;
+    thread_local std::size_t g_allocations = 0;
+
+    /// \brief Counts the heap allocations of the current thread while it is in scope
+    class AllocationCounter
+    {
+    public:
+        AllocationCounter() { g_allocations = 0; g_count_allocations = true; }
+        ~AllocationCounter() { g_count_allocations = false; }
+
+        std::size_t count() const { return g_allocations; }
+    };
+
+#ifdef _MSC_VER
+#define TEST_NOINLINE __declspec(noinline)
+#else
+#define TEST_NOINLINE __attribute__((noinline))
+#endif
+
+    /// \brief Frees the memory of the replaced operator new
+    /// Not inlined, so the compiler does not pair the free with the operator new at the call sites of delete.
+    TEST_NOINLINE void freeAllocation(void * memory) noexcept
+    {
+        std::free(memory);
+    }
+}
+
+void * operator new(std::size_t size)
+{
+    if (g_count_allocations)
+    {
+        ++g_allocations;
+    }
+    if (void * memory = std::malloc(size == 0 ? 1 : size))
+    {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void * memory) noexcept
+{
+    freeAllocation(memory);
+}
+
+void operator delete(void * memory, std::size_t) noexcept
+{
+    freeAllocation(memory);
+}
 
 TEST(ParkingLotTest, GetInstanceReturnsValidInstance)
 {
@@ -113,7 +231,7 @@ TEST(ParkingLotTest, ReleaseVehicleByTicketID)
     // Park a car and get its ticket ID
     std::shared_ptr<Car> car = std::make_shared<Car>("CAR0015", 2.0);
     EXPECT_TRUE(parkingLot->parkVehicle(car));
-    int ticket_id = parkingLot->getTicketIDByLicensePlate("CAR0015");
+    TicketID ticket_id = parkingLot->getTicketIDByLicensePlate("CAR0015");
 
     // Release the car by ticket ID
     EXPECT_TRUE(parkingLot->releaseVehicleByTicketID(ticket_id));
@@ -263,4 +381,2236 @@ TEST(ParkingLotConcurrentTest, MixedParkingAndReleasing)
     {
         thread.join();
     }
+}
+
+TEST(ParkingLotTest, ReleaseByLicensePlateInvalidatesTicketID)
+{
+    std::shared_ptr<ParkingLot> parkingLot = ParkingLot::getInstance();
+
+    // Park a car, release it by license plate and check that its ticket is gone too
+    std::shared_ptr<Car> car = std::make_shared<Car>("CAR0040", 2.0);
+    EXPECT_TRUE(parkingLot->parkVehicle(car));
+    TicketID ticket_id = parkingLot->getTicketIDByLicensePlate("CAR0040");
+
+    EXPECT_TRUE(parkingLot->releaseVehicleByLicensePlate("CAR0040"));
+    EXPECT_THROW(parkingLot->releaseVehicleByTicketID(ticket_id), VehicleNotFoundException);
+}
+
+TEST(ParkingLotTest, ReleaseByTicketIDInvalidatesLicensePlate)
+{
+    std::shared_ptr<ParkingLot> parkingLot = ParkingLot::getInstance();
+
+    // Park a car, release it by ticket ID and check that its license plate is gone too
+    std::shared_ptr<Car> car = std::make_shared<Car>("CAR0041", 2.0);
+    EXPECT_TRUE(parkingLot->parkVehicle(car));
+    TicketID ticket_id = parkingLot->getTicketIDByLicensePlate("CAR0041");
+
+    EXPECT_TRUE(parkingLot->releaseVehicleByTicketID(ticket_id));
+    EXPECT_THROW(parkingLot->getTicketIDByLicensePlate("CAR0041"), VehicleNotFoundException);
+    EXPECT_THROW(parkingLot->releaseVehicleByTicketID(ticket_id), VehicleNotFoundException);
+}
+
+TEST(ParkingLotConcurrentTest, ConcurrentParkingIssuesUniqueTicketIDs)
+{
+    std::shared_ptr<ParkingLot> parkingLot = ParkingLot::getInstance();
+
+    // Park cars from several threads, their plates end up in different shards
+    std::vector<std::thread> threads;
+    std::vector<std::vector<TicketID>> ticket_ids(4);
+    for (int i = 0; i < 4; ++i)
+    {
+        threads.emplace_back([parkingLot, i, &ticket_ids]()
+        {
+            for (int j = 0; j < 8; ++j)
+            {
+                std::string license_plate = "CAR05" + std::to_string(i) + std::to_string(j);
+                EXPECT_TRUE(parkingLot->parkVehicle(std::make_shared<Car>(license_plate, 2.0)));
+                ticket_ids[i].push_back(parkingLot->getTicketIDByLicensePlate(license_plate));
+            }
+        });
+    }
+
+    for (auto & thread : threads)
+    {
+        thread.join();
+    }
+
+    // Every ticket ID is unique and releases exactly one vehicle
+    std::set<TicketID> unique_ticket_ids;
+    for (const auto & thread_ticket_ids : ticket_ids)
+    {
+        unique_ticket_ids.insert(thread_ticket_ids.begin(), thread_ticket_ids.end());
+    }
+    EXPECT_EQ(unique_ticket_ids.size(), 32u);
+
+    for (TicketID ticket_id : unique_ticket_ids)
+    {
+        EXPECT_TRUE(parkingLot->releaseVehicleByTicketID(ticket_id));
+    }
+}
+
+TEST(ParkingLotTest, ParkingWritesLogEntry)
+{
+    std::shared_ptr<ParkingLot> parkingLot = ParkingLot::getInstance();
+
+    std::shared_ptr<Car> car = std::make_shared<Car>("CAR0042", 2.0);
+    EXPECT_TRUE(parkingLot->parkVehicle(car));
+    TicketID ticket_id = parkingLot->getTicketIDByLicensePlate("CAR0042");
+    EXPECT_TRUE(parkingLot->releaseVehicleByLicensePlate("CAR0042"));
+
+    // The entries are written by the logger thread, flushLog waits for them
+    parkingLot->flushLog();
+    std::vector<std::string> lines = readLines("parking_log.txt");
+    std::string expected_entry = "Entry: Ticket ID " + std::to_string(ticket_id) + ", Car with license plate CAR0042";
+    std::string expected_exit = "Exit: Ticket ID " + std::to_string(ticket_id) + ", Car with license plate CAR0042";
+    EXPECT_NE(std::find(lines.begin(), lines.end(), expected_entry), lines.end());
+    EXPECT_NE(std::find(lines.begin(), lines.end(), expected_exit), lines.end());
+}
+
+TEST(AsyncLoggerTest, WritesAllEntriesInOrderOnDestruction)
+{
+    const std::string file_path = "async_logger_test.txt";
+    std::remove(file_path.c_str());
+
+    {
+        AsyncLoggerConfig config;
+        config.file_path = file_path;
+        config.buffer_capacity = 64;
+        AsyncLogger logger(config);
+        for (int i = 0; i < 1000; ++i)
+        {
+            EXPECT_TRUE(logger.log("Entry", VehicleType::Car, "CAR" + std::to_string(i), i, i));
+        }
+    }
+
+    std::vector<std::string> lines = readLines(file_path);
+    ASSERT_EQ(lines.size(), 1000u);
+    for (int i = 0; i < 1000; ++i)
+    {
+        EXPECT_EQ(lines[i], "Entry: Ticket ID " + std::to_string(i) + ", Car with license plate CAR" + std::to_string(i));
+    }
+}
+
+TEST(AsyncLoggerTest, FlushWritesPendingEntries)
+{
+    const std::string file_path = "async_logger_flush_test.txt";
+    std::remove(file_path.c_str());
+
+    AsyncLoggerConfig config;
+    config.file_path = file_path;
+    config.flush_interval = std::chrono::milliseconds(10000);
+    AsyncLogger logger(config);
+    logger.log("Entry", VehicleType::Bus, "BUS1", 1, 1);
+    logger.log("Exit", VehicleType::Bus, "BUS1", 1, 2);
+    logger.flush();
+
+    std::vector<std::string> lines = readLines(file_path);
+    ASSERT_EQ(lines.size(), 2u);
+    EXPECT_EQ(lines[1], "Exit: Ticket ID 1, Bus with license plate BUS1");
+}
+
+TEST(AsyncLoggerTest, DropNewestPolicyCountsDroppedEntries)
+{
+    const std::string file_path = "async_logger_drop_test.txt";
+    std::remove(file_path.c_str());
+
+    int accepted = 0;
+    std::size_t dropped = 0;
+    {
+        AsyncLoggerConfig config;
+        config.file_path = file_path;
+        config.buffer_capacity = 2;
+        config.overflow_policy = LogOverflowPolicy::DropNewest;
+        AsyncLogger logger(config);
+        for (int i = 0; i < 10000; ++i)
+        {
+            accepted += logger.log("Entry", VehicleType::Motorcycle, "MOTO" + std::to_string(i), i, i) ? 1 : 0;
+        }
+        dropped = logger.droppedCount();
+    }
+
+    // Every entry is either written or counted as dropped
+    EXPECT_EQ(static_cast<std::size_t>(accepted) + dropped, 10000u);
+    EXPECT_EQ(readLines(file_path).size(), static_cast<std::size_t>(accepted));
+}
+
+TEST(ParkingLotTest, EventsAreSentToEventSink)
+{
+    std::shared_ptr<ParkingLot> parkingLot = ParkingLot::getInstance();
+
+    std::ostringstream out;
+    std::shared_ptr<BufferedEventSink> event_sink = std::make_shared<BufferedEventSink>(out);
+    parkingLot->setEventSink(event_sink);
+
+    std::shared_ptr<Bus> bus = std::make_shared<Bus>("BUS0043", 1.0);
+    EXPECT_TRUE(parkingLot->parkVehicle(bus));
+    EXPECT_FALSE(parkingLot->parkVehicle(bus));
+    ParkingResult ticket = parkingLot->tryGetTicketIDByLicensePlate("BUS0043");
+    EXPECT_TRUE(parkingLot->releaseVehicleByTicketID(ticket.ticket_id));
+    EXPECT_THROW(parkingLot->releaseVehicleByLicensePlate("BUS0043"), VehicleNotFoundException);
+
+    // Nothing is written until the batch is full or the sink is flushed
+    EXPECT_TRUE(out.str().empty());
+    event_sink->flush();
+    parkingLot->setEventSink(std::make_shared<ConsoleEventSink>());
+
+    EXPECT_EQ(out.str(),
+        "Bus with license plate BUS0043 parked. Ticket ID: " + std::to_string(ticket.ticket_id) + ", bay: " + std::to_string(ticket.bay) + "\n"
+        "Bus with license plate BUS0043 is already parked.\n"
+        "Bus with license plate BUS0043 released. Charge: $5\n"
+        "Vehicle with license plate BUS0043 is not found in the parking lot.\n");
+}
+
+TEST(BufferedEventSinkTest, WritesFullBatches)
+{
+    std::ostringstream out;
+    BufferedEventSink event_sink(out, 2);
+
+    ParkingEvent event{ ParkingEventType::Full, VehicleType::Car, "CAR1" };
+    event_sink.onEvent(event);
+    EXPECT_TRUE(out.str().empty());
+    event_sink.onEvent(event);
+    EXPECT_EQ(out.str(),
+        "Parking lot is full for Car, Car with license plate CAR1 is not parked.\n"
+        "Parking lot is full for Car, Car with license plate CAR1 is not parked.\n");
+}
+
+TEST(BufferedEventSinkTest, BatchesOfConcurrentGatesStayInOrder)
+{
+    const int thread_count = 8;
+    const int events_per_thread = 5000;
+    std::ostringstream out;
+    {
+        BufferedEventSink event_sink(out, 2);
+        std::vector<std::thread> gates;
+        for (int i = 0; i < thread_count; ++i)
+        {
+            gates.emplace_back([&event_sink, i]()
+            {
+                for (int j = 0; j < events_per_thread; ++j)
+                {
+                    event_sink.onEvent(ParkingEvent{ ParkingEventType::NotFound, VehicleType::Car, LicensePlate(), static_cast<TicketID>(i) * events_per_thread + j });
+                }
+            });
+        }
+        for (auto & gate : gates)
+        {
+            gate.join();
+        }
+    }
+
+    // Every gate's events appear in the order it reported them
+    std::vector<TicketID> last(thread_count, -1);
+    std::istringstream lines(out.str());
+    std::string line;
+    int count = 0;
+    while (std::getline(lines, line))
+    {
+        TicketID ticket_id = std::stoll(line.substr(std::string("Vehicle with ticket ID ").size()));
+        ASSERT_GT(ticket_id, last[ticket_id / events_per_thread]);
+        last[ticket_id / events_per_thread] = ticket_id;
+        ++count;
+    }
+    EXPECT_EQ(count, thread_count * events_per_thread);
+}
+
+TEST(VehicleTest, VehicleTypeIsSetBySubclasses)
+{
+    EXPECT_EQ(Car("CAR1", 1.0).getType(), VehicleType::Car);
+    EXPECT_EQ(Motorcycle("MOTO1", 1.0).getType(), VehicleType::Motorcycle);
+    EXPECT_EQ(Bus("BUS1", 1.0).getType(), VehicleType::Bus);
+
+    // The names are only used for printing and logging
+    EXPECT_EQ(Car("CAR1", 1.0).getVehicleType(), "Car");
+    EXPECT_EQ(Motorcycle("MOTO1", 1.0).getVehicleType(), "Motorcycle");
+    EXPECT_EQ(Bus("BUS1", 1.0).getVehicleType(), "Bus");
+}
+
+TEST(ParkingLotTest, ParkAndReleaseVehiclesInBulk)
+{
+    std::shared_ptr<ParkingLot> parkingLot = ParkingLot::getInstance();
+
+    std::vector<std::shared_ptr<Vehicle>> vehicles;
+    std::vector<std::string> license_plates;
+    for (int i = 0; i < 50; ++i)
+    {
+        license_plates.push_back("MOTO06" + std::to_string(i));
+        vehicles.push_back(std::make_shared<Motorcycle>(license_plates.back(), 1.0));
+    }
+    // The same vehicle twice in one burst is only parked once
+    vehicles.push_back(vehicles.front());
+
+    std::vector<ParkingResult> park_results = parkingLot->parkVehicles(vehicles);
+    ASSERT_EQ(park_results.size(), vehicles.size());
+    for (int i = 0; i < 50; ++i)
+    {
+        EXPECT_EQ(park_results[i].status, ParkingEventType::Parked);
+        EXPECT_EQ(park_results[i].ticket_id, parkingLot->getTicketIDByLicensePlate(license_plates[i]));
+    }
+    EXPECT_EQ(park_results.back().status, ParkingEventType::AlreadyParked);
+
+    // An unknown license plate does not stop the rest of the burst
+    license_plates.push_back("UNKNOWN06");
+    std::vector<ParkingResult> release_results = parkingLot->releaseVehicles(license_plates);
+    ASSERT_EQ(release_results.size(), license_plates.size());
+    for (int i = 0; i < 50; ++i)
+    {
+        EXPECT_TRUE(release_results[i].succeeded());
+        EXPECT_EQ(release_results[i].ticket_id, park_results[i].ticket_id);
+        EXPECT_DOUBLE_EQ(release_results[i].charge, 1.0);
+    }
+    EXPECT_EQ(release_results.back().status, ParkingEventType::NotFound);
+    EXPECT_THROW(parkingLot->getTicketIDByLicensePlate(license_plates.front()), VehicleNotFoundException);
+}
+
+TEST(AsyncLoggerTest, BatchEntriesAreWrittenTogether)
+{
+    const std::string file_path = "async_logger_batch_test.txt";
+    std::remove(file_path.c_str());
+
+    {
+        AsyncLoggerConfig config;
+        config.file_path = file_path;
+        config.buffer_capacity = 16;
+        AsyncLogger logger(config);
+
+        // Larger than the buffer, the batch is queued in parts
+        std::vector<LogRecord> records;
+        for (int i = 0; i < 40; ++i)
+        {
+            records.push_back(AsyncLogger::makeRecord("Exit", VehicleType::Car, "CAR" + std::to_string(i), i, i));
+        }
+        EXPECT_EQ(logger.logBatch(records.data(), records.size()), 40u);
+    }
+
+    std::vector<std::string> lines = readLines(file_path);
+    ASSERT_EQ(lines.size(), 40u);
+    EXPECT_EQ(lines[39], "Exit: Ticket ID 39, Car with license plate CAR39");
+}
+
+TEST(ParkingLotTest, TryFunctionsReportOutcomesWithoutThrowing)
+{
+    std::shared_ptr<ParkingLot> parkingLot = ParkingLot::getInstance();
+
+    // Fill the bus slots until the lot reports Full instead of throwing
+    std::vector<std::string> license_plates;
+    ParkingResult result;
+    for (int i = 0; i < 1000; ++i)
+    {
+        license_plates.push_back("BUS07" + std::to_string(i));
+        result = parkingLot->tryParkVehicle(std::make_shared<Bus>(license_plates.back(), 1.0));
+        if (result.status != ParkingEventType::Parked)
+        {
+            license_plates.pop_back();
+            break;
+        }
+    }
+    EXPECT_EQ(result.status, ParkingEventType::Full);
+    EXPECT_FALSE(result.succeeded());
+
+    EXPECT_EQ(parkingLot->tryParkVehicle(std::make_shared<Bus>(license_plates.front(), 1.0)).status, ParkingEventType::AlreadyParked);
+    EXPECT_EQ(parkingLot->tryGetTicketIDByLicensePlate("UNKNOWN07").status, ParkingEventType::NotFound);
+    EXPECT_EQ(parkingLot->tryReleaseVehicleByLicensePlate("UNKNOWN07").status, ParkingEventType::NotFound);
+    EXPECT_EQ(parkingLot->tryReleaseVehicleByTicketID(-7).status, ParkingEventType::NotFound);
+
+    ParkingResult ticket = parkingLot->tryGetTicketIDByLicensePlate(license_plates.front());
+    ASSERT_EQ(ticket.status, ParkingEventType::Parked);
+    result = parkingLot->tryReleaseVehicleByTicketID(ticket.ticket_id);
+    EXPECT_EQ(result.status, ParkingEventType::Released);
+    EXPECT_DOUBLE_EQ(result.charge, 5.0);
+
+    for (std::size_t i = 1; i < license_plates.size(); ++i)
+    {
+        EXPECT_TRUE(parkingLot->tryReleaseVehicleByLicensePlate(license_plates[i]).succeeded());
+    }
+}
+
+TEST(ParkingLotTest, ParkAndReleaseDoNotAllocate)
+{
+    std::shared_ptr<ParkingLot> parkingLot = ParkingLot::getInstance();
+    parkingLot->setEventSink(std::make_shared<NullEventSink>());
+    std::shared_ptr<Vehicle> car = std::make_shared<Car>("CAR08", 2.0);
+
+    // The shard storage grows on first use only
+    parkingLot->tryReleaseVehicleByTicketID(parkingLot->tryParkVehicle(car).ticket_id);
+
+    int succeeded = 0;
+    std::size_t allocations = 0;
+    {
+        AllocationCounter counter;
+        for (int i = 0; i < 100; ++i)
+        {
+            ParkingResult parked = parkingLot->tryParkVehicle(car);
+            ParkingResult ticket = parkingLot->tryGetTicketIDByLicensePlate("CAR08");
+            ParkingResult released = parkingLot->tryReleaseVehicleByTicketID(ticket.ticket_id);
+            succeeded += parked.succeeded() && released.succeeded();
+
+            succeeded += parkingLot->tryParkVehicle(car).succeeded() && parkingLot->tryReleaseVehicleByLicensePlate("CAR08").succeeded();
+        }
+        allocations = counter.count();
+    }
+    parkingLot->setEventSink(std::make_shared<ConsoleEventSink>());
+
+    EXPECT_EQ(succeeded, 200);
+    EXPECT_EQ(allocations, 0u);
+}
+
+TEST(ParkingLotTest, LicensePlateLongerThanMaximumIsRejected)
+{
+    std::string license_plate(LicensePlate::kMaxLength + 1, 'X');
+    EXPECT_THROW(std::make_shared<Car>(license_plate, 1.0), InvalidLicensePlateException);
+
+    std::shared_ptr<ParkingLot> parkingLot = ParkingLot::getInstance();
+    EXPECT_EQ(parkingLot->tryReleaseVehicleByLicensePlate(license_plate).status, ParkingEventType::NotFound);
+    EXPECT_THROW(parkingLot->getTicketIDByLicensePlate(license_plate), VehicleNotFoundException);
+}
+
+TEST(ParkingLotTest, ParkedVehiclesGetDistinctBays)
+{
+    std::shared_ptr<ParkingLot> parkingLot = ParkingLot::getInstance();
+
+    std::vector<std::shared_ptr<Vehicle>> motorcycles;
+    for (int i = 0; i < 50; ++i)
+    {
+        motorcycles.push_back(std::make_shared<Motorcycle>("MOTO09" + std::to_string(i), 1.0));
+    }
+    std::vector<ParkingResult> parked = parkingLot->parkVehicles(motorcycles);
+
+    std::set<int> bays;
+    for (std::size_t i = 0; i < parked.size(); ++i)
+    {
+        ASSERT_EQ(parked[i].status, ParkingEventType::Parked);
+        EXPECT_GE(parked[i].bay, 1);
+        EXPECT_LE(parked[i].bay, 200);
+        EXPECT_EQ(parkingLot->tryGetTicketIDByLicensePlate(motorcycles[i]->getLicensePlateView()).bay, parked[i].bay);
+        bays.insert(parked[i].bay);
+    }
+    EXPECT_EQ(bays.size(), parked.size());
+
+    // A released bay is the lowest free one, so the next vehicle gets it
+    int freed_bay = *bays.begin();
+    std::size_t freed = 0;
+    for (; parked[freed].bay != freed_bay; ++freed) {}
+    EXPECT_EQ(parkingLot->tryReleaseVehicleByLicensePlate(motorcycles[freed]->getLicensePlateView()).bay, freed_bay);
+    ParkingResult reparked = parkingLot->tryParkVehicle(motorcycles[freed]);
+    EXPECT_EQ(reparked.bay, freed_bay);
+
+    std::vector<std::string> license_plates;
+    for (const auto & motorcycle : motorcycles)
+    {
+        license_plates.push_back(motorcycle->getLicensePlate());
+    }
+    parkingLot->releaseVehicles(license_plates);
+}
+
+TEST(BayAllocatorTest, AllocatesLowestFreeBayAcrossWords)
+{
+    BayAllocator bays(130);
+
+    for (int bay = 0; bay < 130; ++bay)
+    {
+        ASSERT_EQ(bays.allocate(), bay);
+    }
+    EXPECT_EQ(bays.allocate(), BayAllocator::kNoBay);
+
+    bays.release(129);
+    bays.release(64);
+    bays.release(3);
+    EXPECT_TRUE(bays.isFree(64));
+    EXPECT_EQ(bays.allocate(), 3);
+    EXPECT_EQ(bays.allocate(), 64);
+    EXPECT_EQ(bays.allocate(), 129);
+    EXPECT_EQ(bays.allocate(), BayAllocator::kNoBay);
+}
+
+TEST(BayAllocatorTest, ConcurrentAllocationsGetDistinctBays)
+{
+    const int bay_count = 100000;
+    const int thread_count = 4;
+    BayAllocator bays(bay_count);
+
+    std::vector<std::vector<int>> taken(thread_count);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < thread_count; ++i)
+    {
+        threads.emplace_back([&bays, &taken, i, bay_count, thread_count]()
+        {
+            for (int j = 0; j < bay_count / thread_count; ++j)
+            {
+                int bay = bays.allocate();
+                taken[i].push_back(bay);
+
+                // Give some bays back and take them again, so words fill up and free up concurrently
+                if (j % 3 == 0)
+                {
+                    bays.release(bay);
+                    taken[i].back() = bays.allocate();
+                }
+            }
+        });
+    }
+    for (auto & thread : threads)
+    {
+        thread.join();
+    }
+
+    std::set<int> unique_bays;
+    for (const auto & thread_bays : taken)
+    {
+        unique_bays.insert(thread_bays.begin(), thread_bays.end());
+    }
+    EXPECT_EQ(unique_bays.size(), static_cast<std::size_t>(bay_count));
+    EXPECT_EQ(unique_bays.count(BayAllocator::kNoBay), 0u);
+    EXPECT_EQ(bays.allocate(), BayAllocator::kNoBay);
+}
+
+TEST(ParkingLotTest, OccupancySnapshotFollowsParkAndRelease)
+{
+    std::shared_ptr<ParkingLot> parkingLot = ParkingLot::getInstance();
+
+    OccupancySnapshot before = parkingLot->getOccupancySnapshot();
+    EXPECT_EQ(before[VehicleType::Car].capacity, 200);
+    EXPECT_EQ(before[VehicleType::Car].available(), 200 - before[VehicleType::Car].occupied);
+
+    std::shared_ptr<Car> car = std::make_shared<Car>("CAR10", 1.0);
+    EXPECT_TRUE(parkingLot->parkVehicle(car));
+    EXPECT_EQ(parkingLot->getOccupancy(VehicleType::Car).occupied, before[VehicleType::Car].occupied + 1);
+    EXPECT_EQ(parkingLot->getOccupancy(VehicleType::Bus).occupied, before[VehicleType::Bus].occupied);
+
+    EXPECT_TRUE(parkingLot->releaseVehicleByLicensePlate("CAR10"));
+    EXPECT_EQ(parkingLot->getOccupancySnapshot()[VehicleType::Car].occupied, before[VehicleType::Car].occupied);
+}
+
+TEST(ParkingSiteManagerTest, SitesAreIndependent)
+{
+    ParkingSiteManager manager;
+    ASSERT_NE(manager.addSite(1, 1, 1, 1), nullptr);
+    ASSERT_NE(manager.addSite(2, 2, 1, 1), nullptr);
+    EXPECT_EQ(manager.addSite(1, 5, 5, 5), nullptr);
+    EXPECT_EQ(manager.siteIDs().size(), 2u);
+    manager.site(1).setEventSink(std::make_shared<NullEventSink>());
+    manager.site(2).setEventSink(std::make_shared<NullEventSink>());
+
+    // The same vehicle may be parked at both sites, each has its own capacity and bays
+    std::shared_ptr<Car> car = std::make_shared<Car>("CAR11", 1.0);
+    ParkingResult first = manager.site(1).tryParkVehicle(car);
+    ParkingResult second = manager.site(2).tryParkVehicle(car);
+    EXPECT_EQ(first.status, ParkingEventType::Parked);
+    EXPECT_EQ(second.status, ParkingEventType::Parked);
+    EXPECT_EQ(first.bay, 1);
+    EXPECT_EQ(second.bay, 1);
+    EXPECT_EQ(manager.site(1).tryParkVehicle(std::make_shared<Car>("CAR11B", 1.0)).status, ParkingEventType::Full);
+    EXPECT_EQ(manager.site(2).tryParkVehicle(std::make_shared<Car>("CAR11B", 1.0)).status, ParkingEventType::Parked);
+    EXPECT_EQ(manager.findSite(2)->getOccupancy(VehicleType::Car).occupied, 2);
+
+    EXPECT_TRUE(manager.site(1).tryReleaseVehicleByLicensePlate("CAR11").succeeded());
+    EXPECT_EQ(manager.site(1).getOccupancy(VehicleType::Car).occupied, 0);
+    EXPECT_EQ(manager.site(2).getOccupancy(VehicleType::Car).occupied, 2);
+
+    EXPECT_THROW(manager.site(3), SiteNotFoundException);
+    EXPECT_EQ(manager.findSite(3), nullptr);
+
+    // Every site writes its own log
+    manager.site(1).flushLog();
+    std::vector<std::string> lines = readLines("parking_log_1.txt");
+    ASSERT_FALSE(lines.empty());
+    EXPECT_EQ(lines.back(), "Exit: Ticket ID " + std::to_string(first.ticket_id) + ", Car with license plate CAR11");
+}
+
+TEST(ParkingSiteManagerTest, SitesCanBeAddedWhileOthersAreUsed)
+{
+    ParkingSiteManager manager;
+    manager.addSite(0, 1000, 1000, 1000);
+    manager.site(0).setEventSink(std::make_shared<NullEventSink>());
+
+    std::atomic<bool> stop{ false };
+    std::atomic<int> parked{ 0 };
+    std::thread gate([&manager, &stop, &parked]()
+    {
+        std::shared_ptr<Car> car = std::make_shared<Car>("CAR11G", 1.0);
+        while (!stop.load() || parked.load() == 0)
+        {
+            parked += manager.site(0).tryParkVehicle(car).succeeded();
+            manager.site(0).tryReleaseVehicleByLicensePlate("CAR11G");
+        }
+    });
+
+    for (int site_id = 1; site_id <= 20; ++site_id)
+    {
+        ASSERT_NE(manager.addSite(site_id, 10, 10, 10), nullptr);
+    }
+    stop.store(true);
+    gate.join();
+
+    EXPECT_EQ(manager.siteIDs().size(), 21u);
+    EXPECT_GT(parked.load(), 0);
+}
+
+TEST(JournalTest, ParkedVehiclesSurviveRestart)
+{
+    JournalConfig config;
+    config.directory = "journal_restart_test";
+    std::filesystem::remove_all(config.directory);
+    std::filesystem::create_directory(config.directory);
+
+    std::vector<ParkingResult> parked;
+    {
+        ParkingSiteManager manager;
+        ParkingLot & site = *manager.addSite(12, 10, 10, 10);
+        site.setEventSink(std::make_shared<NullEventSink>());
+        EXPECT_EQ(site.openJournal(config).parked_vehicles, 0u);
+
+        parked.push_back(site.tryParkVehicle(std::make_shared<Car>("CAR12A", 3.0)));
+        parked.push_back(site.tryParkVehicle(std::make_shared<Bus>("BUS12B", 1.0)));
+        parked.push_back(site.tryParkVehicle(std::make_shared<Car>("CAR12C", 1.0)));
+        EXPECT_TRUE(site.tryReleaseVehicleByLicensePlate("CAR12A").succeeded());
+    }
+
+    ParkingSiteManager manager;
+    ParkingLot & site = *manager.addSite(12, 10, 10, 10);
+    site.setEventSink(std::make_shared<NullEventSink>());
+    JournalRecoveryStats stats = site.openJournal(config);
+    EXPECT_EQ(stats.journal_records, 4u);
+    EXPECT_EQ(stats.parked_vehicles, 2u);
+
+    EXPECT_EQ(site.tryGetTicketIDByLicensePlate("CAR12A").status, ParkingEventType::NotFound);
+    ParkingResult bus = site.tryGetTicketIDByLicensePlate("BUS12B");
+    EXPECT_EQ(bus.ticket_id, parked[1].ticket_id);
+    EXPECT_EQ(bus.bay, parked[1].bay);
+    EXPECT_EQ(site.getOccupancy(VehicleType::Car).occupied, 1);
+
+    // Ticket IDs issued before the restart, even released ones, are not issued again
+    std::set<TicketID> ticket_ids = { parked[0].ticket_id, parked[1].ticket_id, parked[2].ticket_id };
+    for (int i = 0; i < 20; ++i)
+    {
+        ParkingResult result = site.tryParkVehicle(std::make_shared<Motorcycle>("MOTO12" + std::to_string(i), 1.0));
+        if (result.succeeded())
+        {
+            EXPECT_TRUE(ticket_ids.insert(result.ticket_id).second);
+        }
+    }
+    EXPECT_TRUE(site.tryReleaseVehicleByTicketID(parked[2].ticket_id).succeeded());
+}
+
+TEST(JournalTest, RecoveryUsesSnapshotAndIgnoresTornTail)
+{
+    JournalConfig config;
+    config.directory = "journal_snapshot_test";
+    config.snapshot_interval = 5;
+    std::filesystem::remove_all(config.directory);
+    std::filesystem::create_directory(config.directory);
+
+    {
+        ParkingSiteManager manager;
+        ParkingLot & site = *manager.addSite(12, 100, 100, 100);
+        site.setEventSink(std::make_shared<NullEventSink>());
+        site.openJournal(config);
+        for (int i = 0; i < 30; ++i)
+        {
+            site.tryParkVehicle(std::make_shared<Car>("CAR12S" + std::to_string(i), 1.0));
+            if (i % 3 == 0)
+            {
+                site.tryReleaseVehicleByLicensePlate("CAR12S" + std::to_string(i));
+            }
+        }
+    }
+
+    // Snapshots replaced the older files, the last journal only holds the records written after its snapshot
+    std::vector<std::uint64_t> journals = Journal::listGenerations(config, false);
+    ASSERT_EQ(journals.size(), 1u);
+    EXPECT_EQ(Journal::listGenerations(config, true), journals);
+    std::uintmax_t journal_size = std::filesystem::file_size(Journal::journalPath(config, journals.back()));
+    EXPECT_LT(journal_size, 5 * Journal::kRecordSize);
+
+    // A record torn by a crash in the middle of a write
+    {
+        std::ofstream journal(Journal::journalPath(config, journals.back()), std::ios_base::app | std::ios_base::binary);
+        journal << "torn record";
+    }
+
+    ParkingSiteManager manager;
+    ParkingLot & site = *manager.addSite(12, 100, 100, 100);
+    JournalRecoveryStats stats = site.openJournal(config);
+    EXPECT_EQ(stats.journal_records, journal_size / Journal::kRecordSize);
+    EXPECT_EQ(stats.parked_vehicles, 20u);
+    EXPECT_EQ(site.getOccupancy(VehicleType::Car).occupied, 20);
+    EXPECT_EQ(site.tryGetTicketIDByLicensePlate("CAR12S0").status, ParkingEventType::NotFound);
+    EXPECT_EQ(site.tryGetTicketIDByLicensePlate("CAR12S29").status, ParkingEventType::Parked);
+}
+
+TEST(JournalTest, ConcurrentGatesShareGroupCommits)
+{
+    JournalConfig config;
+    config.directory = "journal_concurrent_test";
+    config.snapshot_interval = 50;
+    std::filesystem::remove_all(config.directory);
+    std::filesystem::create_directory(config.directory);
+
+    const int thread_count = 4;
+    const int vehicles_per_thread = 100;
+    {
+        ParkingSiteManager manager;
+        ParkingLot & site = *manager.addSite(12, 1000, 1000, 1000);
+        site.setEventSink(std::make_shared<NullEventSink>());
+        site.openJournal(config);
+
+        std::vector<std::thread> gates;
+        for (int i = 0; i < thread_count; ++i)
+        {
+            gates.emplace_back([&site, i]()
+            {
+                for (int j = 0; j < vehicles_per_thread; ++j)
+                {
+                    std::string license_plate = "CAR12T" + std::to_string(i) + "_" + std::to_string(j);
+                    site.tryParkVehicle(std::make_shared<Car>(license_plate, 1.0));
+                    if (j % 2 == 0)
+                    {
+                        site.tryReleaseVehicleByLicensePlate(license_plate);
+                    }
+                }
+            });
+        }
+        for (auto & gate : gates)
+        {
+            gate.join();
+        }
+    }
+
+    ParkingSiteManager manager;
+    ParkingLot & site = *manager.addSite(12, 1000, 1000, 1000);
+    EXPECT_EQ(site.openJournal(config).parked_vehicles, static_cast<std::size_t>(thread_count * vehicles_per_thread / 2));
+    EXPECT_EQ(site.tryGetTicketIDByLicensePlate("CAR12T3_99").status, ParkingEventType::Parked);
+    EXPECT_EQ(site.tryGetTicketIDByLicensePlate("CAR12T3_98").status, ParkingEventType::NotFound);
+}
+
+TEST(JournalTest, RecordsQueuedBeforeRotateStayInThePreviousFile)
+{
+    JournalConfig config;
+    config.directory = "journal_rotation_test";
+    std::filesystem::remove_all(config.directory);
+    std::filesystem::create_directory(config.directory);
+
+    auto record = [](TicketID ticket_id) { return ParkedRecord{ LicensePlate("CAR12J"), ticket_id, VehicleType::Car, 0, 1 }; };
+    auto ticketIDs = [&config](std::uint64_t generation)
+    {
+        std::vector<TicketID> ticket_ids;
+        Journal::replay(Journal::journalPath(config, generation), [&ticket_ids](JournalRecordKind, const ParkedRecord & parked) { ticket_ids.push_back(parked.ticket_id); });
+        return ticket_ids;
+    };
+    {
+        Journal journal(config, 1);
+        journal.append(JournalRecordKind::Park, record(1));
+        journal.prepareRotation(2);
+
+        // Appended after the next file is opened but before the swap, the record belongs to the previous file
+        journal.append(JournalRecordKind::Park, record(2));
+        journal.rotate();
+        EXPECT_EQ(journal.generation(), 2u);
+        std::uint64_t sequence = journal.append(JournalRecordKind::Park, record(3));
+        journal.finishRotation();
+        journal.waitDurable(sequence);
+    }
+    EXPECT_EQ(ticketIDs(1), std::vector<TicketID>({ 1, 2 }));
+    EXPECT_EQ(ticketIDs(2), std::vector<TicketID>({ 3 }));
+}
+
+TEST(JournalTest, UnwritableJournalIsReportedWithoutUndoingTheGateOperation)
+{
+    // Writes to /dev/full fail, the journal file the first checkpoint continues in is redirected there
+    if (!std::filesystem::exists("/dev/full"))
+    {
+        GTEST_SKIP();
+    }
+    JournalConfig config;
+    config.directory = "journal_failure_test";
+    config.snapshot_interval = 0;
+    std::filesystem::remove_all(config.directory);
+    std::filesystem::create_directory(config.directory);
+
+    ParkingSiteManager manager;
+    ParkingLot & site = *manager.addSite(12, 10, 10, 10);
+    std::ostringstream out;
+    std::shared_ptr<BufferedEventSink> event_sink = std::make_shared<BufferedEventSink>(out);
+    site.setEventSink(event_sink);
+    site.openJournal(config);
+    std::filesystem::create_symlink("/dev/full", Journal::journalPath(config, 2));
+    site.checkpoint();
+
+    // The vehicle went through the gate, it stays parked and its event is emitted
+    ParkingResult parked = site.tryParkVehicle(std::make_shared<Car>("CAR12F", 1.0));
+    EXPECT_EQ(parked.status, ParkingEventType::Parked);
+    EXPECT_FALSE(parked.durable);
+    EXPECT_EQ(site.tryGetTicketIDByLicensePlate("CAR12F").ticket_id, parked.ticket_id);
+    ParkingResult already_parked = site.tryParkVehicle(std::make_shared<Car>("CAR12F", 1.0));
+    EXPECT_EQ(already_parked.status, ParkingEventType::AlreadyParked);
+    EXPECT_TRUE(already_parked.durable);
+
+    // Outcomes that change nothing have nothing to lose on a restart and do not throw
+    EXPECT_FALSE(site.parkVehicle(std::make_shared<Car>("CAR12F", 1.0)));
+    EXPECT_TRUE(site.releaseVehicles({ "CAR12N" })[0].durable);
+
+    std::vector<ParkingResult> released = site.releaseVehicles({ "CAR12F" });
+    EXPECT_EQ(released[0].status, ParkingEventType::Released);
+    EXPECT_FALSE(released[0].durable);
+    EXPECT_THROW(site.parkVehicle(std::make_shared<Bus>("BUS12F", 1.0)), JournalException);
+    EXPECT_EQ(site.getOccupancy(VehicleType::Bus).occupied, 1);
+
+    event_sink->flush();
+    EXPECT_EQ(out.str(),
+        "Car with license plate CAR12F parked. Ticket ID: " + std::to_string(parked.ticket_id) + ", bay: 1\n"
+        "Car with license plate CAR12F is already parked.\n"
+        "Car with license plate CAR12F is already parked.\n"
+        "Vehicle with license plate CAR12N is not found in the parking lot.\n"
+        "Car with license plate CAR12F released. Charge: $2\n"
+        "Bus with license plate BUS12F parked. Ticket ID: " + std::to_string(site.tryGetTicketIDByLicensePlate("BUS12F").ticket_id) + ", bay: 1\n");
+}
+
+TEST(JournalTest, UnwritableJournalSkipsAutomaticSnapshots)
+{
+    // Writes to /dev/full fail, the journal file the first checkpoint continues in is redirected there
+    if (!std::filesystem::exists("/dev/full"))
+    {
+        GTEST_SKIP();
+    }
+    JournalConfig config;
+    config.directory = "journal_failure_interval_test";
+    config.snapshot_interval = 2;
+    std::filesystem::remove_all(config.directory);
+    std::filesystem::create_directory(config.directory);
+
+    ParkingSiteManager manager;
+    ParkingLot & site = *manager.addSite(12, 10, 10, 10);
+    site.setEventSink(nullptr);
+    site.openJournal(config);
+    std::filesystem::create_symlink("/dev/full", Journal::journalPath(config, 2));
+    site.checkpoint();
+
+    // The snapshot interval is reached by the second vehicle, no snapshot is attempted on the failed journal
+    for (int i = 0; i < 4; ++i)
+    {
+        ParkingResult parked;
+        ASSERT_NO_THROW(parked = site.tryParkVehicle(std::make_shared<Car>("CAR12I" + std::to_string(i), 1.0)));
+        EXPECT_EQ(parked.status, ParkingEventType::Parked);
+        EXPECT_FALSE(parked.durable);
+        EXPECT_EQ(site.getOccupancy(VehicleType::Car).occupied, i + 1);
+    }
+    std::vector<ParkingResult> released;
+    ASSERT_NO_THROW(released = site.releaseVehicles({ "CAR12I0", "CAR12I1" }));
+    EXPECT_EQ(released[1].status, ParkingEventType::Released);
+    EXPECT_FALSE(released[1].durable);
+    EXPECT_FALSE(std::filesystem::exists(Journal::journalPath(config, 3)));
+}
+
+TEST(JournalTest, JournalStaysInItsFileWhenTheNextOneCannotBeOpened)
+{
+    JournalConfig config;
+    config.directory = "journal_rotation_failure_test";
+    config.snapshot_interval = 2;
+    std::filesystem::remove_all(config.directory);
+    std::filesystem::create_directory(config.directory);
+    {
+        ParkingSiteManager manager;
+        ParkingLot & site = *manager.addSite(12, 10, 10, 10);
+        site.setEventSink(nullptr);
+        site.openJournal(config);
+
+        // A directory in place of the next journal file cannot be opened for appending
+        std::filesystem::create_directory(Journal::journalPath(config, 2));
+        EXPECT_TRUE(site.tryParkVehicle(std::make_shared<Car>("CAR12R0", 1.0)).durable);
+        EXPECT_FALSE(site.tryParkVehicle(std::make_shared<Car>("CAR12R1", 1.0)).durable);
+        EXPECT_THROW(site.checkpoint(), JournalException);
+
+        // The records go to the file that stayed open
+        std::filesystem::remove(Journal::journalPath(config, 2));
+        EXPECT_EQ(site.tryParkVehicle(std::make_shared<Car>("CAR12R2", 1.0)).status, ParkingEventType::Parked);
+    }
+
+    ParkingSiteManager manager;
+    ParkingLot & site = *manager.addSite(12, 10, 10, 10);
+    site.setEventSink(nullptr);
+    EXPECT_EQ(site.openJournal(config).parked_vehicles, 3u);
+    EXPECT_EQ(site.tryGetTicketIDByLicensePlate("CAR12R2").status, ParkingEventType::Parked);
+}
+
+namespace
+{
+    const std::int64_t kLogReplayTimeUs = 1700000000LL * 1000000;
+}
+
+TEST(BinaryLogTest, SegmentsRotateAndLicensePlatesAreInterned)
+{
+    const std::string directory = "binary_log_test";
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directory(directory);
+
+    AsyncLoggerConfig config;
+    config.file_path = directory + "/log.bin";
+    config.format = LogFormat::Binary;
+    config.max_segment_size = 11 * sizeof(BinaryLogRecord);
+    for (int run = 0; run < 2; ++run)
+    {
+        AsyncLogger logger(config);
+        for (int i = 0; i < 25; ++i)
+        {
+            logger.log(i % 2 == 0 ? "Entry" : "Exit", VehicleType::Bus, "BUS" + std::to_string(i % 5), run * 100 + i, run * 100 + i);
+        }
+    }
+
+    // Segments hold a header and 10 records, every logger starts a new segment
+    BinaryLogReader reader(config.file_path);
+    EXPECT_EQ(reader.segmentCount(), 6u);
+    EXPECT_EQ(reader.findPlate("BUS7"), BinaryLogReader::kUnknownPlate);
+    std::uint32_t plate_id = reader.findPlate("BUS3");
+    ASSERT_NE(plate_id, BinaryLogReader::kUnknownPlate);
+    EXPECT_EQ(reader.plate(plate_id), "BUS3");
+
+    std::vector<TicketID> ticket_ids;
+    std::int64_t last_timestamp = 0;
+    reader.forEachRecord([&](const BinaryLogRecord & record)
+    {
+        EXPECT_EQ(record.vehicle_type, VehicleType::Bus);
+        EXPECT_EQ(record.action, record.ticket_id % 2 == 0 ? LogAction::Entry : LogAction::Exit);
+        EXPECT_GE(record.timestamp_us, last_timestamp);
+        last_timestamp = record.timestamp_us;
+        if (record.plate_id == plate_id)
+        {
+            ticket_ids.push_back(record.ticket_id);
+        }
+    });
+    EXPECT_EQ(ticket_ids, std::vector<TicketID>({ 3, 8, 13, 18, 23, 103, 108, 113, 118, 123 }));
+}
+
+TEST(BinaryLogTest, WrittenRecordsOnlyReferToWrittenLicensePlates)
+{
+    const std::string directory = "binary_log_order_test";
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directory(directory);
+    const std::string log_path = directory + "/log.bin";
+
+    // More records than fit into the buffer, every one with a new license plate; nothing is flushed explicitly
+    BinaryLogWriter writer(log_path, 64 * 1024 * 1024);
+    for (int i = 0; i < 100000; ++i)
+    {
+        writer.write(AsyncLogger::makeRecord("Entry", VehicleType::Car, "ORDER" + std::to_string(i), i, i));
+    }
+
+    // What is in the files while the writer is still running is what a crash would leave
+    BinaryLogReader reader(log_path);
+    std::size_t count = 0;
+    reader.forEachRecord([&](const BinaryLogRecord & record)
+    {
+        EXPECT_EQ(reader.plate(record.plate_id), "ORDER" + std::to_string(record.ticket_id));
+        ++count;
+    });
+    EXPECT_GT(count, 0u);
+}
+
+TEST(BinaryLogTest, OccupancyCanBeReplayedFromTheLog)
+{
+    const std::string directory = "binary_log_site_test";
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directory(directory);
+
+    AsyncLoggerConfig config;
+    config.file_path = directory + "/log.bin";
+    config.format = LogFormat::Binary;
+    {
+        ParkingSiteManager manager;
+        ParkingLot & site = *manager.addSite(13, 10, 10, 10, config);
+        site.setEventSink(std::make_shared<NullEventSink>());
+        site.setClock([]() { return kLogReplayTimeUs; });
+        site.tryParkVehicle(std::make_shared<Car>("CAR13A", 1.0));
+        site.tryParkVehicle(std::make_shared<Car>("CAR13B", 1.0));
+        site.tryParkVehicle(std::make_shared<Motorcycle>("MOTO13A", 1.0));
+        site.tryReleaseVehicleByLicensePlate("CAR13A");
+    }
+
+    BinaryLogReader reader(config.file_path);
+    std::array<int, kVehicleTypeCount> occupied = {};
+    reader.forEachRecord([&](const BinaryLogRecord & record)
+    {
+        occupied[toIndex(record.vehicle_type)] += record.action == LogAction::Entry ? 1 : -1;
+        EXPECT_EQ(record.timestamp_us, kLogReplayTimeUs);
+    });
+    EXPECT_EQ(occupied[toIndex(VehicleType::Car)], 1);
+    EXPECT_EQ(occupied[toIndex(VehicleType::Motorcycle)], 1);
+    EXPECT_EQ(occupied[toIndex(VehicleType::Bus)], 0);
+}
+
+TEST(TicketGeneratorTest, BlocksAreUniqueAndContinueAfterRestart)
+{
+    const std::string state_path = "ticket_generator_test.state";
+    std::remove(state_path.c_str());
+
+    const int thread_count = 4;
+    const int blocks_per_thread = 200;
+    std::vector<std::vector<TicketBlock>> blocks(thread_count);
+    TicketID last_end = 0;
+    {
+        TicketGenerator generator(state_path, 16, 100);
+        std::vector<std::thread> threads;
+        for (int i = 0; i < thread_count; ++i)
+        {
+            threads.emplace_back([&generator, &blocks, i]()
+            {
+                for (int j = 0; j < blocks_per_thread; ++j)
+                {
+                    blocks[i].push_back(generator.nextBlock());
+                }
+            });
+        }
+        for (auto & thread : threads)
+        {
+            thread.join();
+        }
+        last_end = generator.nextSequence();
+    }
+
+    std::set<TicketID> firsts;
+    for (const auto & thread_blocks : blocks)
+    {
+        for (std::size_t j = 0; j < thread_blocks.size(); ++j)
+        {
+            EXPECT_EQ(thread_blocks[j].end - thread_blocks[j].first, 16);
+            EXPECT_EQ(thread_blocks[j].first % 16, 1);
+            EXPECT_TRUE(firsts.insert(thread_blocks[j].first).second);
+            if (j > 0)
+            {
+                EXPECT_GT(thread_blocks[j].first, thread_blocks[j - 1].first);
+            }
+        }
+    }
+
+    TicketGenerator restarted(state_path, 16, 100);
+    EXPECT_GE(restarted.nextBlock().first, last_end);
+}
+
+TEST(TicketGeneratorTest, SitesShareTheTicketGenerator)
+{
+    ParkingSiteManager manager;
+    ParkingLot & first_site = *manager.addSite(14, 100, 100, 100);
+    ParkingLot & second_site = *manager.addSite(15, 100, 100, 100);
+    first_site.setEventSink(std::make_shared<NullEventSink>());
+    second_site.setEventSink(std::make_shared<NullEventSink>());
+
+    std::set<TicketID> ticket_ids;
+    for (int i = 0; i < 50; ++i)
+    {
+        // The same license plates land in the same shards of both sites
+        std::string license_plate = "CAR14_" + std::to_string(i);
+        ParkingResult first = first_site.tryParkVehicle(std::make_shared<Car>(license_plate, 1.0));
+        ParkingResult second = second_site.tryParkVehicle(std::make_shared<Car>(license_plate, 1.0));
+        ASSERT_TRUE(first.succeeded() && second.succeeded());
+        EXPECT_TRUE(ticket_ids.insert(first.ticket_id).second);
+        EXPECT_TRUE(ticket_ids.insert(second.ticket_id).second);
+    }
+
+    // A ticket ID is only known to the site that issued it
+    TicketID ticket_id = *ticket_ids.rbegin();
+    int released = (first_site.tryReleaseVehicleByTicketID(ticket_id).succeeded() ? 1 : 0)
+        + (second_site.tryReleaseVehicleByTicketID(ticket_id).succeeded() ? 1 : 0);
+    EXPECT_EQ(released, 1);
+}
+
+TEST(TicketGeneratorTest, VehiclesWithoutTicketAreReportedWithoutThrowing)
+{
+    const std::string state_directory = "ticket_generator_failure_test";
+    std::filesystem::remove_all(state_directory);
+    std::filesystem::create_directory(state_directory);
+
+    // Blocks of one number with three numbers reserved, the fourth ticket needs the state file written
+    ParkingSiteManager manager(std::make_shared<TicketGenerator>(state_directory + "/state", 1, 2));
+    ParkingLot & site = *manager.addSite(28, 10, 10, 10);
+    std::ostringstream out;
+    std::shared_ptr<BufferedEventSink> event_sink = std::make_shared<BufferedEventSink>(out);
+    site.setEventSink(event_sink);
+    std::filesystem::remove_all(state_directory);
+
+    std::vector<std::shared_ptr<Vehicle>> vehicles;
+    for (int i = 0; i < 5; ++i)
+    {
+        vehicles.push_back(std::make_shared<Car>("CAR28T" + std::to_string(i), 1.0));
+    }
+    std::vector<ParkingResult> results;
+    ASSERT_NO_THROW(results = site.parkVehicles(vehicles));
+
+    // The batch goes on after the first vehicle without a ticket, every vehicle's event is emitted
+    int parked = 0;
+    for (const auto & result : results)
+    {
+        EXPECT_TRUE(result.status == ParkingEventType::Parked || result.status == ParkingEventType::NoTicket);
+        parked += result.succeeded() ? 1 : 0;
+    }
+    EXPECT_EQ(parked, 3);
+    EXPECT_EQ(site.getOccupancy(VehicleType::Car).occupied, 3);
+    EXPECT_EQ(site.tryParkVehicle(std::make_shared<Car>("CAR28T5", 1.0)).status, ParkingEventType::NoTicket);
+    EXPECT_THROW(site.parkVehicle(std::make_shared<Car>("CAR28T6", 1.0)), TicketGeneratorException);
+
+    event_sink->flush();
+    std::istringstream lines(out.str());
+    std::string line;
+    int emitted = 0;
+    while (std::getline(lines, line))
+    {
+        ++emitted;
+    }
+    EXPECT_EQ(emitted, 7);
+    EXPECT_NE(out.str().find("No ticket can be issued, Car with license plate CAR28T5 is not parked.\n"), std::string::npos);
+}
+
+TEST(TariffTableTest, LoadsRatesBandsAndCaps)
+{
+    const std::string path = "tariff_test.txt";
+    {
+        std::ofstream file(path);
+        file << "# Night rate for everybody, daily cap for cars\n"
+             << "rate Car 3 2 20\n"
+             << "band All 22 6 0.5\n"
+             << "utc_offset_minutes 60\n";
+    }
+    TariffTable tariffs = TariffTable::load(path);
+    std::remove(path.c_str());
+
+    const std::int64_t kHour = 3600LL * 1000000;
+    const std::int64_t kDay = 24 * kHour;
+    EXPECT_DOUBLE_EQ(tariffs.rates(VehicleType::Car).daily_cap, 20.0);
+    EXPECT_DOUBLE_EQ(tariffs.rates(VehicleType::Bus).first_hour, 5.0);
+
+    // 10:00 UTC is 11:00 local, 2.5 hours cost 3 + 1.5 * 2
+    EXPECT_DOUBLE_EQ(tariffs.charge(VehicleType::Car, 10 * kHour, 10 * kHour + 5 * kHour / 2), 6.0);
+
+    // 21:30 UTC is 22:30 local, the night band halves the charge
+    EXPECT_DOUBLE_EQ(tariffs.charge(VehicleType::Car, 21 * kHour + kHour / 2, 23 * kHour + kHour / 2), 2.5);
+    EXPECT_DOUBLE_EQ(tariffs.charge(VehicleType::Motorcycle, 21 * kHour + kHour / 2, 22 * kHour + kHour / 2), 0.5);
+
+    // The cap applies per started day
+    EXPECT_DOUBLE_EQ(tariffs.charge(VehicleType::Car, 10 * kHour, 10 * kHour + 20 * kHour), 20.0);
+    EXPECT_DOUBLE_EQ(tariffs.charge(VehicleType::Car, 10 * kHour, 10 * kHour + kDay + kHour), 40.0);
+
+    // A band may end at hour 24, a band wrapping past midnight covers both days, one ending where it starts the whole day
+    {
+        std::ofstream file(path);
+        file << "band Car 18 24 1.5\n"
+             << "band Motorcycle 20 2 2\n"
+             << "band Bus 5 5 3\n";
+    }
+    tariffs = TariffTable::load(path);
+    std::remove(path.c_str());
+    EXPECT_DOUBLE_EQ(tariffs.charge(VehicleType::Car, 17 * kHour, 18 * kHour), 2.0);
+    EXPECT_DOUBLE_EQ(tariffs.charge(VehicleType::Car, 18 * kHour, 19 * kHour), 3.0);
+    EXPECT_DOUBLE_EQ(tariffs.charge(VehicleType::Car, 23 * kHour, 24 * kHour), 3.0);
+    EXPECT_DOUBLE_EQ(tariffs.charge(VehicleType::Car, kDay, kDay + kHour), 2.0);
+    EXPECT_DOUBLE_EQ(tariffs.charge(VehicleType::Motorcycle, 19 * kHour, 20 * kHour), 1.0);
+    EXPECT_DOUBLE_EQ(tariffs.charge(VehicleType::Motorcycle, 23 * kHour, 24 * kHour), 2.0);
+    EXPECT_DOUBLE_EQ(tariffs.charge(VehicleType::Motorcycle, kDay + kHour, kDay + 2 * kHour), 2.0);
+    EXPECT_DOUBLE_EQ(tariffs.charge(VehicleType::Motorcycle, kDay + 2 * kHour, kDay + 3 * kHour), 1.0);
+    EXPECT_DOUBLE_EQ(tariffs.charge(VehicleType::Bus, 0, kHour), 15.0);
+    EXPECT_DOUBLE_EQ(tariffs.charge(VehicleType::Bus, 13 * kHour, 14 * kHour), 15.0);
+
+    {
+        std::ofstream file(path);
+        file << "rate Car 3\n";
+    }
+    EXPECT_THROW(TariffTable::load(path), TariffException);
+    std::remove(path.c_str());
+}
+
+TEST(TariffTableTest, BatchChargesEqualSingleCharges)
+{
+    TariffTable tariffs;
+    tariffs.setRates(VehicleType::Bus, { 6.0, 4.0, 50.0 });
+    tariffs.setBand(VehicleType::Car, 7, 10, 1.5);
+    tariffs.setUtcOffsetMinutes(-300);
+
+    ClosedTickets tickets;
+    std::srand(15);
+    const std::int64_t kStart = 1700000000LL * 1000000;
+    for (int i = 0; i < 1000; ++i)
+    {
+        std::int64_t entry_time_us = kStart + static_cast<std::int64_t>(std::rand()) * 100000;
+        std::int64_t exit_time_us = entry_time_us + static_cast<std::int64_t>(std::rand() % 4000) * 60 * 1000000;
+        tickets.add(static_cast<VehicleType>(i % kVehicleTypeCount), entry_time_us, exit_time_us);
+    }
+
+    std::vector<double> charges(tickets.size());
+    tariffs.calculateCharges(tickets, charges.data());
+    for (std::size_t i = 0; i < tickets.size(); ++i)
+    {
+        EXPECT_DOUBLE_EQ(charges[i], tariffs.charge(tickets.types[i], tickets.entry_times_us[i], tickets.exit_times_us[i]));
+    }
+}
+
+namespace
+{
+    std::int64_t g_billing_test_time_us = 0;
+}
+
+TEST(TariffTableTest, ReleaseChargesTheTimeParked)
+{
+    const std::int64_t kHour = 3600LL * 1000000;
+    ParkingSiteManager manager;
+    ParkingLot & site = *manager.addSite(16, 10, 10, 10);
+    site.setEventSink(std::make_shared<NullEventSink>());
+    site.setClock([]() { return g_billing_test_time_us; });
+
+    g_billing_test_time_us = 1700000000LL * 1000000;
+    ParkingResult parked = site.tryParkVehicle(std::make_shared<Car>("BILL1", 1.0));
+    ASSERT_TRUE(parked.succeeded());
+
+    // The expected duration of the vehicle does not matter, 3 hours cost 2 + 2 * 1
+    g_billing_test_time_us += 3 * kHour;
+    EXPECT_DOUBLE_EQ(site.tryReleaseVehicleByTicketID(parked.ticket_id).charge, 4.0);
+
+    TariffTable tariffs;
+    tariffs.setRates(VehicleType::Bus, { 10.0, 5.0, 0.0 });
+    site.setTariffs(tariffs);
+    site.tryParkVehicle(std::make_shared<Bus>("BILL2", 1.0));
+    g_billing_test_time_us += 2 * kHour;
+    EXPECT_DOUBLE_EQ(site.tryReleaseVehicleByLicensePlate("BILL2").charge, 15.0);
+}
+
+TEST(LatencyHistogramTest, PercentilesWithinBucketPrecision)
+{
+    LatencyHistogram first;
+    LatencyHistogram second;
+    for (std::uint64_t value = 1; value <= 100000; ++value)
+    {
+        (value % 2 == 0 ? first : second).record(value);
+    }
+    first.merge(second);
+    EXPECT_EQ(first.count(), 100000u);
+
+    // Small values are exact, larger ones are at most one bucket (1/32) above the true value
+    for (double percentile : { 50.0, 99.0, 99.9 })
+    {
+        double expected = percentile * 1000.0;
+        double reported = static_cast<double>(first.percentile(percentile));
+        EXPECT_GE(reported, expected);
+        EXPECT_LE(reported, expected * (1.0 + 1.0 / 32.0));
+    }
+    EXPECT_EQ(first.percentile(0.0), 1u);
+    EXPECT_GE(first.percentile(100.0), 100000u);
+
+    LatencyHistogram small;
+    small.record(7);
+    small.record(63);
+    EXPECT_EQ(small.percentile(50.0), 7u);
+    EXPECT_EQ(small.percentile(100.0), 63u);
+    EXPECT_EQ(LatencyHistogram().percentile(99.0), 0u);
+}
+
+#if PARKING_LOT_METRICS
+TEST(MetricsTest, CountsAndTimesGateOperations)
+{
+    ParkingSiteManager manager;
+    ParkingLot & site = *manager.addSite(17, 2, 10, 10);
+    site.setEventSink(std::make_shared<NullEventSink>());
+    site.setMetricsSamplePeriod(1);
+
+    site.tryParkVehicle(std::make_shared<Car>("METRIC1", 1.0));
+    site.tryParkVehicle(std::make_shared<Car>("METRIC2", 1.0));
+    EXPECT_THROW(site.parkVehicle(std::make_shared<Car>("METRIC3", 1.0)), ParkingLotFullException);
+    site.tryReleaseVehicleByLicensePlate("METRIC1");
+    site.tryReleaseVehicleByTicketID(-5);
+    site.tryGetTicketIDByLicensePlate("METRIC2");
+
+    MetricsSnapshot metrics = site.getMetricsSnapshot();
+    EXPECT_EQ(metrics[ParkingEventType::Parked], 2u);
+    EXPECT_EQ(metrics[ParkingEventType::Full], 1u);
+    EXPECT_EQ(metrics[ParkingEventType::Released], 1u);
+    EXPECT_EQ(metrics[ParkingEventType::NotFound], 1u);
+    EXPECT_EQ(metrics[GateLatency::Park].count(), 3u);
+    EXPECT_EQ(metrics[GateLatency::Release].count(), 2u);
+    EXPECT_EQ(metrics[GateLatency::Log].count(), 3u);
+
+    // The invalid ticket ID needs no lock, the lookup does
+    EXPECT_EQ(metrics[GateLatency::LockWait].count(), 5u);
+    EXPECT_EQ(metrics[GateLatency::LockHold].count(), 5u);
+    EXPECT_GT(metrics[GateLatency::Park].percentile(99.0), 0u);
+
+    std::string text = metrics.toText();
+    EXPECT_NE(text.find("parking_lot_events_total{event=\"full\"} 1\n"), std::string::npos);
+    EXPECT_NE(text.find("parking_lot_lock_wait_ns_count 5\n"), std::string::npos);
+    EXPECT_NE(text.find("parking_lot_park_ns{quantile=\"0.999\"} "), std::string::npos);
+
+    // Only every fourth operation is timed, all are counted
+    site.setMetricsSamplePeriod(4);
+    for (int i = 0; i < 8; ++i)
+    {
+        site.tryParkVehicle(std::make_shared<Motorcycle>("METRIC_M" + std::to_string(i), 1.0));
+    }
+    MetricsSnapshot sampled = site.getMetricsSnapshot();
+    EXPECT_EQ(sampled[ParkingEventType::Parked], 10u);
+    EXPECT_EQ(sampled[GateLatency::Park].count(), 5u);
+}
+#endif
+
+TEST(BookingCalendarTest, BookedBaysAreTrackedPerBucket)
+{
+    const std::int64_t kHour = 3600LL * 1000000;
+    const std::int64_t kNow = 1700000000LL * 1000000 / kHour * kHour;
+    BookingConfig config;
+    config.bucket_us = kHour;
+    config.bucket_count = 24;
+    BookingCalendar calendar({ { 2, 0, 0 } }, config);
+
+    // Two cars can be booked from 14:00 to 18:00 and 16:00 to 20:00, a third one only outside 16:00 to 18:00
+    EXPECT_NE(calendar.book(VehicleType::Car, "BOOK1", kNow + 14 * kHour, kNow + 18 * kHour, kNow), kNoBooking);
+    BookingID second = calendar.book(VehicleType::Car, "BOOK2", kNow + 16 * kHour, kNow + 20 * kHour, kNow);
+    EXPECT_NE(second, kNoBooking);
+    EXPECT_EQ(calendar.getFreeBays(VehicleType::Car, kNow + 15 * kHour, kNow + 17 * kHour, kNow), 0);
+    EXPECT_EQ(calendar.getFreeBays(VehicleType::Car, kNow + 12 * kHour, kNow + 15 * kHour, kNow), 1);
+    EXPECT_EQ(calendar.book(VehicleType::Car, "BOOK3", kNow + 17 * kHour + 1, kNow + 18 * kHour, kNow), kNoBooking);
+    EXPECT_NE(calendar.book(VehicleType::Car, "BOOK3", kNow + 18 * kHour, kNow + 19 * kHour, kNow), kNoBooking);
+    EXPECT_EQ(calendar.book(VehicleType::Motorcycle, "BOOK4", kNow, kNow + kHour, kNow), kNoBooking);
+
+    EXPECT_TRUE(calendar.cancel(second, kNow));
+    EXPECT_FALSE(calendar.cancel(second, kNow));
+    EXPECT_EQ(calendar.getFreeBays(VehicleType::Car, kNow + 15 * kHour, kNow + 17 * kHour, kNow), 1);
+    EXPECT_EQ(calendar.size(), 2u);
+
+    EXPECT_THROW(calendar.getFreeBays(VehicleType::Car, kNow + kHour, kNow + kHour, kNow), BookingException);
+    EXPECT_THROW(calendar.getFreeBays(VehicleType::Car, kNow, kNow + 25 * kHour, kNow), BookingException);
+
+    // A day later the buckets are reused and the bookings are over
+    std::int64_t tomorrow = kNow + 24 * kHour;
+    EXPECT_EQ(calendar.getFreeBays(VehicleType::Car, tomorrow, tomorrow + 24 * kHour, tomorrow), 2);
+    EXPECT_TRUE(calendar.empty());
+    EXPECT_THROW(calendar.getFreeBays(VehicleType::Car, kNow, kNow + kHour, tomorrow), BookingException);
+}
+
+TEST(BookingCalendarTest, ParkingHonoursHeldBookings)
+{
+    const std::int64_t kHour = 3600LL * 1000000;
+    ParkingSiteManager manager;
+    ParkingLot & site = *manager.addSite(18, 2, 0, 0);
+    site.setEventSink(std::make_shared<NullEventSink>());
+    site.setClock([]() { return g_billing_test_time_us; });
+    g_billing_test_time_us = 1700000000LL * 1000000;
+    std::int64_t start = g_billing_test_time_us;
+
+    BookingID booking = site.bookBay(VehicleType::Car, "BOOKED", start + kHour, start + 3 * kHour);
+    EXPECT_EQ(site.getBookableBays(VehicleType::Car, start + 2 * kHour, start + 4 * kHour), 1);
+    EXPECT_TRUE(site.parkVehicle(std::make_shared<Car>("WALKIN1", 1.0)));
+
+    // Once the booking starts its bay is held, other vehicles are turned away until the booked one arrives
+    g_billing_test_time_us = start + kHour;
+    EXPECT_THROW(site.parkVehicle(std::make_shared<Car>("WALKIN2", 1.0)), ParkingLotFullException);
+    EXPECT_EQ(site.getBookableBays(VehicleType::Car, g_billing_test_time_us, start + 2 * kHour), 0);
+    EXPECT_EQ(site.tryBookBay(VehicleType::Car, "LATE", g_billing_test_time_us, start + 2 * kHour), kNoBooking);
+    EXPECT_TRUE(site.parkVehicle(std::make_shared<Car>("BOOKED", 1.0)));
+    EXPECT_FALSE(site.cancelBooking(booking));
+
+    // The booking ended with the arrival, the bay becomes free when the vehicle leaves
+    EXPECT_TRUE(site.releaseVehicleByLicensePlate("BOOKED"));
+    EXPECT_TRUE(site.parkVehicle(std::make_shared<Car>("WALKIN2", 1.0)));
+
+    // A cancelled booking holds nothing
+    EXPECT_TRUE(site.releaseVehicleByLicensePlate("WALKIN2"));
+    booking = site.bookBay(VehicleType::Car, "BOOKED", g_billing_test_time_us, start + 2 * kHour);
+    EXPECT_THROW(site.parkVehicle(std::make_shared<Car>("WALKIN2", 1.0)), ParkingLotFullException);
+    EXPECT_TRUE(site.cancelBooking(booking));
+    EXPECT_TRUE(site.parkVehicle(std::make_shared<Car>("WALKIN2", 1.0)));
+
+    // The lot is full now, bookings for later do not depend on the vehicles parked now
+    EXPECT_THROW(site.bookBay(VehicleType::Car, "BOOKED", g_billing_test_time_us, start + 3 * kHour), ParkingLotFullException);
+    EXPECT_NE(site.tryBookBay(VehicleType::Car, "BOOKED", start + 2 * kHour, start + 3 * kHour), kNoBooking);
+}
+
+TEST(LicensePlateTrieTest, PrefixAndApproximateQueries)
+{
+    LicensePlateTrie trie;
+    std::vector<std::string> license_plates = { "AB1234", "AB1235", "AB12", "AC1234", "XY9876", "B1234" };
+    for (std::uint32_t i = 0; i < license_plates.size(); ++i)
+    {
+        trie.insert(license_plates[i], i);
+    }
+
+    std::vector<std::uint32_t> values;
+    trie.findByPrefix("AB12", 10, values);
+    EXPECT_EQ(values, (std::vector<std::uint32_t>{ 2, 0, 1 }));
+    values.clear();
+    trie.findByPrefix("A", 2, values);
+    EXPECT_EQ(values, (std::vector<std::uint32_t>{ 2, 0 }));
+
+    // One replaced (AC1234, AB1235) or deleted (B1234) character; AB12 is two away
+    std::vector<std::pair<std::uint32_t, int>> matches;
+    trie.findWithin("AB1234", 1, matches);
+    std::sort(matches.begin(), matches.end());
+    EXPECT_EQ(matches, (std::vector<std::pair<std::uint32_t, int>>{ { 0, 0 }, { 1, 1 }, { 3, 1 }, { 5, 1 } }));
+    matches.clear();
+    trie.findWithin("A81234", 2, matches);
+    EXPECT_EQ(matches.size(), 4u);
+
+    // Erased license plates and their nodes are gone, shared nodes stay
+    trie.erase("AB1234");
+    trie.erase("AB12");
+    trie.erase("NOT PARKED");
+    values.clear();
+    trie.findByPrefix("AB", 10, values);
+    EXPECT_EQ(values, (std::vector<std::uint32_t>{ 1 }));
+    trie.insert("AB1234", 7);
+    matches.clear();
+    trie.findWithin("AB1234", 0, matches);
+    EXPECT_EQ(matches, (std::vector<std::pair<std::uint32_t, int>>{ { 7, 0 } }));
+}
+
+TEST(LicensePlateTrieTest, SharedTreeKeepsItsLicensePlatesWhileTheTableChanges)
+{
+    ParkedVehicleTable table;
+    std::uint32_t parked = table.insert(ParkedRecord{ LicensePlate("KA-1000"), 1 }, LicensePlate::hash("KA-1000"));
+    std::shared_ptr<const LicensePlateTrie> shared = table.shareLicensePlateTrie();
+
+    // The table goes on with a copy, the query still sees the license plates as they were when it was shared
+    table.erase(parked);
+    table.insert(ParkedRecord{ LicensePlate("KA-1001"), 2 }, LicensePlate::hash("KA-1001"));
+    std::vector<std::pair<std::uint32_t, int>> matches;
+    shared->findWithin("KA-1000", 0, matches);
+    EXPECT_EQ(matches, (std::vector<std::pair<std::uint32_t, int>>{ { parked, 0 } }));
+    matches.clear();
+    shared->findWithin("KA-1001", 0, matches);
+    EXPECT_TRUE(matches.empty());
+
+    std::vector<std::uint32_t> slots;
+    table.findByLicensePlatePrefix("KA-", 10, slots);
+    ASSERT_EQ(slots.size(), 1u);
+    EXPECT_EQ(table.record(slots[0]).ticket_id, 2);
+    EXPECT_NE(table.shareLicensePlateTrie(), shared);
+}
+
+TEST(ParkingLotTest, FindsVehiclesByPartialAndMisreadLicensePlates)
+{
+    ParkingSiteManager manager;
+    ParkingLot & site = *manager.addSite(19, 100, 100, 100);
+    site.setEventSink(std::make_shared<NullEventSink>());
+    for (int i = 0; i < 30; ++i)
+    {
+        site.tryParkVehicle(std::make_shared<Car>("KA-" + std::to_string(1000 + i), 1.0));
+    }
+    ParkingResult bus = site.tryParkVehicle(std::make_shared<Bus>("KB-1005", 1.0));
+
+    std::vector<ParkedRecord> records = site.findVehiclesByLicensePlatePrefix("KA-101");
+    ASSERT_EQ(records.size(), 10u);
+    EXPECT_EQ(records.front().license_plate.view(), "KA-1010");
+    EXPECT_EQ(records.back().license_plate.view(), "KA-1019");
+    EXPECT_EQ(site.findVehiclesByLicensePlatePrefix("KA-", 5).size(), 5u);
+    EXPECT_TRUE(site.findVehiclesByLicensePlatePrefix("ZZ").empty());
+
+    // The camera read an 8 as a B and dropped the dash
+    std::vector<LicensePlateMatch> matches = site.findVehiclesByApproximateLicensePlate("KB1005", 1);
+    ASSERT_EQ(matches.size(), 1u);
+    EXPECT_EQ(matches[0].record.ticket_id, bus.ticket_id);
+    EXPECT_EQ(matches[0].distance, 1);
+    matches = site.findVehiclesByApproximateLicensePlate("KA-1005", 1);
+    ASSERT_GE(matches.size(), 2u);
+    EXPECT_EQ(matches[0].record.license_plate.view(), "KA-1005");
+    EXPECT_EQ(matches[0].distance, 0);
+
+    // Released vehicles are no longer found
+    site.tryReleaseVehicleByLicensePlate("KB-1005");
+    EXPECT_TRUE(site.findVehiclesByApproximateLicensePlate("KB1005", 1).empty());
+}
+
+TEST(OccupancyAnalyticsTest, PeakOccupancyAndDwellTimesPerWindow)
+{
+    const std::int64_t kMinute = 60LL * 1000000;
+    OccupancyAnalytics analytics(AnalyticsConfig{ kMinute, 61 });
+    std::int64_t start = 1700000040LL * 1000000;
+    auto park = [&](const std::int64_t at, const int occupancy) {
+        ParkingEvent event;
+        event.type = ParkingEventType::Parked;
+        event.vehicle_type = VehicleType::Bus;
+        event.entry_time_us = at;
+        analytics.record(event, occupancy);
+    };
+    auto release = [&](const std::int64_t entered, const std::int64_t at, const int occupancy) {
+        ParkingEvent event;
+        event.type = ParkingEventType::Released;
+        event.vehicle_type = VehicleType::Bus;
+        event.entry_time_us = entered;
+        event.exit_time_us = at;
+        analytics.record(event, occupancy);
+    };
+    park(start, 1);
+    park(start, 2);
+    park(start, 3);
+    release(start, start + 10 * kMinute, 2);
+    release(start, start + 40 * kMinute, 1);
+    park(start + 50 * kMinute, 2);
+
+    // Minute 10 started with three buses parked
+    std::int64_t now = start + 70 * kMinute;
+    EXPECT_EQ(analytics.getPeakOccupancy(VehicleType::Bus, 60 * kMinute, now), 3);
+    EXPECT_EQ(analytics.getPeakOccupancy(VehicleType::Bus, 20 * kMinute, now), 2);
+    EXPECT_EQ(analytics.getPeakOccupancy(VehicleType::Car, 60 * kMinute, now), 0);
+
+    std::vector<OccupancySample> history = analytics.getOccupancyHistory(VehicleType::Bus, 20 * kMinute, now);
+    ASSERT_EQ(history.size(), 21u);
+    EXPECT_EQ(history[0].start_us, start + 50 * kMinute);
+    EXPECT_EQ(history[0].low, 1);
+    EXPECT_EQ(history[0].peak, 2);
+    EXPECT_EQ(history[20].low, 2);
+
+    // Percentiles are the upper bounds of buckets at most 1/32 wide
+    DwellTimeSketch dwell_times = analytics.getDwellTimes(VehicleType::Bus, 60 * kMinute, now);
+    EXPECT_EQ(dwell_times.count(), 2u);
+    EXPECT_GE(dwell_times.percentile(50), 10 * kMinute);
+    EXPECT_LE(dwell_times.percentile(50), 10 * kMinute * 33 / 32);
+    EXPECT_GE(dwell_times.percentile(100), 40 * kMinute);
+    EXPECT_LE(dwell_times.percentile(100), 40 * kMinute * 33 / 32);
+    EXPECT_EQ(analytics.getDwellTimes(VehicleType::Bus, 20 * kMinute, now).count(), 0u);
+
+    // Two hours later the ring has been reused, the occupancy carries over and the departures are out of every window
+    now = start + 190 * kMinute;
+    EXPECT_EQ(analytics.getPeakOccupancy(VehicleType::Bus, 600 * kMinute, now), 2);
+    EXPECT_EQ(analytics.getOccupancyHistory(VehicleType::Bus, 600 * kMinute, now).size(), 61u);
+    EXPECT_EQ(analytics.getDwellTimes(VehicleType::Bus, 600 * kMinute, now).count(), 0u);
+
+    DwellTimeSketch merged;
+    merged.merge(dwell_times);
+    merged.merge(dwell_times);
+    EXPECT_EQ(merged.count(), 4u);
+    EXPECT_EQ(merged.percentile(50), dwell_times.percentile(50));
+}
+
+TEST(OccupancyAnalyticsTest, ParkingLotFeedsAnalytics)
+{
+    const std::int64_t kHour = 3600LL * 1000000;
+    ParkingSiteManager manager;
+    ParkingLot & site = *manager.addSite(20, 5, 0, 0);
+    site.setEventSink(std::make_shared<NullEventSink>());
+    site.setClock([]() { return g_billing_test_time_us; });
+    g_billing_test_time_us = 1700000000LL * 1000000;
+
+    site.parkVehicle(std::make_shared<Car>("STAY1", 1.0));
+    site.parkVehicle(std::make_shared<Car>("STAY2", 1.0));
+    g_billing_test_time_us += 3 * kHour / 2;
+    site.releaseVehicleByLicensePlate("STAY1");
+    EXPECT_EQ(site.getPeakOccupancy(VehicleType::Car, kHour), 2);
+
+    DwellTimeSketch dwell_times = site.getDwellTimes(VehicleType::Car, kHour);
+    ASSERT_EQ(dwell_times.count(), 1u);
+    EXPECT_GE(dwell_times.percentile(95), 3 * kHour / 2);
+    EXPECT_LE(dwell_times.percentile(95), 3 * kHour / 2 * 33 / 32);
+
+    g_billing_test_time_us += kHour / 2;
+    EXPECT_EQ(site.getPeakOccupancy(VehicleType::Car, kHour / 4), 1);
+    EXPECT_EQ(site.getDwellTimes(VehicleType::Car, kHour / 4).count(), 0u);
+}
+
+TEST(OccupancyForecasterTest, ProjectsTimeToFullOfSyntheticTraffic)
+{
+    const std::int64_t kMinute = 60LL * 1000000;
+    const std::int64_t kDay = 24 * 60 * kMinute;
+    const int kCapacity = 5000;
+
+    // Poisson arrivals of 10 cars a minute at night, 60 during the morning peak and 20 for the rest of the day,
+    // every car stays for an exponentially distributed time of two hours on average
+    OccupancyForecaster forecaster;
+    std::mt19937_64 rng(7);
+    std::exponential_distribution<double> dwell_minutes(1.0 / 120);
+    std::uniform_int_distribution<std::int64_t> within_minute(0, kMinute - 1);
+    std::priority_queue<std::int64_t, std::vector<std::int64_t>, std::greater<std::int64_t>> departures;
+    std::vector<std::pair<std::int64_t, ParkingEventType>> events;
+    int occupancy = 0;
+    std::int64_t start = 1700006400LL * 1000000 / kDay * kDay;
+    auto simulateMinute = [&](const std::int64_t minute_start) {
+        int hour = static_cast<int>((minute_start - start) % kDay / (60 * kMinute));
+        std::poisson_distribution<int> arrivals(hour < 7 ? 10.0 : (hour < 10 ? 60.0 : 20.0));
+        events.clear();
+        for (int count = arrivals(rng); count > 0; --count)
+        {
+            std::int64_t entry = minute_start + within_minute(rng);
+            events.emplace_back(entry, ParkingEventType::Parked);
+            departures.push(entry + static_cast<std::int64_t>(dwell_minutes(rng) * kMinute));
+        }
+        for (; !departures.empty() && departures.top() < minute_start + kMinute; departures.pop())
+        {
+            events.emplace_back(departures.top(), ParkingEventType::Released);
+        }
+        std::sort(events.begin(), events.end());
+        for (const auto & timed : events)
+        {
+            ParkingEvent event;
+            event.type = timed.second;
+            event.entry_time_us = event.exit_time_us = timed.first;
+            occupancy += timed.second == ParkingEventType::Parked ? 1 : -1;
+            forecaster.record(event, occupancy);
+        }
+    };
+
+    // Four weeks of history and the night of the next day
+    std::int64_t now = start;
+    for (; now < start + 28 * kDay + 7 * 60 * kMinute; now += kMinute)
+    {
+        simulateMinute(now);
+    }
+    SlotRates morning = forecaster.getRates(VehicleType::Car, start + 8 * 60 * kMinute);
+    EXPECT_NEAR(morning.arrivals, 15 * 60.0, 15 * 60.0 * 0.05);
+    EXPECT_NEAR(forecaster.getRates(VehicleType::Car, start + 3 * 60 * kMinute).arrivals, 15 * 10.0, 15 * 10.0 * 0.1);
+    EXPECT_GT(morning.departure_share, 0.0);
+
+    std::int64_t time_to_full = forecaster.getTimeToFull(VehicleType::Car, occupancy, kCapacity, now, kDay);
+    ASSERT_NE(time_to_full, OccupancyForecaster::kNotFull);
+    std::vector<OccupancyForecast> forecast = forecaster.getForecast(VehicleType::Car, occupancy, now, 60 * kMinute);
+    ASSERT_EQ(forecast.size(), 4u);
+    EXPECT_LT(forecast[0].occupancy, forecast[3].occupancy);
+
+    // The morning peak fills the lot within ten minutes of the projected time
+    std::int64_t forecast_at = now;
+    for (; occupancy < kCapacity && now < forecast_at + kDay; now += kMinute)
+    {
+        simulateMinute(now);
+    }
+    EXPECT_NEAR(static_cast<double>(time_to_full) / kMinute, static_cast<double>(now - forecast_at) / kMinute, 10.0);
+
+    // Full now, and never full without traffic
+    EXPECT_EQ(forecaster.getTimeToFull(VehicleType::Car, kCapacity, kCapacity, now, kDay), 0);
+    EXPECT_EQ(forecaster.getTimeToFull(VehicleType::Bus, 0, 1, now, kDay), OccupancyForecaster::kNotFull);
+}
+
+TEST(OccupancyForecasterTest, FirstSlotIsNotLearnedAndStartOccupancyIsSeeded)
+{
+    const std::int64_t kMinute = 60LL * 1000000;
+    const std::int64_t kStart = 1700000400LL * 1000000;
+    OccupancyForecaster forecaster(ForecastConfig{ 10 * kMinute, 1.0, 0 }, { { 4, 0, 0 } });
+
+    // Counting starts halfway through the first slot, with a motorcycle; the four cars parked before stay
+    ParkingEvent parked{ ParkingEventType::Parked, VehicleType::Motorcycle, "FSM", 1 };
+    parked.entry_time_us = kStart + 5 * kMinute;
+    forecaster.record(parked, 1);
+
+    // One of the four cars leaves in the second slot
+    ParkingEvent released{ ParkingEventType::Released, VehicleType::Car, "FSC", 2 };
+    released.exit_time_us = kStart + 15 * kMinute;
+    forecaster.record(released, 3);
+    forecaster.getTimeToFull(VehicleType::Car, 3, 4, kStart + 20 * kMinute, 0);
+
+    EXPECT_FALSE(forecaster.getRates(VehicleType::Car, kStart).trained);
+    EXPECT_FALSE(forecaster.getRates(VehicleType::Motorcycle, kStart).trained);
+    SlotRates rates = forecaster.getRates(VehicleType::Car, kStart + 10 * kMinute);
+    EXPECT_TRUE(rates.trained);
+    EXPECT_DOUBLE_EQ(rates.departure_share, 0.25);
+}
+
+TEST(OccupancyForecasterTest, ParkingLotLearnsFromItsEvents)
+{
+    const std::int64_t kMinute = 60LL * 1000000;
+    ParkingSiteManager manager;
+    ParkingLot & site = *manager.addSite(21, 4, 0, 0);
+    site.setEventSink(std::make_shared<NullEventSink>());
+    site.setClock([]() { return g_billing_test_time_us; });
+    site.setForecastConfig(ForecastConfig{ 10 * kMinute, 1.0, 0 });
+    g_billing_test_time_us = 1700000400LL * 1000000;
+    EXPECT_EQ(site.getTimeToFull(VehicleType::Car), OccupancyForecaster::kNotFull);
+
+    // For a day, every ten minutes two cars arrive and leave right away and one motorcycle arrives and stays
+    for (int slot = 0; slot < 24 * 6; ++slot)
+    {
+        for (int car = 0; car < 2; ++car)
+        {
+            site.tryParkVehicle(std::make_shared<Car>("FC" + std::to_string(slot * 2 + car), 1.0));
+            site.tryReleaseVehicleByLicensePlate("FC" + std::to_string(slot * 2 + car));
+        }
+        site.tryParkVehicle(std::make_shared<Motorcycle>("FM" + std::to_string(slot), 1.0));
+        g_billing_test_time_us += 10 * kMinute;
+    }
+    for (int car = 0; car < 2; ++car)
+    {
+        site.tryParkVehicle(std::make_shared<Car>("FULL" + std::to_string(car), 1.0));
+    }
+
+    // The motorcycles filled their 4 bays and are turned away since, demand stays at one a slot
+    EXPECT_EQ(site.getTimeToFull(VehicleType::Motorcycle), 0);
+    EXPECT_EQ(site.getOccupancyForecast(VehicleType::Car, 60 * kMinute).size(), 6u);
+
+    // Every car left again within its slot, so the 2 parked now stay and the lot never fills
+    EXPECT_EQ(site.getTimeToFull(VehicleType::Car), OccupancyForecaster::kNotFull);
+}
+
+TEST(ZonedBayAllocatorTest, PoliciesPickZonesAndFallBackToOtherBayKinds)
+{
+    // Two floors of two zones, the second zone of a floor is nearer to the exit
+    LotTopology topology;
+    topology.addZone(ZoneSpec{ 0, "0-A", 20, { 0, 0, 2, 0, 0, 0 } });
+    topology.addZone(ZoneSpec{ 0, "0-B", 5, { 0, 1, 2, 0, 0, 0 } });
+    topology.addZone(ZoneSpec{ 1, "1-A", 1, { 0, 0, 4, 0, 0, 1 } });
+    topology.addZone(ZoneSpec{ 1, "1-B", 30, { 2, 0, 0, 0, 1, 0 } });
+    EXPECT_EQ(topology.bayCount(), 13);
+    EXPECT_EQ(topology.usableBays(VehicleType::Car), 10);
+
+    ZonedBayAllocator nearest(topology, std::make_shared<NearestToExitPolicy>());
+    EXPECT_EQ(nearest.locate(nearest.allocate(VehicleType::Car)).zone, 2u);
+    ZonedBayAllocator lowest(topology, std::make_shared<LowestFloorPolicy>());
+    EXPECT_EQ(lowest.locate(lowest.allocate(VehicleType::Car)).zone, 1u);
+
+    // The zone with the largest share of free standard bays is taken, ties go to the lower floor and the nearer zone
+    ZonedBayAllocator balanced(topology, std::make_shared<BalancedPolicy>());
+    std::vector<std::size_t> zones;
+    for (int i = 0; i < 4; ++i)
+    {
+        zones.push_back(balanced.locate(balanced.allocate(VehicleType::Car)).zone);
+    }
+    EXPECT_EQ(zones, (std::vector<std::size_t>{ 1, 0, 2, 2 }));
+
+    // Cars fill the 7 standard bays left, then the compact and bus bays; the accessible bay is never given out
+    std::vector<int> bays;
+    for (int i = 0; i < 9; ++i)
+    {
+        bays.push_back(nearest.allocate(VehicleType::Car));
+        ASSERT_NE(bays.back(), ZonedBayAllocator::kNoBay);
+    }
+    EXPECT_EQ(nearest.allocate(VehicleType::Car), ZonedBayAllocator::kNoBay);
+    BayLocation compact = nearest.locate(bays[7]);
+    EXPECT_EQ(compact.kind, BayKind::Compact);
+    EXPECT_EQ(compact.zone, 1u);
+    EXPECT_EQ(compact.floor, 0);
+    EXPECT_EQ(compact.number, 1);
+    EXPECT_EQ(nearest.locate(bays[8]).kind, BayKind::Bus);
+    EXPECT_EQ(nearest.freeBays(BayKind::Accessible), 1);
+    EXPECT_EQ(nearest.allocate(VehicleType::Bus), ZonedBayAllocator::kNoBay);
+
+    // Motorcycles take their own bays first and then the car bays, which are full
+    EXPECT_EQ(nearest.locate(nearest.allocate(VehicleType::Motorcycle)).kind, BayKind::Motorcycle);
+    EXPECT_EQ(nearest.locate(nearest.allocate(VehicleType::Motorcycle)).kind, BayKind::Motorcycle);
+    EXPECT_EQ(nearest.allocate(VehicleType::Motorcycle), ZonedBayAllocator::kNoBay);
+
+    // A released bay is found again and every bay number is known exactly once
+    nearest.release(bays[3]);
+    EXPECT_EQ(nearest.allocate(VehicleType::Motorcycle), bays[3]);
+    EXPECT_FALSE(nearest.acquire(bays[3]));
+    EXPECT_EQ(nearest.locate(0).zone, LotTopology::kNoZone);
+    EXPECT_EQ(nearest.locate(15).zone, LotTopology::kNoZone);
+}
+
+TEST(ZonedBayAllocatorTest, ConcurrentAllocationsGetDistinctBays)
+{
+    // 20 floors of 5 zones with 100k bays in all
+    LotTopology topology;
+    topology.addFloors(20, 5, { 100, 100, 600, 100, 0, 100 });
+    const int thread_count = 4;
+    const int usable_bays = topology.usableBays(VehicleType::Car);
+    ASSERT_EQ(topology.bayCount(), 100000);
+    ZonedBayAllocator bays(topology, std::make_shared<NearestToExitPolicy>());
+
+    std::vector<std::vector<int>> taken(thread_count);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < thread_count; ++i)
+    {
+        threads.emplace_back([&bays, &taken, i]()
+        {
+            for (int j = 0;; ++j)
+            {
+                int bay = bays.allocate(VehicleType::Car);
+                if (bay == ZonedBayAllocator::kNoBay)
+                {
+                    break;
+                }
+                taken[i].push_back(bay);
+
+                // Give some bays back and take them again, so zones fill up and free up concurrently
+                if (j % 3 == 0)
+                {
+                    bays.release(bay);
+                    taken[i].back() = bays.allocate(VehicleType::Car);
+                }
+            }
+        });
+    }
+    for (auto & thread : threads)
+    {
+        thread.join();
+    }
+
+    std::set<int> unique_bays;
+    for (const auto & thread_bays : taken)
+    {
+        unique_bays.insert(thread_bays.begin(), thread_bays.end());
+    }
+    unique_bays.erase(ZonedBayAllocator::kNoBay);
+    EXPECT_EQ(unique_bays.size(), static_cast<std::size_t>(usable_bays));
+    EXPECT_EQ(bays.freeBays(BayKind::Standard) + bays.freeBays(BayKind::Bus), 0);
+    EXPECT_EQ(bays.freeBays(BayKind::Motorcycle), 10 * 1000);
+}
+
+TEST(ParkingLotTest, TopologyParksVehiclesInOtherBayKindsWhenTheirOwnAreFull)
+{
+    ParkingSiteManager manager;
+    ParkingLot & site = *manager.addSite(22, 1, 1, 1);
+    site.setEventSink(std::make_shared<NullEventSink>());
+
+    LotTopology topology;
+    topology.addZone(ZoneSpec{ -1, "Basement", 10, { 0, 0, 1, 0, 0, 1 } });
+    topology.addZone(ZoneSpec{ 0, "Ground", 1, { 1, 0, 1, 0, 0, 0 } });
+    site.setTopology(topology, std::make_shared<LowestFloorPolicy>());
+    EXPECT_EQ(site.getOccupancy(VehicleType::Car).capacity, 3);
+
+    ParkingResult first = site.tryParkVehicle(std::make_shared<Car>("ZONE1", 1.0));
+    BayLocation location = site.getBayLocation(first.bay);
+    EXPECT_EQ(location.floor, -1);
+    EXPECT_EQ(location.kind, BayKind::Standard);
+    EXPECT_EQ(site.getBayLocation(site.tryParkVehicle(std::make_shared<Car>("ZONE2", 1.0)).bay).floor, 0);
+
+    // The third car takes the bus bay instead of being turned away, then the bus has none left
+    ParkingResult fallback = site.tryParkVehicle(std::make_shared<Car>("ZONE3", 1.0));
+    ASSERT_EQ(fallback.status, ParkingEventType::Parked);
+    EXPECT_EQ(site.getBayLocation(fallback.bay).kind, BayKind::Bus);
+    EXPECT_EQ(site.tryParkVehicle(std::make_shared<Bus>("ZONEBUS", 1.0)).status, ParkingEventType::Full);
+    EXPECT_THROW(site.parkVehicle(std::make_shared<Car>("ZONE4", 1.0)), ParkingLotFullException);
+    EXPECT_EQ(site.getBayLocation(site.tryParkVehicle(std::make_shared<Motorcycle>("ZONEM", 1.0)).bay).kind, BayKind::Motorcycle);
+
+    site.releaseVehicleByLicensePlate("ZONE3");
+    EXPECT_EQ(site.getBayLocation(site.tryParkVehicle(std::make_shared<Bus>("ZONEBUS", 1.0)).bay).kind, BayKind::Bus);
+    EXPECT_EQ(site.getBayLocation(0).zone, LotTopology::kNoZone);
+}
+
+TEST(ParkingLotTest, BookedVehicleTurnedAwayKeepsItsBooking)
+{
+    const std::int64_t kHour = 3600LL * 1000000;
+    ParkingSiteManager manager;
+    ParkingLot & site = *manager.addSite(26, 1, 1, 1);
+    site.setEventSink(std::make_shared<NullEventSink>());
+    site.setClock([]() { return g_billing_test_time_us; });
+    g_billing_test_time_us = 1700000000LL * 1000000;
+
+    // Cars may park in the standard and the bus bay, the bus takes the bus bay
+    LotTopology topology;
+    topology.addZone(ZoneSpec{ 0, "Ground", 1, { 0, 0, 1, 0, 0, 1 } });
+    site.setTopology(topology, std::make_shared<LowestFloorPolicy>());
+    BookingID booking = site.bookBay(VehicleType::Car, "BOOKED", g_billing_test_time_us, g_billing_test_time_us + 2 * kHour);
+    EXPECT_EQ(site.tryParkVehicle(std::make_shared<Car>("WALKIN1", 1.0)).status, ParkingEventType::Parked);
+    EXPECT_EQ(site.tryParkVehicle(std::make_shared<Bus>("BUS", 1.0)).status, ParkingEventType::Parked);
+
+    // The counts leave room for the booked car, but the bays it may use are taken
+    ParkingResult turned_away = site.tryParkVehicle(std::make_shared<Car>("BOOKED", 1.0));
+    EXPECT_EQ(turned_away.status, ParkingEventType::Full);
+    EXPECT_EQ(turned_away.bay, 0);
+
+    // The booking still holds the freed bay for the booked car
+    EXPECT_TRUE(site.releaseVehicleByLicensePlate("BUS"));
+    EXPECT_EQ(site.tryParkVehicle(std::make_shared<Car>("WALKIN2", 1.0)).status, ParkingEventType::Full);
+    EXPECT_EQ(site.tryParkVehicle(std::make_shared<Car>("BOOKED", 1.0)).status, ParkingEventType::Parked);
+    EXPECT_FALSE(site.cancelBooking(booking));
+}
+
+namespace
+{
+    /// \brief Fills the lowest floor first and calls a probe while a gate allocates a bay
+    class ProbingPolicy : public LowestFloorPolicy
+    {
+    public:
+        std::size_t chooseZone(const FreeZones & free_zones) const override
+        {
+            if (probe)
+            {
+                probe();
+            }
+            return LowestFloorPolicy::chooseZone(free_zones);
+        }
+
+        std::function<void()> probe;
+    };
+}
+
+TEST(ParkingLotTest, BookedVehicleIsCountedOnceWhileItGetsItsBay)
+{
+    const std::int64_t kHour = 3600LL * 1000000;
+    ParkingSiteManager manager;
+    ParkingLot & site = *manager.addSite(27, 1, 1, 1);
+    site.setEventSink(std::make_shared<NullEventSink>());
+    site.setClock([]() { return g_billing_test_time_us; });
+    g_billing_test_time_us = 1700000000LL * 1000000;
+
+    LotTopology topology;
+    topology.addZone(ZoneSpec{ 0, "Ground", 1, { 0, 0, 2, 0, 0, 0 } });
+    std::shared_ptr<ProbingPolicy> policy = std::make_shared<ProbingPolicy>();
+    site.setTopology(topology, policy);
+    std::int64_t now = g_billing_test_time_us;
+    BookingID booking = site.bookBay(VehicleType::Car, "BOOKED", now, now + 2 * kHour);
+    EXPECT_EQ(site.getBookableBays(VehicleType::Car, now, now + kHour), 1);
+
+    // The booked car is counted, its booking no longer holds a bay; the other bay stays free for walk-ins
+    int bookable_while_allocating = -1;
+    policy->probe = [&]() { bookable_while_allocating = site.getBookableBays(VehicleType::Car, now, now + kHour); };
+    EXPECT_EQ(site.tryParkVehicle(std::make_shared<Car>("BOOKED", 1.0)).status, ParkingEventType::Parked);
+    policy->probe = nullptr;
+    EXPECT_EQ(bookable_while_allocating, 1);
+    EXPECT_FALSE(site.cancelBooking(booking));
+    EXPECT_EQ(site.tryParkVehicle(std::make_shared<Car>("WALKIN1", 1.0)).status, ParkingEventType::Parked);
+    EXPECT_EQ(site.tryParkVehicle(std::make_shared<Car>("WALKIN2", 1.0)).status, ParkingEventType::Full);
+}
+
+TEST(BookingCalendarTest, ArrivedBookingsHoldNoBayUntilTheirVehicleLeaves)
+{
+    const std::int64_t kHour = 3600LL * 1000000;
+    const std::int64_t kNow = 1700000000LL * 1000000 / kHour * kHour;
+    BookingCalendar calendar({ { 2, 0, 0 } }, BookingConfig());
+    BookingID first = calendar.book(VehicleType::Car, "BOOK1", kNow, kNow + 2 * kHour, kNow);
+    BookingID second = calendar.book(VehicleType::Car, "BOOK2", kNow, kNow + 2 * kHour, kNow);
+    EXPECT_EQ(calendar.getHeldBays(VehicleType::Car, kNow), 2);
+
+    EXPECT_TRUE(calendar.arrive(first, kNow));
+    EXPECT_FALSE(calendar.arrive(first, kNow));
+    EXPECT_EQ(calendar.getHeldBays(VehicleType::Car, kNow), 1);
+    calendar.leave(first);
+    EXPECT_EQ(calendar.getHeldBays(VehicleType::Car, kNow), 2);
+
+    // Claiming or cancelling an arrived booking leaves the held bays as they are
+    EXPECT_TRUE(calendar.arrive(first, kNow));
+    EXPECT_TRUE(calendar.claim(first, kNow));
+    EXPECT_TRUE(calendar.arrive(second, kNow));
+    EXPECT_TRUE(calendar.cancel(second, kNow));
+    calendar.leave(second);
+    EXPECT_EQ(calendar.getHeldBays(VehicleType::Car, kNow), 0);
+    EXPECT_TRUE(calendar.empty());
+}
+
+TEST(ParkingLotTest, ParkedVehicleSnapshotStaysAsTakenWhileGatesGoOn)
+{
+    const std::int64_t kHour = 3600LL * 1000000;
+    ParkingSiteManager manager;
+    ParkingLot & site = *manager.addSite(23, 1000, 1000, 1000);
+    site.setEventSink(std::make_shared<NullEventSink>());
+    site.setClock([]() { return g_billing_test_time_us; });
+
+    // More cars than fit into the first page of every shard
+    g_billing_test_time_us = 1700000000LL * 1000000;
+    for (int i = 0; i < 600; ++i)
+    {
+        site.tryParkVehicle(std::make_shared<Car>("SNAP" + std::to_string(i), 1.0));
+    }
+    for (int i = 0; i < 5; ++i)
+    {
+        site.tryParkVehicle(std::make_shared<Bus>("SNAPBUS" + std::to_string(i), 1.0));
+    }
+    g_billing_test_time_us += 25 * kHour;
+    for (int i = 0; i < 10; ++i)
+    {
+        site.tryParkVehicle(std::make_shared<Car>("SNAPNEW" + std::to_string(i), 1.0));
+    }
+
+    ParkedVehicleSnapshot snapshot = site.getParkedVehicleSnapshot();
+    auto is_bus = [](const ParkedRecord & record) { return record.type == VehicleType::Bus; };
+    auto parked_over_a_day = [&snapshot, kHour](const ParkedRecord & record) { return snapshot.timeUs() - record.entry_time_us > 24 * kHour; };
+    std::set<TicketID> ticket_ids;
+    for (const ParkedRecord & record : snapshot)
+    {
+        ticket_ids.insert(record.ticket_id);
+    }
+    EXPECT_EQ(snapshot.size(), 615u);
+    EXPECT_EQ(ticket_ids.size(), 615u);
+    EXPECT_EQ(std::count_if(snapshot.begin(), snapshot.end(), is_bus), 5);
+    EXPECT_EQ(std::count_if(snapshot.begin(), snapshot.end(), parked_over_a_day), 605);
+
+    // Releases and parks after the snapshot change the lot, not the snapshot
+    for (int i = 0; i < 5; ++i)
+    {
+        site.tryReleaseVehicleByLicensePlate("SNAPBUS" + std::to_string(i));
+    }
+    for (int i = 0; i < 300; ++i)
+    {
+        site.tryReleaseVehicleByLicensePlate("SNAP" + std::to_string(i));
+    }
+    for (int i = 0; i < 50; ++i)
+    {
+        site.tryParkVehicle(std::make_shared<Motorcycle>("SNAPMOTO" + std::to_string(i), 1.0));
+    }
+    std::set<TicketID> ticket_ids_later;
+    for (const ParkedRecord & record : snapshot)
+    {
+        ticket_ids_later.insert(record.ticket_id);
+    }
+    EXPECT_EQ(ticket_ids_later, ticket_ids);
+    EXPECT_EQ(std::count_if(snapshot.begin(), snapshot.end(), is_bus), 5);
+
+    ParkedVehicleSnapshot now = site.getParkedVehicleSnapshot();
+    EXPECT_EQ(now.size(), 360u);
+    EXPECT_EQ(static_cast<std::size_t>(std::distance(now.begin(), now.end())), now.size());
+    EXPECT_EQ(std::count_if(now.begin(), now.end(), is_bus), 0);
+    EXPECT_TRUE(ParkedVehicleSnapshot().empty());
+    EXPECT_TRUE(ParkedVehicleSnapshot().begin() == ParkedVehicleSnapshot().end());
+}
+
+TEST(ParkingLotConcurrentTest, SnapshotsAreConsistentWhileGatesRun)
+{
+    ParkingSiteManager manager;
+    ParkingLot & site = *manager.addSite(24, 10000, 10000, 10000);
+    site.setEventSink(std::make_shared<NullEventSink>());
+
+    // Vehicles parked throughout, every snapshot must hold them
+    const int kResidents = 1000;
+    for (int i = 0; i < kResidents; ++i)
+    {
+        site.tryParkVehicle(std::make_shared<Car>("RESIDENT" + std::to_string(i), 1.0));
+    }
+
+    std::atomic<bool> stop{ false };
+    std::vector<std::thread> gates;
+    for (int gate = 0; gate < 4; ++gate)
+    {
+        gates.emplace_back([&site, &stop, gate]()
+        {
+            std::vector<std::shared_ptr<Vehicle>> visitors;
+            for (int i = 0; i < 200; ++i)
+            {
+                visitors.push_back(std::make_shared<Car>("VISITOR" + std::to_string(gate) + "-" + std::to_string(i), 1.0));
+            }
+            while (!stop.load())
+            {
+                for (const auto & visitor : visitors)
+                {
+                    site.tryParkVehicle(visitor);
+                }
+                for (const auto & visitor : visitors)
+                {
+                    site.tryReleaseVehicleByLicensePlate(visitor->getLicensePlateView());
+                }
+            }
+        });
+    }
+
+    for (int round = 0; round < 50; ++round)
+    {
+        ParkedVehicleSnapshot snapshot = site.getParkedVehicleSnapshot();
+        std::size_t count = 0;
+        int residents = 0;
+        std::set<TicketID> ticket_ids;
+        for (const ParkedRecord & record : snapshot)
+        {
+            ++count;
+            residents += record.license_plate.view().substr(0, 8) == "RESIDENT";
+            ticket_ids.insert(record.ticket_id);
+        }
+        EXPECT_EQ(count, snapshot.size());
+        EXPECT_EQ(ticket_ids.size(), snapshot.size());
+        EXPECT_EQ(residents, kResidents);
+    }
+
+    stop.store(true);
+    for (auto & gate : gates)
+    {
+        gate.join();
+    }
+}
+
+TEST(ColumnarExportTest, ParkedVehiclesAndClosedTicketsRoundTrip)
+{
+    const std::int64_t kMinute = 60LL * 1000000;
+    const std::string export_path = "columnar_export_test.plcol";
+    ParkingSiteManager manager;
+    ParkingLot & site = *manager.addSite(25, 100, 100, 100);
+    site.setClock([]() { return g_billing_test_time_us; });
+    g_billing_test_time_us = 1700000000LL * 1000000;
+
+    std::map<TicketID, ParkingEvent> released;
+    {
+        ColumnarExportWriter writer(export_path);
+        site.setEventSink(std::make_shared<ColumnarExportSink>(writer));
+        std::vector<ParkingResult> parked;
+        for (int i = 0; i < 90; ++i)
+        {
+            std::shared_ptr<Vehicle> vehicle;
+            std::string license_plate = "EXP-" + std::to_string(i);
+            if (i % 3 == 0)
+            {
+                vehicle = std::make_shared<Car>(license_plate, 1.0);
+            }
+            else if (i % 3 == 1)
+            {
+                vehicle = std::make_shared<Motorcycle>(license_plate, 1.0);
+            }
+            else
+            {
+                vehicle = std::make_shared<Bus>(license_plate, 1.0);
+            }
+            parked.push_back(site.tryParkVehicle(vehicle));
+            g_billing_test_time_us += 7 * kMinute;
+        }
+        for (int i = 0; i < 90; i += 2)
+        {
+            ParkingEvent event;
+            event.type = ParkingEventType::Released;
+            event.license_plate = "EXP-" + std::to_string(i);
+            event.vehicle_type = i % 3 == 0 ? VehicleType::Car : (i % 3 == 1 ? VehicleType::Motorcycle : VehicleType::Bus);
+            event.ticket_id = parked[i].ticket_id;
+            event.bay = parked[i].bay;
+            event.exit_time_us = g_billing_test_time_us;
+            event.charge = site.tryReleaseVehicleByTicketID(parked[i].ticket_id).charge;
+            released[event.ticket_id] = event;
+            g_billing_test_time_us += 3 * kMinute;
+        }
+        site.setEventSink(std::make_shared<NullEventSink>());
+        writer.addParkedVehicles(site.getParkedVehicleSnapshot());
+        writer.close();
+    }
+
+    ParkedVehicleSnapshot snapshot = site.getParkedVehicleSnapshot();
+    std::map<TicketID, ParkedRecord> still_parked;
+    for (const ParkedRecord & record : snapshot)
+    {
+        still_parked[record.ticket_id] = record;
+    }
+
+    ColumnarExportReader reader(export_path);
+    ExportBlock block;
+    std::size_t closed_rows = 0;
+    std::size_t parked_rows = 0;
+    while (reader.readBlock(block))
+    {
+        for (std::size_t row = 0; row < block.size(); ++row)
+        {
+            if (block.kind == ExportBlockKind::ClosedTickets)
+            {
+                ASSERT_EQ(released.count(block.ticket_ids[row]), 1u);
+                const ParkingEvent & expected = released[block.ticket_ids[row]];
+                EXPECT_EQ(block.license_plates[row], expected.license_plate.view());
+                EXPECT_EQ(block.types[row], expected.vehicle_type);
+                EXPECT_EQ(block.bays[row], expected.bay);
+                EXPECT_EQ(block.exit_times_us[row], expected.exit_time_us);
+                EXPECT_NEAR(block.charges[row], expected.charge, 0.00005);
+                EXPECT_LT(block.entry_times_us[row], block.exit_times_us[row]);
+                ++closed_rows;
+            }
+            else
+            {
+                ASSERT_EQ(still_parked.count(block.ticket_ids[row]), 1u);
+                const ParkedRecord & expected = still_parked[block.ticket_ids[row]];
+                EXPECT_EQ(block.license_plates[row], expected.license_plate.view());
+                EXPECT_EQ(block.types[row], expected.type);
+                EXPECT_EQ(block.entry_times_us[row], expected.entry_time_us);
+                EXPECT_EQ(block.bays[row], expected.bay);
+                EXPECT_TRUE(block.charges.empty());
+                ++parked_rows;
+            }
+        }
+    }
+    EXPECT_EQ(closed_rows, 45u);
+    EXPECT_EQ(parked_rows, 45u);
+    EXPECT_EQ(reader.plateCount(), 90u);
+    std::filesystem::remove(export_path);
+}
+
+TEST(ColumnarExportTest, SinkWritesTheTicketsOfConcurrentGatesFromItsThread)
+{
+    const std::string export_path = "columnar_export_sink_test.plcol";
+    const int thread_count = 4;
+    const int tickets_per_thread = static_cast<int>(ColumnarExportWriter::kBlockRows) / 2 + 100;
+    {
+        ColumnarExportWriter writer(export_path);
+        ColumnarExportSink event_sink(writer, 100);
+        std::vector<std::thread> gates;
+        for (int i = 0; i < thread_count; ++i)
+        {
+            gates.emplace_back([&event_sink, i]()
+            {
+                for (int j = 0; j < tickets_per_thread; ++j)
+                {
+                    ParkingEvent event;
+                    event.type = ParkingEventType::Released;
+                    event.license_plate = "SINK" + std::to_string(i) + "-" + std::to_string(j % 500);
+                    event.ticket_id = static_cast<TicketID>(i) * tickets_per_thread + j + 1;
+                    event.entry_time_us = 1700000000LL * 1000000 + j;
+                    event.exit_time_us = event.entry_time_us + 1000000;
+                    event_sink.onEvent(event);
+                }
+            });
+        }
+        for (auto & gate : gates)
+        {
+            gate.join();
+        }
+
+        // Once flushed, every ticket is in the export, two of its blocks are full
+        event_sink.flush();
+        EXPECT_GT(writer.bytesWritten(), 1000u);
+    }
+
+    ColumnarExportReader reader(export_path);
+    ExportBlock block;
+    std::set<TicketID> ticket_ids;
+    while (reader.readBlock(block))
+    {
+        EXPECT_EQ(block.kind, ExportBlockKind::ClosedTickets);
+        ticket_ids.insert(block.ticket_ids.begin(), block.ticket_ids.end());
+    }
+    EXPECT_EQ(ticket_ids.size(), static_cast<std::size_t>(thread_count * tickets_per_thread));
+    EXPECT_EQ(reader.plateCount(), static_cast<std::size_t>(thread_count * 500));
+    std::filesystem::remove(export_path);
+}
+
+TEST(ColumnarExportTest, ExportIsSmallerThanTheTextLogAndStopsAtATornBlock)
+{
+    const std::string export_path = "columnar_export_size_test.plcol";
+    const std::size_t kTickets = ColumnarExportWriter::kBlockRows * 2 + 1000;
+    std::mt19937_64 random(25);
+    std::uniform_int_distribution<int> visitor(0, 19999);
+    std::uniform_int_distribution<std::int64_t> gap_us(0, 2000000);
+    std::uniform_int_distribution<std::int64_t> stay_us(10LL * 60 * 1000000, 10LL * 3600 * 1000000);
+
+    // Departures in exit order, the text log has an entry and an exit line per ticket
+    std::vector<ParkingEvent> tickets;
+    std::size_t text_size = 0;
+    std::int64_t entry_time_us = 1700000000LL * 1000000;
+    for (std::size_t i = 0; i < kTickets; ++i)
+    {
+        ParkingEvent event;
+        event.type = ParkingEventType::Released;
+        event.vehicle_type = static_cast<VehicleType>(i % 7 == 0 ? 2 : i % 3 == 0 ? 1 : 0);
+        event.license_plate = "KA-" + std::to_string(visitor(random));
+        event.ticket_id = static_cast<TicketID>(i + 1) * 16 + static_cast<TicketID>(i % 16);
+        event.bay = 1 + static_cast<int>(i % 500);
+        entry_time_us += gap_us(random);
+        event.entry_time_us = entry_time_us;
+        event.exit_time_us = entry_time_us + stay_us(random);
+        event.charge = 2.0 + static_cast<double>(event.exit_time_us - event.entry_time_us) / 3600e6;
+        tickets.push_back(event);
+
+        std::ostringstream lines;
+        lines << "Entry: Ticket ID " << event.ticket_id << ", " << toString(event.vehicle_type) << " with license plate " << event.license_plate.view() << '\n'
+              << "Exit: Ticket ID " << event.ticket_id << ", " << toString(event.vehicle_type) << " with license plate " << event.license_plate.view() << '\n';
+        text_size += lines.str().size();
+    }
+    std::sort(tickets.begin(), tickets.end(), [](const ParkingEvent & left, const ParkingEvent & right) { return left.exit_time_us < right.exit_time_us; });
+
+    std::uint64_t export_size = 0;
+    {
+        ColumnarExportWriter writer(export_path);
+        for (const auto & ticket : tickets)
+        {
+            writer.addClosedTicket(ticket);
+        }
+        writer.close();
+        export_size = writer.bytesWritten();
+    }
+    EXPECT_EQ(std::filesystem::file_size(export_path), export_size);
+    EXPECT_LT(export_size * 4, text_size);
+
+    std::size_t rows = 0;
+    std::size_t blocks = 0;
+    {
+        ColumnarExportReader reader(export_path);
+        ExportBlock block;
+        while (reader.readBlock(block))
+        {
+            rows += block.size();
+            ++blocks;
+        }
+    }
+    EXPECT_EQ(rows, kTickets);
+    EXPECT_EQ(blocks, 3u);
+
+    // A crash while the last block was written leaves the complete blocks before it readable
+    std::filesystem::resize_file(export_path, export_size - 100);
+    rows = 0;
+    {
+        ColumnarExportReader reader(export_path);
+        ExportBlock block;
+        while (reader.readBlock(block))
+        {
+            rows += block.size();
+        }
+    }
+    EXPECT_EQ(rows, ColumnarExportWriter::kBlockRows * 2);
+    std::filesystem::remove(export_path);
+    EXPECT_THROW(ColumnarExportReader("columnar_export_missing.plcol"), ExportException);
 }
\ No newline at end of file